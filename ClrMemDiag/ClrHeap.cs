@@ -192,6 +192,151 @@ virtual public ClrType GetTypeByMethodTable(ulong methodTable)
         /// <returns>An enumeration of all objects on the heap.</returns>
         abstract public IEnumerable<ClrObject> EnumerateObjects();
 
+        /// <summary>
+        /// Enumerates all objects on the heap, walking several segments at once on worker threads.
+        /// Each worker reads target memory through its own cache; types are resolved on the thread
+        /// doing the enumerating, as objects are handed back.  Heaps which don't support parallel
+        /// walks simply return EnumerateObjects().
+        /// </summary>
+        /// <param name="degreeOfParallelism">The most segments to walk at a time.  Zero or less means
+        /// one per processor.</param>
+        /// <param name="ordered">True to return objects in address order (the same order as
+        /// EnumerateObjects).  Otherwise objects from different segments are interleaved in
+        /// whatever order the workers find them, which keeps more of the workers busy.</param>
+        /// <returns>An enumeration of all objects on the heap.</returns>
+        virtual public IEnumerable<ClrObject> EnumerateObjects(int degreeOfParallelism, bool ordered)
+        {
+            return EnumerateObjects();
+        }
+
+        /// <summary>
+        /// Counts the objects on the heap and adds up their sizes by type (like !dumpheap -stat).
+        /// Heaps which support it walk segments in parallel, each worker keeping its own tallies,
+        /// which are merged at the end.
+        /// </summary>
+        /// <param name="degreeOfParallelism">The most segments to walk at a time.  Zero or less means
+        /// one per processor.</param>
+        /// <returns>The statistics for each type with objects on the heap, smallest total size first.</returns>
+        public IList<ClrTypeStatistics> GetTypeStatistics(int degreeOfParallelism)
+        {
+            return GetTypeStatistics(degreeOfParallelism, CancellationToken.None);
+        }
+
+        /// <summary>
+        /// Counts the objects on the heap and adds up their sizes by type (like !dumpheap -stat).
+        /// Heaps which support it walk segments in parallel, each worker keeping its own tallies,
+        /// which are merged at the end.
+        /// </summary>
+        /// <param name="degreeOfParallelism">The most segments to walk at a time.  Zero or less means
+        /// one per processor.</param>
+        /// <param name="cancel">Stops the walk (with an OperationCanceledException).</param>
+        /// <returns>The statistics for each type with objects on the heap, smallest total size first.</returns>
+        public IList<ClrTypeStatistics> GetTypeStatistics(int degreeOfParallelism, CancellationToken cancel)
+        {
+            return GetTypeStatistics(degreeOfParallelism, false, cancel);
+        }
+
+        /// <summary>
+        /// Counts the objects on the heap and adds up their sizes by type (like !dumpheap -stat).
+        /// Heaps which support it walk segments in parallel, each worker keeping its own tallies,
+        /// which are merged at the end.
+        /// </summary>
+        /// <remarks>
+        /// Estimating retained sizes takes another pass over the heap first, to find the objects
+        /// which are referred to only once.  That is kept in two bitmaps of heap size / 64 each (on
+        /// 64 bit targets); otherwise memory use is one entry per type.
+        /// </remarks>
+        /// <param name="degreeOfParallelism">The most segments to walk at a time.  Zero or less means
+        /// one per processor.</param>
+        /// <param name="estimateRetainedSizes">Whether to fill in ClrTypeStatistics.RetainedSize.</param>
+        /// <param name="cancel">Stops the walk (with an OperationCanceledException).</param>
+        /// <returns>The statistics for each type with objects on the heap, smallest total size first.</returns>
+        virtual public IList<ClrTypeStatistics> GetTypeStatistics(int degreeOfParallelism, bool estimateRetainedSizes, CancellationToken cancel)
+        {
+            // The references of the current object, each one once.
+            var refs = new List<ulong>();
+            Action<ulong, int> addRef = (r, offset) => refs.Add(r);
+
+            OwnedObjectSet owned = null;
+            int objects = 0;
+            if (estimateRetainedSizes)
+            {
+                owned = new OwnedObjectSet(this);
+                foreach (ClrObject obj in EnumerateObjects())
+                {
+                    if ((objects++ & 0xfff) == 0)
+                        cancel.ThrowIfCancellationRequested();
+
+                    if (obj.Type != null && obj.Type.ContainsPointers)
+                    {
+                        refs.Clear();
+                        obj.Type.EnumerateRefsOfObjectCarefully(obj.Address, addRef);
+                        OwnedObjectSet.RemoveDuplicates(refs);
+                        foreach (ulong r in refs)
+                            owned.AddReference(r);
+                    }
+                }
+
+                owned.AddRoots(this);
+            }
+
+            var stats = new Dictionary<ClrType, ClrTypeStatistics>();
+            objects = 0;
+            foreach (ClrObject obj in EnumerateObjects())
+            {
+                if ((objects++ & 0xfff) == 0)
+                    cancel.ThrowIfCancellationRequested();
+
+                if (obj.Type == null)
+                    continue;
+
+                ClrTypeStatistics entry;
+                if (!stats.TryGetValue(obj.Type, out entry))
+                {
+                    entry = new ClrTypeStatistics(obj.Type);
+                    stats.Add(obj.Type, entry);
+                }
+
+                ulong size = obj.Size;
+                ulong retained = 0;
+                if (owned != null)
+                {
+                    retained = size;
+                    if (obj.Type.ContainsPointers)
+                    {
+                        refs.Clear();
+                        obj.Type.EnumerateRefsOfObjectCarefully(obj.Address, addRef);
+                        OwnedObjectSet.RemoveDuplicates(refs);
+                        foreach (ulong r in refs)
+                        {
+                            if (owned.IsOwned(r))
+                            {
+                                ClrType type = GetObjectType(r);
+                                if (type != null)
+                                    retained += type.GetSize(r);
+                            }
+                        }
+                    }
+                }
+
+                entry.Add(1, size, retained);
+            }
+
+            return ClrTypeStatistics.Sort(stats.Values);
+        }
+
+        /// <summary>
+        /// The number of bytes of target memory each heap keeps cached for reading objects.  Only heaps
+        /// created after this is set are affected.
+        /// </summary>
+        public static int MemoryCacheSize { get; set; } = 0x100000;
+
+        /// <summary>
+        /// How many pages ahead EnumerateObjects and EnumerateObjectAddresses read while walking a
+        /// segment.  Zero turns read-ahead off.
+        /// </summary>
+        public static int ReadAheadPages { get; set; } = 4;
+
         /// <summary>
         /// TotalHeapSize is defined as the sum of the length of all segments.  
         /// </summary>
@@ -271,6 +416,115 @@ public override string ToString()
 
     }
 
+    /// <summary>
+    /// The number of objects of a type on the heap, their total size, and (optionally) an estimate
+    /// of how much memory they keep alive.  Returned by ClrHeap.GetTypeStatistics; can be saved to
+    /// a file and compared with another dump's with ClrHeapHistogram.
+    /// </summary>
+    public class ClrTypeStatistics
+    {
+        private readonly ulong _methodTable;
+        private readonly string _typeName;
+        private readonly string _moduleName;
+
+        /// <summary>
+        /// The type.  Null for statistics loaded from a file (ClrHeapHistogram.Load).
+        /// </summary>
+        public ClrType Type { get; private set; }
+
+        /// <summary>
+        /// The MethodTable of the type.
+        /// </summary>
+        public ulong MethodTable { get { return Type != null ? Type.MethodTable : _methodTable; } }
+
+        /// <summary>
+        /// The name of the type.
+        /// </summary>
+        public string TypeName { get { return Type != null ? Type.Name ?? string.Empty : _typeName; } }
+
+        /// <summary>
+        /// The file name (without directory) of the module which defines the type, or the empty
+        /// string if unknown.
+        /// </summary>
+        public string ModuleName { get { return Type != null ? GetModuleName(Type.Module) : _moduleName; } }
+
+        /// <summary>
+        /// The number of objects of this type on the heap.
+        /// </summary>
+        public long Count { get; private set; }
+
+        /// <summary>
+        /// The sum of the sizes of all objects of this type on the heap.
+        /// </summary>
+        public ulong TotalSize { get; private set; }
+
+        /// <summary>
+        /// An estimate of how much memory the objects of this type keep alive: their own size,
+        /// plus the size of each object which is referred to by one of them and by nothing else.
+        /// Zero unless retained sizes were asked for.
+        /// </summary>
+        public ulong RetainedSize { get; private set; }
+
+        internal ClrTypeStatistics(ClrType type)
+        {
+            Type = type;
+        }
+
+        internal ClrTypeStatistics(ulong methodTable, string typeName, string moduleName, long count, ulong totalSize, ulong retainedSize)
+        {
+            _methodTable = methodTable;
+            _typeName = typeName;
+            _moduleName = moduleName;
+            Count = count;
+            TotalSize = totalSize;
+            RetainedSize = retainedSize;
+        }
+
+        internal void Add(long count, ulong totalSize)
+        {
+            Count += count;
+            TotalSize += totalSize;
+        }
+
+        internal void Add(long count, ulong totalSize, ulong retainedSize)
+        {
+            Count += count;
+            TotalSize += totalSize;
+            RetainedSize += retainedSize;
+        }
+
+        internal static IList<ClrTypeStatistics> Sort(IEnumerable<ClrTypeStatistics> stats)
+        {
+            var result = new List<ClrTypeStatistics>(stats);
+            result.Sort((x, y) =>
+            {
+                int cmp = x.TotalSize.CompareTo(y.TotalSize);
+                return cmp != 0 ? cmp : x.Count.CompareTo(y.Count);
+            });
+            return result;
+        }
+
+        private static string GetModuleName(ClrModule module)
+        {
+            string name = module != null ? module.Name : null;
+            if (string.IsNullOrEmpty(name))
+                return string.Empty;
+
+            // Not Path.GetFileName: module names aren't always valid paths ("<error>").
+            int slash = name.LastIndexOfAny(new char[] { '\\', '/' });
+            return slash >= 0 ? name.Substring(slash + 1) : name;
+        }
+
+        /// <summary>
+        /// Returns a string representation of these statistics, in the style of !dumpheap -stat.
+        /// </summary>
+        /// <returns>A string representation of these statistics.</returns>
+        public override string ToString()
+        {
+            return string.Format("{0:x} {1,10} {2,12} {3}", MethodTable, Count, TotalSize, TypeName);
+        }
+    }
+
     /// <summary>
     /// Represents a managed lock within the runtime.
     /// </summary>
@@ -709,7 +963,7 @@ internal abstract class HeapBase : ClrHeap
         public HeapBase(RuntimeBase runtime)
         {
             _canWalkHeap = runtime.CanWalkHeap;
-            MemoryReader = new MemoryReader(runtime.DataReader, 0x10000);
+            MemoryReader = new MemoryReader(runtime.DataReader, MemoryCacheSize);
             _pointerSize = runtime.PointerSize;
         }
 
@@ -882,11 +1136,13 @@ public override IEnumerable<Address> EnumerateObjectAddresses()
             if (Revision != GetRuntimeRevision())
                 ClrDiagnosticsException.ThrowRevisionError(Revision, GetRuntimeRevision());
 
+            ulong page = 0;
             for (int i = 0; i < _segments.Length; ++i)
             {
                 var seg = _segments[i];
                 for (ulong obj = seg.FirstObjectAddress; obj != 0; obj = seg.NextObject(obj))
                 {
+                    ReadAhead(obj, ref page);
                     _lastSegmentIdx = i;
                     yield return obj;
                 }
@@ -898,17 +1154,34 @@ public override IEnumerable<ClrObject> EnumerateObjects()
             if (Revision != GetRuntimeRevision())
                 ClrDiagnosticsException.ThrowRevisionError(Revision, GetRuntimeRevision());
 
+            ulong page = 0;
             for (int i = 0; i < _segments.Length; ++i)
             {
                 var seg = _segments[i];
                 for (ClrObject obj = seg.FirstObject; !obj.IsNull; obj = seg.GetNextObject(obj))
                 {
+                    ReadAhead(obj.Address, ref page);
                     _lastSegmentIdx = i;
                     yield return obj;
                 }
             }
         }
 
+        /// <summary>
+        /// Segments are walked front to back, so when the walk crosses onto a new page, pull the next
+        /// few pages into the cache with one read instead of missing on each of them in turn.
+        /// </summary>
+        private void ReadAhead(ulong obj, ref ulong page)
+        {
+            ulong curr = obj & ~((ulong)MemoryReader.PageSize - 1);
+            if (curr == page)
+                return;
+
+            page = curr;
+            if (ReadAheadPages > 0)
+                MemoryReader.Prefetch(obj, ReadAheadPages);
+        }
+
         public override ClrSegment GetSegmentByAddress(Address objRef)
         {
             if (_minAddr <= objRef && objRef < _maxAddr)
@@ -1080,6 +1353,11 @@ internal static Address Align(ulong size, bool large)
         }
 
         public override bool IsEphemeral { get { return _segment.Address == _subHeap.EphemeralSegment; ; } }
+
+        /// <summary>
+        /// Allocation contexts on this segment's heap (start -> limit), which the walk skips over.
+        /// </summary>
+        internal Dictionary<ulong, ulong> AllocPointers { get { return _subHeap.AllocPointers; } }
         internal HeapSegment(RuntimeBase clr, ISegmentData segment, SubHeap subHeap, bool large, HeapBase heap)
         {
             _clr = clr;
@@ -0,0 +1,257 @@
+﻿// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Text;
+
+namespace Microsoft.Diagnostics.Runtime
+{
+    /// <summary>
+    /// The change in the objects of one type between two sets of ClrTypeStatistics.
+    /// </summary>
+    public sealed class ClrHeapHistogramDelta
+    {
+        /// <summary>
+        /// The name of the type.
+        /// </summary>
+        public string TypeName { get; private set; }
+
+        /// <summary>
+        /// The file name of the module which defines the type.
+        /// </summary>
+        public string ModuleName { get; private set; }
+
+        /// <summary>
+        /// The number of objects of this type in the baseline.
+        /// </summary>
+        public long BaselineCount { get; private set; }
+
+        /// <summary>
+        /// The number of objects of this type now.
+        /// </summary>
+        public long Count { get; private set; }
+
+        /// <summary>
+        /// The total size of the objects of this type in the baseline.
+        /// </summary>
+        public ulong BaselineTotalSize { get; private set; }
+
+        /// <summary>
+        /// The total size of the objects of this type now.
+        /// </summary>
+        public ulong TotalSize { get; private set; }
+
+        /// <summary>
+        /// The estimated retained size of the objects of this type in the baseline.
+        /// </summary>
+        public ulong BaselineRetainedSize { get; private set; }
+
+        /// <summary>
+        /// The estimated retained size of the objects of this type now.
+        /// </summary>
+        public ulong RetainedSize { get; private set; }
+
+        /// <summary>
+        /// How many more objects of this type there are now (negative if fewer).
+        /// </summary>
+        public long CountDelta { get { return Count - BaselineCount; } }
+
+        /// <summary>
+        /// How much bigger the objects of this type are in total now (negative if smaller).
+        /// </summary>
+        public long TotalSizeDelta { get { return (long)TotalSize - (long)BaselineTotalSize; } }
+
+        /// <summary>
+        /// How much bigger the estimated retained size is now (negative if smaller).
+        /// </summary>
+        public long RetainedSizeDelta { get { return (long)RetainedSize - (long)BaselineRetainedSize; } }
+
+        internal ClrHeapHistogramDelta(string typeName, string moduleName)
+        {
+            TypeName = typeName;
+            ModuleName = moduleName;
+        }
+
+        internal void AddBaseline(ClrTypeStatistics entry)
+        {
+            BaselineCount += entry.Count;
+            BaselineTotalSize += entry.TotalSize;
+            BaselineRetainedSize += entry.RetainedSize;
+        }
+
+        internal void AddCurrent(ClrTypeStatistics entry)
+        {
+            Count += entry.Count;
+            TotalSize += entry.TotalSize;
+            RetainedSize += entry.RetainedSize;
+        }
+
+        /// <summary>
+        /// Returns a string representation of this delta.
+        /// </summary>
+        /// <returns>A string representation of this delta.</returns>
+        public override string ToString()
+        {
+            return string.Format("{0,10:+#;-#;0} {1,14:+#;-#;0} {2}", CountDelta, TotalSizeDelta, TypeName);
+        }
+    }
+
+    /// <summary>
+    /// Saves, loads and compares heap histograms: the ClrTypeStatistics of a heap (like
+    /// !dumpheap -stat).  Histograms can be saved to a file and compared with histograms of
+    /// another dump of the same process (or another process running the same code), to find out
+    /// what is growing.
+    /// </summary>
+    public static class ClrHeapHistogram
+    {
+        private const string FileHeader = "# ClrHeapHistogram 2";
+
+        /// <summary>
+        /// Whether the statistics have retained size estimates.  (Every type with objects has a
+        /// retained size at least as big as its total size, if it has one at all.)
+        /// </summary>
+        /// <param name="stats">The statistics.</param>
+        public static bool HasRetainedSizes(IEnumerable<ClrTypeStatistics> stats)
+        {
+            if (stats == null)
+                throw new ArgumentNullException(nameof(stats));
+
+            foreach (ClrTypeStatistics entry in stats)
+            {
+                if (entry.RetainedSize != 0)
+                    return true;
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Compares two histograms.  Types are matched by name and module file name, so the
+        /// histograms can come from different dumps.  Types may appear more than once in either
+        /// (for instance when there is more than one runtime); their counts and sizes are added up.
+        /// </summary>
+        /// <param name="baseline">The earlier histogram.</param>
+        /// <param name="current">The later histogram.</param>
+        /// <returns>The types whose count or size changed, biggest change in total size first.</returns>
+        public static IList<ClrHeapHistogramDelta> Compare(IEnumerable<ClrTypeStatistics> baseline, IEnumerable<ClrTypeStatistics> current)
+        {
+            if (baseline == null)
+                throw new ArgumentNullException(nameof(baseline));
+
+            if (current == null)
+                throw new ArgumentNullException(nameof(current));
+
+            var deltas = new Dictionary<KeyValuePair<string, string>, ClrHeapHistogramDelta>();
+            foreach (ClrTypeStatistics entry in baseline)
+                GetDelta(deltas, entry).AddBaseline(entry);
+
+            foreach (ClrTypeStatistics entry in current)
+                GetDelta(deltas, entry).AddCurrent(entry);
+
+            var result = new List<ClrHeapHistogramDelta>();
+            foreach (ClrHeapHistogramDelta delta in deltas.Values)
+            {
+                if (delta.CountDelta != 0 || delta.TotalSizeDelta != 0 || delta.RetainedSizeDelta != 0)
+                    result.Add(delta);
+            }
+
+            result.Sort((x, y) =>
+            {
+                int cmp = Math.Abs(y.TotalSizeDelta).CompareTo(Math.Abs(x.TotalSizeDelta));
+                if (cmp == 0)
+                    cmp = Math.Abs(y.CountDelta).CompareTo(Math.Abs(x.CountDelta));
+
+                return cmp != 0 ? cmp : string.CompareOrdinal(x.TypeName, y.TypeName);
+            });
+
+            return result;
+        }
+
+        private static ClrHeapHistogramDelta GetDelta(Dictionary<KeyValuePair<string, string>, ClrHeapHistogramDelta> deltas, ClrTypeStatistics entry)
+        {
+            var key = new KeyValuePair<string, string>(entry.TypeName, entry.ModuleName.ToLowerInvariant());
+
+            ClrHeapHistogramDelta delta;
+            if (!deltas.TryGetValue(key, out delta))
+            {
+                delta = new ClrHeapHistogramDelta(entry.TypeName, entry.ModuleName);
+                deltas.Add(key, delta);
+            }
+
+            return delta;
+        }
+
+        /// <summary>
+        /// Writes the histogram to a file, so it can be compared with histograms of other dumps
+        /// later.
+        /// </summary>
+        /// <param name="stats">The histogram (from ClrHeap.GetTypeStatistics).</param>
+        /// <param name="path">The file to write.</param>
+        public static void Save(IEnumerable<ClrTypeStatistics> stats, string path)
+        {
+            if (stats == null)
+                throw new ArgumentNullException(nameof(stats));
+
+            using (StreamWriter writer = new StreamWriter(path, false, new UTF8Encoding(false)))
+            {
+                writer.WriteLine(FileHeader);
+
+                // The type name goes last, since it's the only field which may contain spaces.
+                foreach (ClrTypeStatistics entry in stats)
+                {
+                    writer.WriteLine(string.Format(CultureInfo.InvariantCulture,
+                                                   "{0:x}\t{1}\t{2}\t{3}\t{4}\t{5}",
+                                                   entry.MethodTable,
+                                                   entry.Count,
+                                                   entry.TotalSize,
+                                                   entry.RetainedSize,
+                                                   entry.ModuleName,
+                                                   entry.TypeName));
+                }
+            }
+        }
+
+        /// <summary>
+        /// Reads a histogram written by Save.  The entries of the result have no Type.
+        /// </summary>
+        /// <param name="path">The file to read.</param>
+        /// <returns>The statistics, smallest total size first.</returns>
+        public static IList<ClrTypeStatistics> Load(string path)
+        {
+            using (StreamReader reader = new StreamReader(path, Encoding.UTF8))
+            {
+                if (reader.ReadLine() != FileHeader)
+                    throw new InvalidDataException(string.Format("'{0}' is not a heap histogram file.", path));
+
+                var entries = new List<ClrTypeStatistics>();
+                string line;
+                int lineNumber = 1;
+                while ((line = reader.ReadLine()) != null)
+                {
+                    lineNumber++;
+                    if (line.Length == 0)
+                        continue;
+
+                    string[] fields = line.Split(new char[] { '\t' }, 6);
+                    ulong mt, totalSize, retainedSize;
+                    long count;
+                    if (fields.Length != 6 ||
+                        !ulong.TryParse(fields[0], NumberStyles.HexNumber, CultureInfo.InvariantCulture, out mt) ||
+                        !long.TryParse(fields[1], NumberStyles.None, CultureInfo.InvariantCulture, out count) ||
+                        !ulong.TryParse(fields[2], NumberStyles.None, CultureInfo.InvariantCulture, out totalSize) ||
+                        !ulong.TryParse(fields[3], NumberStyles.None, CultureInfo.InvariantCulture, out retainedSize))
+                    {
+                        throw new InvalidDataException(string.Format("'{0}', line {1}: bad histogram entry.", path, lineNumber));
+                    }
+
+                    entries.Add(new ClrTypeStatistics(mt, fields[5], fields[4], count, totalSize, retainedSize));
+                }
+
+                return ClrTypeStatistics.Sort(entries);
+            }
+        }
+    }
+}
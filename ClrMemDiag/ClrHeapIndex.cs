@@ -0,0 +1,773 @@
+﻿// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Threading;
+using Microsoft.Diagnostics.Runtime.Desktop;
+using Address = System.UInt64;
+
+namespace Microsoft.Diagnostics.Runtime
+{
+    /// <summary>
+    /// A compact, memory-mapped index of every object on a heap: its address, MethodTable,
+    /// size and outbound references.  Building one walks the whole heap once; after that, heap
+    /// queries (enumerating objects, type statistics, following references) read the index
+    /// instead of the target.
+    ///
+    /// Only makes sense for a heap that doesn't change (a dump).  The caller supplies an id for
+    /// the source of the heap (a dump's identity, say), which is stored in the file; an index
+    /// whose id, pointer size or segment layout doesn't match the heap is treated as stale.
+    /// </summary>
+    /// <remarks>
+    /// The file format (version 1) is a header followed by columns, one element per object, in
+    /// address order:
+    ///
+    ///    Header (128 bytes):
+    ///       uint   magic ("DSHI")
+    ///       uint   version
+    ///       Guid   source id
+    ///       int    pointer size
+    ///       int    number of segments
+    ///       ulong  total heap size
+    ///       int    number of objects
+    ///       int    flags (1: has component MethodTables)
+    ///       long   number of references
+    ///       long   offsets of the address, MethodTable, component MethodTable, reference
+    ///              start, size and reference columns
+    ///    Addresses:           ulong per object
+    ///    MethodTables:        ulong per object
+    ///    Component MTs:       ulong per object (only if the heap has component MethodTables)
+    ///    Reference starts:    long per object, plus one (CSR: object i's references are
+    ///                         [start[i], start[i + 1]) in the reference column)
+    ///    Sizes:               uint per object (uint.MaxValue means "too big; ask the type")
+    ///    References:          int per reference: the index of the referenced object, or -1 if
+    ///                         the reference doesn't point at the start of an indexed object
+    /// </remarks>
+    public sealed class ClrHeapIndex : IDisposable
+    {
+        private const uint Magic = 0x49485344; // "DSHI"
+        private const uint Version = 1;
+        private const int HeaderSize = 128;
+        private const int FlagHasComponentMTs = 1;
+
+        private readonly ClrHeap _heap;
+        private readonly DesktopGCHeap _desktopHeap;
+        private MemoryMappedFile _map;
+        private MemoryMappedViewAccessor _view;
+        private unsafe byte* _base;
+
+        private int _count;
+        private long _refCount;
+        private unsafe ulong* _addresses;
+        private unsafe ulong* _methodTables;
+        private unsafe ulong* _componentMTs;
+        private unsafe long* _refStarts;
+        private unsafe uint* _sizes;
+        private unsafe int* _refs;
+
+        /// <summary>
+        /// The heap this index describes.
+        /// </summary>
+        public ClrHeap Heap { get { return _heap; } }
+
+        /// <summary>
+        /// The path of the index file.
+        /// </summary>
+        public string Path { get; private set; }
+
+        /// <summary>
+        /// The number of objects in the index.
+        /// </summary>
+        public int Count { get { return _count; } }
+
+        /// <summary>
+        /// The total number of references between objects in the index.
+        /// </summary>
+        public long ReferenceCount { get { return _refCount; } }
+
+        private ClrHeapIndex(ClrHeap heap, string path)
+        {
+            _heap = heap;
+            _desktopHeap = heap as DesktopGCHeap;
+            Path = path;
+        }
+
+        /// <summary>
+        /// Opens an existing index for the given heap.
+        /// </summary>
+        /// <param name="heap">The heap the index describes.</param>
+        /// <param name="path">The index file.</param>
+        /// <param name="sourceId">Identifies what the heap came from; must match the id the index was built with.</param>
+        /// <returns>The index, or null if the file doesn't exist, or is stale or corrupt.</returns>
+        public static ClrHeapIndex TryOpen(ClrHeap heap, string path, Guid sourceId)
+        {
+            if (heap == null)
+                throw new ArgumentNullException(nameof(heap));
+
+            if (path == null)
+                throw new ArgumentNullException(nameof(path));
+
+            if (!File.Exists(path))
+                return null;
+
+            var index = new ClrHeapIndex(heap, path);
+            try
+            {
+                if (index.Open(sourceId))
+                    return index;
+            }
+            catch (IOException)
+            {
+            }
+            catch (UnauthorizedAccessException)
+            {
+            }
+
+            index.Dispose();
+            return null;
+        }
+
+        /// <summary>
+        /// Walks the heap and writes an index of it to the given file (replacing anything already
+        /// there), then opens it.
+        /// </summary>
+        /// <param name="heap">The heap to index.</param>
+        /// <param name="path">The index file to write.</param>
+        /// <param name="sourceId">Identifies what the heap came from (a dump, for instance).</param>
+        /// <returns>The new index.</returns>
+        public static ClrHeapIndex Build(ClrHeap heap, string path, Guid sourceId)
+        {
+            if (heap == null)
+                throw new ArgumentNullException(nameof(heap));
+
+            if (path == null)
+                throw new ArgumentNullException(nameof(path));
+
+            if (!heap.CanWalkHeap)
+                throw new InvalidOperationException("The heap is not in a walkable state.");
+
+            // Each column goes to its own scratch file as we walk the heap (holding them in
+            // memory would take ~30 bytes per object, which is more than we can have on a big
+            // heap), and they are stitched together afterwards.  The finished index is written
+            // next to the real one and then swapped into place, so a reader never sees half
+            // of one.
+            string tmpPath = path + ".tmp";
+            var scratch = new ScratchColumns(path, heap.HasComponentMethodTables);
+            try
+            {
+                int count = 0;
+                long refCount = 0;
+                ulong prev = 0;
+
+                using (scratch)
+                {
+                    // References can't be turned into object indices until we have seen every
+                    // object, so they are kept as addresses in the meantime.
+                    Action<Address, int> addRef = (address, offset) =>
+                    {
+                        scratch.Refs.Write(address);
+                        refCount++;
+                    };
+
+                    foreach (ClrObject obj in heap.EnumerateObjects(0, ordered: true))
+                    {
+                        ulong mt, cmt;
+                        if (!heap.TryGetMethodTable(obj.Address, out mt, out cmt))
+                            continue;
+
+                        if (count == int.MaxValue)
+                            throw new InvalidOperationException("The heap has too many objects to index.");
+
+                        if (count > 0 && obj.Address <= prev)
+                            throw new InvalidOperationException("The heap walk did not produce objects in address order.");
+
+                        prev = obj.Address;
+                        count++;
+
+                        scratch.Addresses.Write(obj.Address);
+                        scratch.MethodTables.Write(mt);
+                        scratch.ComponentMTs?.Write(cmt);
+
+                        ulong size = obj.Type != null ? obj.Type.GetSize(obj.Address) : 0;
+                        scratch.Sizes.Write(size < uint.MaxValue ? (uint)size : uint.MaxValue);
+
+                        scratch.RefStarts.Write(refCount);
+                        if (obj.Type != null && obj.Type.ContainsPointers)
+                            obj.Type.EnumerateRefsOfObjectCarefully(obj.Address, addRef);
+                    }
+
+                    scratch.RefStarts.Write(refCount);
+                }
+
+                Write(heap, tmpPath, scratch, sourceId, count, refCount);
+
+                if (File.Exists(path))
+                    File.Replace(tmpPath, path, null);
+                else
+                    File.Move(tmpPath, path);
+            }
+            finally
+            {
+                scratch.Delete();
+                File.Delete(tmpPath);
+            }
+
+            var index = new ClrHeapIndex(heap, path);
+            if (!index.Open(sourceId))
+            {
+                index.Dispose();
+                throw new InvalidDataException("Could not read back the heap index just written to " + path + ".");
+            }
+
+            return index;
+        }
+
+        /// <summary>
+        /// The scratch files Build writes each column to while it walks the heap.
+        /// </summary>
+        private sealed class ScratchColumns : IDisposable
+        {
+            private readonly string[] _paths;
+            public readonly BinaryWriter Addresses;
+            public readonly BinaryWriter MethodTables;
+            public readonly BinaryWriter ComponentMTs;
+            public readonly BinaryWriter RefStarts;
+            public readonly BinaryWriter Sizes;
+            public readonly BinaryWriter Refs;
+
+            public ScratchColumns(string path, bool hasComponentMTs)
+            {
+                _paths = new string[] { path + ".addr.tmp", path + ".mt.tmp", path + ".cmt.tmp", path + ".starts.tmp", path + ".size.tmp", path + ".refs.tmp" };
+                try
+                {
+                    Addresses = Create(_paths[0]);
+                    MethodTables = Create(_paths[1]);
+                    ComponentMTs = hasComponentMTs ? Create(_paths[2]) : null;
+                    RefStarts = Create(_paths[3]);
+                    Sizes = Create(_paths[4]);
+                    Refs = Create(_paths[5]);
+                }
+                catch
+                {
+                    Dispose();
+                    Delete();
+                    throw;
+                }
+            }
+
+            public string AddressesPath { get { return _paths[0]; } }
+            public string RefsPath { get { return _paths[5]; } }
+
+            /// <summary>
+            /// The columns that are copied into the index as-is, in file order.
+            /// </summary>
+            public IEnumerable<string> PlainColumnPaths
+            {
+                get
+                {
+                    yield return _paths[0];
+                    yield return _paths[1];
+                    if (ComponentMTs != null)
+                        yield return _paths[2];
+                    yield return _paths[3];
+                    yield return _paths[4];
+                }
+            }
+
+            private static BinaryWriter Create(string path)
+            {
+                return new BinaryWriter(new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.None, 1 << 16));
+            }
+
+            public void Dispose()
+            {
+                Addresses?.Dispose();
+                MethodTables?.Dispose();
+                ComponentMTs?.Dispose();
+                RefStarts?.Dispose();
+                Sizes?.Dispose();
+                Refs?.Dispose();
+            }
+
+            public void Delete()
+            {
+                foreach (string path in _paths)
+                    File.Delete(path);
+            }
+        }
+
+        private static unsafe void Write(ClrHeap heap, string path, ScratchColumns scratch, Guid sourceId, int count, long refCount)
+        {
+            bool hasComponentMTs = scratch.ComponentMTs != null;
+            long addressesOffset = HeaderSize;
+            long methodTablesOffset = addressesOffset + (long)count * 8;
+            long componentMTsOffset = hasComponentMTs ? methodTablesOffset + (long)count * 8 : 0;
+            long refStartsOffset = methodTablesOffset + (long)count * 8 + (hasComponentMTs ? (long)count * 8 : 0);
+            long sizesOffset = refStartsOffset + ((long)count + 1) * 8;
+            long refsOffset = sizesOffset + (long)count * 4;
+
+            using (var writer = new BinaryWriter(new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.None, 1 << 16)))
+            {
+                writer.Write(Magic);
+                writer.Write(Version);
+                writer.Write(sourceId.ToByteArray());
+                writer.Write(heap.PointerSize);
+                writer.Write(heap.Segments.Count);
+                writer.Write(heap.TotalHeapSize);
+                writer.Write(count);
+                writer.Write(hasComponentMTs ? FlagHasComponentMTs : 0);
+                writer.Write(refCount);
+                writer.Write(addressesOffset);
+                writer.Write(methodTablesOffset);
+                writer.Write(componentMTsOffset);
+                writer.Write(refStartsOffset);
+                writer.Write(sizesOffset);
+                writer.Write(refsOffset);
+                writer.Write(new byte[HeaderSize - writer.BaseStream.Position]);
+                writer.Flush();
+
+                foreach (string column in scratch.PlainColumnPaths)
+                {
+                    using (var fs = new FileStream(column, FileMode.Open, FileAccess.Read, FileShare.None, 1 << 16))
+                        fs.CopyTo(writer.BaseStream);
+                }
+
+                if (refCount == 0)
+                    return;
+
+                // The address column is sorted, so the references can be translated with a
+                // binary search of it, straight out of the scratch file.
+                using (var map = MemoryMappedFile.CreateFromFile(scratch.AddressesPath, FileMode.Open, null, 0, MemoryMappedFileAccess.Read))
+                using (var view = map.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read))
+                using (var refs = new BinaryReader(new FileStream(scratch.RefsPath, FileMode.Open, FileAccess.Read, FileShare.None, 1 << 16)))
+                {
+                    byte* p = null;
+                    view.SafeMemoryMappedViewHandle.AcquirePointer(ref p);
+                    try
+                    {
+                        ulong* sorted = (ulong*)(p + view.PointerOffset);
+                        for (long i = 0; i < refCount; i++)
+                            writer.Write(BinarySearch(sorted, count, refs.ReadUInt64()));
+                    }
+                    finally
+                    {
+                        view.SafeMemoryMappedViewHandle.ReleasePointer();
+                    }
+                }
+            }
+        }
+
+        private static unsafe int BinarySearch(ulong* sorted, int count, ulong address)
+        {
+            int lo = 0;
+            int hi = count - 1;
+            while (lo <= hi)
+            {
+                int mid = lo + ((hi - lo) >> 1);
+                ulong curr = sorted[mid];
+                if (curr == address)
+                    return mid;
+                else if (curr < address)
+                    lo = mid + 1;
+                else
+                    hi = mid - 1;
+            }
+
+            return -1;
+        }
+
+        private unsafe bool Open(Guid sourceId)
+        {
+            var fs = new FileStream(Path, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete);
+            long length = fs.Length;
+            if (length < HeaderSize)
+            {
+                fs.Dispose();
+                return false;
+            }
+
+            _map = MemoryMappedFile.CreateFromFile(fs, null, 0, MemoryMappedFileAccess.Read, HandleInheritability.None, false);
+            _view = _map.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+            byte* p = null;
+            _view.SafeMemoryMappedViewHandle.AcquirePointer(ref p);
+            _base = p + _view.PointerOffset;
+
+            if (*(uint*)_base != Magic || *(uint*)(_base + 4) != Version || *(Guid*)(_base + 8) != sourceId)
+                return false;
+
+            if (*(int*)(_base + 24) != _heap.PointerSize ||
+                *(int*)(_base + 28) != _heap.Segments.Count ||
+                *(ulong*)(_base + 32) != _heap.TotalHeapSize)
+            {
+                return false;
+            }
+
+            int count = *(int*)(_base + 40);
+            bool hasComponentMTs = (*(int*)(_base + 44) & FlagHasComponentMTs) != 0;
+            long refCount = *(long*)(_base + 48);
+            long* offsets = (long*)(_base + 56);
+            if (count < 0 || refCount < 0 || hasComponentMTs != _heap.HasComponentMethodTables)
+                return false;
+
+            // Every column has to fit in the file.
+            if (!Fits(offsets[0], count, 8, length) ||
+                !Fits(offsets[1], count, 8, length) ||
+                (hasComponentMTs && !Fits(offsets[2], count, 8, length)) ||
+                !Fits(offsets[3], (long)count + 1, 8, length) ||
+                !Fits(offsets[4], count, 4, length) ||
+                !Fits(offsets[5], refCount, 4, length))
+            {
+                return false;
+            }
+
+            _count = count;
+            _refCount = refCount;
+            _addresses = (ulong*)(_base + offsets[0]);
+            _methodTables = (ulong*)(_base + offsets[1]);
+            _componentMTs = hasComponentMTs ? (ulong*)(_base + offsets[2]) : null;
+            _refStarts = (long*)(_base + offsets[3]);
+            _sizes = (uint*)(_base + offsets[4]);
+            _refs = (int*)(_base + offsets[5]);
+
+            return Validate();
+        }
+
+        /// <summary>
+        /// Checks the parts of the index that lookups depend on to stay inside the file: the
+        /// objects are in address order, and each object's reference range is in order and
+        /// inside the reference column.  (The references themselves are too many to check up
+        /// front; GetReferenceAt checks each one as it is read.)
+        /// </summary>
+        private unsafe bool Validate()
+        {
+            if (_refStarts[0] != 0 || _refStarts[_count] != _refCount)
+                return false;
+
+            for (int i = 0; i < _count; i++)
+            {
+                if (_refStarts[i + 1] < _refStarts[i] || _refStarts[i + 1] - _refStarts[i] > int.MaxValue)
+                    return false;
+
+                if (i > 0 && _addresses[i] <= _addresses[i - 1])
+                    return false;
+            }
+
+            return true;
+        }
+
+        private static bool Fits(long offset, long count, int elementSize, long length)
+        {
+            return offset >= HeaderSize && offset <= length && count <= (length - offset) / elementSize;
+        }
+
+        /// <summary>
+        /// Closes the index file.
+        /// </summary>
+        public unsafe void Dispose()
+        {
+            if (_view != null)
+            {
+                if (_base != null)
+                    _view.SafeMemoryMappedViewHandle.ReleasePointer();
+
+                _view.Dispose();
+                _view = null;
+            }
+
+            if (_map != null)
+            {
+                _map.Dispose();
+                _map = null;
+            }
+
+            _base = null;
+            _count = 0;
+            _refCount = 0;
+        }
+
+        private unsafe void CheckIndex(int index)
+        {
+            if (_base == null)
+                throw new ObjectDisposedException(nameof(ClrHeapIndex));
+
+            if ((uint)index >= (uint)_count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+        }
+
+        /// <summary>
+        /// Returns the address of the object at the given index.
+        /// </summary>
+        public unsafe ulong GetAddress(int index)
+        {
+            CheckIndex(index);
+            return _addresses[index];
+        }
+
+        /// <summary>
+        /// Returns the MethodTable of the object at the given index.
+        /// </summary>
+        public unsafe ulong GetMethodTable(int index)
+        {
+            CheckIndex(index);
+            return _methodTables[index];
+        }
+
+        /// <summary>
+        /// Returns the component MethodTable of the object at the given index (0 if it doesn't
+        /// have one, or if the heap doesn't have component MethodTables).
+        /// </summary>
+        public unsafe ulong GetComponentMethodTable(int index)
+        {
+            CheckIndex(index);
+            return _componentMTs != null ? _componentMTs[index] : 0;
+        }
+
+        /// <summary>
+        /// Returns the size of the object at the given index.
+        /// </summary>
+        public unsafe ulong GetSize(int index)
+        {
+            CheckIndex(index);
+            uint size = _sizes[index];
+            if (size != uint.MaxValue)
+                return size;
+
+            ClrType type = GetObjectType(index);
+            return type != null ? type.GetSize(_addresses[index]) : 0;
+        }
+
+        /// <summary>
+        /// Returns the type of the object at the given index.
+        /// </summary>
+        public unsafe ClrType GetObjectType(int index)
+        {
+            CheckIndex(index);
+            return GetTypeByMethodTable(_methodTables[index], _componentMTs != null ? _componentMTs[index] : 0, _addresses[index]);
+        }
+
+        private ClrType GetTypeByMethodTable(ulong mt, ulong cmt, ulong obj)
+        {
+            if (_desktopHeap != null)
+                return _desktopHeap.GetTypeByMethodTable(mt, cmt, obj);
+
+            return _heap.GetTypeByMethodTable(mt, cmt);
+        }
+
+        /// <summary>
+        /// Returns the ClrObject at the given index.
+        /// </summary>
+        public unsafe ClrObject GetObject(int index)
+        {
+            CheckIndex(index);
+            return ClrObject.Create(_addresses[index], GetObjectType(index));
+        }
+
+        /// <summary>
+        /// Finds the index of the object that starts at the given address.
+        /// </summary>
+        /// <returns>The index of the object, or -1 if no indexed object starts there.</returns>
+        public unsafe int IndexOf(ulong address)
+        {
+            if (_base == null)
+                throw new ObjectDisposedException(nameof(ClrHeapIndex));
+
+            return BinarySearch(_addresses, _count, address);
+        }
+
+        /// <summary>
+        /// Returns the number of references the object at the given index has (including any
+        /// which don't point at indexed objects).
+        /// </summary>
+        public unsafe int GetReferenceCount(int index)
+        {
+            CheckIndex(index);
+            return (int)(_refStarts[index + 1] - _refStarts[index]);
+        }
+
+        /// <summary>
+        /// Enumerates the indices of the objects the object at the given index refers to.
+        /// References which don't point at an indexed object are skipped.
+        /// </summary>
+        public unsafe IEnumerable<int> EnumerateReferences(int index)
+        {
+            CheckIndex(index);
+            return EnumerateReferences(_refStarts[index], _refStarts[index + 1]);
+        }
+
+        private IEnumerable<int> EnumerateReferences(long start, long end)
+        {
+            for (long i = start; i < end; i++)
+            {
+                int target = GetReferenceAt(i);
+                if (target >= 0)
+                    yield return target;
+            }
+        }
+
+        /// <summary>
+        /// The raw reference column, for traversals that don't want an enumerator per object:
+        /// object 'index' refers to reference slots [start, end), and GetReferenceAt returns the
+        /// target index of a slot (or -1).
+        /// </summary>
+        internal unsafe void GetReferenceRange(int index, out long start, out long end)
+        {
+            CheckIndex(index);
+            start = _refStarts[index];
+            end = _refStarts[index + 1];
+        }
+
+        internal unsafe int GetReferenceAt(long slot)
+        {
+            if (_base == null)
+                throw new ObjectDisposedException(nameof(ClrHeapIndex));
+
+            if ((ulong)slot >= (ulong)_refCount)
+                throw new ArgumentOutOfRangeException(nameof(slot));
+
+            int target = _refs[slot];
+            if (target < -1 || target >= _count)
+                throw new InvalidDataException("The heap index " + Path + " is corrupt: reference " + slot + " is to object " + target + ", but there are only " + _count + ".");
+
+            return target;
+        }
+
+        /// <summary>
+        /// Enumerates all objects in the index, in address order.
+        /// </summary>
+        public IEnumerable<ClrObject> EnumerateObjects()
+        {
+            for (int i = 0; i < _count; i++)
+                yield return GetObject(i);
+        }
+
+        /// <summary>
+        /// Counts the objects in the index and adds up their sizes, by type.
+        /// </summary>
+        /// <returns>The statistics for each type, smallest total size first.</returns>
+        public IList<ClrTypeStatistics> GetTypeStatistics()
+        {
+            return GetTypeStatistics(CancellationToken.None);
+        }
+
+        /// <summary>
+        /// Counts the objects in the index and adds up their sizes, by type.
+        /// </summary>
+        /// <param name="cancel">Stops the count (with an OperationCanceledException).</param>
+        /// <returns>The statistics for each type, smallest total size first.</returns>
+        public IList<ClrTypeStatistics> GetTypeStatistics(CancellationToken cancel)
+        {
+            return GetTypeStatistics(false, cancel);
+        }
+
+        /// <summary>
+        /// Counts the objects in the index and adds up their sizes, by type.  Estimating retained
+        /// sizes takes an extra byte per object, to count each object's referrers.
+        /// </summary>
+        /// <param name="estimateRetainedSizes">Whether to fill in ClrTypeStatistics.RetainedSize.</param>
+        /// <param name="cancel">Stops the count (with an OperationCanceledException).</param>
+        /// <returns>The statistics for each type, smallest total size first.</returns>
+        public unsafe IList<ClrTypeStatistics> GetTypeStatistics(bool estimateRetainedSizes, CancellationToken cancel)
+        {
+            if (_base == null)
+                throw new ObjectDisposedException(nameof(ClrHeapIndex));
+
+            // References in the index are already object indices, so there's no need to find
+            // segments or types for them.  0: unreferenced; 1: one referrer; 2: more than one (or
+            // a root).  An object referring to another through several fields counts once.
+            byte[] referrers = null;
+            var targets = new List<int>();
+            if (estimateRetainedSizes)
+            {
+                referrers = new byte[_count];
+                for (int i = 0; i < _count; i++)
+                {
+                    if ((i & 0xffff) == 0)
+                        cancel.ThrowIfCancellationRequested();
+
+                    GetDistinctReferences(i, targets);
+                    foreach (int target in targets)
+                    {
+                        if (referrers[target] < 2)
+                            referrers[target]++;
+                    }
+                }
+
+                foreach (ClrRoot root in Heap.EnumerateRoots())
+                {
+                    int target = IndexOf(root.Object);
+                    if (target >= 0)
+                        referrers[target] = 2;
+                }
+            }
+
+            // Sizes are all in the index, so the types only need resolving once per MethodTable.
+            var tallies = new Dictionary<KeyValuePair<ulong, ulong>, ClrTypeStatistics>();
+            var stats = new Dictionary<ClrType, ClrTypeStatistics>();
+            for (int i = 0; i < _count; i++)
+            {
+                if ((i & 0xffff) == 0)
+                    cancel.ThrowIfCancellationRequested();
+
+                ulong cmt = _componentMTs != null ? _componentMTs[i] : 0;
+                var key = new KeyValuePair<ulong, ulong>(_methodTables[i], cmt);
+
+                ClrTypeStatistics entry;
+                if (!tallies.TryGetValue(key, out entry))
+                {
+                    ClrType type = GetTypeByMethodTable(key.Key, key.Value, 0);
+                    if (type != null && !stats.TryGetValue(type, out entry))
+                    {
+                        entry = new ClrTypeStatistics(type);
+                        stats.Add(type, entry);
+                    }
+
+                    tallies.Add(key, entry);
+                }
+
+                if (entry == null)
+                    continue;
+
+                ulong size = GetSize(i);
+                ulong retained = 0;
+                if (referrers != null)
+                {
+                    retained = size;
+
+                    GetDistinctReferences(i, targets);
+                    foreach (int target in targets)
+                    {
+                        if (referrers[target] == 1)
+                            retained += GetSize(target);
+                    }
+                }
+
+                entry.Add(1, size, retained);
+            }
+
+            return ClrTypeStatistics.Sort(stats.Values);
+        }
+
+        /// <summary>
+        /// Fills targets with the indices of the objects that object 'index' refers to, each
+        /// one once.
+        /// </summary>
+        private void GetDistinctReferences(int index, List<int> targets)
+        {
+            targets.Clear();
+
+            long start, end;
+            GetReferenceRange(index, out start, out end);
+            for (long slot = start; slot < end; slot++)
+            {
+                int target = GetReferenceAt(slot);
+                if (target >= 0)
+                    targets.Add(target);
+            }
+
+            OwnedObjectSet.RemoveDuplicates(targets);
+        }
+    }
+}
@@ -7,6 +7,7 @@
 using System.Diagnostics;
 using System.IO;
 using System.Text;
+using System.Threading;
 using Address = System.UInt64;
 
 namespace Microsoft.Diagnostics.Runtime.Desktop
@@ -49,6 +50,28 @@ public override ClrRuntime Runtime
             }
         }
 
+        public override IEnumerable<ClrObject> EnumerateObjects(int degreeOfParallelism, bool ordered)
+        {
+            if (Revision != GetRuntimeRevision())
+                ClrDiagnosticsException.ThrowRevisionError(Revision, GetRuntimeRevision());
+
+            if (!ParallelHeapWalker.CanWalk(this))
+                return EnumerateObjects();
+
+            return new ParallelHeapWalker(this, degreeOfParallelism).EnumerateObjects(ordered);
+        }
+
+        public override IList<ClrTypeStatistics> GetTypeStatistics(int degreeOfParallelism, bool estimateRetainedSizes, CancellationToken cancel)
+        {
+            if (Revision != GetRuntimeRevision())
+                ClrDiagnosticsException.ThrowRevisionError(Revision, GetRuntimeRevision());
+
+            if (!ParallelHeapWalker.CanWalk(this))
+                return base.GetTypeStatistics(degreeOfParallelism, estimateRetainedSizes, cancel);
+
+            return new ParallelHeapWalker(this, degreeOfParallelism).GetTypeStatistics(estimateRetainedSizes, cancel);
+        }
+
         public override ClrException GetExceptionObject(Address objRef)
         {
             ClrType type = GetObjectType(objRef);
@@ -0,0 +1,483 @@
+﻿// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Runtime.ExceptionServices;
+using System.Threading;
+using System.Threading.Tasks;
+using Address = System.UInt64;
+
+namespace Microsoft.Diagnostics.Runtime.Desktop
+{
+    /// <summary>
+    /// Walks the segments of a desktop GC heap on several threads at once.
+    ///
+    /// Nothing the workers do touches the heap's own state (its memory cache, type tables, last
+    /// object, etc.) or the DAC, none of which are thread safe.  Instead each worker gets its own
+    /// RawObjectReader, which works out object sizes from the MethodTable in target memory.  The
+    /// workers hand back (address, MethodTable, component MethodTable) triples, and ClrTypes are
+    /// resolved from those on the calling thread.
+    ///
+    /// For dumps, the data reader reads from the mapped dump file, which is safe to do from any
+    /// thread (and doesn't need the dbgeng thread).
+    ///
+    /// RawObjectReader only understands v4+ MethodTables; v2 heaps are walked the ordinary way.
+    /// </summary>
+    internal sealed class ParallelHeapWalker
+    {
+        private const int BatchSize = 4096;
+        private const int QueueDepth = 8;
+
+        private readonly DesktopGCHeap _heap;
+        private readonly SegmentInfo[] _segments;
+        private readonly int _workerCount;
+        private readonly int _pointerSize;
+
+        private struct SegmentInfo
+        {
+            public ulong Start;
+            public ulong End;
+            public bool Large;
+            public Dictionary<ulong, ulong> AllocPointers;
+        }
+
+        private struct TypeKey : IEquatable<TypeKey>
+        {
+            public readonly ulong MethodTable;
+            public readonly ulong ComponentMethodTable;
+
+            public TypeKey(ulong mt, ulong cmt)
+            {
+                MethodTable = mt;
+                ComponentMethodTable = cmt;
+            }
+
+            public bool Equals(TypeKey other)
+            {
+                return MethodTable == other.MethodTable && ComponentMethodTable == other.ComponentMethodTable;
+            }
+
+            public override bool Equals(object obj)
+            {
+                return obj is TypeKey && Equals((TypeKey)obj);
+            }
+
+            public override int GetHashCode()
+            {
+                return (MethodTable ^ (ComponentMethodTable << 3)).GetHashCode();
+            }
+        }
+
+        private sealed class Tally
+        {
+            public long Count;
+            public ulong TotalSize;
+            public ulong RetainedSize;
+        }
+
+        /// <summary>
+        /// Objects found by a worker, as parallel arrays.
+        /// </summary>
+        private sealed class ObjectBatch
+        {
+            public readonly ulong[] Addresses = new ulong[BatchSize];
+            public readonly ulong[] MethodTables = new ulong[BatchSize];
+            public readonly ulong[] ComponentMethodTables = new ulong[BatchSize];
+            public int Count;
+        }
+
+        public ParallelHeapWalker(DesktopGCHeap heap, int degreeOfParallelism)
+        {
+            _heap = heap;
+            _pointerSize = heap.PointerSize;
+
+            // Gather everything the workers need up front, on this thread.
+            IList<ClrSegment> segments = heap.Segments;
+            _segments = new SegmentInfo[segments.Count];
+            for (int i = 0; i < _segments.Length; i++)
+            {
+                HeapSegment seg = (HeapSegment)segments[i];
+                _segments[i].Start = seg.Gen2Start;
+                _segments[i].End = seg.End;
+                _segments[i].Large = seg.IsLarge;
+                _segments[i].AllocPointers = seg.AllocPointers;
+            }
+
+            if (degreeOfParallelism <= 0)
+                degreeOfParallelism = Environment.ProcessorCount;
+
+            _workerCount = Math.Max(1, Math.Min(degreeOfParallelism, _segments.Length));
+        }
+
+        public static bool CanWalk(DesktopGCHeap heap)
+        {
+            return RawObjectReader.CanRead(heap);
+        }
+
+        public IList<ClrTypeStatistics> GetTypeStatistics(bool estimateRetainedSizes, CancellationToken cancel)
+        {
+            // Retained sizes need to know which objects have just one referrer before the
+            // tallying pass starts, so that takes a pass of its own.
+            OwnedObjectSet owned = null;
+            if (estimateRetainedSizes)
+            {
+                owned = new OwnedObjectSet(_heap);
+                WalkAll((walker, worker, seg) => walker.Walk(seg, null, null, cancel, null, owned));
+                owned.AddRoots(_heap);
+            }
+
+            var tallies = new Dictionary<TypeKey, Tally>[_workerCount];
+            for (int w = 0; w < tallies.Length; w++)
+                tallies[w] = new Dictionary<TypeKey, Tally>();
+
+            WalkAll((walker, worker, seg) => walker.Walk(seg, tallies[worker], null, cancel, null, owned));
+
+            // Merge, then resolve types here, where it's safe to use the heap.  Different handles
+            // can map to the same ClrType, so merge once more by type.
+            var merged = new Dictionary<TypeKey, Tally>();
+            foreach (var workerTallies in tallies)
+            {
+                foreach (var kv in workerTallies)
+                {
+                    Tally tally;
+                    if (!merged.TryGetValue(kv.Key, out tally))
+                    {
+                        tally = new Tally();
+                        merged.Add(kv.Key, tally);
+                    }
+
+                    tally.Count += kv.Value.Count;
+                    tally.TotalSize += kv.Value.TotalSize;
+                    tally.RetainedSize += kv.Value.RetainedSize;
+                }
+            }
+
+            var stats = new Dictionary<ClrType, ClrTypeStatistics>();
+            foreach (var kv in merged)
+            {
+                ClrType type = _heap.GetTypeByMethodTable(kv.Key.MethodTable, kv.Key.ComponentMethodTable, 0);
+                if (type == null)
+                    continue;
+
+                ClrTypeStatistics entry;
+                if (!stats.TryGetValue(type, out entry))
+                {
+                    entry = new ClrTypeStatistics(type);
+                    stats.Add(type, entry);
+                }
+
+                entry.Add(kv.Value.Count, kv.Value.TotalSize, kv.Value.RetainedSize);
+            }
+
+            return ClrTypeStatistics.Sort(stats.Values);
+        }
+
+        /// <summary>
+        /// Calls walk for every segment, biggest first, from _workerCount threads.  Workers have
+        /// nobody waiting on their output, so the big segments going first keeps the last one to
+        /// finish from running on alone.
+        /// </summary>
+        private void WalkAll(Action<SegmentWalker, int, SegmentInfo> walk)
+        {
+            int[] order = GetOrderBySize();
+            int next = -1;
+            Exception error = null;
+
+            Task[] tasks = new Task[_workerCount];
+            for (int w = 0; w < tasks.Length; w++)
+            {
+                int worker = w;
+                tasks[w] = StartWorker(() =>
+                {
+                    var walker = new SegmentWalker(this);
+                    try
+                    {
+                        int i;
+                        while (error == null && (i = Interlocked.Increment(ref next)) < order.Length)
+                            walk(walker, worker, _segments[order[i]]);
+                    }
+                    catch (Exception e)
+                    {
+                        Interlocked.CompareExchange(ref error, e, null);
+                    }
+                });
+            }
+
+            Task.WaitAll(tasks);
+            if (error != null)
+                ExceptionDispatchInfo.Capture(error).Throw();
+        }
+
+        public IEnumerable<ClrObject> EnumerateObjects(bool ordered)
+        {
+            // When ordered, each segment gets its own queue and we drain them in address order;
+            // workers claim segments in that same order, so the segment we are waiting on always
+            // has a worker.  Otherwise everybody shares one queue.
+            BlockingCollection<ObjectBatch>[] queues;
+            int[] order;
+            if (ordered)
+            {
+                order = new int[_segments.Length];
+                for (int i = 0; i < order.Length; i++)
+                    order[i] = i;
+
+                queues = new BlockingCollection<ObjectBatch>[_segments.Length];
+                for (int i = 0; i < queues.Length; i++)
+                    queues[i] = new BlockingCollection<ObjectBatch>(QueueDepth);
+            }
+            else
+            {
+                order = GetOrderBySize();
+                queues = new[] { new BlockingCollection<ObjectBatch>(QueueDepth * _workerCount) };
+            }
+
+            // Batches go back and forth rather than being allocated for every BatchSize objects.
+            var free = new ConcurrentBag<ObjectBatch>();
+            var cts = new CancellationTokenSource();
+            Exception error = null;
+            int next = -1;
+            int running = _workerCount;
+
+            Task[] tasks = new Task[_workerCount];
+            for (int w = 0; w < tasks.Length; w++)
+            {
+                tasks[w] = StartWorker(() =>
+                {
+                    var walker = new SegmentWalker(this);
+                    try
+                    {
+                        int i;
+                        while (!cts.IsCancellationRequested && (i = Interlocked.Increment(ref next)) < order.Length)
+                        {
+                            var queue = ordered ? queues[i] : queues[0];
+                            walker.Walk(_segments[order[i]], null, (batch) => queue.Add(batch, cts.Token), cts.Token, free);
+                            if (ordered)
+                                queue.CompleteAdding();
+                        }
+                    }
+                    catch (OperationCanceledException)
+                    {
+                    }
+                    catch (Exception e)
+                    {
+                        Interlocked.CompareExchange(ref error, e, null);
+                        cts.Cancel();
+                    }
+                    finally
+                    {
+                        // The last one out makes sure nobody is left waiting on a queue (for
+                        // instance one for a segment that never got walked, after an error).
+                        if (Interlocked.Decrement(ref running) == 0)
+                        {
+                            foreach (var queue in queues)
+                                queue.CompleteAdding();
+                        }
+                    }
+                });
+            }
+
+            try
+            {
+                foreach (var queue in queues)
+                {
+                    foreach (ObjectBatch batch in queue.GetConsumingEnumerable())
+                    {
+                        for (int i = 0; i < batch.Count; i++)
+                        {
+                            ulong addr = batch.Addresses[i];
+                            ClrType type = _heap.GetTypeByMethodTable(batch.MethodTables[i], batch.ComponentMethodTables[i], addr);
+                            yield return ClrObject.Create(addr, type);
+                        }
+
+                        batch.Count = 0;
+                        free.Add(batch);
+                    }
+
+                    if (error != null)
+                        break;
+                }
+
+                if (error != null)
+                    ExceptionDispatchInfo.Capture(error).Throw();
+            }
+            finally
+            {
+                // If the caller stopped early, the workers may be blocked on full queues.
+                cts.Cancel();
+                Task.WaitAll(tasks);
+                cts.Dispose();
+                foreach (var queue in queues)
+                    queue.Dispose();
+            }
+        }
+
+        private static Task StartWorker(Action action)
+        {
+            return Task.Factory.StartNew(action, CancellationToken.None, TaskCreationOptions.LongRunning, TaskScheduler.Default);
+        }
+
+        private int[] GetOrderBySize()
+        {
+            int[] order = new int[_segments.Length];
+            for (int i = 0; i < order.Length; i++)
+                order[i] = i;
+
+            Array.Sort(order, (x, y) => (_segments[y].End - _segments[y].Start).CompareTo(_segments[x].End - _segments[x].Start));
+            return order;
+        }
+
+        /// <summary>
+        /// One worker's object reader.  Follows the same rules as HeapSegment.GetNextObject.
+        /// </summary>
+        private sealed class SegmentWalker
+        {
+            private readonly ParallelHeapWalker _owner;
+            private readonly RawObjectReader _objects;
+            private readonly MemoryReader _reader;
+            private readonly List<ulong> _refs = new List<ulong>();
+
+            public SegmentWalker(ParallelHeapWalker owner)
+            {
+                _owner = owner;
+                _objects = new RawObjectReader(owner._heap);
+                _reader = _objects.Reader;
+            }
+
+            /// <summary>
+            /// Walks one segment.  With flush, objects are handed back in batches; with tallies,
+            /// they are counted by type (and their retained sizes estimated, with owned).  With
+            /// neither, the references of every object are added to owned.
+            /// </summary>
+            public void Walk(SegmentInfo seg,
+                             Dictionary<TypeKey, Tally> tallies,
+                             Action<ObjectBatch> flush,
+                             CancellationToken cancel,
+                             ConcurrentBag<ObjectBatch> free = null,
+                             OwnedObjectSet owned = null)
+            {
+                if (seg.Start == seg.End)
+                    return;
+
+                uint pointerSize = (uint)_owner._pointerSize;
+                uint minObjSize = pointerSize * 3;
+                ulong page = 0;
+                ulong pageMask = ~((ulong)_reader.PageSize - 1);
+                TypeKey lastKey = new TypeKey();
+                Tally lastTally = null;
+
+                ObjectBatch batch = null;
+                if (flush != null && (free == null || !free.TryTake(out batch)))
+                    batch = new ObjectBatch();
+
+                ulong addr = seg.Start;
+                while (true)
+                {
+                    if ((addr & pageMask) != page)
+                    {
+                        page = addr & pageMask;
+                        if (ClrHeap.ReadAheadPages > 0)
+                            _reader.Prefetch(addr, ClrHeap.ReadAheadPages);
+
+                        cancel.ThrowIfCancellationRequested();
+                    }
+
+                    ulong mt, cmt, size;
+                    if (!_objects.TryReadObject(addr, out mt, out cmt, out size))
+                        break;
+
+                    if (batch != null)
+                    {
+                        batch.Addresses[batch.Count] = addr;
+                        batch.MethodTables[batch.Count] = mt;
+                        batch.ComponentMethodTables[batch.Count] = cmt;
+                        if (++batch.Count == BatchSize)
+                        {
+                            flush(batch);
+                            if (free == null || !free.TryTake(out batch))
+                                batch = new ObjectBatch();
+                        }
+                    }
+                    else if (tallies == null)
+                    {
+                        _refs.Clear();
+                        _objects.GetReferences(addr, _refs);
+                        OwnedObjectSet.RemoveDuplicates(_refs);
+                        foreach (ulong r in _refs)
+                            owned.AddReference(r);
+                    }
+                    else
+                    {
+                        // Runs of the same type are common (arrays of strings, lists of nodes...).
+                        if (lastTally == null || lastKey.MethodTable != mt || lastKey.ComponentMethodTable != cmt)
+                        {
+                            lastKey = new TypeKey(mt, cmt);
+                            if (!tallies.TryGetValue(lastKey, out lastTally))
+                            {
+                                lastTally = new Tally();
+                                tallies.Add(lastKey, lastTally);
+                            }
+                        }
+
+                        lastTally.Count++;
+                        lastTally.TotalSize += size;
+                        if (owned != null)
+                            lastTally.RetainedSize += size + GetOwnedSize(addr, owned);
+                    }
+
+                    size = HeapSegment.Align(size, seg.Large);
+                    if (size < minObjSize)
+                        size = minObjSize;
+
+                    // Check to make sure a GC didn't cause "count" to be invalid, leading to too
+                    // large of an object.
+                    addr += size;
+                    if (addr >= seg.End)
+                        break;
+
+                    // Ensure we aren't at the start of an alloc context.
+                    ulong tmp;
+                    bool corrupt = false;
+                    while (!seg.Large && seg.AllocPointers.TryGetValue(addr, out tmp))
+                    {
+                        tmp += HeapSegment.Align(minObjSize, seg.Large);
+                        if (addr >= tmp || tmp >= seg.End)
+                        {
+                            corrupt = true;
+                            break;
+                        }
+
+                        addr = tmp;
+                    }
+
+                    if (corrupt)
+                        break;
+                }
+
+                if (batch != null && batch.Count > 0)
+                    flush(batch);
+            }
+
+            /// <summary>
+            /// The total size of the objects which only the object at addr refers to.
+            /// </summary>
+            private ulong GetOwnedSize(ulong addr, OwnedObjectSet owned)
+            {
+                _refs.Clear();
+                _objects.GetReferences(addr, _refs);
+                OwnedObjectSet.RemoveDuplicates(_refs);
+
+                ulong total = 0;
+                foreach (ulong r in _refs)
+                {
+                    ulong mt, cmt, size;
+                    if (owned.IsOwned(r) && _objects.TryReadObject(r, out mt, out cmt, out size))
+                        total += size;
+                }
+
+                return total;
+            }
+        }
+    }
+}
@@ -0,0 +1,209 @@
+﻿// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+using System;
+using System.Collections.Generic;
+
+namespace Microsoft.Diagnostics.Runtime.Desktop
+{
+    /// <summary>
+    /// Reads object headers and references straight out of target memory, without going through
+    /// ClrType (and so without the DAC or any of the heap's caches).  Each instance has its own
+    /// MemoryReader and MethodTable cache, so one per thread can be used for parallel heap work.
+    ///
+    /// Object sizes follow the same rules as DesktopHeapType.GetSize, and references are found
+    /// with the same GCDesc the type would use.  The MethodTable layout read here (flags, with
+    /// the component size in the low word, then the base size) is the v4+ one.
+    /// </summary>
+    internal sealed class RawObjectReader
+    {
+        private const uint HasComponentSizeFlag = 0x80000000;
+        private const uint ContainsPointersFlag = 0x01000000;
+
+        private readonly IDataReader _dataReader;
+        private readonly MemoryReader _reader;
+        private readonly uint _pointerSize;
+        private readonly ulong _arrayMT;
+        private readonly ulong _stringMT;
+        private readonly bool _hasComponentMTs;
+        private readonly Dictionary<ulong, Layout> _layouts = new Dictionary<ulong, Layout>();
+
+        // Segment bounds (sorted), for checking that objects fit in their segments without
+        // going through the heap's own segment lookup.
+        private readonly ulong[] _segStarts;
+        private readonly ulong[] _segEnds;
+        private int _lastSegment;
+
+        private List<ulong> _refs;
+        private readonly Action<ulong, int> _addRef;
+
+        private sealed class Layout
+        {
+            public uint BaseSize;
+            public uint ComponentSize;
+            public bool ContainsPointers;
+            public GCDesc GCDesc;
+            public bool TriedGCDesc;
+        }
+
+        public RawObjectReader(DesktopGCHeap heap)
+        {
+            _dataReader = heap.DesktopRuntime.DataReader;
+            _reader = new MemoryReader(_dataReader, ClrHeap.MemoryCacheSize);
+            _pointerSize = (uint)heap.PointerSize;
+            _arrayMT = heap.DesktopRuntime.ArrayMethodTable;
+            _stringMT = heap.DesktopRuntime.StringMethodTable;
+            _hasComponentMTs = heap.HasComponentMethodTables;
+            _addRef = (obj, offset) => _refs.Add(obj);
+
+            IList<ClrSegment> segments = heap.Segments;
+            _segStarts = new ulong[segments.Count];
+            _segEnds = new ulong[segments.Count];
+            for (int i = 0; i < segments.Count; i++)
+            {
+                _segStarts[i] = segments[i].Start;
+                _segEnds[i] = segments[i].End;
+            }
+        }
+
+        public static bool CanRead(DesktopGCHeap heap)
+        {
+            return heap.DesktopRuntime.CLRVersion != DesktopVersion.v2;
+        }
+
+        public MemoryReader Reader { get { return _reader; } }
+
+        /// <summary>
+        /// Reads the MethodTable, component MethodTable and size (unaligned) of the object at addr.
+        /// Returns false if the object can't be read, or doesn't look like an object.
+        /// </summary>
+        public bool TryReadObject(ulong addr, out ulong mt, out ulong cmt, out ulong size)
+        {
+            Layout layout;
+            return TryReadObject(addr, out mt, out cmt, out size, out layout);
+        }
+
+        private bool TryReadObject(ulong addr, out ulong mt, out ulong cmt, out ulong size, out Layout layout)
+        {
+            cmt = 0;
+            size = 0;
+            layout = null;
+
+            if (!_reader.ReadPtr(addr, out mt))
+                return false;
+
+            mt &= ~3UL;
+            if (mt == 0)
+                return false;
+
+            if (_hasComponentMTs && mt == _arrayMT && !_reader.ReadPtr(addr + _pointerSize * 2, out cmt))
+                return false;
+
+            if (!TryGetLayout(mt, out layout))
+                return false;
+
+            size = layout.BaseSize;
+            if (layout.ComponentSize != 0)
+            {
+                uint count;
+                if (!_reader.ReadDword(addr + _pointerSize, out count))
+                    return false;
+
+                // Strings in v4+ contain a trailing null terminator not accounted for.
+                if (mt == _stringMT)
+                    count++;
+
+                size += count * (ulong)layout.ComponentSize;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Appends the (non-null) references held by the object at addr to refs.  Like
+        /// EnumerateRefsOfObjectCarefully, an object that claims to run past the end of its
+        /// segment (or isn't in one) is taken to be garbage, and has no references.
+        /// </summary>
+        public void GetReferences(ulong addr, List<ulong> refs)
+        {
+            ulong mt, cmt, size;
+            Layout layout;
+            if (!TryReadObject(addr, out mt, out cmt, out size, out layout) || !layout.ContainsPointers)
+                return;
+
+            if (!FitsInSegment(addr, size))
+                return;
+
+            if (!layout.TriedGCDesc)
+            {
+                layout.TriedGCDesc = true;
+                layout.GCDesc = ReadGCDesc(mt);
+            }
+
+            if (layout.GCDesc == null)
+                return;
+
+            _refs = refs;
+            layout.GCDesc.WalkObject(addr, size, _reader, _addRef);
+            _refs = null;
+        }
+
+        private bool FitsInSegment(ulong addr, ulong size)
+        {
+            int seg = _lastSegment;
+            if (seg >= _segStarts.Length || addr < _segStarts[seg] || addr >= _segEnds[seg])
+            {
+                seg = Array.BinarySearch(_segStarts, addr);
+                if (seg < 0)
+                    seg = ~seg - 1;
+
+                if (seg < 0 || addr >= _segEnds[seg])
+                    return false;
+
+                _lastSegment = seg;
+            }
+
+            ulong end = addr + size;
+            return end >= addr && end <= _segEnds[seg];
+        }
+
+        private bool TryGetLayout(ulong mt, out Layout layout)
+        {
+            if (_layouts.TryGetValue(mt, out layout))
+                return true;
+
+            uint flags, baseSize;
+            if (!_reader.ReadDword(mt, out flags) || !_reader.ReadDword(mt + 4, out baseSize) || baseSize == 0)
+                return false;
+
+            layout = new Layout();
+            layout.BaseSize = baseSize;
+            layout.ComponentSize = (flags & HasComponentSizeFlag) != 0 ? flags & 0xffff : 0;
+            layout.ContainsPointers = (flags & ContainsPointersFlag) != 0;
+            _layouts.Add(mt, layout);
+            return true;
+        }
+
+        /// <summary>
+        /// The GCDesc lives just before the MethodTable (see DesktopHeapType.FillGCDesc).
+        /// </summary>
+        private GCDesc ReadGCDesc(ulong mt)
+        {
+            int entries;
+            if (!_reader.ReadDword(mt - (ulong)IntPtr.Size, out entries))
+                return null;
+
+            // Get entries in map
+            if (entries < 0)
+                entries = -entries;
+
+            int read;
+            int slots = 1 + entries * 2;
+            byte[] buffer = new byte[slots * IntPtr.Size];
+            if (!_dataReader.ReadMemory(mt - (ulong)(slots * IntPtr.Size), buffer, buffer.Length, out read) || read != buffer.Length)
+                return null;
+
+            return new GCDesc(buffer);
+        }
+    }
+}
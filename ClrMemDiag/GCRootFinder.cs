@@ -0,0 +1,582 @@
+﻿// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Runtime.ExceptionServices;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using Microsoft.Diagnostics.Runtime.Desktop;
+
+namespace Microsoft.Diagnostics.Runtime
+{
+    /// <summary>
+    /// A chain of references from a GC root to an object.
+    /// </summary>
+    public sealed class GCRootPath
+    {
+        /// <summary>
+        /// The root the path starts at.
+        /// </summary>
+        public ClrRoot Root { get; private set; }
+
+        /// <summary>
+        /// The objects on the path: the root's object first, and the target object last.  Each
+        /// object holds a reference to the next.
+        /// </summary>
+        public IList<ulong> Objects { get; private set; }
+
+        internal GCRootPath(ClrRoot root, IList<ulong> objects)
+        {
+            Root = root;
+            Objects = objects;
+        }
+
+        /// <summary>
+        /// Returns a string representation of this path.
+        /// </summary>
+        /// <returns>A string representation of this path.</returns>
+        public override string ToString()
+        {
+            var sb = new StringBuilder();
+            sb.Append(Root.Kind);
+            foreach (ulong obj in Objects)
+                sb.AppendFormat(" -> {0:x}", obj);
+
+            return sb.ToString();
+        }
+    }
+
+    /// <summary>
+    /// Finds out what keeps an object alive: paths of references from GC roots to it.
+    /// </summary>
+    /// <remarks>
+    /// Marking uses ObjectSet bitmaps (one bit per pointer-sized slot of the heap, so 1/64th of
+    /// the heap size each, on 64 bit targets), and traversals use explicit work lists rather
+    /// than recursion, so neither deep object graphs nor large numbers of objects are a problem.
+    /// FindShortestPath uses one bitmap.  FindAllPaths needs a bitmap per worker plus a shared
+    /// one, so it runs no more workers than fit in MarkingMemoryBudget.
+    ///
+    /// References are read from a ClrHeapIndex if one is supplied; otherwise, for v4+ desktop
+    /// heaps, straight from target memory by RawObjectReaders (one per worker).  Either way the
+    /// heap's own caches and the DAC are not used, so several workers can mark at once.  For
+    /// other heaps, references come from ClrType, and there is only one worker.
+    ///
+    /// Interior roots (which point into the middle of an object) are skipped.
+    /// </remarks>
+    public sealed class GCRootFinder
+    {
+        private const int ChunkSize = 256;
+
+        private readonly ClrHeap _heap;
+
+        /// <summary>
+        /// Creates a root finder for the given heap.
+        /// </summary>
+        public GCRootFinder(ClrHeap heap)
+        {
+            if (heap == null)
+                throw new ArgumentNullException(nameof(heap));
+
+            _heap = heap;
+        }
+
+        /// <summary>
+        /// An index of the heap to read references from, instead of target memory.  Optional.
+        /// </summary>
+        public ClrHeapIndex Index { get; set; }
+
+        /// <summary>
+        /// The most threads to mark with at once.  Zero or less means one per processor.
+        /// </summary>
+        public int DegreeOfParallelism { get; set; }
+
+        /// <summary>
+        /// The default MarkingMemoryBudget.
+        /// </summary>
+        public const long DefaultMarkingMemoryBudget = 256 * 1024 * 1024;
+
+        /// <summary>
+        /// The most memory, in bytes, FindAllPaths may use for marking bitmaps.  Each worker
+        /// needs its own bitmap (as does the shared dead end set), so this limits the number of
+        /// workers; there is always at least one, though, so the least FindAllPaths can use is
+        /// two bitmaps.  Zero or less means DefaultMarkingMemoryBudget.
+        /// </summary>
+        public long MarkingMemoryBudget { get; set; }
+
+        /// <summary>
+        /// Finds a shortest path from any root to the target object, by breadth-first search from
+        /// all roots at once.
+        /// </summary>
+        /// <param name="target">The address of the object.</param>
+        /// <param name="cancel">Cancels the search.</param>
+        /// <returns>The path, or null if no root keeps the target alive.</returns>
+        /// <remarks>
+        /// No parent is kept for each object (that would cost memory per object); instead, once
+        /// the target is found, the search is repeated for its predecessor, and so on back to a
+        /// root.  Each repeat stops one level earlier than the one before.
+        /// </remarks>
+        public GCRootPath FindShortestPath(ulong target, CancellationToken cancel)
+        {
+            Roots roots = GetRoots();
+            CheckTarget(target);
+
+            var path = new List<ulong>();
+            var visited = new ObjectSet(_heap);
+            ReferenceSource[] sources = CreateSources();
+
+            ulong current = target;
+            int maxDepth = int.MaxValue;
+            while (true)
+            {
+                path.Add(current);
+
+                List<ClrRoot> direct;
+                if (roots.ByObject.TryGetValue(current, out direct))
+                {
+                    path.Reverse();
+                    return new GCRootPath(direct[0], path);
+                }
+
+                ulong predecessor;
+                int depth;
+                if (!Search(current, roots.Objects, maxDepth, visited, sources, cancel, out predecessor, out depth))
+                    return null;
+
+                current = predecessor;
+                maxDepth = depth - 1;
+            }
+        }
+
+        /// <summary>
+        /// Finds, for every root which keeps the target object alive, a path from that root to the
+        /// target.  Roots are searched depth first, several at a time.
+        /// </summary>
+        /// <param name="target">The address of the object.</param>
+        /// <param name="cancel">Cancels the search.</param>
+        /// <returns>One path per root that reaches the target, in root enumeration order.</returns>
+        /// <remarks>
+        /// What each root's search learns is shared: when a search reaches the target, every
+        /// object on its path is remembered as leading to the target (so other searches can stop
+        /// when they get to one), and when a search runs out of objects without reaching the
+        /// target, everything it saw is added to a shared "dead end" bitmap.
+        /// </remarks>
+        public IList<GCRootPath> FindAllPaths(ulong target, CancellationToken cancel)
+        {
+            Roots roots = GetRoots();
+            CheckTarget(target);
+
+            ulong[] rootObjects = roots.Objects;
+            ulong[][] paths = new ulong[rootObjects.Length][];
+            var deadEnds = new ObjectSet(_heap);
+            var reaches = new ConcurrentDictionary<ulong, ulong>();
+            reaches[target] = 0;
+
+            ReferenceSource[] sources = CreateSources();
+            int workers = WorkersWithinBudget(sources.Length, deadEnds.Size);
+            int next = -1;
+            RunWorkers(workers, (worker) =>
+            {
+                var search = new DepthFirstSearch(_heap, target, sources[worker], deadEnds, reaches, cancel);
+                int i;
+                while ((i = Interlocked.Increment(ref next)) < rootObjects.Length)
+                    paths[i] = search.Run(rootObjects[i]);
+            });
+
+            var result = new List<GCRootPath>();
+            foreach (ClrRoot root in roots.All)
+            {
+                int i = Array.BinarySearch(rootObjects, root.Object);
+                if (paths[i] != null)
+                    result.Add(new GCRootPath(root, paths[i]));
+            }
+
+            return result;
+        }
+
+        /// <summary>
+        /// How many of the 'wanted' workers FindAllPaths can run without the bitmaps (one per
+        /// worker, plus the shared one, each 'bitmapSize' bytes) going over MarkingMemoryBudget.
+        /// </summary>
+        private int WorkersWithinBudget(int wanted, long bitmapSize)
+        {
+            long budget = MarkingMemoryBudget > 0 ? MarkingMemoryBudget : DefaultMarkingMemoryBudget;
+            long fit = bitmapSize > 0 ? budget / bitmapSize - 1 : wanted;
+            return (int)Math.Max(1, Math.Min(wanted, fit));
+        }
+
+        private sealed class Roots
+        {
+            public List<ClrRoot> All = new List<ClrRoot>();
+            public Dictionary<ulong, List<ClrRoot>> ByObject = new Dictionary<ulong, List<ClrRoot>>();
+            public ulong[] Objects;     // distinct, sorted
+        }
+
+        private Roots GetRoots()
+        {
+            // Roots come from the DAC, so this has to happen on this thread, up front.
+            var roots = new Roots();
+            foreach (ClrRoot root in _heap.EnumerateRoots())
+            {
+                if (root.Object == 0 || root.IsInterior)
+                    continue;
+
+                roots.All.Add(root);
+
+                List<ClrRoot> list;
+                if (!roots.ByObject.TryGetValue(root.Object, out list))
+                {
+                    list = new List<ClrRoot>(1);
+                    roots.ByObject.Add(root.Object, list);
+                }
+
+                list.Add(root);
+            }
+
+            roots.Objects = new ulong[roots.ByObject.Count];
+            roots.ByObject.Keys.CopyTo(roots.Objects, 0);
+            Array.Sort(roots.Objects);
+            return roots;
+        }
+
+        private void CheckTarget(ulong target)
+        {
+            if (!_heap.IsInHeap(target))
+                throw new ArgumentException("The target object is not on the GC heap.", nameof(target));
+        }
+
+        /// <summary>
+        /// Level-synchronous breadth-first search from all roots.  The frontier is split into chunks
+        /// which the workers claim; marks are set with TryAddConcurrent, so each object is expanded
+        /// once.
+        /// </summary>
+        private bool Search(ulong target,
+                            ulong[] rootObjects,
+                            int maxDepth,
+                            ObjectSet visited,
+                            ReferenceSource[] sources,
+                            CancellationToken cancel,
+                            out ulong predecessor,
+                            out int depth)
+        {
+            predecessor = 0;
+            depth = 0;
+
+            visited.ClearAll();
+            var frontier = new List<ulong>(rootObjects.Length);
+            foreach (ulong obj in rootObjects)
+            {
+                if (visited.TryAddConcurrent(obj))
+                    frontier.Add(obj);
+            }
+
+            var nextLevels = new List<ulong>[sources.Length];
+            for (int i = 0; i < nextLevels.Length; i++)
+                nextLevels[i] = new List<ulong>();
+
+            int level = 0;
+            long found = 0;
+            ulong foundPredecessor = 0;
+            while (frontier.Count > 0 && level < maxDepth)
+            {
+                cancel.ThrowIfCancellationRequested();
+
+                List<ulong> current = frontier;
+                int next = -ChunkSize;
+                RunWorkers(sources.Length, (worker) =>
+                {
+                    ReferenceSource source = sources[worker];
+                    List<ulong> mine = nextLevels[worker];
+                    var refs = new List<ulong>();
+
+                    int start;
+                    while (Interlocked.Read(ref found) == 0 && (start = Interlocked.Add(ref next, ChunkSize)) < current.Count)
+                    {
+                        int end = Math.Min(start + ChunkSize, current.Count);
+                        for (int i = start; i < end; i++)
+                        {
+                            ulong obj = current[i];
+                            refs.Clear();
+                            source.GetReferences(obj, refs);
+                            foreach (ulong r in refs)
+                            {
+                                if (r == target)
+                                {
+                                    if (Interlocked.CompareExchange(ref found, 1, 0) == 0)
+                                        foundPredecessor = obj;
+
+                                    return;
+                                }
+
+                                if (visited.TryAddConcurrent(r))
+                                    mine.Add(r);
+                            }
+                        }
+
+                        cancel.ThrowIfCancellationRequested();
+                    }
+                });
+
+                level++;
+                if (found != 0)
+                {
+                    predecessor = foundPredecessor;
+                    depth = level;
+                    return true;
+                }
+
+                frontier = new List<ulong>();
+                foreach (List<ulong> mine in nextLevels)
+                {
+                    frontier.AddRange(mine);
+                    mine.Clear();
+                }
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// One worker's depth-first search state.  The stack of objects being explored is the path
+        /// from the root, so finding the target needs no parent links.
+        /// </summary>
+        private sealed class DepthFirstSearch
+        {
+            private readonly ulong _target;
+            private readonly ReferenceSource _source;
+            private readonly ObjectSet _deadEnds;
+            private readonly ConcurrentDictionary<ulong, ulong> _reaches;
+            private readonly CancellationToken _cancel;
+            private readonly ObjectSet _seen;
+
+            // The stack: _objects[i] is being explored, and its unexplored references are
+            // _children[_position[i] .. (i == top ? _children.Count : _start[i + 1])).
+            private readonly List<ulong> _objects = new List<ulong>();
+            private readonly List<int> _start = new List<int>();
+            private readonly List<int> _position = new List<int>();
+            private readonly List<ulong> _children = new List<ulong>();
+
+            public DepthFirstSearch(ClrHeap heap,
+                                    ulong target,
+                                    ReferenceSource source,
+                                    ObjectSet deadEnds,
+                                    ConcurrentDictionary<ulong, ulong> reaches,
+                                    CancellationToken cancel)
+            {
+                _target = target;
+                _source = source;
+                _deadEnds = deadEnds;
+                _reaches = reaches;
+                _cancel = cancel;
+                _seen = new ObjectSet(heap);
+            }
+
+            public ulong[] Run(ulong root)
+            {
+                if (_reaches.ContainsKey(root))
+                    return FollowReaches(new List<ulong>(), root);
+
+                if (_deadEnds.Contains(root))
+                    return null;
+
+                _seen.Clear();
+                if (!_seen.Add(root))
+                    return null;
+
+                try
+                {
+                    Push(root);
+                    int steps = 0;
+                    while (_objects.Count > 0)
+                    {
+                        int top = _objects.Count - 1;
+                        int pos = _position[top];
+                        if (pos == _children.Count)
+                        {
+                            _children.RemoveRange(_start[top], _children.Count - _start[top]);
+                            _objects.RemoveAt(top);
+                            _start.RemoveAt(top);
+                            _position.RemoveAt(top);
+                            continue;
+                        }
+
+                        ulong child = _children[pos];
+                        _position[top] = pos + 1;
+
+                        if (_reaches.ContainsKey(child))
+                            return Found(child);
+
+                        if (_deadEnds.Contains(child) || !_seen.Add(child))
+                            continue;
+
+                        if ((++steps & 0xfff) == 0)
+                            _cancel.ThrowIfCancellationRequested();
+
+                        Push(child);
+                    }
+
+                    // Nothing reachable from this root leads to the target.
+                    _deadEnds.UnionWith(_seen);
+                    return null;
+                }
+                finally
+                {
+                    _objects.Clear();
+                    _start.Clear();
+                    _position.Clear();
+                    _children.Clear();
+                }
+            }
+
+            private void Push(ulong obj)
+            {
+                _objects.Add(obj);
+                _start.Add(_children.Count);
+                _position.Add(_children.Count);
+                _source.GetReferences(obj, _children);
+            }
+
+            private ulong[] Found(ulong child)
+            {
+                // Record the path back to front, so that whenever an object is added, the object
+                // it points to already leads to the target (which keeps the links free of cycles,
+                // even with other workers adding links at the same time).
+                ulong succ = child;
+                for (int i = _objects.Count - 1; i >= 0; i--)
+                {
+                    _reaches.TryAdd(_objects[i], succ);
+                    succ = _objects[i];
+                }
+
+                return FollowReaches(new List<ulong>(_objects), child);
+            }
+
+            private ulong[] FollowReaches(List<ulong> path, ulong obj)
+            {
+                while (obj != _target)
+                {
+                    path.Add(obj);
+                    obj = _reaches[obj];
+                }
+
+                path.Add(_target);
+                return path.ToArray();
+            }
+        }
+
+        private ReferenceSource[] CreateSources()
+        {
+            int workers = DegreeOfParallelism > 0 ? DegreeOfParallelism : Environment.ProcessorCount;
+
+            var sources = new List<ReferenceSource>();
+            DesktopGCHeap desktopHeap = _heap as DesktopGCHeap;
+            if (Index != null)
+            {
+                for (int i = 0; i < workers; i++)
+                    sources.Add(new IndexReferenceSource(Index));
+            }
+            else if (desktopHeap != null && RawObjectReader.CanRead(desktopHeap))
+            {
+                for (int i = 0; i < workers; i++)
+                    sources.Add(new RawReferenceSource(desktopHeap));
+            }
+            else
+            {
+                sources.Add(new TypeReferenceSource(_heap));
+            }
+
+            return sources.ToArray();
+        }
+
+        private static void RunWorkers(int count, Action<int> body)
+        {
+            if (count == 1)
+            {
+                body(0);
+                return;
+            }
+
+            try
+            {
+                Parallel.For(0, count, new ParallelOptions() { MaxDegreeOfParallelism = count }, body);
+            }
+            catch (AggregateException ae)
+            {
+                ExceptionDispatchInfo.Capture(ae.InnerExceptions[0]).Throw();
+                throw;
+            }
+        }
+
+        private abstract class ReferenceSource
+        {
+            public abstract void GetReferences(ulong obj, List<ulong> refs);
+        }
+
+        private sealed class IndexReferenceSource : ReferenceSource
+        {
+            private readonly ClrHeapIndex _index;
+
+            public IndexReferenceSource(ClrHeapIndex index)
+            {
+                _index = index;
+            }
+
+            public override void GetReferences(ulong obj, List<ulong> refs)
+            {
+                int index = _index.IndexOf(obj);
+                if (index < 0)
+                    return;
+
+                long start, end;
+                _index.GetReferenceRange(index, out start, out end);
+                for (long slot = start; slot < end; slot++)
+                {
+                    int target = _index.GetReferenceAt(slot);
+                    if (target >= 0)
+                        refs.Add(_index.GetAddress(target));
+                }
+            }
+        }
+
+        private sealed class RawReferenceSource : ReferenceSource
+        {
+            private readonly RawObjectReader _reader;
+
+            public RawReferenceSource(DesktopGCHeap heap)
+            {
+                _reader = new RawObjectReader(heap);
+            }
+
+            public override void GetReferences(ulong obj, List<ulong> refs)
+            {
+                _reader.GetReferences(obj, refs);
+            }
+        }
+
+        private sealed class TypeReferenceSource : ReferenceSource
+        {
+            private readonly ClrHeap _heap;
+            private List<ulong> _refs;
+            private readonly Action<ulong, int> _addRef;
+
+            public TypeReferenceSource(ClrHeap heap)
+            {
+                _heap = heap;
+                _addRef = (obj, offset) => _refs.Add(obj);
+            }
+
+            public override void GetReferences(ulong obj, List<ulong> refs)
+            {
+                ClrType type = _heap.GetObjectType(obj);
+                if (type == null || !type.ContainsPointers)
+                    return;
+
+                _refs = refs;
+                type.EnumerateRefsOfObject(obj, _addRef);
+                _refs = null;
+            }
+        }
+    }
+}
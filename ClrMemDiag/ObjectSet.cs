@@ -0,0 +1,271 @@
+﻿// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+using System;
+using System.Collections.Generic;
+using System.Threading;
+
+namespace Microsoft.Diagnostics.Runtime
+{
+    /// <summary>
+    /// A set of heap objects, kept as one bit per pointer-aligned slot of each segment.  Memory
+    /// use depends only on the size of the heap (1/64th of it, on 64 bit targets), not on how many
+    /// objects are in the set.  Addresses outside of the heap's segments can't be added.
+    ///
+    /// Add is for use by one thread at a time; TryAddConcurrent and UnionWith can be used from
+    /// several threads at once (with each other and with Contains).
+    /// </summary>
+    internal sealed class ObjectSet
+    {
+        private readonly ulong[] _starts;
+        private readonly ulong[] _ends;
+        private readonly long[][] _bits;
+        private readonly int _shift;        // log2(pointer size)
+        private int _lastSegment;
+
+        // Words that have gone from zero to non-zero through Add, as (segment << 32 | word), so
+        // that a mostly-empty set can be cleared or merged without touching every word.
+        private readonly List<long> _dirty = new List<long>();
+
+        public ObjectSet(ClrHeap heap)
+        {
+            IList<ClrSegment> segments = heap.Segments;
+            _starts = new ulong[segments.Count];
+            _ends = new ulong[segments.Count];
+            _bits = new long[segments.Count][];
+            _shift = heap.PointerSize == 8 ? 3 : 2;
+
+            // Segments come back sorted by address.
+            for (int i = 0; i < segments.Count; i++)
+            {
+                _starts[i] = segments[i].Start;
+                _ends[i] = segments[i].End;
+                ulong slots = (_ends[i] - _starts[i]) >> _shift;
+                _bits[i] = new long[(slots + 63) / 64];
+            }
+        }
+
+        /// <summary>
+        /// The number of bytes the bitmaps take.
+        /// </summary>
+        public long Size
+        {
+            get
+            {
+                long size = 0;
+                foreach (long[] bits in _bits)
+                    size += bits.LongLength * 8;
+                return size;
+            }
+        }
+
+        public bool IsInHeap(ulong obj)
+        {
+            return FindSegment(obj) >= 0;
+        }
+
+        public bool Contains(ulong obj)
+        {
+            int seg = FindSegment(obj);
+            if (seg < 0)
+                return false;
+
+            ulong slot = (obj - _starts[seg]) >> _shift;
+            long word = Volatile.Read(ref _bits[seg][slot >> 6]);
+            return (word & (1L << (int)(slot & 63))) != 0;
+        }
+
+        /// <summary>
+        /// Adds obj to the set.  Returns false if it was already there, or isn't on the heap.
+        /// </summary>
+        public bool Add(ulong obj)
+        {
+            int seg = FindSegment(obj);
+            if (seg < 0)
+                return false;
+
+            ulong slot = (obj - _starts[seg]) >> _shift;
+            long[] bits = _bits[seg];
+            int index = (int)(slot >> 6);
+            long mask = 1L << (int)(slot & 63);
+
+            long word = bits[index];
+            if ((word & mask) != 0)
+                return false;
+
+            if (word == 0)
+                _dirty.Add(((long)seg << 32) | (uint)index);
+
+            bits[index] = word | mask;
+            return true;
+        }
+
+        /// <summary>
+        /// Adds obj to the set; safe to call from several threads at once.  Returns false if it was
+        /// already there (added by this or any other thread), or isn't on the heap.
+        /// </summary>
+        public bool TryAddConcurrent(ulong obj)
+        {
+            int seg = FindSegmentNoCache(obj);
+            if (seg < 0)
+                return false;
+
+            ulong slot = (obj - _starts[seg]) >> _shift;
+            long[] bits = _bits[seg];
+            int index = (int)(slot >> 6);
+            long mask = 1L << (int)(slot & 63);
+
+            long word = Volatile.Read(ref bits[index]);
+            while ((word & mask) == 0)
+            {
+                long prev = Interlocked.CompareExchange(ref bits[index], word | mask, word);
+                if (prev == word)
+                    return true;
+
+                word = prev;
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Adds everything in other (which must have been built from the same heap, and only
+        /// filled with Add) to this set.  Safe to call from several threads at once.
+        /// </summary>
+        public void UnionWith(ObjectSet other)
+        {
+            foreach (long entry in other._dirty)
+            {
+                int seg = (int)(entry >> 32);
+                int index = (int)(uint)entry;
+                long add = other._bits[seg][index];
+
+                long word = Volatile.Read(ref _bits[seg][index]);
+                while ((word | add) != word)
+                {
+                    long prev = Interlocked.CompareExchange(ref _bits[seg][index], word | add, word);
+                    if (prev == word)
+                        break;
+
+                    word = prev;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Empties the set.  Only touches the words Add has set.
+        /// </summary>
+        public void Clear()
+        {
+            foreach (long entry in _dirty)
+                _bits[(int)(entry >> 32)][(int)(uint)entry] = 0;
+
+            _dirty.Clear();
+        }
+
+        /// <summary>
+        /// Empties the set, including anything added with TryAddConcurrent.
+        /// </summary>
+        public void ClearAll()
+        {
+            foreach (long[] bits in _bits)
+                Array.Clear(bits, 0, bits.Length);
+
+            _dirty.Clear();
+        }
+
+        private int FindSegment(ulong obj)
+        {
+            int last = _lastSegment;
+            if (last < _starts.Length && _starts[last] <= obj && obj < _ends[last])
+                return last;
+
+            int seg = FindSegmentNoCache(obj);
+            if (seg >= 0)
+                _lastSegment = seg;
+
+            return seg;
+        }
+
+        private int FindSegmentNoCache(ulong obj)
+        {
+            int lo = 0;
+            int hi = _starts.Length - 1;
+            while (lo <= hi)
+            {
+                int mid = lo + ((hi - lo) >> 1);
+                if (obj < _starts[mid])
+                    hi = mid - 1;
+                else if (obj >= _ends[mid])
+                    lo = mid + 1;
+                else
+                    return mid;
+            }
+
+            return -1;
+        }
+    }
+
+    /// <summary>
+    /// Finds the objects which have exactly one referrer, for estimating retained sizes: an
+    /// object which only one other object refers to (and no root) is taken to be owned by it.
+    /// Kept as two ObjectSets (heap size / 64 each, on 64 bit targets).
+    ///
+    /// AddReference is called once per referring object, not once per reference: an object
+    /// with two fields pointing at the same child is still its only referrer (see
+    /// RemoveDuplicates).  It can be called from several threads at once.  IsOwned is only
+    /// meaningful once all of the references and roots have been added.
+    /// </summary>
+    internal sealed class OwnedObjectSet
+    {
+        private readonly ObjectSet _once;
+        private readonly ObjectSet _shared;
+
+        public OwnedObjectSet(ClrHeap heap)
+        {
+            _once = new ObjectSet(heap);
+            _shared = new ObjectSet(heap);
+        }
+
+        public void AddReference(ulong obj)
+        {
+            if (!_once.TryAddConcurrent(obj))
+                _shared.TryAddConcurrent(obj);
+        }
+
+        public void AddRoots(ClrHeap heap)
+        {
+            // Rooted objects aren't owned by whatever else refers to them.
+            foreach (ClrRoot root in heap.EnumerateRoots())
+            {
+                if (root.Object != 0)
+                    _shared.TryAddConcurrent(root.Object);
+            }
+        }
+
+        public bool IsOwned(ulong obj)
+        {
+            return _once.Contains(obj) && !_shared.Contains(obj);
+        }
+
+        /// <summary>
+        /// Sorts the references of one object and removes the repeats, so that each object it
+        /// refers to is counted (and its size added) once.
+        /// </summary>
+        public static void RemoveDuplicates<T>(List<T> refs) where T : IComparable<T>
+        {
+            if (refs.Count < 2)
+                return;
+
+            refs.Sort();
+            int count = 1;
+            for (int i = 1; i < refs.Count; i++)
+            {
+                if (refs[i].CompareTo(refs[count - 1]) != 0)
+                    refs[count++] = refs[i];
+            }
+
+            refs.RemoveRange(count, refs.Count - count);
+        }
+    }
+}
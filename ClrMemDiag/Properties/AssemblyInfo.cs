@@ -19,6 +19,8 @@
 
 [assembly: ComVisible(false)]
 
+[assembly: InternalsVisibleTo("TestManagedCommon")]
+
 // The following GUID is for the ID of the typelib if this project is exposed to COM
 [assembly: Guid("94432a8e-3e06-4776-b9b2-3684a62bb96a")]
 
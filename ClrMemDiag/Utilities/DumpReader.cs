@@ -923,52 +923,64 @@ public int CompareTo(MinidumpMemoryChunk other)
             // Practically speaking, that fallback could be in the
             // implementation of ICorDebugDataTarget.ReadVirtual.
             // Keep in mind this list presumes there are no overlapping chunks.
+            //
+            // The chunks are kept as a struct-of-arrays (start addresses, sizes, RVAs),
+            // sorted by start address. A full dump can have tens of thousands of chunks,
+            // and every memory read starts with a search of the start addresses, so we
+            // want those packed together, and no objects to chase.
             public class MinidumpMemoryChunks
             {
                 private UInt64 _count;
                 private MinidumpMemory64List _memory64List;
                 private MinidumpMemoryList _memoryList;
-                private MinidumpMemoryChunk[] _chunks;
+                private UInt64[] _startAddresses;
+                private UInt64[] _sizes;
+                private UInt64[] _rvas;
                 private DumpPointer _dumpStream;
                 private MINIDUMP_STREAM_TYPE _listType;
 
                 public UInt64 Size(UInt64 i)
                 {
-                    return _chunks[i].Size;
+                    return _sizes[i];
                 }
 
                 public UInt64 RVA(UInt64 i)
                 {
-                    return _chunks[i].RVA;
+                    return _rvas[i];
                 }
 
                 public UInt64 StartAddress(UInt64 i)
                 {
-                    return _chunks[i].TargetStartAddress;
+                    return _startAddresses[i];
                 }
 
                 public UInt64 EndAddress(UInt64 i)
                 {
-                    return _chunks[i].TargetEndAddress;
+                    return _startAddresses[i] + _sizes[i];
                 }
 
                 public int GetChunkContainingAddress(ulong address)
                 {
-                    MinidumpMemoryChunk targetChunk = new MinidumpMemoryChunk();
-                    targetChunk.TargetStartAddress = address;
-                    int index = Array.BinarySearch(_chunks, targetChunk);
-                    if (index >= 0)
-                    {
-                        Debug.Assert(_chunks[index].TargetStartAddress == address);
-                        return index; // exact match will contain the address
-                    }
-                    else if (~index != 0)
+                    UInt64[] starts = _startAddresses;
+                    int length = starts.Length;
+                    if (length == 0)
+                        return -1;
+
+                    // Find the last chunk that starts at or below the address. The loop
+                    // always runs log2(n) times, and the comparison just picks which
+                    // half to keep, which the JIT can do without a branch (so there are
+                    // no mispredictions for random addresses).
+                    int index = 0;
+                    while (length > 1)
                     {
-                        int possibleIndex = Math.Min(_chunks.Length, ~index) - 1;
-                        if (_chunks[possibleIndex].TargetStartAddress <= address &&
-                            _chunks[possibleIndex].TargetEndAddress > address)
-                            return possibleIndex;
+                        int half = length >> 1;
+                        index = (starts[index + half] <= address) ? index + half : index;
+                        length -= half;
                     }
+
+                    if ((starts[index] <= address) && ((address - starts[index]) < _sizes[index]))
+                        return index;
+
                     return -1;
                 }
 
@@ -1021,8 +1033,7 @@ private void InitFromMemory64List()
 
                     chunks.Sort();
                     SplitAndMergeChunks(chunks);
-                    _chunks = chunks.ToArray();
-                    _count = (ulong)chunks.Count;
+                    SetChunks(chunks);
 
                     ValidateChunks();
                 }
@@ -1047,12 +1058,31 @@ public void InitFromMemoryList()
 
                     chunks.Sort();
                     SplitAndMergeChunks(chunks);
-                    _chunks = chunks.ToArray();
-                    _count = (ulong)chunks.Count;
+                    SetChunks(chunks);
 
                     ValidateChunks();
                 }
 
+                private void SetChunks(List<MinidumpMemoryChunk> chunks)
+                {
+                    _startAddresses = new UInt64[chunks.Count];
+                    _sizes = new UInt64[chunks.Count];
+                    _rvas = new UInt64[chunks.Count];
+                    for (int i = 0; i < chunks.Count; i++)
+                    {
+                        _startAddresses[i] = chunks[i].TargetStartAddress;
+                        _sizes[i] = chunks[i].Size;
+                        _rvas[i] = chunks[i].RVA;
+
+                        if (chunks[i].Size != chunks[i].TargetEndAddress - chunks[i].TargetStartAddress)
+                        {
+                            throw new ClrDiagnosticsException("Unexpected inconsistency error in dump memory chunk " + i
+                                + " with target base address " + chunks[i].TargetStartAddress + ".", ClrDiagnosticsException.HR.CrashDumpError);
+                        }
+                    }
+                    _count = (ulong)chunks.Count;
+                }
+
                 public UInt64 Count
                 {
                     get
@@ -1112,26 +1142,25 @@ private void ValidateChunks()
                 {
                     for (UInt64 i = 0; i < _count; i++)
                     {
-                        if ((_chunks[i].Size != _chunks[i].TargetEndAddress - _chunks[i].TargetStartAddress) ||
-                            (_chunks[i].TargetStartAddress > _chunks[i].TargetEndAddress))
+                        if (StartAddress(i) > EndAddress(i))
                         {
                             throw new ClrDiagnosticsException("Unexpected inconsistency error in dump memory chunk " + i
-                                + " with target base address " + _chunks[i].TargetStartAddress + ".", ClrDiagnosticsException.HR.CrashDumpError);
+                                + " with target base address " + StartAddress(i) + ".", ClrDiagnosticsException.HR.CrashDumpError);
                         }
 
                         // If there's a next to compare to, and it's a MinidumpWithFullMemory, then we expect
                         // that the RVAs & addresses will all be sorted in the dump.
                         // MinidumpWithFullMemory stores things in a Memory64ListStream.
                         if (((i < _count - 1) && (_listType == MINIDUMP_STREAM_TYPE.Memory64ListStream)) &&
-                            ((_chunks[i].RVA >= _chunks[i + 1].RVA) ||
-                             (_chunks[i].TargetEndAddress > _chunks[i + 1].TargetStartAddress)))
+                            ((RVA(i) >= RVA(i + 1)) ||
+                             (EndAddress(i) > StartAddress(i + 1))))
                         {
                             throw new ClrDiagnosticsException("Unexpected relative addresses inconsistency between dump memory chunks "
                                 + i + " and " + (i + 1) + ".", ClrDiagnosticsException.HR.CrashDumpError);
                         }
 
                         // Because we sorted and split/merged entries we can expect them to be increasing and non-overlapping
-                        if ((i < _count - 1) && (_chunks[i].TargetEndAddress > _chunks[i + 1].TargetStartAddress))
+                        if ((i < _count - 1) && (EndAddress(i) > StartAddress(i + 1)))
                         {
                             throw new ClrDiagnosticsException("Unexpected overlap between memory chunks", ClrDiagnosticsException.HR.CrashDumpError);
                         }
@@ -1515,36 +1544,47 @@ public virtual uint ReadPartialMemory(ulong targetRequestStart, IntPtr destinati
 
 
 
-        internal ulong ReadPointerUnsafe(ulong addr)
+        internal unsafe ulong ReadPointerUnsafe(ulong addr)
         {
-            int chunkIndex = _memoryChunks.GetChunkContainingAddress(addr);
-            if (chunkIndex == -1)
+            if (IntPtr.Size == 4)
+                return ReadDwordUnsafe(addr);
+
+            byte* p = TryGetChunkPointer(addr, sizeof(ulong));
+            if (p == null)
                 return 0;
 
-            DumpPointer chunk = this.TranslateRVA(_memoryChunks.RVA((uint)chunkIndex));
-            ulong offset = addr - _memoryChunks.StartAddress((uint)chunkIndex);
+            return *(ulong*)p;
+        }
 
-            if (IntPtr.Size == 4)
-                return chunk.Adjust(offset).GetDword();
 
-            return chunk.Adjust(offset).GetUlong();
-        }
 
+        internal unsafe uint ReadDwordUnsafe(ulong addr)
+        {
+            byte* p = TryGetChunkPointer(addr, sizeof(uint));
+            if (p == null)
+                return 0;
+
+            return *(uint*)p;
+        }
 
 
-        internal uint ReadDwordUnsafe(ulong addr)
+        // Gets a pointer to size bytes at addr, if they lie entirely within one chunk
+        // (reads that straddle chunks, or run off the end of the memory, get null).
+        private unsafe byte* TryGetChunkPointer(ulong addr, uint size)
         {
             int chunkIndex = _memoryChunks.GetChunkContainingAddress(addr);
             if (chunkIndex == -1)
-                return 0;
+                return null;
 
-            DumpPointer chunk = this.TranslateRVA(_memoryChunks.RVA((uint)chunkIndex));
             ulong offset = addr - _memoryChunks.StartAddress((uint)chunkIndex);
-            return chunk.Adjust(offset).GetDword();
+            if (size > _memoryChunks.Size((uint)chunkIndex) - offset)
+                return null;
+
+            return GetViewPointer(_memoryChunks.RVA((uint)chunkIndex) + offset, size);
         }
 
 
-        public virtual int ReadPartialMemory(ulong targetRequestStart, byte[] destinationBuffer, int bytesRequested)
+        public virtual unsafe int ReadPartialMemory(ulong targetRequestStart, byte[] destinationBuffer, int bytesRequested)
         {
             EnsureValid();
 
@@ -1554,31 +1594,10 @@ public virtual int ReadPartialMemory(ulong targetRequestStart, byte[] destinatio
             if (bytesRequested > destinationBuffer.Length)
                 bytesRequested = destinationBuffer.Length;
 
-            int bytesRead = 0;
-            do
+            fixed (byte* pDest = destinationBuffer)
             {
-                int chunkIndex = _memoryChunks.GetChunkContainingAddress(targetRequestStart + (uint)bytesRead);
-                if (chunkIndex == -1)
-                    break;
-
-                DumpPointer pointerCurrentChunk = this.TranslateRVA(_memoryChunks.RVA((uint)chunkIndex));
-                ulong startAddr = targetRequestStart + (uint)bytesRead - _memoryChunks.StartAddress((uint)chunkIndex);
-                ulong bytesAvailable = _memoryChunks.Size((uint)chunkIndex) - startAddr;
-
-                Debug.Assert(bytesRequested >= bytesRead);
-                int bytesToCopy = bytesRequested - bytesRead;
-                if (bytesAvailable < (uint)bytesToCopy)
-                    bytesToCopy = (int)bytesAvailable;
-
-                Debug.Assert(bytesToCopy > 0);
-                if (bytesToCopy == 0)
-                    break;
-
-                pointerCurrentChunk.Adjust(startAddr).Copy(destinationBuffer, bytesRead, bytesToCopy);
-                bytesRead += bytesToCopy;
-            } while (bytesRead < bytesRequested);
-
-            return bytesRead;
+                return (int)ReadPartialMemoryInternal(targetRequestStart, pDest, (uint)bytesRequested);
+            }
         }
         
 #pragma warning disable 0420
@@ -1627,10 +1646,21 @@ private void ReleaseWriteLock()
         // Since a MemoryListStream makes no guarantees that there aren't duplicate, overlapping, or wholly contained
         // memory regions, we need to handle that.  For the purposes of this code, we presume all memory regions
         // in the dump that cover a given VA have the correct (duplicate) contents.
-        protected uint ReadPartialMemoryInternal(ulong targetRequestStart,
-                                                IntPtr destinationBuffer,
-                                                uint destinationBufferSizeInBytes,
-                                                uint startIndex)
+        protected unsafe uint ReadPartialMemoryInternal(ulong targetRequestStart,
+                                                       IntPtr destinationBuffer,
+                                                       uint destinationBufferSizeInBytes,
+                                                       uint startIndex)
+        {
+            return ReadPartialMemoryInternal(targetRequestStart,
+                                             (byte*)destinationBuffer.ToPointer(),
+                                             destinationBufferSizeInBytes);
+        }
+
+        // Copies straight from the mapped view of the dump file into the destination:
+        // no DumpPointer, no marshaling, no P/Invoke.
+        private unsafe uint ReadPartialMemoryInternal(ulong targetRequestStart,
+                                                      byte* destinationBuffer,
+                                                      uint destinationBufferSizeInBytes)
         {
             EnsureValid();
 
@@ -1639,23 +1669,22 @@ private void ReleaseWriteLock()
             uint bytesRead = 0;
             do
             {
-                int chunkIndex = _memoryChunks.GetChunkContainingAddress(targetRequestStart + bytesRead);
+                ulong addr = targetRequestStart + bytesRead;
+                int chunkIndex = _memoryChunks.GetChunkContainingAddress(addr);
                 if (chunkIndex == -1)
                     break;
 
-                DumpPointer pointerCurrentChunk = this.TranslateRVA(_memoryChunks.RVA((uint)chunkIndex));
-                uint idxStart = (uint)(targetRequestStart + bytesRead - _memoryChunks.StartAddress((uint)chunkIndex));
-                uint bytesAvailable = (uint)_memoryChunks.Size((uint)chunkIndex) - idxStart;
+                ulong idxStart = addr - _memoryChunks.StartAddress((uint)chunkIndex);
+                ulong bytesAvailable = _memoryChunks.Size((uint)chunkIndex) - idxStart;
                 uint bytesNeeded = destinationBufferSizeInBytes - bytesRead;
-                uint bytesToCopy = Math.Min(bytesAvailable, bytesNeeded);
+                uint bytesToCopy = (uint)Math.Min(bytesAvailable, bytesNeeded);
 
                 Debug.Assert(bytesToCopy > 0);
                 if (bytesToCopy == 0)
                     break;
 
-                IntPtr dest = new IntPtr(destinationBuffer.ToInt64() + bytesRead);
-                uint destSize = destinationBufferSizeInBytes - bytesRead;
-                pointerCurrentChunk.Adjust(idxStart).Copy(dest, destSize, bytesToCopy);
+                byte* src = GetViewPointer(_memoryChunks.RVA((uint)chunkIndex) + idxStart, bytesToCopy);
+                Buffer.MemoryCopy(src, destinationBuffer + bytesRead, destinationBufferSizeInBytes - bytesRead, bytesToCopy);
                 bytesRead += bytesToCopy;
             } while (bytesRead < destinationBufferSizeInBytes);
 
@@ -1663,11 +1692,23 @@ private void ReleaseWriteLock()
         }
 
 
+        // Gets a pointer into the mapped view of the dump file, checking that the
+        // requested range is within the file. (Unlike DumpPointer, this works for RVAs
+        // past 4GB, which full dumps of 64-bit processes have plenty of.)
+        private unsafe byte* GetViewPointer(ulong rva, uint size)
+        {
+            if ((rva > _viewLength) || (size > (_viewLength - rva)))
+                throw new ClrDiagnosticsException("The given crash dump is in an incorrect format.", ClrDiagnosticsException.HR.CrashDumpError);
+
+            return _viewStart + rva;
+        }
+
+
 
         // Caching the chunks avoids the cost of Marshal.PtrToStructure on every single element in the memory list.
         // Empirically, this cache provides huge performance improvements for read memory.
-        // This cache could be completey removed if we used unsafe C# and just had direct pointers
-        // into the mapped dump file.
+        // (The chunk data itself is read through direct pointers into the mapped dump file;
+        // see GetViewPointer.)
         protected DumpNative.MinidumpMemoryChunks _memoryChunks;
         // The backup lookup method for memory that's not in the dump is to try and load the memory
         // from the same file on disk.
@@ -1718,6 +1759,11 @@ public DumpReader(string path)
             }
 
             _base = DumpPointer.DangerousMakeDumpPointer(_view.BaseAddress, (uint)length);
+            unsafe
+            {
+                _viewStart = (byte*)_view.BaseAddress.ToPointer();
+            }
+            _viewLength = (ulong)length;
 
             //
             // Cache stuff
@@ -1788,6 +1834,11 @@ private void EnsureValid()
         // This is useful for computing RVAs.
         private DumpPointer _base;
 
+        // The same thing, as a raw pointer plus the full (64-bit) length, for reading
+        // memory out of the dump (see GetViewPointer).
+        private unsafe byte* _viewStart;
+        private ulong _viewLength;
+
         // Cached info
         private DumpNative.MINIDUMP_SYSTEM_INFO _info;
 
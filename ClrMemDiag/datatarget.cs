@@ -774,6 +774,17 @@ public static DataTarget CreateFromDataReader(IDataReader reader)
             return CreateFromReader(reader, null);
         }
 
+        /// <summary>
+        /// Creates a DataReader that reads directly from a memory-mapped view of a crash dump,
+        /// without going through dbgeng. It is safe to read memory from it on any thread.
+        /// </summary>
+        /// <param name="fileName">The crash dump's filename.</param>
+        /// <returns>A new DataReader; the caller is responsible for calling Close on it.</returns>
+        public static IDataReader CreateDumpDataReader(string fileName)
+        {
+            return new DumpDataReader(fileName);
+        }
+
         private static DataTarget CreateFromReader(IDataReader reader, Interop.IDebugClient client)
         {
 #if _TRACING
@@ -2,6 +2,7 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 using System;
+using System.Collections.Generic;
 using System.Diagnostics;
 using System.Runtime.InteropServices;
 using System.IO;
@@ -269,53 +270,137 @@ public bool GetThreadContext(uint threadID, uint contextFlags, uint contextSize,
 #endif
 
 
+    /// <summary>
+    /// An N-way set-associative cache of target memory pages.  Lookups hash the page number into a
+    /// set and compare tags against each way in the set; a miss reads the whole page and evicts the
+    /// least recently used way.  The total size of the cache is fixed at construction.
+    /// </summary>
     internal unsafe class MemoryReader
     {
         #region Variables
-        protected ulong _currPageStart;
-        protected int _currPageSize;
-        protected byte[] _data;
-        private byte[] _ptr;
-        private byte[] _dword;
+        public const int DefaultPageSize = 0x1000;
+        public const int DefaultWays = 4;
+
+        private const ulong EmptyTag = ulong.MaxValue;
+
         protected IDataReader _dataReader;
         protected int _cacheSize;
+
+        private readonly int _pageSize;
+        private readonly ulong _pageMask;       // ~(pageSize - 1)
+        private readonly int _pageShift;
+        private readonly int _ways;
+        private readonly int _setMask;
+
+        // Slot 's' holds the page starting at _tags[s]; its bytes live at _data[s * _pageSize], and
+        // only [_validStart[s], _validEnd[s]) of them could actually be read.
+        private readonly byte[] _data;
+        private readonly ulong[] _tags;
+        private readonly int[] _validStart;
+        private readonly int[] _validEnd;
+        private readonly uint[] _lastUse;
+        private uint _clock;
+        private int _lastSlot = -1;             // Most reads land on the same page as the last one.
+
+        private byte[] _prefetch;
+        private byte[] _ptr;
+        private byte[] _dword;
+
+        private long _hits;
+        private long _misses;
         #endregion
 
         public MemoryReader(IDataReader dataReader, int cacheSize)
+            : this(dataReader, cacheSize, DefaultPageSize, DefaultWays)
+        {
+        }
+
+        public MemoryReader(IDataReader dataReader, int cacheSize, int pageSize, int ways)
         {
-            _data = new byte[cacheSize];
+            if (cacheSize <= 0)
+                throw new ArgumentOutOfRangeException(nameof(cacheSize));
+
+            if (pageSize <= 0 || (pageSize & (pageSize - 1)) != 0)
+                throw new ArgumentOutOfRangeException(nameof(pageSize), "The page size must be a power of two.");
+
             _dataReader = dataReader;
             uint sz = _dataReader.GetPointerSize();
             if (sz != 4 && sz != 8)
                 throw new InvalidOperationException("DataReader reported an invalid pointer size.");
 
+            // Small caches (the runtime's, for instance) get a single page as big as the whole cache.
+            while (pageSize > cacheSize && pageSize > 16)
+                pageSize >>= 1;
+
+            int pages = Math.Max(1, cacheSize / pageSize);
+            ways = Math.Max(1, Math.Min(ways, pages));
+
+            int sets = 1;
+            while (sets * 2 * ways <= pages)
+                sets *= 2;
+
+            _pageSize = pageSize;
+            _pageMask = ~((ulong)pageSize - 1);
+            while ((1 << _pageShift) < pageSize)
+                _pageShift++;
+
+            _ways = ways;
+            _setMask = sets - 1;
+
+            int slots = sets * ways;
+            _data = new byte[slots * pageSize];
+            _tags = new ulong[slots];
+            _validStart = new int[slots];
+            _validEnd = new int[slots];
+            _lastUse = new uint[slots];
+            for (int i = 0; i < slots; i++)
+                _tags[i] = EmptyTag;
+
             _ptr = new byte[sz];
             _dword = new byte[4];
-            _cacheSize = cacheSize;
+            _cacheSize = slots * pageSize;
+        }
+
+        public int PageSize { get { return _pageSize; } }
+        public int Ways { get { return _ways; } }
+        public int Sets { get { return _setMask + 1; } }
+        public long Hits { get { return _hits; } }
+        public long Misses { get { return _misses; } }
+
+        /// <summary>
+        /// When non-null, the address of every ReadPtr/ReadDword call is appended here.  Used to
+        /// capture traces for replaying against different cache geometries.
+        /// </summary>
+        public List<ulong> Trace { get; set; }
+
+        public void ResetStatistics()
+        {
+            _hits = 0;
+            _misses = 0;
+        }
+
+        public void Clear()
+        {
+            for (int i = 0; i < _tags.Length; i++)
+                _tags[i] = EmptyTag;
+
+            _lastSlot = -1;
         }
 
         public bool ReadDword(ulong addr, out uint value)
         {
-            uint size = 4;
-            // Is addr on the current page?  If not read the page of memory addr is on.
-            // If this fails, we will fall back to a raw read out of the process (which
-            // is what MisalignedRead does).
-            if ((addr < _currPageStart) || (addr >= _currPageStart + (uint)_currPageSize))
-                if (!MoveToPage(addr))
-                    return MisalignedRead(addr, out value);
-
-            // If MoveToPage succeeds, we MUST be on the right page.
-            Debug.Assert(addr >= _currPageStart);
-
-            // However, the amount of data requested may fall off of the page.  In that case,
-            // fall back to MisalignedRead.
-            ulong offset = addr - _currPageStart;
-            if (offset + size > (uint)_currPageSize)
+            Trace?.Add(addr);
+
+            // Find (or load) the page addr is on.  If that fails, or the dword falls off the end
+            // of what we could read, fall back to a raw read out of the process (which is what
+            // MisalignedRead does).
+            int offset = GetOffset(addr, 4, true);
+            if (offset < 0)
                 return MisalignedRead(addr, out value);
 
-            // If we reach here we know we are on the right page of memory in the cache, and
-            // that the read won't fall off of the end of the page.
-            value = BitConverter.ToUInt32(_data, (int)offset);
+            fixed (byte* b = &_data[offset])
+                value = *((uint*)b);
+
             return true;
         }
 
@@ -330,79 +415,57 @@ public bool ReadDword(ulong addr, out int value)
 
         internal bool TryReadPtr(ulong addr, out ulong value)
         {
-            if ((_currPageStart <= addr) && (addr - _currPageStart < (uint)_currPageSize))
-            {
-                ulong offset = addr - _currPageStart;
-                fixed (byte* b = &_data[offset])
-                    if (_ptr.Length == 4)
+            // The TryRead* functions only look in the cache; they never evict anything.
+            int offset = GetOffset(addr, _ptr.Length, false);
+            if (offset < 0)
+                return MisalignedRead(addr, out value);
+
+            fixed (byte* b = &_data[offset])
+                if (_ptr.Length == 4)
                     value = *((uint*)b);
                 else
                     value = *((ulong*)b);
 
-                return true;
-            }
-
-            return MisalignedRead(addr, out value);
+            return true;
         }
 
         internal bool TryReadDword(ulong addr, out uint value)
         {
-            if ((_currPageStart <= addr) && (addr - _currPageStart < (uint)_currPageSize))
-            {
-                ulong offset = addr - _currPageStart;
-                value = BitConverter.ToUInt32(_data, (int)offset);
-                fixed (byte* b = &_data[offset])
-                    value = *((uint*)b);
-                return true;
-            }
+            int offset = GetOffset(addr, 4, false);
+            if (offset < 0)
+                return MisalignedRead(addr, out value);
+
+            fixed (byte* b = &_data[offset])
+                value = *((uint*)b);
 
-            return MisalignedRead(addr, out value);
+            return true;
         }
 
         internal bool TryReadDword(ulong addr, out int value)
         {
-            if ((_currPageStart <= addr) && (addr - _currPageStart < (uint)_currPageSize))
-            {
-                ulong offset = addr - _currPageStart;
-                fixed (byte* b = &_data[offset])
-                    value = *((int*)b);
+            int offset = GetOffset(addr, 4, false);
+            if (offset < 0)
+                return MisalignedRead(addr, out value);
 
-                return true;
-            }
+            fixed (byte* b = &_data[offset])
+                value = *((int*)b);
 
-            return MisalignedRead(addr, out value);
+            return true;
         }
 
         public bool ReadPtr(ulong addr, out ulong value)
         {
-            // Is addr on the current page?  If not read the page of memory addr is on.
-            // If this fails, we will fall back to a raw read out of the process (which
-            // is what MisalignedRead does).
-            if ((addr < _currPageStart) || (addr - _currPageStart > (uint)_currPageSize))
-                if (!MoveToPage(addr))
-                    return MisalignedRead(addr, out value);
-
-            // If MoveToPage succeeds, we MUST be on the right page.
-            Debug.Assert(addr >= _currPageStart);
+            Trace?.Add(addr);
 
-            // However, the amount of data requested may fall off of the page.  In that case,
-            // fall back to MisalignedRead.
-            ulong offset = addr - _currPageStart;
-            if (offset + (uint)_ptr.Length > (uint)_currPageSize)
-            {
-                if (!MoveToPage(addr))
-                    return MisalignedRead(addr, out value);
-
-                offset = 0;
-            }
+            int offset = GetOffset(addr, _ptr.Length, true);
+            if (offset < 0)
+                return MisalignedRead(addr, out value);
 
-            // If we reach here we know we are on the right page of memory in the cache, and
-            // that the read won't fall off of the end of the page.
             fixed (byte* b = &_data[offset])
                 if (_ptr.Length == 4)
-                value = *((uint*)b);
-            else
-                value = *((ulong*)b);
+                    value = *((uint*)b);
+                else
+                    value = *((ulong*)b);
 
             return true;
         }
@@ -413,22 +476,207 @@ virtual public void EnsureRangeInCache(ulong addr)
                 MoveToPage(addr);
         }
 
-
         public bool Contains(ulong addr)
         {
-            return ((_currPageStart <= addr) && (addr - _currPageStart < (uint)_currPageSize));
+            return FindSlot(addr) >= 0;
+        }
+
+        /// <summary>
+        /// Makes sure the 'pages' pages following the one addr is on are in the cache.  Linear
+        /// scans call this as they cross onto a new page; if any of the window is missing, this
+        /// reads a full 'pages' pages starting at the first missing one, with a single read, so
+        /// that a scan only goes back to the data reader once every 'pages' pages.  Checking
+        /// the window does not count as a use of the pages in it (they shouldn't be kept
+        /// around just because the scan is approaching them).
+        /// </summary>
+        public void Prefetch(ulong addr, int pages)
+        {
+            ulong start = (addr & _pageMask) + (ulong)_pageSize;
+            int cached = 0;
+            while (cached < pages && start != 0 && IsCached(start))
+            {
+                start += (ulong)_pageSize;
+                cached++;
+            }
+
+            // The whole window is already here.
+            if (cached == pages)
+                return;
+
+            // Don't prefetch more than a quarter of the cache, or we would evict the pages the
+            // caller is still using.
+            pages = Math.Min(pages, Math.Max(1, _tags.Length / 4));
+            if (pages <= 0 || start == 0 || start + (ulong)(pages * _pageSize) < start)
+                return;
+
+            int size = pages * _pageSize;
+            if (_prefetch == null || _prefetch.Length < size)
+                _prefetch = new byte[size];
+
+            int read;
+            fixed (byte* b = _prefetch)
+            {
+                if (!_dataReader.ReadMemory(start, new IntPtr(b), size, out read))
+                    return;
+
+                for (int offset = 0; offset < read; offset += _pageSize)
+                {
+                    ulong tag = start + (ulong)offset;
+                    if (IsCached(tag))
+                        continue;
+
+                    int slot = ChooseVictim(tag);
+                    int valid = Math.Min(_pageSize, read - offset);
+                    Buffer.BlockCopy(_prefetch, offset, _data, slot * _pageSize, valid);
+                    Fill(slot, tag, 0, valid);
+                }
+            }
         }
 
         #region Private Functions
+        /// <summary>
+        /// Returns the index into _data of addr, if the 'size' bytes starting there are all cached
+        /// on a single page.  If 'load' is set, a page that isn't cached is read in.  Returns -1 on
+        /// failure.
+        /// </summary>
+        private int GetOffset(ulong addr, int size, bool load)
+        {
+            int slot = FindSlot(addr);
+            if (slot >= 0)
+            {
+                _hits++;
+            }
+            else if (load)
+            {
+                _misses++;
+                slot = LoadPage(addr);
+                if (slot < 0)
+                    return -1;
+            }
+            else
+            {
+                return -1;
+            }
+
+            int offset = (int)(addr - _tags[slot]);
+            if (offset + size > _validEnd[slot])
+                return -1;
+
+            return slot * _pageSize + offset;
+        }
+
+        private int FindSlot(ulong addr)
+        {
+            ulong tag = addr & _pageMask;
+            int offset = (int)(addr - tag);
+
+            int slot = _lastSlot;
+            if (slot >= 0 && _tags[slot] == tag && _validStart[slot] <= offset && offset < _validEnd[slot])
+                return slot;
+
+            slot = ((int)(addr >> _pageShift) & _setMask) * _ways;
+            for (int end = slot + _ways; slot < end; slot++)
+            {
+                if (_tags[slot] == tag)
+                {
+                    if (offset < _validStart[slot] || offset >= _validEnd[slot])
+                        return -1;
+
+                    _lastUse[slot] = ++_clock;
+                    _lastSlot = slot;
+                    return slot;
+                }
+            }
+
+            return -1;
+        }
+
+        /// <summary>
+        /// Like FindSlot, but for looking without using: doesn't update the LRU clock or
+        /// _lastSlot.
+        /// </summary>
+        private bool IsCached(ulong addr)
+        {
+            ulong tag = addr & _pageMask;
+            int offset = (int)(addr - tag);
+
+            int slot = ((int)(addr >> _pageShift) & _setMask) * _ways;
+            for (int end = slot + _ways; slot < end; slot++)
+            {
+                if (_tags[slot] == tag)
+                    return _validStart[slot] <= offset && offset < _validEnd[slot];
+            }
+
+            return false;
+        }
+
+        private int ChooseVictim(ulong tag)
+        {
+            int first = ((int)(tag >> _pageShift) & _setMask) * _ways;
+            int victim = first;
+            for (int slot = first; slot < first + _ways; slot++)
+            {
+                // A stale, partially read copy of the same page has to be the one we replace.
+                if (_tags[slot] == tag || _tags[slot] == EmptyTag)
+                    return slot;
+
+                if (_lastUse[slot] < _lastUse[victim])
+                    victim = slot;
+            }
+
+            return victim;
+        }
+
+        private void Fill(int slot, ulong tag, int validStart, int validEnd)
+        {
+            _tags[slot] = tag;
+            _validStart[slot] = validStart;
+            _validEnd[slot] = validEnd;
+            _lastUse[slot] = ++_clock;
+            _lastSlot = slot;
+        }
+
+        private int LoadPage(ulong addr)
+        {
+            ulong tag = addr & _pageMask;
+            int offset = (int)(addr - tag);
+            int slot = ChooseVictim(tag);
+
+            // Mark the slot empty until we know what it holds.
+            _tags[slot] = EmptyTag;
+            if (_lastSlot == slot)
+                _lastSlot = -1;
+
+            int read;
+            fixed (byte* b = &_data[slot * _pageSize])
+            {
+                if (_dataReader.ReadMemory(tag, new IntPtr(b), _pageSize, out read) && offset < read)
+                {
+                    Fill(slot, tag, 0, read);
+                    return slot;
+                }
+
+                // The start of the page is unreadable (or the read came up short); try again
+                // starting at addr itself, as the old single-page cache did.
+                if (_dataReader.ReadMemory(addr, new IntPtr(b + offset), _pageSize - offset, out read) && read > 0)
+                {
+                    Fill(slot, tag, offset, offset + read);
+                    return slot;
+                }
+            }
+
+            return -1;
+        }
+
         private bool MisalignedRead(ulong addr, out ulong value)
         {
             int size = 0;
             bool res = _dataReader.ReadMemory(addr, _ptr, _ptr.Length, out size);
             fixed (byte* b = _ptr)
                 if (_ptr.Length == 4)
-                value = *((uint*)b);
-            else
-                value = *((ulong*)b);
+                    value = *((uint*)b);
+                else
+                    value = *((ulong*)b);
             return res;
         }
 
@@ -455,16 +703,7 @@ virtual protected bool MoveToPage(ulong addr)
 
         protected virtual bool ReadMemory(ulong addr)
         {
-            _currPageStart = addr;
-            bool res = _dataReader.ReadMemory(_currPageStart, _data, _cacheSize, out _currPageSize);
-
-            if (!res)
-            {
-                _currPageStart = 0;
-                _currPageSize = 0;
-            }
-
-            return res;
+            return LoadPage(addr) >= 0;
         }
         #endregion
     }
@@ -4,6 +4,8 @@
 #include "dbgeng.h"
 #undef DEBUG_PROCESS // We want to use the managed enum definition.
 #include "DbgEngWrapper.h"
+#include <vector>
+#include <msclr\lock.h>
 
 using namespace System;
 using namespace System::Text;
@@ -193,6 +195,30 @@ public interface class IDebugOutputCallbacksImp
 };
 
 
+// Managed output callbacks can implement this instead if they want whole lines. Rather
+// than getting every chunk of output that dbgeng produces as a new String (which can be
+// hundreds of thousands of them for things like "dt -r"), output is accumulated on the
+// native side, and the complete lines are handed over in batches.
+//
+// Text points to Count lines laid out back to back, with no line terminators; line i
+// ends at LineEnds[ i ] (an Int32 offset, in characters). Every line in a batch was
+// produced with the same Mask. The memory is only valid for the duration of the call.
+public interface class IDebugOutputLinesCallbacksImp : IDebugOutputCallbacksImp
+{
+//public:
+    int OutputLines(
+        [In] DEBUG_OUTPUT Mask,
+        [In] IntPtr Text,
+        [In] IntPtr LineEnds,
+        [In] Int32 Count);
+
+    // The adapter calls this once, with something that the managed side can call to
+    // get any partial (unterminated) line that is still being buffered.
+    void SetFlushCallback(
+        [In] Action^ Flush);
+};
+
+
 //
 // COM Interfaces
 //
@@ -801,8 +827,151 @@ public:
 }; // end class DbgEngInputCallbacksAdapter
 
 
+// Accumulates dbgeng output (minus any '\r's) for DbgEngOutputCallbacksAdapter, keeping
+// track of where each complete line ends. Anything after the last line end is a partial
+// line.
+class OutputLineBuffer
+{
+public:
+    OutputLineBuffer()
+        : m_linesMask( 0 ),
+          m_partialMask( 0 )
+    {
+        m_text.reserve( 4096 );
+        m_lineEnds.reserve( 64 );
+    }
+
+    void Append( PCWSTR text, size_t cch, ULONG mask )
+    {
+        m_text.insert( m_text.end(), text, text + cch );
+        m_partialMask |= mask;
+    }
+
+    // True if the partial line, were it to end now, would not go in the same batch as
+    // the lines that are already complete.
+    bool EndLineNeedsNewBatch() const
+    {
+        return !m_lineEnds.empty() && (m_linesMask != m_partialMask);
+    }
+
+    void EndLine()
+    {
+        m_linesMask = m_lineEnds.empty() ? m_partialMask : (m_linesMask | m_partialMask);
+        m_partialMask = 0;
+        m_lineEnds.push_back( (int) m_text.size() );
+    }
+
+    bool HasLines() const { return !m_lineEnds.empty(); }
+    bool HasPartialLine() const { return (0 != m_partialMask) || (m_text.size() > _EndOfLines()); }
+
+    ULONG LinesMask() const { return m_linesMask; }
+    int LineCount() const { return (int) m_lineEnds.size(); }
+    const wchar_t* Text() const { return m_text.data(); }
+    const int* LineEnds() const { return m_lineEnds.data(); }
+
+    // Moves the partial line (if any) into other, which must be empty.
+    void MovePartialLineTo( OutputLineBuffer& other )
+    {
+        size_t end = _EndOfLines();
+        other.m_text.assign( m_text.begin() + end, m_text.end() );
+        other.m_partialMask = m_partialMask;
+        m_text.resize( end );
+        m_partialMask = 0;
+    }
+
+    void Clear()
+    {
+        m_text.clear();
+        m_lineEnds.clear();
+        m_linesMask = 0;
+        m_partialMask = 0;
+    }
+
+private:
+    size_t _EndOfLines() const { return m_lineEnds.empty() ? 0 : (size_t) m_lineEnds.back(); }
+
+    std::vector< wchar_t > m_text;
+    std::vector< int > m_lineEnds;
+    ULONG m_linesMask;   // the union of the masks of the complete lines
+    ULONG m_partialMask; // the union of the masks of the pieces of the partial line
+}; // end class OutputLineBuffer
+
+
 public ref class DbgEngOutputCallbacksAdapter : DbgEngCallbacksAdapter<IDebugOutputCallbacksImp, &IID_IDebugOutputCallbacksWide>, IComDbgEngOutputCallbacks
 {
+private:
+    IDebugOutputLinesCallbacksImp^ m_linesCallbacks;
+
+    // Output is appended to m_pCurrent. When lines are delivered, the partial line is
+    // moved to m_pDelivering and the two are swapped, so that if the managed callback
+    // causes more output (on the same thread), it has somewhere to go.
+    OutputLineBuffer* m_pCurrent;
+    OutputLineBuffer* m_pDelivering;
+    bool m_isDelivering;
+
+    HRESULT _DeliverLines()
+    {
+        if( m_isDelivering )
+            return S_OK; // the outer _DeliverLines will get them
+
+        HRESULT hr = S_OK;
+        m_isDelivering = true;
+        try
+        {
+            while( m_pCurrent->HasLines() )
+            {
+                OutputLineBuffer* pLines = m_pCurrent;
+                pLines->MovePartialLineTo( *m_pDelivering );
+                m_pCurrent = m_pDelivering;
+                m_pDelivering = pLines;
+
+                hr = m_linesCallbacks->OutputLines( (DEBUG_OUTPUT) pLines->LinesMask(),
+                                                    IntPtr( (void*) pLines->Text() ),
+                                                    IntPtr( (void*) pLines->LineEnds() ),
+                                                    pLines->LineCount() );
+                pLines->Clear();
+            }
+        }
+        finally
+        {
+            m_isDelivering = false;
+        }
+        return hr;
+    }
+
+    HRESULT _BufferOutput( ULONG Mask, PCWSTR Text )
+    {
+        HRESULT hr = S_OK;
+        PCWSTR p = Text;
+        while( *p )
+        {
+            size_t cch = wcscspn( p, L"\r\n" );
+            m_pCurrent->Append( p, cch, Mask );
+            p += cch;
+
+            if( L'\r' == *p )
+            {
+                p++;
+            }
+            else if( L'\n' == *p )
+            {
+                if( m_pCurrent->EndLineNeedsNewBatch() )
+                    hr = _DeliverLines();
+
+                m_pCurrent->EndLine();
+                p++;
+            }
+        }
+
+        // We don't hold on to complete lines past the end of the chunk: there's no
+        // telling when (or if) dbgeng will send more output, and whoever is waiting for
+        // this line needs it now.
+        if( m_pCurrent->HasLines() )
+            hr = _DeliverLines();
+
+        return hr;
+    }
+
 public:
     // IDebugOutputCallbacksWide.
 
@@ -810,13 +979,62 @@ public:
         __in ULONG Mask,
         __in PCWSTR Text )
     {
-        return m_managedCallbacks->Output( (DEBUG_OUTPUT) Mask,
-                                           Text ? gcnew String( Text ) : nullptr );
+        if( nullptr == m_linesCallbacks )
+        {
+            return m_managedCallbacks->Output( (DEBUG_OUTPUT) Mask,
+                                               Text ? gcnew String( Text ) : nullptr );
+        }
+
+        if( !Text )
+            return S_OK;
+
+        msclr::lock l( this );
+        return _BufferOutput( Mask, Text );
+    }
+
+    // Hands over the partial line, if there is one.
+    void Flush()
+    {
+        if( nullptr == m_linesCallbacks )
+            return;
+
+        msclr::lock l( this );
+        if( m_pCurrent->HasPartialLine() )
+        {
+            if( m_pCurrent->EndLineNeedsNewBatch() )
+                _DeliverLines();
+
+            m_pCurrent->EndLine();
+            _DeliverLines();
+        }
     }
 
     DbgEngOutputCallbacksAdapter( IDebugOutputCallbacksImp^ managedCallbacks )
-        : DbgEngCallbacksAdapter( managedCallbacks )
+        : DbgEngCallbacksAdapter( managedCallbacks ),
+          m_pCurrent( nullptr ),
+          m_pDelivering( nullptr ),
+          m_isDelivering( false )
+    {
+        m_linesCallbacks = dynamic_cast< IDebugOutputLinesCallbacksImp^ >( managedCallbacks );
+        if( nullptr != m_linesCallbacks )
+        {
+            m_pCurrent = new OutputLineBuffer();
+            m_pDelivering = new OutputLineBuffer();
+            m_linesCallbacks->SetFlushCallback( gcnew Action( this, &DbgEngOutputCallbacksAdapter::Flush ) );
+        }
+    }
+
+    ~DbgEngOutputCallbacksAdapter()
+    {
+        this->!DbgEngOutputCallbacksAdapter();
+    }
+
+    !DbgEngOutputCallbacksAdapter()
     {
+        delete m_pCurrent;
+        m_pCurrent = nullptr;
+        delete m_pDelivering;
+        m_pDelivering = nullptr;
     }
 }; // end class DbgEngOutputCallbacksAdapter
 
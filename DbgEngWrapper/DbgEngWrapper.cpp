@@ -2352,6 +2352,223 @@ int WDebugControl::DisassembleWide(
     return hr;
 }
 
+
+// Like the batched reads in WDebugDataSpaces, the disassembly loop is compiled as native
+// code, so that a range of instructions costs one managed-to-native transition instead
+// of one per instruction.
+#pragma managed(push, off)
+
+// (These two are defined below, with ReadVirtualBatch.)
+static int NativeBatchSehFilter( EXCEPTION_POINTERS* pEp, HRESULT* pCode );
+
+static HRESULT ReadOneRangeWithSehProtection( ::IDebugDataSpaces4* pDds,
+                                              ULONG64 Offset,
+                                              BYTE* pDest,
+                                              ULONG Length,
+                                              ULONG* pBytesRead,
+                                              bool* pSehHappened );
+
+static HRESULT DisassembleOneWithSehProtection( ::IDebugControl6* pDc,
+                                                ULONG64 Offset,
+                                                ULONG Flags,
+                                                PWSTR Buffer,
+                                                ULONG BufferSize,
+                                                ULONG* pDisassemblySize,
+                                                ULONG64* pEndOffset,
+                                                bool* pSehHappened )
+{
+    HRESULT hr = 0;
+    __try
+    {
+        return pDc->DisassembleWide( Offset, Flags, Buffer, BufferSize, pDisassemblySize, pEndOffset );
+    }
+    __except( NativeBatchSehFilter( GetExceptionInformation(), &hr ) )
+    {
+        *pSehHappened = true;
+        return hr;
+    }
+}
+
+// On return, Offsets has one more element than TextEnds: the offset where the next
+// instruction would start.
+static HRESULT DisassembleRangeNative( ::IDebugControl6* pDc,
+                                       ::IDebugDataSpaces4* pDds,
+                                       ULONG64 Offset,
+                                       ULONG64 LastOffset,
+                                       ULONG MaxInstructions,
+                                       ULONG Flags,
+                                       std::vector< ULONG64 >& Offsets,
+                                       std::vector< wchar_t >& Text,
+                                       std::vector< size_t >& TextEnds,
+                                       std::vector< BYTE >& CodeBytes,
+                                       ULONG* pCodeBytesRead,
+                                       HRESULT* pFirstSehCode )
+{
+    HRESULT hrOverall = S_OK;
+    ULONG64 cur = Offset;
+    Offsets.push_back( cur );
+
+    while( (TextEnds.size() < MaxInstructions) && (cur <= LastOffset) )
+    {
+        size_t textStart = Text.size();
+        ULONG cchBuffer = 128;
+        ULONG cchNeeded = 0;
+        ULONG64 next = 0;
+        HRESULT hr = S_FALSE;
+
+        // S_FALSE means the buffer was too small.
+        while( S_FALSE == hr )
+        {
+            Text.resize( textStart + cchBuffer );
+            bool sehHappened = false;
+            hr = DisassembleOneWithSehProtection( pDc,
+                                                  cur,
+                                                  Flags,
+                                                  &Text[ textStart ],
+                                                  cchBuffer,
+                                                  &cchNeeded,
+                                                  &next,
+                                                  &sehHappened );
+            if( sehHappened && (S_OK == *pFirstSehCode) )
+            {
+                *pFirstSehCode = hr;
+            }
+
+            if( S_FALSE == hr )
+            {
+                cchBuffer = (cchNeeded > cchBuffer) ? cchNeeded : (cchBuffer * 2);
+            }
+        }
+
+        if( FAILED( hr ) || (next <= cur) )
+        {
+            Text.resize( textStart );
+            if( TextEnds.empty() )
+                return FAILED( hr ) ? hr : E_FAIL;
+
+            hrOverall = S_FALSE;
+            break;
+        }
+
+        Text.resize( textStart + wcsnlen( &Text[ textStart ], cchBuffer ) );
+        TextEnds.push_back( Text.size() );
+
+        cur = next;
+        Offsets.push_back( cur );
+    }
+
+    *pCodeBytesRead = 0;
+    ULONG64 cbCode = Offsets.back() - Offsets.front();
+    if( (cbCode > 0) && (cbCode <= ULONG_MAX) )
+    {
+        CodeBytes.resize( (size_t) cbCode );
+        bool sehHappened = false;
+        HRESULT hr = ReadOneRangeWithSehProtection( pDds,
+                                                    Offsets.front(),
+                                                    CodeBytes.data(),
+                                                    (ULONG) cbCode,
+                                                    pCodeBytesRead,
+                                                    &sehHappened );
+        if( sehHappened && (S_OK == *pFirstSehCode) )
+        {
+            *pFirstSehCode = hr;
+        }
+
+        if( FAILED( hr ) )
+            *pCodeBytesRead = 0;
+    }
+
+    return hrOverall;
+}
+
+#pragma managed(pop)
+
+
+int WDebugControl::DisassembleRange(
+    [In] UInt64 Offset,
+    [In] UInt64 LastOffset,
+    [In] ULONG MaxInstructions,
+    [In] DEBUG_DISASM Flags,
+    [Out] array<WDisassembledInstruction^>^% Instructions)
+{
+    WDebugClient::g_log->Write( L"DebugControl::DisassembleRange" );
+    Instructions = gcnew array<WDisassembledInstruction^>( 0 );
+
+    if( (0 == MaxInstructions) || (Offset > LastOffset) )
+        return S_OK;
+
+    ::IDebugDataSpaces4* pDds = nullptr;
+    HRESULT hr = m_pNative->QueryInterface( IID_IDebugDataSpaces4, (PVOID*) &pDds );
+    if( FAILED( hr ) )
+        return hr;
+
+    std::vector< ULONG64 > offsets;
+    std::vector< wchar_t > text;
+    std::vector< size_t > textEnds;
+    std::vector< BYTE > codeBytes;
+    ULONG codeBytesRead = 0;
+    HRESULT sehCode = S_OK;
+
+    try
+    {
+        hr = DisassembleRangeNative( m_pNative,
+                                     pDds,
+                                     Offset,
+                                     LastOffset,
+                                     MaxInstructions,
+                                     (ULONG) Flags,
+                                     offsets,
+                                     text,
+                                     textEnds,
+                                     codeBytes,
+                                     &codeBytesRead,
+                                     &sehCode );
+    }
+    finally
+    {
+        pDds->Release();
+    }
+
+    if( S_OK != sehCode )
+    {
+        String^ msg = String::Format( "SEH exception from dbgeng: 0x{0:x}", sehCode );
+        WDebugClient::g_notifyBadThingCallback( msg );
+    }
+
+    if( FAILED( hr ) )
+        return hr;
+
+    Instructions = gcnew array<WDisassembledInstruction^>( (int) textEnds.size() );
+    size_t textStart = 0;
+    for( size_t i = 0; i < textEnds.size(); i++ )
+    {
+        ULONG64 codeStart = offsets[ i ] - offsets[ 0 ];
+        ULONG length = (ULONG) (offsets[ i + 1 ] - offsets[ i ]);
+
+        array<byte>^ instructionBytes = nullptr;
+        if( (codeStart + length) <= codeBytesRead )
+        {
+            instructionBytes = gcnew array<byte>( length );
+            if( length > 0 )
+            {
+                Marshal::Copy( IntPtr( codeBytes.data() + codeStart ), instructionBytes, 0, length );
+            }
+        }
+
+        String^ disassembly = gcnew String( text.data(),
+                                            (int) textStart,
+                                            (int) (textEnds[ i ] - textStart) );
+        textStart = textEnds[ i ];
+
+        Instructions[ (int) i ] = gcnew WDisassembledInstruction( offsets[ i ],
+                                                                  length,
+                                                                  instructionBytes,
+                                                                  disassembly );
+    }
+
+    return hr;
+}
+
 int WDebugControl::GetProcessorTypeNamesWide(
 //       [In] IMAGE_FILE_MACHINE Type,
 //       [Out, MarshalAs(UnmanagedType.LPWStr)] StringBuilder FullNameBuffer,
@@ -5278,6 +5495,155 @@ int WDebugDataSpaces::ReadVirtualValue(
     return hr;
 }
 
+
+// The batched read loop is compiled as native code, so that servicing N ranges costs
+// one managed-to-native transition instead of N.
+#pragma managed(push, off)
+
+static int NativeBatchSehFilter( EXCEPTION_POINTERS* pEp, HRESULT* pCode )
+{
+    *pCode = pEp->ExceptionRecord->ExceptionCode;
+    return EXCEPTION_EXECUTE_HANDLER;
+}
+
+// Kept separate from the loop so that the __try/__except does not need object unwinding.
+static HRESULT ReadOneRangeWithSehProtection( ::IDebugDataSpaces4* pDds,
+                                              ULONG64 Offset,
+                                              BYTE* pDest,
+                                              ULONG Length,
+                                              ULONG* pBytesRead,
+                                              bool* pSehHappened )
+{
+    HRESULT hr = 0;
+    __try
+    {
+        return pDds->ReadVirtual( Offset, pDest, Length, pBytesRead );
+    }
+    __except( NativeBatchSehFilter( GetExceptionInformation(), &hr ) )
+    {
+        *pSehHappened = true;
+        return hr;
+    }
+}
+
+static HRESULT ReadVirtualBatchNative( ::IDebugDataSpaces4* pDds,
+                                       ULONG Count,
+                                       const ULONG64* Offsets,
+                                       const ULONG* Lengths,
+                                       BYTE* Buffer,
+                                       ULONG BufferSize,
+                                       ULONG* BytesRead,
+                                       HRESULT* Results,
+                                       HRESULT* pFirstSehCode )
+{
+    HRESULT hrOverall = S_OK;
+    ULONG64 destOffset = 0;
+
+    for( ULONG i = 0; i < Count; i++ )
+    {
+        BytesRead[ i ] = 0;
+
+        if( 0 == Lengths[ i ] )
+        {
+            Results[ i ] = S_OK;
+            continue;
+        }
+
+        if( (destOffset + Lengths[ i ]) > BufferSize )
+        {
+            // The caller did not give us enough room; this range and all the ones
+            // after it cannot be serviced.
+            for( ; i < Count; i++ )
+            {
+                BytesRead[ i ] = 0;
+                Results[ i ] = E_NOT_SUFFICIENT_BUFFER;
+            }
+            return S_FALSE;
+        }
+
+        bool sehHappened = false;
+        Results[ i ] = ReadOneRangeWithSehProtection( pDds,
+                                                      Offsets[ i ],
+                                                      Buffer + destOffset,
+                                                      Lengths[ i ],
+                                                      &BytesRead[ i ],
+                                                      &sehHappened );
+        if( sehHappened && (S_OK == *pFirstSehCode) )
+        {
+            *pFirstSehCode = Results[ i ];
+        }
+
+        if( (S_OK != Results[ i ]) || (BytesRead[ i ] != Lengths[ i ]) )
+        {
+            hrOverall = S_FALSE;
+        }
+
+        destOffset += Lengths[ i ];
+    }
+
+    return hrOverall;
+}
+
+#pragma managed(pop)
+
+
+int WDebugDataSpaces::ReadVirtualBatch(
+    [In] array<UInt64>^ Offsets,
+    [In] array<ULONG>^ Lengths,
+    [In] BYTE* Buffer,
+    [In] ULONG BufferSize,
+    [In,Out] array<ULONG>^ BytesRead,
+    [In,Out] array<int>^ Results)
+{
+    if( !Offsets )
+        throw gcnew ArgumentNullException( L"Offsets" );
+
+    if( !Lengths )
+        throw gcnew ArgumentNullException( L"Lengths" );
+
+    if( !BytesRead )
+        throw gcnew ArgumentNullException( L"BytesRead" );
+
+    if( !Results )
+        throw gcnew ArgumentNullException( L"Results" );
+
+    if( Lengths->Length != Offsets->Length )
+        throw gcnew ArgumentException( L"There must be exactly one length per offset.", L"Lengths" );
+
+    if( (BytesRead->Length < Offsets->Length) || (Results->Length < Offsets->Length) )
+        throw gcnew ArgumentException( L"The BytesRead and Results arrays must have room for every range." );
+
+    if( 0 == Offsets->Length )
+        return S_OK;
+
+    if( !Buffer )
+        throw gcnew ArgumentNullException( L"Buffer" );
+
+    pin_ptr<UInt64> ppOffsets = &Offsets[ 0 ];
+    pin_ptr<ULONG> ppLengths = &Lengths[ 0 ];
+    pin_ptr<ULONG> ppBytesRead = &BytesRead[ 0 ];
+    pin_ptr<int> ppResults = &Results[ 0 ];
+    HRESULT sehCode = S_OK;
+
+    int hr = ReadVirtualBatchNative( m_pNative,
+                                     static_cast<ULONG>( Offsets->Length ),
+                                     (const ULONG64*) ppOffsets,
+                                     (const ULONG*) ppLengths,
+                                     Buffer,
+                                     BufferSize,
+                                     (ULONG*) ppBytesRead,
+                                     (HRESULT*) ppResults,
+                                     &sehCode );
+
+    if( S_OK != sehCode )
+    {
+        String^ msg = String::Format( "SEH exception from dbgeng: 0x{0:x}", sehCode );
+        WDebugClient::g_notifyBadThingCallback( msg );
+    }
+
+    return hr;
+}
+
 // Note that not all bytes may be written!
 int WDebugDataSpaces::WriteVirtual(
     [In] UInt64 Offset,
@@ -1020,6 +1020,31 @@ namespace DbgEngWrapper
     };
 
 
+    // One instruction from WDebugControl::DisassembleRange.
+    public ref class WDisassembledInstruction
+    {
+    public:
+        initonly UInt64 Offset;
+        initonly ULONG Length;
+
+        // Null if the code bytes could not be read.
+        initonly array<byte>^ CodeBytes;
+
+        // The same text that DisassembleWide would produce for the instruction.
+        initonly String^ Disassembly;
+
+        WDisassembledInstruction( UInt64 offset,
+                                  ULONG length,
+                                  array<byte>^ codeBytes,
+                                  String^ disassembly )
+        {
+            Offset = offset;
+            Length = length;
+            CodeBytes = codeBytes;
+            Disassembly = disassembly;
+        }
+    };
+
     public ref class WDebugControl : WDebugEngInterface< ::IDebugControl6 >
     {
     public:
@@ -1626,6 +1651,21 @@ namespace DbgEngWrapper
             //[Out] ULONG% DisassemblySize,
             [Out] UInt64% EndOffset);
 
+        // Disassembles consecutive instructions starting at Offset, with a single
+        // transition to native code (and a single read for the code bytes). Stops after
+        // MaxInstructions instructions, or before the first instruction that starts
+        // after LastOffset, or at the first instruction that fails to disassemble.
+        //
+        // Returns S_OK if it stopped because of MaxInstructions or LastOffset, S_FALSE
+        // if it stopped early, or the error for the first instruction (in which case
+        // Instructions is empty).
+        int DisassembleRange(
+            [In] UInt64 Offset,
+            [In] UInt64 LastOffset,
+            [In] ULONG MaxInstructions,
+            [In] DEBUG_DISASM Flags,
+            [Out] array<WDisassembledInstruction^>^% Instructions);
+
         int GetProcessorTypeNamesWide(
             //[In] IMAGE_FILE_MACHINE Type,
             //[Out, MarshalAs(UnmanagedType.LPWStr)] StringBuilder FullNameBuffer,
@@ -2829,6 +2869,23 @@ namespace DbgEngWrapper
                 [In] UInt64 Offset,
                 [Out] TValue% value);
 
+        // Reads a batch of (Offsets[i], Lengths[i]) ranges with a single transition to
+        // native code. The data for each range is packed into Buffer back-to-back, in
+        // order (range i starts right after the Lengths[i - 1] bytes of range i - 1).
+        //
+        // A failure to read one range does not stop the batch: the HRESULT and the
+        // number of bytes read for each range are returned in Results and BytesRead
+        // (which must be allocated by the caller, at least as long as Offsets). The
+        // return value is S_OK if every range was read in full, S_FALSE if any range
+        // failed or was under-read.
+        int ReadVirtualBatch(
+            [In] array<UInt64>^ Offsets,
+            [In] array<ULONG>^ Lengths,
+            [In] BYTE* Buffer,
+            [In] ULONG BufferSize,
+            [In,Out] array<ULONG>^ BytesRead,
+            [In,Out] array<int>^ Results);
+
         // Note that not all bytes may be written!
         int WriteVirtual(
             [In] UInt64 Offset,
@@ -16,3 +16,58 @@ DBGNATIVEUTIL_API int fnDbgNativeUtil(void)
 }
 */
 
+
+DBGNATIVEUTIL_API int __cdecl DbgX86DecodeInstruction( const uint8_t* code,
+                                                       size_t codeSize,
+                                                       uint64_t address,
+                                                       int is64Bit,
+                                                       DBGX86_INSTRUCTION* pInstruction )
+{
+    return DbgX86Decode( code, codeSize, address, 0 != is64Bit, pInstruction );
+}
+
+
+DBGNATIVEUTIL_API size_t __cdecl DbgX86DecodeInstructions( const uint8_t* code,
+                                                           size_t codeSize,
+                                                           uint64_t address,
+                                                           int is64Bit,
+                                                           DBGX86_INSTRUCTION* pInstructions,
+                                                           size_t maxInstructions,
+                                                           size_t* pBytesDecoded )
+{
+    return DbgX86DecodeRange( code,
+                              codeSize,
+                              address,
+                              0 != is64Bit,
+                              pInstructions,
+                              maxInstructions,
+                              pBytesDecoded );
+}
+
+
+DBGNATIVEUTIL_API int __cdecl DbgX86FindCallBeforeReturn( const uint8_t* code,
+                                                          size_t codeSize,
+                                                          uint64_t returnAddress,
+                                                          int is64Bit,
+                                                          DBGX86_INSTRUCTION* pCall )
+{
+    return DbgX86FindCallBefore( code, codeSize, returnAddress, 0 != is64Bit, pCall ) ? 1 : 0;
+}
+
+
+DBGNATIVEUTIL_API size_t __cdecl DbgX86FindCallTargets( const uint8_t* code,
+                                                        size_t codeSize,
+                                                        uint64_t address,
+                                                        int is64Bit,
+                                                        DBGX86_CALL_SITE* pCallSites,
+                                                        size_t maxCallSites,
+                                                        size_t* pBytesScanned )
+{
+    return DbgX86FindCalls( code,
+                            codeSize,
+                            address,
+                            0 != is64Bit,
+                            pCallSites,
+                            maxCallSites,
+                            pBytesScanned );
+}
@@ -15,3 +15,39 @@ extern DBGNATIVEUTIL_API int nDbgNativeUtil;
 
 DBGNATIVEUTIL_API int fnDbgNativeUtil(void);
 */
+
+#include "X86Decoder.h"
+
+//
+// x86/x64 instruction decoding (see X86Decoder.h). These are thin wrappers for
+// P/Invoke (see X86Decoder.cs in DbgProvider); the "is64Bit" parameters are ints
+// because bool does not marshal the same way everywhere.
+//
+
+extern "C" DBGNATIVEUTIL_API int __cdecl DbgX86DecodeInstruction( const uint8_t* code,
+                                                                  size_t codeSize,
+                                                                  uint64_t address,
+                                                                  int is64Bit,
+                                                                  DBGX86_INSTRUCTION* pInstruction );
+
+extern "C" DBGNATIVEUTIL_API size_t __cdecl DbgX86DecodeInstructions( const uint8_t* code,
+                                                                      size_t codeSize,
+                                                                      uint64_t address,
+                                                                      int is64Bit,
+                                                                      DBGX86_INSTRUCTION* pInstructions,
+                                                                      size_t maxInstructions,
+                                                                      size_t* pBytesDecoded );
+
+extern "C" DBGNATIVEUTIL_API int __cdecl DbgX86FindCallBeforeReturn( const uint8_t* code,
+                                                                     size_t codeSize,
+                                                                     uint64_t returnAddress,
+                                                                     int is64Bit,
+                                                                     DBGX86_INSTRUCTION* pCall );
+
+extern "C" DBGNATIVEUTIL_API size_t __cdecl DbgX86FindCallTargets( const uint8_t* code,
+                                                                   size_t codeSize,
+                                                                   uint64_t address,
+                                                                   int is64Bit,
+                                                                   DBGX86_CALL_SITE* pCallSites,
+                                                                   size_t maxCallSites,
+                                                                   size_t* pBytesScanned );
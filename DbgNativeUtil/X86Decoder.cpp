@@ -0,0 +1,746 @@
+// X86Decoder.cpp : A table-driven x86/x64 instruction decoder. See X86Decoder.h.
+//
+// N.B. No Windows headers (and no precompiled header) in here: this file has to build
+// on its own.
+
+#include "X86Decoder.h"
+
+namespace
+{
+    //
+    // Opcode table entries.
+    //
+    // The low 16 bits describe what follows the opcode byte; the next 4 are the
+    // control flow kind (DBGX86_FLOW_*).
+    //
+
+    const uint32_t M    = 0x0001;   // ModRM (and maybe SIB and displacement)
+    const uint32_t Ib   = 0x0002;   // imm8
+    const uint32_t Iw   = 0x0004;   // imm16
+    const uint32_t Iz   = 0x0008;   // imm16/32, by operand size
+    const uint32_t Iv   = 0x0010;   // imm16/32/64, by operand size
+    const uint32_t Ao   = 0x0020;   // moffs, by address size
+    const uint32_t Ap   = 0x0040;   // far pointer: imm16/32 offset + imm16 selector
+    const uint32_t Jb   = 0x0080;   // rel8
+    const uint32_t Jz   = 0x0100;   // rel16/32
+    const uint32_t I64  = 0x0200;   // invalid in 64-bit mode
+    const uint32_t Bad  = 0x0400;   // invalid
+    const uint32_t Esc  = 0x0800;   // prefix or escape (handled before the table lookup)
+    const uint32_t G3   = 0x1000;   // F6/F7 group 3: imm only for /0 and /1 (test)
+    const uint32_t NoMem= 0x2000;   // ModRM always names registers (mov to/from cr/dr)
+
+    const uint32_t CALL = DBGX86_FLOW_CALL      << 16;
+    const uint32_t JMP  = DBGX86_FLOW_JUMP      << 16;
+    const uint32_t JCC  = DBGX86_FLOW_JCC       << 16;
+    const uint32_t RET  = DBGX86_FLOW_RETURN    << 16;
+    const uint32_t INT  = DBGX86_FLOW_INTERRUPT << 16;
+    const uint32_t SYS  = DBGX86_FLOW_SYSCALL   << 16;
+
+    const uint32_t MIb  = M | Ib;
+
+    const uint32_t sm_oneByte[ 256 ] =
+    {
+        //  0        1        2        3        4        5        6        7        8        9        A        B        C        D        E        F
+        M,       M,       M,       M,       Ib,      Iz,      I64,     I64,     M,       M,       M,       M,       Ib,      Iz,      I64,     Esc,      // 0
+        M,       M,       M,       M,       Ib,      Iz,      I64,     I64,     M,       M,       M,       M,       Ib,      Iz,      I64,     I64,      // 1
+        M,       M,       M,       M,       Ib,      Iz,      Esc,     I64,     M,       M,       M,       M,       Ib,      Iz,      Esc,     I64,      // 2
+        M,       M,       M,       M,       Ib,      Iz,      Esc,     I64,     M,       M,       M,       M,       Ib,      Iz,      Esc,     I64,      // 3
+        0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,        // 4
+        0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       0,        // 5
+        I64,     I64,     M|I64,   M,       Esc,     Esc,     Esc,     Esc,     Iz,      M|Iz,    Ib,      MIb,     0,       0,       0,       0,        // 6
+        Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,   // 7
+        MIb,     M|Iz,    MIb|I64, MIb,     M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // 8
+        0,       0,       0,       0,       0,       0,       0,       0,       0,       0,       Ap|I64|CALL, 0,   0,       0,       0,       0,        // 9
+        Ao,      Ao,      Ao,      Ao,      0,       0,       0,       0,       Ib,      Iz,      0,       0,       0,       0,       0,       0,        // A
+        Ib,      Ib,      Ib,      Ib,      Ib,      Ib,      Ib,      Ib,      Iv,      Iv,      Iv,      Iv,      Iv,      Iv,      Iv,      Iv,       // B
+        MIb,     MIb,     Iw|RET,  RET,     M|I64,   M|I64,   MIb,     M|Iz,    Iw|Ib,   0,       Iw|RET,  RET,     INT,     Ib|INT,  I64|INT, RET,      // C
+        M,       M,       M,       M,       Ib|I64,  Ib|I64,  I64,     0,       M,       M,       M,       M,       M,       M,       M,       M,        // D
+        Jb|JCC,  Jb|JCC,  Jb|JCC,  Jb|JCC,  Ib,      Ib,      Ib,      Ib,      Jz|CALL, Jz|JMP,  Ap|I64|JMP, Jb|JMP, 0,     0,       0,       0,        // E
+        Esc,     INT,     Esc,     Esc,     0,       0,       M|G3,    M|G3,    0,       0,       0,       0,       0,       0,       M,       M,        // F
+    };
+
+    const uint32_t sm_0F[ 256 ] =
+    {
+        //  0        1        2        3        4        5        6        7        8        9        A        B        C        D        E        F
+        M,       M,       M,       M,       Bad,     SYS,     0,       RET,     0,       0,       Bad,     0,       Bad,     M,       0,       Esc,      // 0
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // 1
+        M|NoMem, M|NoMem, M|NoMem, M|NoMem, Bad,     Bad,     Bad,     Bad,     M,       M,       M,       M,       M,       M,       M,       M,        // 2
+        0,       0,       0,       0,       SYS,     RET,     Bad,     0,       Esc,     Bad,     Esc,     Bad,     Bad,     Bad,     Bad,     Bad,      // 3
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // 4
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // 5
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // 6
+        MIb,     MIb,     MIb,     MIb,     M,       M,       M,       0,       M,       M,       Bad,     Bad,     M,       M,       M,       M,        // 7
+        Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,  Jz|JCC,   // 8
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // 9
+        0,       0,       0,       M,       MIb,     M,       Bad,     Bad,     0,       0,       0,       M,       MIb,     M,       M,       M,        // A
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       MIb,     M,       M,       M,       M,       M,        // B
+        M,       M,       MIb,     M,       MIb,     MIb,     MIb,     M,       0,       0,       0,       0,       0,       0,       0,       0,        // C
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // D
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // E
+        M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,       M,        // F
+    };
+
+
+    struct Reader
+    {
+        const uint8_t* Code;
+        size_t Limit;       // min( CodeSize, DBGX86_MAX_INSTRUCTION_LENGTH )
+        size_t CodeSize;
+        size_t Pos;
+
+        // Returns DBGX86_OK if there are n more bytes.
+        int Need( size_t n ) const
+        {
+            if( (Pos + n) <= Limit )
+                return DBGX86_OK;
+
+            // If we ran into the end of the code before the length limit, more code
+            // might have made it work.
+            if( (Pos + n) > DBGX86_MAX_INSTRUCTION_LENGTH )
+                return DBGX86_E_INVALID;
+
+            return DBGX86_E_TRUNCATED;
+        }
+
+        uint8_t Peek() const { return Code[ Pos ]; }
+        uint8_t Next() { return Code[ Pos++ ]; }
+    };
+
+
+    uint64_t ReadLittleEndian( const uint8_t* p, size_t size )
+    {
+        uint64_t val = 0;
+        for( size_t i = 0; (i < size) && (i < 8); i++ )
+        {
+            val |= ((uint64_t) p[ i ]) << (i * 8);
+        }
+        return val;
+    }
+
+    int64_t SignExtend( uint64_t val, size_t size )
+    {
+        switch( size )
+        {
+            case 1: return (int8_t) val;
+            case 2: return (int16_t) val;
+            case 4: return (int32_t) val;
+            default: return (int64_t) val;
+        }
+    }
+
+
+    // Handles the VEX (C4/C5), EVEX (62) and XOP (8F) prefixes. Returns DBGX86_OK and
+    // sets *pIsVex if the byte at r.Pos - 1 starts one of them, in which case the
+    // opcode map, opcode and table entry are filled in.
+    int TryDecodeVex( Reader& r,
+                      uint8_t lead,
+                      bool is64Bit,
+                      DBGX86_INSTRUCTION* pInstr,
+                      uint32_t* pEntry,
+                      bool* pIsVex )
+    {
+        *pIsVex = false;
+
+        int status = r.Need( 1 );
+        if( DBGX86_OK != status )
+            return status;
+
+        uint8_t p0 = r.Peek();
+
+        if( 0x8F == lead )
+        {
+            // XOP, if the map field is 8 or more; otherwise it's POP r/m.
+            if( (p0 & 0x1F) < 8 )
+                return DBGX86_OK;
+        }
+        else if( !is64Bit && ((p0 & 0xC0) != 0xC0) )
+        {
+            // In 32-bit mode, these are LES/LDS/BOUND unless ModRM.mod would be 11.
+            return DBGX86_OK;
+        }
+
+        *pIsVex = true;
+
+        // None of these can have a legacy SIMD prefix, LOCK, or REX in front.
+        if( (pInstr->Prefixes & (DBGX86_PFX_LOCK | DBGX86_PFX_REP | DBGX86_PFX_REPNE | DBGX86_PFX_OPSIZE)) ||
+            (0 != pInstr->Rex) )
+        {
+            return DBGX86_E_INVALID;
+        }
+
+        size_t prefixBytes;
+        uint8_t map;
+        bool w = false;
+        switch( lead )
+        {
+            case 0xC5:
+                prefixBytes = 1;
+                map = DBGX86_MAP_0F;
+                pInstr->Prefixes |= DBGX86_PFX_VEX;
+                break;
+
+            case 0xC4:
+            case 0x8F:
+                prefixBytes = 2;
+                status = r.Need( 2 );
+                if( DBGX86_OK != status )
+                    return status;
+
+                w = 0 != (r.Code[ r.Pos + 1 ] & 0x80);
+                map = p0 & 0x1F;
+                if( 0xC4 == lead )
+                {
+                    if( (map < DBGX86_MAP_0F) || (map > DBGX86_MAP_0F3A) )
+                        return DBGX86_E_INVALID;
+                }
+                else
+                {
+                    if( map > DBGX86_MAP_XOPA )
+                        return DBGX86_E_INVALID;
+                }
+                pInstr->Prefixes |= DBGX86_PFX_VEX;
+                break;
+
+            default: // 0x62
+                prefixBytes = 3;
+                status = r.Need( 3 );
+                if( DBGX86_OK != status )
+                    return status;
+
+                w = 0 != (r.Code[ r.Pos + 1 ] & 0x80);
+                map = p0 & 0x07;
+                if( (DBGX86_MAP_1BYTE == map) || (DBGX86_MAP_3DNOW == map) || (7 == map) )
+                    return DBGX86_E_INVALID;
+
+                pInstr->Prefixes |= DBGX86_PFX_EVEX;
+                break;
+        }
+
+        r.Pos += prefixBytes;
+
+        status = r.Need( 1 );
+        if( DBGX86_OK != status )
+            return status;
+
+        uint8_t opcode = r.Next();
+        pInstr->OpcodeMap = map;
+        pInstr->Opcode = opcode;
+        if( w )
+            pInstr->OperandSize = 8;
+
+        switch( map )
+        {
+            case DBGX86_MAP_0F:
+                // Same immediates as the legacy encoding, but always a ModRM (except
+                // for vzeroupper/vzeroall).
+                if( 0x77 == opcode )
+                    *pEntry = 0;
+                else
+                    *pEntry = M | (sm_0F[ opcode ] & Ib);
+                break;
+
+            case DBGX86_MAP_0F3A:
+            case DBGX86_MAP_XOP8:
+                *pEntry = MIb;
+                break;
+
+            case DBGX86_MAP_XOPA:
+                // (Always a 32-bit immediate, whatever the operand size.)
+                *pEntry = M | Iz;
+                pInstr->OperandSize = 4;
+                break;
+
+            default:
+                *pEntry = M;
+                break;
+        }
+
+        return DBGX86_OK;
+    } // end TryDecodeVex()
+
+
+    void SetMemoryAddress( DBGX86_INSTRUCTION* pInstr, uint64_t addr )
+    {
+        pInstr->MemoryAddress = addr;
+        pInstr->Flags |= DBGX86_F_MEMORY_ADDRESS;
+    }
+} // end anonymous namespace
+
+
+int DbgX86Decode( const uint8_t* Code,
+                  size_t CodeSize,
+                  uint64_t Address,
+                  bool Is64Bit,
+                  DBGX86_INSTRUCTION* pInstruction )
+{
+    if( !pInstruction )
+        return DBGX86_E_INVALID;
+
+    *pInstruction = DBGX86_INSTRUCTION();
+    DBGX86_INSTRUCTION* pInstr = pInstruction;
+    pInstr->Address = Address;
+
+    if( !Code )
+        return DBGX86_E_TRUNCATED;
+
+    Reader r;
+    r.Code = Code;
+    r.CodeSize = CodeSize;
+    r.Limit = (CodeSize < DBGX86_MAX_INSTRUCTION_LENGTH) ? CodeSize : DBGX86_MAX_INSTRUCTION_LENGTH;
+    r.Pos = 0;
+
+    int status;
+    uint8_t segment = 0;
+
+    //
+    // Prefixes.
+    //
+    for( ;; )
+    {
+        status = r.Need( 1 );
+        if( DBGX86_OK != status )
+            return status;
+
+        uint8_t b = r.Peek();
+        uint8_t pfx = 0;
+        switch( b )
+        {
+            case 0xF0: pfx = DBGX86_PFX_LOCK; break;
+            case 0xF2: pfx = DBGX86_PFX_REPNE; break;
+            case 0xF3: pfx = DBGX86_PFX_REP; break;
+            case 0x66: pfx = DBGX86_PFX_OPSIZE; break;
+            case 0x67: pfx = DBGX86_PFX_ADDRSIZE; break;
+            case 0x26:
+            case 0x2E:
+            case 0x36:
+            case 0x3E:
+            case 0x64:
+            case 0x65:
+                pfx = DBGX86_PFX_SEGMENT;
+                segment = b;
+                break;
+        }
+
+        if( pfx )
+        {
+            // Of F2 and F3, the last one wins.
+            if( pfx & (DBGX86_PFX_REP | DBGX86_PFX_REPNE) )
+                pInstr->Prefixes &= ~(DBGX86_PFX_REP | DBGX86_PFX_REPNE);
+
+            pInstr->Prefixes |= pfx;
+
+            // A REX prefix only counts if it comes right before the opcode.
+            pInstr->Rex = 0;
+            r.Pos++;
+            continue;
+        }
+
+        if( Is64Bit && (0x40 == (b & 0xF0)) )
+        {
+            pInstr->Rex = b;
+            r.Pos++;
+            continue;
+        }
+
+        break;
+    }
+
+    pInstr->OperandSize = 4;
+    if( pInstr->Rex & 0x08 )
+        pInstr->OperandSize = 8;
+    else if( pInstr->Prefixes & DBGX86_PFX_OPSIZE )
+        pInstr->OperandSize = 2;
+
+    if( Is64Bit )
+        pInstr->AddressSize = (pInstr->Prefixes & DBGX86_PFX_ADDRSIZE) ? 4 : 8;
+    else
+        pInstr->AddressSize = (pInstr->Prefixes & DBGX86_PFX_ADDRSIZE) ? 2 : 4;
+
+    //
+    // Opcode.
+    //
+    uint8_t b = r.Next();
+    uint32_t entry;
+    bool isVex = false;
+
+    if( 0x0F == b )
+    {
+        status = r.Need( 1 );
+        if( DBGX86_OK != status )
+            return status;
+
+        b = r.Next();
+        if( 0x38 == b )
+        {
+            status = r.Need( 1 );
+            if( DBGX86_OK != status )
+                return status;
+
+            pInstr->OpcodeMap = DBGX86_MAP_0F38;
+            pInstr->Opcode = r.Next();
+            entry = M;
+        }
+        else if( 0x3A == b )
+        {
+            status = r.Need( 1 );
+            if( DBGX86_OK != status )
+                return status;
+
+            pInstr->OpcodeMap = DBGX86_MAP_0F3A;
+            pInstr->Opcode = r.Next();
+            entry = MIb;
+        }
+        else if( 0x0F == b )
+        {
+            // 3DNow!: the opcode is the byte after the operands.
+            pInstr->OpcodeMap = DBGX86_MAP_3DNOW;
+            entry = MIb;
+        }
+        else
+        {
+            pInstr->OpcodeMap = DBGX86_MAP_0F;
+            pInstr->Opcode = b;
+            entry = sm_0F[ b ];
+        }
+    }
+    else
+    {
+        if( (0xC4 == b) || (0xC5 == b) || (0x62 == b) || (0x8F == b) )
+        {
+            status = TryDecodeVex( r, b, Is64Bit, pInstr, &entry, &isVex );
+            if( DBGX86_OK != status )
+                return status;
+        }
+
+        if( !isVex )
+        {
+            pInstr->OpcodeMap = DBGX86_MAP_1BYTE;
+            pInstr->Opcode = b;
+            entry = sm_oneByte[ b ];
+        }
+    }
+
+    if( (entry & (Bad | Esc)) || (Is64Bit && (entry & I64)) )
+        return DBGX86_E_INVALID;
+
+    //
+    // ModRM, SIB, displacement.
+    //
+    uint8_t reg = 0;
+    bool absolute = false;
+    bool ripRelative = false;
+    if( entry & M )
+    {
+        status = r.Need( 1 );
+        if( DBGX86_OK != status )
+            return status;
+
+        uint8_t modrm = r.Next();
+        pInstr->ModRm = modrm;
+        pInstr->Flags |= DBGX86_F_MODRM;
+
+        uint8_t mod = modrm >> 6;
+        uint8_t rm = modrm & 7;
+        reg = (modrm >> 3) & 7;
+
+        if( (3 != mod) && !(entry & NoMem) )
+        {
+            if( 2 == pInstr->AddressSize )
+            {
+                if( ((0 == mod) && (6 == rm)) || (2 == mod) )
+                    pInstr->DisplacementSize = 2;
+                else if( 1 == mod )
+                    pInstr->DisplacementSize = 1;
+
+                absolute = (0 == mod) && (6 == rm);
+            }
+            else
+            {
+                if( 4 == rm )
+                {
+                    status = r.Need( 1 );
+                    if( DBGX86_OK != status )
+                        return status;
+
+                    uint8_t sib = r.Next();
+                    pInstr->Sib = sib;
+                    pInstr->Flags |= DBGX86_F_SIB;
+
+                    if( (0 == mod) && (5 == (sib & 7)) )
+                    {
+                        pInstr->DisplacementSize = 4;
+
+                        // No base; and if no index either, it's just the displacement.
+                        absolute = (4 == ((sib >> 3) & 7)) && !(pInstr->Rex & 0x02);
+                    }
+                }
+
+                if( (0 == mod) && (5 == rm) )
+                {
+                    pInstr->DisplacementSize = 4;
+                    if( Is64Bit )
+                        ripRelative = true;
+                    else
+                        absolute = true;
+                }
+                else if( 1 == mod )
+                {
+                    pInstr->DisplacementSize = 1;
+                }
+                else if( 2 == mod )
+                {
+                    pInstr->DisplacementSize = 4;
+                }
+            }
+
+            if( pInstr->DisplacementSize )
+            {
+                status = r.Need( pInstr->DisplacementSize );
+                if( DBGX86_OK != status )
+                    return status;
+
+                pInstr->Displacement = SignExtend( ReadLittleEndian( r.Code + r.Pos, pInstr->DisplacementSize ),
+                                                   pInstr->DisplacementSize );
+                r.Pos += pInstr->DisplacementSize;
+            }
+        }
+    }
+
+    //
+    // Immediates.
+    //
+    size_t immSize = 0;
+    uint8_t zSize = (2 == pInstr->OperandSize) ? 2 : 4;
+
+    if( entry & G3 )
+    {
+        if( reg < 2 )
+            immSize = (0xF6 == pInstr->Opcode) ? 1 : zSize;
+    }
+    else
+    {
+        if( entry & Ib ) immSize += 1;
+        if( entry & Iw ) immSize += 2;
+        if( entry & Iz ) immSize += zSize;
+        if( entry & Iv ) immSize += pInstr->OperandSize;
+        if( entry & Ao ) immSize += pInstr->AddressSize;
+        if( entry & Ap ) immSize += zSize + 2;
+        if( entry & Jb ) immSize += 1;
+
+        // (In 64-bit mode, the operand size prefix is ignored for near branches.)
+        if( entry & Jz ) immSize += Is64Bit ? 4 : zSize;
+    }
+
+    if( immSize )
+    {
+        status = r.Need( immSize );
+        if( DBGX86_OK != status )
+            return status;
+
+        pInstr->Immediate = ReadLittleEndian( r.Code + r.Pos, immSize );
+        pInstr->ImmediateSize = (uint8_t) immSize;
+        r.Pos += immSize;
+    }
+
+    if( DBGX86_MAP_3DNOW == pInstr->OpcodeMap )
+        pInstr->Opcode = (uint8_t) pInstr->Immediate;
+
+    pInstr->Length = (uint8_t) r.Pos;
+
+    //
+    // Control flow, and addresses.
+    //
+    pInstr->Flow = (uint8_t) ((entry >> 16) & 0xF);
+    if( isVex )
+        pInstr->Flow = DBGX86_FLOW_NONE;
+
+    if( (DBGX86_MAP_1BYTE == pInstr->OpcodeMap) && (0xFF == pInstr->Opcode) )
+    {
+        if( (2 == reg) || (3 == reg) )
+            pInstr->Flow = DBGX86_FLOW_CALL_INDIRECT;
+        else if( (4 == reg) || (5 == reg) )
+            pInstr->Flow = DBGX86_FLOW_JUMP_INDIRECT;
+    }
+
+    uint64_t next = Address + pInstr->Length;
+    uint64_t ipMask = Is64Bit ? ~0ULL : 0xFFFFFFFFULL;
+
+    if( entry & (Jb | Jz) )
+    {
+        pInstr->Flags |= DBGX86_F_RELATIVE | DBGX86_F_BRANCH_TARGET;
+        uint64_t target = next + (uint64_t) SignExtend( pInstr->Immediate, immSize );
+        if( !Is64Bit && (entry & Jz) && (2 == pInstr->OperandSize) )
+            ipMask = 0xFFFF;
+
+        pInstr->BranchTarget = target & ipMask;
+    }
+
+    // FS and GS-relative addresses aren't linear addresses.
+    bool linear = (0x64 != segment) && (0x65 != segment);
+    if( linear )
+    {
+        if( ripRelative )
+        {
+            pInstr->Flags |= DBGX86_F_RIP_RELATIVE;
+            if( 4 == pInstr->AddressSize )
+                SetMemoryAddress( pInstr, (next + (uint64_t) pInstr->Displacement) & 0xFFFFFFFFULL );
+            else
+                SetMemoryAddress( pInstr, next + (uint64_t) pInstr->Displacement );
+        }
+        else if( absolute )
+        {
+            if( 2 == pInstr->AddressSize )
+                SetMemoryAddress( pInstr, (uint64_t) pInstr->Displacement & 0xFFFF );
+            else if( Is64Bit && (8 == pInstr->AddressSize) )
+                SetMemoryAddress( pInstr, (uint64_t) pInstr->Displacement );
+            else
+                SetMemoryAddress( pInstr, (uint64_t) pInstr->Displacement & 0xFFFFFFFFULL );
+        }
+        else if( entry & Ao )
+        {
+            SetMemoryAddress( pInstr, pInstr->Immediate );
+        }
+    }
+    else if( ripRelative )
+    {
+        pInstr->Flags |= DBGX86_F_RIP_RELATIVE;
+    }
+
+    return DBGX86_OK;
+} // end DbgX86Decode()
+
+
+size_t DbgX86DecodeRange( const uint8_t* Code,
+                          size_t CodeSize,
+                          uint64_t Address,
+                          bool Is64Bit,
+                          DBGX86_INSTRUCTION* pInstructions,
+                          size_t MaxInstructions,
+                          size_t* pBytesDecoded )
+{
+    size_t offset = 0;
+    size_t count = 0;
+
+    if( Code && pInstructions )
+    {
+        while( (count < MaxInstructions) && (offset < CodeSize) )
+        {
+            if( DBGX86_OK != DbgX86Decode( Code + offset,
+                                           CodeSize - offset,
+                                           Address + offset,
+                                           Is64Bit,
+                                           &pInstructions[ count ] ) )
+            {
+                break;
+            }
+
+            offset += pInstructions[ count ].Length;
+            count++;
+        }
+    }
+
+    if( pBytesDecoded )
+        *pBytesDecoded = offset;
+
+    return count;
+} // end DbgX86DecodeRange()
+
+
+bool DbgX86FindCallBefore( const uint8_t* Code,
+                           size_t CodeSize,
+                           uint64_t ReturnAddress,
+                           bool Is64Bit,
+                           DBGX86_INSTRUCTION* pCall )
+{
+    if( !Code || !pCall )
+        return false;
+
+    // Several decodings can end at ReturnAddress; the bytes of a direct call's
+    // displacement can look like a short indirect call ("call rax" is FF D0), for
+    // instance. Direct calls are both the most common and the least likely to show up
+    // by accident, so look for one of those first, and only then for indirect calls.
+    // Within each pass, the shortest decoding wins.
+    //
+    // The shortest call is 2 bytes (call reg); the longest is the longest instruction.
+    size_t maxLength = (CodeSize < DBGX86_MAX_INSTRUCTION_LENGTH) ? CodeSize : DBGX86_MAX_INSTRUCTION_LENGTH;
+    const uint8_t passes[] = { DBGX86_FLOW_CALL, DBGX86_FLOW_CALL_INDIRECT };
+    for( uint8_t flow : passes )
+    {
+        for( size_t length = 2; length <= maxLength; length++ )
+        {
+            DBGX86_INSTRUCTION instr;
+            if( (DBGX86_OK == DbgX86Decode( Code + CodeSize - length,
+                                            length,
+                                            ReturnAddress - length,
+                                            Is64Bit,
+                                            &instr )) &&
+                (instr.Length == length) &&
+                (flow == instr.Flow) )
+            {
+                *pCall = instr;
+                return true;
+            }
+        }
+    }
+    return false;
+} // end DbgX86FindCallBefore()
+
+
+size_t DbgX86FindCalls( const uint8_t* Code,
+                        size_t CodeSize,
+                        uint64_t Address,
+                        bool Is64Bit,
+                        DBGX86_CALL_SITE* pCallSites,
+                        size_t MaxCallSites,
+                        size_t* pBytesScanned )
+{
+    size_t offset = 0;
+    size_t count = 0;
+
+    if( Code && pCallSites )
+    {
+        while( (count < MaxCallSites) && (offset < CodeSize) )
+        {
+            DBGX86_INSTRUCTION instr;
+            int status = DbgX86Decode( Code + offset, CodeSize - offset, Address + offset, Is64Bit, &instr );
+            if( DBGX86_E_TRUNCATED == status )
+                break;
+
+            if( DBGX86_OK != status )
+            {
+                offset++;
+                continue;
+            }
+
+            uint64_t target = 0;
+            bool found = false;
+            if( (DBGX86_FLOW_CALL == instr.Flow) && (instr.Flags & DBGX86_F_BRANCH_TARGET) )
+            {
+                target = instr.BranchTarget;
+                found = true;
+            }
+            else if( (DBGX86_FLOW_CALL_INDIRECT == instr.Flow) && (instr.Flags & DBGX86_F_MEMORY_ADDRESS) )
+            {
+                target = instr.MemoryAddress;
+                found = true;
+            }
+
+            if( found )
+            {
+                DBGX86_CALL_SITE& site = pCallSites[ count++ ];
+                site = DBGX86_CALL_SITE();
+                site.CallAddress = instr.Address;
+                site.Target = target;
+                site.Length = instr.Length;
+                site.Flow = instr.Flow;
+            }
+
+            offset += instr.Length;
+        }
+    }
+
+    if( pBytesScanned )
+        *pBytesScanned = offset;
+
+    return count;
+} // end DbgX86FindCalls()
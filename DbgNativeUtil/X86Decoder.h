@@ -0,0 +1,142 @@
+// X86Decoder.h : A table-driven x86/x64 instruction decoder.
+//
+// This figures out instruction lengths, prefixes, ModRM/SIB bytes, displacements,
+// immediates, and control flow (including branch targets). It does not produce text;
+// dbgeng does that. It's for when we need to look at a lot of code quickly: walking
+// instructions for disassembly views, checking whether a candidate return address
+// follows a call, scanning code for call targets, etc.
+//
+// It is plain C++ with no OS dependencies (it does not include any Windows headers),
+// so that it can be built, fuzzed and benchmarked on any machine. X86DecoderDriver.cpp
+// does the fuzzing and benchmarking.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Return codes.
+#define DBGX86_OK               0
+#define DBGX86_E_TRUNCATED      1   // The instruction runs past the end of the code.
+#define DBGX86_E_INVALID        2   // Not a valid instruction.
+
+// DBGX86_INSTRUCTION.Flags
+#define DBGX86_F_MODRM          0x00000001
+#define DBGX86_F_SIB            0x00000002
+#define DBGX86_F_RELATIVE       0x00000004  // Immediate is a relative branch displacement.
+#define DBGX86_F_BRANCH_TARGET  0x00000008  // BranchTarget is valid.
+#define DBGX86_F_MEMORY_ADDRESS 0x00000010  // MemoryAddress is valid.
+#define DBGX86_F_RIP_RELATIVE   0x00000020
+
+// DBGX86_INSTRUCTION.Prefixes
+#define DBGX86_PFX_LOCK         0x01
+#define DBGX86_PFX_REP          0x02        // F3
+#define DBGX86_PFX_REPNE        0x04        // F2
+#define DBGX86_PFX_OPSIZE       0x08        // 66
+#define DBGX86_PFX_ADDRSIZE     0x10        // 67
+#define DBGX86_PFX_SEGMENT      0x20
+#define DBGX86_PFX_VEX          0x40        // VEX or XOP
+#define DBGX86_PFX_EVEX         0x80
+
+// DBGX86_INSTRUCTION.OpcodeMap
+#define DBGX86_MAP_1BYTE        0
+#define DBGX86_MAP_0F           1
+#define DBGX86_MAP_0F38         2
+#define DBGX86_MAP_0F3A         3
+#define DBGX86_MAP_3DNOW        4           // 0F 0F; Opcode is the trailing byte.
+#define DBGX86_MAP_5            5           // EVEX maps 5 and 6
+#define DBGX86_MAP_6            6
+#define DBGX86_MAP_XOP8         8
+#define DBGX86_MAP_XOP9         9
+#define DBGX86_MAP_XOPA         10
+
+// DBGX86_INSTRUCTION.Flow
+#define DBGX86_FLOW_NONE            0
+#define DBGX86_FLOW_CALL            1       // Direct (relative or far absolute).
+#define DBGX86_FLOW_CALL_INDIRECT   2
+#define DBGX86_FLOW_JUMP            3       // Direct (relative or far absolute).
+#define DBGX86_FLOW_JUMP_INDIRECT   4
+#define DBGX86_FLOW_JCC             5       // Conditional: jcc, loop, jcxz.
+#define DBGX86_FLOW_RETURN          6       // Including iret, sysret and sysexit.
+#define DBGX86_FLOW_INTERRUPT       7       // int, int3, into, int1.
+#define DBGX86_FLOW_SYSCALL         8       // syscall, sysenter.
+
+// The longest legal x86 instruction.
+#define DBGX86_MAX_INSTRUCTION_LENGTH 15
+
+// N.B. The layout of this struct is duplicated in managed code (X86Instruction).
+typedef struct _DBGX86_INSTRUCTION
+{
+    uint64_t Address;
+    uint64_t BranchTarget;      // For relative branches (if DBGX86_F_BRANCH_TARGET).
+    uint64_t MemoryAddress;     // For absolute or RIP-relative memory operands (if DBGX86_F_MEMORY_ADDRESS).
+    int64_t  Displacement;      // Of the memory operand, sign-extended.
+    uint64_t Immediate;         // All the immediate bytes, as they appear in the code (little-endian).
+    uint32_t Flags;             // DBGX86_F_*
+    uint8_t  Length;
+    uint8_t  OpcodeMap;         // DBGX86_MAP_*
+    uint8_t  Opcode;
+    uint8_t  Flow;              // DBGX86_FLOW_*
+    uint8_t  Prefixes;          // DBGX86_PFX_*
+    uint8_t  Rex;               // 0 if there isn't one.
+    uint8_t  ModRm;
+    uint8_t  Sib;
+    uint8_t  OperandSize;       // In bytes: 2, 4 or 8.
+    uint8_t  AddressSize;       // In bytes: 2, 4 or 8.
+    uint8_t  DisplacementSize;
+    uint8_t  ImmediateSize;
+} DBGX86_INSTRUCTION;
+
+typedef struct _DBGX86_CALL_SITE
+{
+    uint64_t CallAddress;
+    uint64_t Target;            // For indirect calls, the address of the pointer to the target.
+    uint8_t  Length;
+    uint8_t  Flow;              // DBGX86_FLOW_CALL or DBGX86_FLOW_CALL_INDIRECT
+    uint8_t  Reserved[ 6 ];
+} DBGX86_CALL_SITE;
+
+
+// Decodes the instruction at the start of Code (Address is its address, for computing
+// branch targets and RIP-relative addresses).
+int DbgX86Decode( const uint8_t* Code,
+                  size_t CodeSize,
+                  uint64_t Address,
+                  bool Is64Bit,
+                  DBGX86_INSTRUCTION* pInstruction );
+
+// Decodes consecutive instructions, until MaxInstructions, the end of the code, or the
+// first instruction that can't be decoded. Returns the number decoded. *pBytesDecoded
+// gets the total length of the decoded instructions.
+size_t DbgX86DecodeRange( const uint8_t* Code,
+                          size_t CodeSize,
+                          uint64_t Address,
+                          bool Is64Bit,
+                          DBGX86_INSTRUCTION* pInstructions,
+                          size_t MaxInstructions,
+                          size_t* pBytesDecoded );
+
+// Return address validation: Code is the code right before ReturnAddress (CodeSize
+// bytes of it; DBGX86_MAX_INSTRUCTION_LENGTH is plenty). Looks for a call instruction
+// that ends exactly at ReturnAddress. If there's more than one way to decode one, a
+// direct call (E8 rel32, or 9A ptr16:32 on x86) wins over an indirect one, and
+// otherwise the shortest wins. (Shortest-first alone would prefer a 2-byte "call reg"
+// made out of the last bytes of a direct call's displacement.)
+bool DbgX86FindCallBefore( const uint8_t* Code,
+                           size_t CodeSize,
+                           uint64_t ReturnAddress,
+                           bool Is64Bit,
+                           DBGX86_INSTRUCTION* pCall );
+
+// Call-target scanning: walks the code instruction by instruction (skipping a byte at a
+// time over anything that doesn't decode), and reports the direct calls, and the
+// indirect calls through absolute or RIP-relative pointers (like import thunks).
+// Returns the number of call sites found; stops when MaxCallSites are found.
+// *pBytesScanned gets how far it got.
+size_t DbgX86FindCalls( const uint8_t* Code,
+                        size_t CodeSize,
+                        uint64_t Address,
+                        bool Is64Bit,
+                        DBGX86_CALL_SITE* pCallSites,
+                        size_t MaxCallSites,
+                        size_t* pBytesScanned );
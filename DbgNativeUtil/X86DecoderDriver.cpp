@@ -0,0 +1,308 @@
+// X86DecoderDriver.cpp : A standalone fuzz and benchmark driver for X86Decoder.
+//
+// This is not part of DbgNativeUtil.dll (it has its own main). It only needs
+// X86Decoder.cpp, so it builds with any C++11 compiler, on any OS:
+//
+//    cl /O2 /EHsc X86DecoderDriver.cpp X86Decoder.cpp
+//    clang++ -O2 X86DecoderDriver.cpp X86Decoder.cpp -o X86DecoderDriver
+//
+// Or, as a libFuzzer target (main is left out, and the fuzzer feeds inputs to
+// LLVMFuzzerTestOneInput):
+//
+//    clang++ -g -O1 -fsanitize=fuzzer,address -DDBGX86_LIBFUZZER X86DecoderDriver.cpp X86Decoder.cpp
+//
+// Usage:
+//
+//    X86DecoderDriver fuzz  [iterations [seed]]
+//        Checks the decoder's invariants (see _CheckInput) on random inputs.
+//
+//    X86DecoderDriver bench <file> [x86|x64 [iterations]]
+//        Times DbgX86DecodeRange, DbgX86FindCalls and DbgX86FindCallBefore over the
+//        contents of a file (say, the .text section of a module, saved with
+//        ".writemem"), and checks the invariants on it too.
+
+#include "X86Decoder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    int g_failures = 0;
+
+    void _Fail( const char* what, const uint8_t* code, size_t codeSize, bool is64Bit )
+    {
+        g_failures++;
+        fprintf( stderr, "FAILED (%s): %s:", is64Bit ? "x64" : "x86", what );
+        for( size_t i = 0; (i < codeSize) && (i < 16); i++ )
+            fprintf( stderr, " %02x", code[ i ] );
+
+        fprintf( stderr, "\n" );
+#ifdef DBGX86_LIBFUZZER
+        abort();
+#endif
+    } // end _Fail()
+
+
+    // Everything here must hold for any input at all: whatever the bytes are, the
+    // decoder must not read or write out of bounds (the sanitizers catch that), and
+    // what it reports has to be consistent.
+    void _CheckInput( const uint8_t* code, size_t codeSize, bool is64Bit )
+    {
+        const uint64_t address = is64Bit ? 0x00007ff600001000ULL : 0x00401000ULL;
+
+        DBGX86_INSTRUCTION instr;
+        int status = DbgX86Decode( code, codeSize, address, is64Bit, &instr );
+        if( DBGX86_OK == status )
+        {
+            if( (0 == instr.Length) ||
+                (instr.Length > DBGX86_MAX_INSTRUCTION_LENGTH) ||
+                (instr.Length > codeSize) )
+            {
+                _Fail( "DbgX86Decode: bad length", code, codeSize, is64Bit );
+            }
+
+            // Decoding exactly the instruction's bytes has to give the same answer.
+            DBGX86_INSTRUCTION again;
+            if( (DBGX86_OK != DbgX86Decode( code, instr.Length, address, is64Bit, &again )) ||
+                (0 != memcmp( &instr, &again, sizeof( instr ) )) )
+            {
+                _Fail( "DbgX86Decode: not the same with just its own bytes", code, codeSize, is64Bit );
+            }
+        }
+        else if( (DBGX86_E_TRUNCATED != status) && (DBGX86_E_INVALID != status) )
+        {
+            _Fail( "DbgX86Decode: bad status", code, codeSize, is64Bit );
+        }
+
+        DBGX86_INSTRUCTION instructions[ 64 ];
+        size_t bytesDecoded = 0;
+        size_t count = DbgX86DecodeRange( code, codeSize, address, is64Bit, instructions, 64, &bytesDecoded );
+        size_t total = 0;
+        for( size_t i = 0; i < count; i++ )
+        {
+            if( instructions[ i ].Address != (address + total) )
+                _Fail( "DbgX86DecodeRange: instructions not contiguous", code, codeSize, is64Bit );
+
+            total += instructions[ i ].Length;
+        }
+        if( (total != bytesDecoded) || (bytesDecoded > codeSize) )
+            _Fail( "DbgX86DecodeRange: bad byte count", code, codeSize, is64Bit );
+
+        DBGX86_CALL_SITE sites[ 64 ];
+        size_t bytesScanned = 0;
+        count = DbgX86FindCalls( code, codeSize, address, is64Bit, sites, 64, &bytesScanned );
+        if( bytesScanned > codeSize )
+            _Fail( "DbgX86FindCalls: scanned too far", code, codeSize, is64Bit );
+
+        for( size_t i = 0; i < count; i++ )
+        {
+            if( (sites[ i ].CallAddress < address) ||
+                ((sites[ i ].CallAddress - address + sites[ i ].Length) > bytesScanned) ||
+                ((DBGX86_FLOW_CALL != sites[ i ].Flow) && (DBGX86_FLOW_CALL_INDIRECT != sites[ i ].Flow)) )
+            {
+                _Fail( "DbgX86FindCalls: bad call site", code, codeSize, is64Bit );
+            }
+        }
+
+        DBGX86_INSTRUCTION call;
+        uint64_t returnAddress = address + codeSize;
+        if( DbgX86FindCallBefore( code, codeSize, returnAddress, is64Bit, &call ) )
+        {
+            if( ((call.Address + call.Length) != returnAddress) ||
+                ((DBGX86_FLOW_CALL != call.Flow) && (DBGX86_FLOW_CALL_INDIRECT != call.Flow)) )
+            {
+                _Fail( "DbgX86FindCallBefore: not a call that ends at the return address", code, codeSize, is64Bit );
+            }
+        }
+    } // end _CheckInput()
+
+
+#ifndef DBGX86_LIBFUZZER
+    int _Fuzz( unsigned long long iterations, unsigned int seed )
+    {
+        std::mt19937 rng( seed );
+        std::vector< uint8_t > code;
+
+        // Mostly short inputs (that's where the truncation cases are), built from
+        // bytes that make the decoder do more work (prefixes, escapes, calls) often
+        // enough to matter.
+        static const uint8_t interesting[] = { 0x0f, 0x38, 0x3a, 0x66, 0x67, 0xf2, 0xf3, 0xf0,
+                                               0x26, 0x2e, 0x40, 0x48, 0x4f, 0xc4, 0xc5, 0x62,
+                                               0x8f, 0xe8, 0x9a, 0xff, 0x15, 0x25, 0xd0, 0x05 };
+        for( unsigned long long i = 0; i < iterations; i++ )
+        {
+            code.resize( 1 + (rng() % 32) );
+            for( auto& b : code )
+            {
+                if( 0 == (rng() % 3) )
+                    b = interesting[ rng() % sizeof( interesting ) ];
+                else
+                    b = (uint8_t) rng();
+            }
+
+            _CheckInput( code.data(), code.size(), false );
+            _CheckInput( code.data(), code.size(), true );
+        }
+
+        printf( "%llu inputs (seed %u): %d failures.\n", iterations, seed, g_failures );
+        return g_failures ? 1 : 0;
+    } // end _Fuzz()
+
+
+    double _Seconds( std::chrono::steady_clock::time_point start )
+    {
+        return std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    }
+
+
+    int _Bench( const char* path, bool is64Bit, int iterations )
+    {
+        FILE* f = fopen( path, "rb" );
+        if( !f )
+        {
+            fprintf( stderr, "Could not open %s.\n", path );
+            return 2;
+        }
+
+        std::vector< uint8_t > code;
+        uint8_t buf[ 64 * 1024 ];
+        size_t cb;
+        while( 0 != (cb = fread( buf, 1, sizeof( buf ), f )) )
+            code.insert( code.end(), buf, buf + cb );
+
+        fclose( f );
+
+        if( code.empty() )
+        {
+            fprintf( stderr, "%s is empty.\n", path );
+            return 2;
+        }
+
+        const uint64_t address = 0x10000000ULL;
+        const size_t size = code.size();
+
+        // Decode: a linear sweep, skipping a byte over anything that doesn't decode.
+        std::vector< DBGX86_INSTRUCTION > instructions( 1024 );
+        size_t decoded = 0;
+        auto start = std::chrono::steady_clock::now();
+        for( int iter = 0; iter < iterations; iter++ )
+        {
+            decoded = 0;
+            size_t offset = 0;
+            while( offset < size )
+            {
+                size_t bytes = 0;
+                size_t n = DbgX86DecodeRange( &code[ offset ], size - offset, address + offset, is64Bit,
+                                              instructions.data(), instructions.size(), &bytes );
+                decoded += n;
+                offset += bytes ? bytes : 1;
+            }
+        }
+        double seconds = _Seconds( start );
+        printf( "Decode:     %zu instructions, %.1f ns/instruction, %.1f MB/s\n",
+                decoded, seconds * 1e9 / ((double) decoded * iterations), size * iterations / seconds / 1e6 );
+
+        // FindCalls.
+        std::vector< DBGX86_CALL_SITE > sites;
+        std::vector< DBGX86_CALL_SITE > siteBuf( 1024 );
+        start = std::chrono::steady_clock::now();
+        for( int iter = 0; iter < iterations; iter++ )
+        {
+            sites.clear();
+            size_t offset = 0;
+            while( offset < size )
+            {
+                size_t scanned = 0;
+                size_t n = DbgX86FindCalls( &code[ offset ], size - offset, address + offset, is64Bit,
+                                            siteBuf.data(), siteBuf.size(), &scanned );
+                sites.insert( sites.end(), siteBuf.begin(), siteBuf.begin() + n );
+                if( (n < siteBuf.size()) || (0 == scanned) )
+                    break;
+
+                offset += scanned;
+            }
+        }
+        seconds = _Seconds( start );
+        printf( "FindCalls:  %zu call sites, %.1f MB/s\n", sites.size(), size * iterations / seconds / 1e6 );
+
+        // FindCallBefore, on the return address of each call site found (so every one
+        // of them should find a call).
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for( int iter = 0; iter < iterations; iter++ )
+        {
+            found = 0;
+            for( const auto& site : sites )
+            {
+                size_t end = (size_t) (site.CallAddress - address) + site.Length;
+                size_t begin = (end > DBGX86_MAX_INSTRUCTION_LENGTH) ? end - DBGX86_MAX_INSTRUCTION_LENGTH : 0;
+                DBGX86_INSTRUCTION call;
+                if( DbgX86FindCallBefore( &code[ begin ], end - begin, address + end, is64Bit, &call ) )
+                    found++;
+            }
+        }
+        seconds = _Seconds( start );
+        printf( "CallBefore: %zu of %zu found, %.1f ns/return address\n",
+                found, sites.size(), sites.empty() ? 0.0 : seconds * 1e9 / ((double) sites.size() * iterations) );
+
+        if( found != sites.size() )
+            g_failures++;
+
+        // And the invariants, at every offset.
+        for( size_t offset = 0; offset < size; offset++ )
+        {
+            size_t cbCheck = size - offset;
+            if( cbCheck > 64 )
+                cbCheck = 64;
+
+            _CheckInput( &code[ offset ], cbCheck, is64Bit );
+        }
+
+        printf( "%d failures.\n", g_failures );
+        return g_failures ? 1 : 0;
+    } // end _Bench()
+#endif // DBGX86_LIBFUZZER
+} // end anonymous namespace
+
+
+#ifdef DBGX86_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t* data, size_t size )
+{
+    _CheckInput( data, size, false );
+    _CheckInput( data, size, true );
+    return 0;
+}
+
+#else
+
+int main( int argc, char** argv )
+{
+    if( (argc >= 2) && (0 == strcmp( argv[ 1 ], "fuzz" )) )
+    {
+        unsigned long long iterations = (argc >= 3) ? strtoull( argv[ 2 ], nullptr, 0 ) : 1000000;
+        unsigned int seed = (argc >= 4) ? (unsigned int) strtoul( argv[ 3 ], nullptr, 0 ) : std::random_device()();
+        return _Fuzz( iterations, seed );
+    }
+
+    if( (argc >= 3) && (0 == strcmp( argv[ 1 ], "bench" )) )
+    {
+        bool is64Bit = !((argc >= 4) && (0 == strcmp( argv[ 3 ], "x86" )));
+        int iterations = (argc >= 5) ? atoi( argv[ 4 ] ) : 10;
+        if( iterations < 1 )
+            iterations = 1;
+
+        return _Bench( argv[ 2 ], is64Bit, iterations );
+    }
+
+    fprintf( stderr, "Usage: X86DecoderDriver fuzz [iterations [seed]]\n"
+                     "       X86DecoderDriver bench <file> [x86|x64 [iterations]]\n" );
+    return 2;
+} // end main()
+
+#endif // DBGX86_LIBFUZZER
@@ -1,4 +1,10 @@
 
+# N.B. Most of these are superseded by the built-in (compiled) STL converters (see
+# StlValueConverters.cs), which take priority. These are still used for the types that
+# have no built-in converter, when a built-in converter does not recognize a
+# container's layout, or when the built-in converters are turned off (with the
+# __DisableBuiltInValueConverters environment variable).
+
 Register-DbgValueConverterInfo {
 
     Set-StrictMode -Version Latest
@@ -30,6 +30,23 @@ private class DbgValueConversionManagerInfo
             private Dictionary< string, Dictionary< string, TypeNameMatchList< DbgValueConverterInfo > > > m_moduleMap
                 = new Dictionary< string, Dictionary< string, TypeNameMatchList< DbgValueConverterInfo > > >( StringComparer.OrdinalIgnoreCase );
 
+            // Compiled converters that ship with DbgProvider (see StlValueConverters).
+            // These are kept separate from m_moduleMap so that they survive a Reload,
+            // and so that they can be put ahead of the generic (non-module-scoped)
+            // scripts, which they replace.
+            //
+            // Maps:            Templatename    Match list
+            private Dictionary< string, TypeNameMatchList< DbgValueConverterInfo > > m_builtInMap
+                = new Dictionary< string, TypeNameMatchList< DbgValueConverterInfo > >( StringComparer.OrdinalIgnoreCase );
+
+            private void _RegisterBuiltInConverter( DbgValueConverterInfo converterInfo )
+            {
+                Util.Assert( converterInfo.IsBuiltIn );
+                var matchList = GetOrCreateValue( m_builtInMap, converterInfo.TypeName.TemplateName );
+                matchList.AddOrReplace( converterInfo );
+            } // end _RegisterBuiltInConverter()
+
+
             internal void RegisterConverter( DbgValueConverterInfo converterInfo )
             {
                 if( null == converterInfo )
@@ -88,7 +105,11 @@ internal void RegisterConverter( DbgValueConverterInfo converterInfo )
             /// <summary>
             ///    Picks a converter for a given DbgSymbol.
             /// </summary>
-            internal DbgValueConverterInfo ChooseConverterForSymbol( DbgSymbol symbol )
+            /// <remarks>
+            ///    Module-scoped converters come first, then the built-in converters,
+            ///    then converters that apply to any module.
+            /// </remarks>
+            internal DbgValueConverterInfo ChooseConverterForSymbol( DbgSymbol symbol, bool skipBuiltIn )
             {
                 if( null == symbol )
                     throw new ArgumentNullException( "symbol" );
@@ -97,6 +118,13 @@ internal DbgValueConverterInfo ChooseConverterForSymbol( DbgSymbol symbol )
                 if( null != converter )
                     return converter;
 
+                if( !skipBuiltIn )
+                {
+                    converter = _EnumerateBuiltInConvertersForSymbol( symbol ).FirstOrDefault();
+                    if( null != converter )
+                        return converter;
+                }
+
                 return _ChooseConverter( c_NoModule, symbol );
             } // end ChooseConverterForSymbol()
 
@@ -107,6 +135,24 @@ private DbgValueConverterInfo _ChooseConverter( string modName, DbgSymbol symbol
             } // end _ChooseConverter()
 
 
+            private IEnumerable< DbgValueConverterInfo > _EnumerateBuiltInConvertersForSymbol( DbgSymbol symbol )
+            {
+                if( DisableBuiltInConverters )
+                    yield break;
+
+                foreach( var typeNameTemplate in symbol.GetTemplateNodes() )
+                {
+                    var matchList = TryGetNonNullValue( m_builtInMap, typeNameTemplate.TemplateName );
+                    if( null != matchList )
+                    {
+                        var converter = matchList.TryFindMatchingItem( typeNameTemplate );
+                        if( null != converter )
+                            yield return converter;
+                    }
+                }
+            } // end _EnumerateBuiltInConvertersForSymbol()
+
+
             internal IEnumerable< DbgValueConverterInfo > EnumerateAllConvertersForSymbol( DbgSymbol symbol )
             {
                 if( symbol.Module.BaseAddress != 0 )
@@ -118,6 +164,11 @@ private DbgValueConverterInfo _ChooseConverter( string modName, DbgSymbol symbol
                     }
                 }
 
+                foreach( var converter in _EnumerateBuiltInConvertersForSymbol( symbol ) )
+                {
+                    yield return converter;
+                }
+
                 foreach( var converter in _EnumerateAllConvertersForSymbol( c_NoModule, symbol ) )
                 {
                     yield return converter;
@@ -148,8 +199,19 @@ private DbgValueConverterInfo _ChooseConverter( string modName, DbgSymbol symbol
             } // end _EnumerateAllConvertersForSymbol()
 
 
-            internal IEnumerable< DbgValueConverterInfo > EnumerateEntries()
+            internal IEnumerable< DbgValueConverterInfo > EnumerateEntries( bool includeBuiltIn )
             {
+                if( includeBuiltIn )
+                {
+                    foreach( var tml in m_builtInMap.Values )
+                    {
+                        foreach( var converter in tml )
+                        {
+                            yield return converter;
+                        }
+                    }
+                }
+
                 foreach( var modEntries in m_moduleMap.Values )
                 {
                     foreach( var tml in modEntries.Values )
@@ -338,13 +400,18 @@ private void _Dump()
             /// </summary>
             public void ScrubFileList()
             {
-                m_scriptLoader.SetFileList( EnumerateEntries().Select( ( x ) => x.SourceScript ) );
+                m_scriptLoader.SetFileList( EnumerateEntries( false ).Select( ( x ) => x.SourceScript ) );
             } // end ScrubFileList()
 
 
             internal DbgValueConversionManagerInfo()
             {
                 m_scriptLoader = new ScriptLoader( _Dump );
+
+                foreach( var converterInfo in StlValueConverters.CreateConverterInfos() )
+                {
+                    _RegisterBuiltInConverter( converterInfo );
+                }
             } // end constructor
         } // end class DbgValueConversionManagerInfo
     } // end partial class DbgValueConversionManager
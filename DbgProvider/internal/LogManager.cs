@@ -416,7 +416,12 @@ private static void _Shutdown( object sender, EventArgs e )
                 // We need to be as fast as possible; I don't want to even trace
                 // "_Shutdown called" or anything like that; the last cmdlet
                 // run should have flushed the trace session and I don't want to start
-                // filling a new buffer that needs to be written out.
+                // filling a new buffer that needs to be written out. (But whatever is
+                // still sitting in the trace rings has not been written at all yet.)
+                TraceRing.StopFlushing();
+                if( sm_eventSource.IsValueCreated )
+                    TraceRing.Drain();
+
                 lock( sm_syncRoot )
                 {
                     if( !sm_shuttingDown )
@@ -478,12 +483,26 @@ private static string _TruncateIfNecessary( string s )
 
 
         public static void Trace( string message )
+        {
+            TraceAt( DateTime.Now, Thread.CurrentThread.ManagedThreadId, message );
+        } // end Trace()
+
+
+        internal static string FormatLinePrefix( DateTime timestamp, int managedThreadId )
+        {
+            return Util.Sprintf( "[{0}] [{1,2}]: ", timestamp, managedThreadId );
+        }
+
+
+        /// <summary>
+        ///    Like Trace, but with the timestamp and thread id supplied by the caller
+        ///    (for messages traced earlier, elsewhere, such as by TraceRing).
+        /// </summary>
+        internal static void TraceAt( DateTime timestamp, int managedThreadId, string message )
         {
             lock( sm_syncRoot )
             {
-                DateTime now = DateTime.Now;
-                int tid = Thread.CurrentThread.ManagedThreadId;
-                string prefix = Util.Sprintf( "[{0}] [{1,2}]: ", now, tid );
+                string prefix = FormatLinePrefix( timestamp, managedThreadId );
                 foreach( string line in message.Split( sm_lineDelims, StringSplitOptions.None ) )
                 {
                     string fullLine = _TruncateIfNecessary( prefix + line );
@@ -501,7 +520,7 @@ public static void Trace( string message )
                     }
                 } // end foreach( line )
             }
-        } // end Trace()
+        } // end TraceAt()
 
 
         private static void _WriteToEventProvider( MyEventSource es, string fullLine )
@@ -548,6 +567,11 @@ public static void Trace( MulticulturalString messageFmt, params object[] insert
 
         public static void Flush()
         {
+            // N.B. Before taking the lock: the drain takes its own lock (briefly), and
+            // then traces what it collected.
+            if( !sm_onInitPath )
+                TraceRing.Drain();
+
             lock( sm_syncRoot )
             {
                 if( 0 == sm_traceHandle )
@@ -669,6 +693,11 @@ private static void _StartTracing( MyEventSource es )
                                                         _GetUserType(),
                                                         Environment.UserInteractive ) );
                     es.WriteMessage( Util.Sprintf( "Current machine: {0}", Environment.MachineName ) );
+                    if( TraceRing.IsEnabled )
+                    {
+                        es.WriteMessage( Util.Sprintf( "Trace ring: on (drained every {0} ms)", TraceRing.FlushIntervalMs ) );
+                        es.WriteMessage( "N.B. Trace ring lines are written when drained, so they can come after lines traced later. Their time stamps are when they were traced." );
+                    }
                     Flush();
                 }
             }
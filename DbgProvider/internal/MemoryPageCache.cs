@@ -0,0 +1,277 @@
+using System;
+using System.Collections.Generic;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    An LRU cache of target memory pages, shared by DbgEngDebugger.ReadMem & co. and
+    ///    by the ClrMd data reader.
+    /// </summary>
+    /// <remarks>
+    ///    Pages are partitioned by (system, process), since the same virtual address means
+    ///    different things in different targets. Only pages that could be read in full
+    ///    are cached; a read that touches an unreadable page goes straight to dbgeng.
+    ///
+    ///    Memory in a dump target never changes (modulo explicit writes, which invalidate
+    ///    the pages they touch), so those pages can stay until evicted. Pages from a live
+    ///    target are thrown away whenever the target's execution status changes.
+    /// </remarks>
+    internal sealed class MemoryPageCache
+    {
+        public const int DefaultPageSize = 4096;
+        public const long DefaultBudget = 64 * 1024 * 1024;
+
+        private sealed class Partition
+        {
+            public readonly bool IsLive;
+            public readonly Dictionary< ulong, LinkedListNode< Page > > Pages
+                = new Dictionary< ulong, LinkedListNode< Page > >();
+
+            public Partition( bool isLive )
+            {
+                IsLive = isLive;
+            }
+        } // end class Partition
+
+        private sealed class Page
+        {
+            public readonly Partition Owner;
+            public readonly ulong Address;
+            public readonly byte[] Data;
+
+            public Page( Partition owner, ulong address, byte[] data )
+            {
+                Owner = owner;
+                Address = address;
+                Data = data;
+            }
+        } // end class Page
+
+
+        private readonly object m_syncRoot = new object();
+
+        private readonly Dictionary< (uint, ulong), Partition > m_partitions
+            = new Dictionary< (uint, ulong), Partition >();
+
+        // Most-recently used pages are at the front.
+        private readonly LinkedList< Page > m_lru = new LinkedList< Page >();
+
+        private int m_pageSize = DefaultPageSize;
+        private long m_budget = DefaultBudget;
+
+        public bool Enabled { get; set; } = true;
+
+
+        public int PageSize
+        {
+            get { return m_pageSize; }
+            set
+            {
+                if( (value != 4096) && (value != 65536) )
+                    throw new ArgumentOutOfRangeException( nameof( value ), value, "The page size must be 4K or 64K." );
+
+                lock( m_syncRoot )
+                {
+                    if( value == m_pageSize )
+                        return;
+
+                    _ClearNoLock();
+                    m_pageSize = value;
+                }
+            }
+        } // end property PageSize
+
+
+        /// <summary>
+        ///    The maximum number of bytes of page data to keep around.
+        /// </summary>
+        public long Budget
+        {
+            get { return m_budget; }
+            set
+            {
+                if( value < 0 )
+                    throw new ArgumentOutOfRangeException( nameof( value ) );
+
+                lock( m_syncRoot )
+                {
+                    m_budget = value;
+                    _TrimNoLock();
+                }
+            }
+        } // end property Budget
+
+
+        public ulong GetPageAddress( ulong address )
+        {
+            return address & ~((ulong) m_pageSize - 1);
+        }
+
+
+        /// <summary>
+        ///    Returns the cached page that starts at pageAddress, or null.
+        /// </summary>
+        public byte[] TryGetPage( uint systemIndex, ulong processIndexOrAddress, ulong pageAddress )
+        {
+            lock( m_syncRoot )
+            {
+                if( m_partitions.TryGetValue( (systemIndex, processIndexOrAddress), out Partition partition ) &&
+                    partition.Pages.TryGetValue( pageAddress, out LinkedListNode< Page > node ) )
+                {
+                    DbgTypeInfo._CountMemoryCacheLookup( true );
+                    m_lru.Remove( node );
+                    m_lru.AddFirst( node );
+                    return node.Value.Data;
+                }
+
+                DbgTypeInfo._CountMemoryCacheLookup( false );
+                return null;
+            }
+        } // end TryGetPage()
+
+
+        /// <summary>
+        ///    Tells whether the page that starts at pageAddress is cached, without
+        ///    counting as a hit or miss (or making the page more recently used).
+        /// </summary>
+        public bool ContainsPage( uint systemIndex, ulong processIndexOrAddress, ulong pageAddress )
+        {
+            lock( m_syncRoot )
+            {
+                return m_partitions.TryGetValue( (systemIndex, processIndexOrAddress), out Partition partition ) &&
+                       partition.Pages.ContainsKey( pageAddress );
+            }
+        } // end ContainsPage()
+
+
+        /// <summary>
+        ///    Adds a fully-read page. The isLive function is only called the first time
+        ///    we see a given (system, process) pair.
+        /// </summary>
+        public void AddPage( uint systemIndex,
+                             ulong processIndexOrAddress,
+                             Func< bool > isLive,
+                             ulong pageAddress,
+                             byte[] data )
+        {
+            if( data.Length != m_pageSize )
+                return; // the page size was changed out from under the caller
+
+            lock( m_syncRoot )
+            {
+                if( !m_partitions.TryGetValue( (systemIndex, processIndexOrAddress), out Partition partition ) )
+                {
+                    partition = new Partition( isLive() );
+                    m_partitions.Add( (systemIndex, processIndexOrAddress), partition );
+                }
+
+                if( partition.Pages.ContainsKey( pageAddress ) )
+                    return;
+
+                var node = m_lru.AddFirst( new Page( partition, pageAddress, data ) );
+                partition.Pages.Add( pageAddress, node );
+                _TrimNoLock();
+            }
+        } // end AddPage()
+
+
+        /// <summary>
+        ///    Discards any cached pages that overlap the specified range (in any target;
+        ///    we don't know which target a write went to when we hear about it from a
+        ///    dbgeng callback).
+        /// </summary>
+        public void Invalidate( ulong address, ulong length )
+        {
+            if( 0 == length )
+                return;
+
+            lock( m_syncRoot )
+            {
+                ulong pageSize = (ulong) m_pageSize;
+                ulong first = GetPageAddress( address );
+                ulong last = GetPageAddress( address + length - 1 );
+
+                // Huge ranges are not worth walking page-by-page.
+                if( ((last - first) / pageSize) > (ulong) m_lru.Count )
+                {
+                    _ClearNoLock();
+                    return;
+                }
+
+                foreach( var partition in m_partitions.Values )
+                {
+                    for( ulong pageAddr = first; ; pageAddr += pageSize )
+                    {
+                        if( partition.Pages.TryGetValue( pageAddr, out LinkedListNode< Page > node ) )
+                        {
+                            partition.Pages.Remove( pageAddr );
+                            m_lru.Remove( node );
+                        }
+
+                        if( pageAddr == last )
+                            break;
+                    }
+                }
+            }
+        } // end Invalidate()
+
+
+        /// <summary>
+        ///    Discards all pages belonging to live targets (called when execution status
+        ///    changes).
+        /// </summary>
+        public void InvalidateLive()
+        {
+            lock( m_syncRoot )
+            {
+                var node = m_lru.First;
+                while( null != node )
+                {
+                    var next = node.Next;
+                    if( node.Value.Owner.IsLive )
+                    {
+                        node.Value.Owner.Pages.Remove( node.Value.Address );
+                        m_lru.Remove( node );
+                    }
+                    node = next;
+                }
+            }
+        } // end InvalidateLive()
+
+
+        public void Clear()
+        {
+            lock( m_syncRoot )
+            {
+                _ClearNoLock();
+            }
+        } // end Clear()
+
+
+        public long GetCachedBytes()
+        {
+            lock( m_syncRoot )
+            {
+                return (long) m_lru.Count * m_pageSize;
+            }
+        } // end GetCachedBytes()
+
+
+        private void _ClearNoLock()
+        {
+            m_partitions.Clear();
+            m_lru.Clear();
+        } // end _ClearNoLock()
+
+
+        private void _TrimNoLock()
+        {
+            while( (m_lru.Count > 0) && (((long) m_lru.Count * m_pageSize) > m_budget) )
+            {
+                var victim = m_lru.Last;
+                victim.Value.Owner.Pages.Remove( victim.Value.Address );
+                m_lru.RemoveLast();
+            }
+        } // end _TrimNoLock()
+    } // end class MemoryPageCache
+}
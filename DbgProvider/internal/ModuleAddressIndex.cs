@@ -0,0 +1,182 @@
+using System;
+using System.Collections.Generic;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    An immutable, sorted index of module address ranges, for finding the module
+    ///    that contains a given address without asking dbgeng.
+    /// </summary>
+    /// <remarks>
+    ///    Loaded modules never overlap each other, but unloaded modules can overlap
+    ///    anything (something else may since have been loaded at the same address, and
+    ///    the same module can be on the unloaded list more than once). To stay
+    ///    O(log n) in the common case and still be correct when ranges overlap, along
+    ///    with the sorted base addresses we keep a running max of the end addresses:
+    ///    after the binary search finds the last range that starts at or below the
+    ///    address, we walk backwards only while some earlier range could still reach
+    ///    it.
+    ///
+    ///    Lookups do not allocate. Instances are never modified after construction, so
+    ///    they can be shared between threads; to update, build a new one.
+    /// </remarks>
+    internal sealed class ModuleAddressIndex
+    {
+        public static readonly ModuleAddressIndex Empty = new ModuleAddressIndex( new DbgModuleInfo[ 0 ] );
+
+        private readonly ulong[] m_bases;
+        private readonly ulong[] m_ends;       // exclusive
+        private readonly ulong[] m_maxEnds;    // max of m_ends[ 0 .. i ]
+        private readonly int[] m_inputOrder;   // position in the input, for tie-breaking
+        private readonly DbgModuleInfo[] m_modules;
+
+
+        /// <summary>
+        ///    Builds an index over the given modules. Modules with a zero size are
+        ///    skipped. If ranges overlap, lookups favor the module that comes first in
+        ///    the input.
+        /// </summary>
+        public static ModuleAddressIndex Build( IEnumerable< DbgModuleInfo > modules )
+        {
+            if( null == modules )
+                throw new ArgumentNullException( "modules" );
+
+            var list = new List< DbgModuleInfo >();
+            foreach( var mod in modules )
+            {
+                if( 0 != mod.Size )
+                    list.Add( mod );
+            }
+
+            if( 0 == list.Count )
+                return Empty;
+
+            return new ModuleAddressIndex( list.ToArray() );
+        } // end Build()
+
+
+        private ModuleAddressIndex( DbgModuleInfo[] modules )
+        {
+            int count = modules.Length;
+            m_bases = new ulong[ count ];
+            m_ends = new ulong[ count ];
+            m_maxEnds = new ulong[ count ];
+
+            var order = new int[ count ];
+            for( int i = 0; i < count; i++ )
+            {
+                m_bases[ i ] = modules[ i ].BaseAddress;
+                order[ i ] = i;
+            }
+
+            // Sort by base address; for equal bases, keep input order (Array.Sort is
+            // not stable, so we sort on the (base, input index) pair).
+            Array.Sort( order, ( x, y ) =>
+                {
+                    int cmp = m_bases[ x ].CompareTo( m_bases[ y ] );
+                    return (0 != cmp) ? cmp : x.CompareTo( y );
+                } );
+
+            m_modules = new DbgModuleInfo[ count ];
+            m_inputOrder = new int[ count ];
+            ulong maxEnd = 0;
+            for( int i = 0; i < count; i++ )
+            {
+                DbgModuleInfo mod = modules[ order[ i ] ];
+                m_modules[ i ] = mod;
+                m_inputOrder[ i ] = order[ i ];
+                m_bases[ i ] = mod.BaseAddress;
+                m_ends[ i ] = mod.BaseAddress + mod.Size;
+                maxEnd = Math.Max( maxEnd, m_ends[ i ] );
+                m_maxEnds[ i ] = maxEnd;
+            }
+        } // end constructor
+
+
+        public int Count { get { return m_modules.Length; } }
+
+
+        /// <summary>
+        ///    The indexed modules, in base address order.
+        /// </summary>
+        public IReadOnlyList< DbgModuleInfo > Modules { get { return m_modules; } }
+
+
+        /// <summary>
+        ///    Finds the module whose range contains the specified address. Returns null
+        ///    if there isn't one.
+        /// </summary>
+        public DbgModuleInfo FindByAddress( ulong address )
+        {
+            int i = _FindLastStartingAtOrBelow( address );
+
+            // Among overlapping candidates, the one that came first in the input wins,
+            // so we can't just take the first hit walking backwards.
+            DbgModuleInfo found = null;
+            int foundOrder = Int32.MaxValue;
+            for( ; (i >= 0) && (m_maxEnds[ i ] > address); i-- )
+            {
+                if( m_ends[ i ] > address )
+                {
+                    if( null == found )
+                    {
+                        found = m_modules[ i ];
+                        // Fast path: nothing else could contain the address.
+                        if( (0 == i) || (m_maxEnds[ i - 1 ] <= address) )
+                            return found;
+
+                        foundOrder = m_inputOrder[ i ];
+                    }
+                    else
+                    {
+                        if( m_inputOrder[ i ] < foundOrder )
+                        {
+                            found = m_modules[ i ];
+                            foundOrder = m_inputOrder[ i ];
+                        }
+                    }
+                }
+            }
+            return found;
+        } // end FindByAddress()
+
+
+        /// <summary>
+        ///    Finds the module with the specified base address. Returns null if there
+        ///    isn't one.
+        /// </summary>
+        public DbgModuleInfo FindByBase( ulong baseAddress )
+        {
+            int i = _FindLastStartingAtOrBelow( baseAddress );
+            DbgModuleInfo found = null;
+            for( ; (i >= 0) && (m_bases[ i ] == baseAddress); i-- )
+            {
+                // Equal bases are in input order, so the leftmost one is the first.
+                found = m_modules[ i ];
+            }
+            return found;
+        } // end FindByBase()
+
+
+        private int _FindLastStartingAtOrBelow( ulong address )
+        {
+            int lo = 0;
+            int hi = m_bases.Length - 1;
+            int result = -1;
+            while( lo <= hi )
+            {
+                int mid = lo + ((hi - lo) / 2);
+                if( m_bases[ mid ] <= address )
+                {
+                    result = mid;
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid - 1;
+                }
+            }
+            return result;
+        } // end _FindLastStartingAtOrBelow()
+    } // end class ModuleAddressIndex
+}
@@ -0,0 +1,222 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    A bounded, lock-free, multiple-producer/single-consumer queue of actions.
+    /// </summary>
+    /// <remarks>
+    ///    This is the usual sequence-numbered ring: each slot carries a sequence number
+    ///    that tells producers when it is free and the consumer when it has been
+    ///    published, so producers only contend on the CompareExchange that claims a
+    ///    slot. When the ring is full, producers spin (and eventually yield) until the
+    ///    consumer catches up.
+    ///
+    ///    The consumer drains everything that has been published in one go
+    ///    (DrainTo), and only blocks on an event once the ring is empty. Producers
+    ///    only touch the event if the consumer says it is (about to be) asleep.
+    ///
+    ///    Add and CompleteAdding behave like their BlockingCollection namesakes: once
+    ///    adding is complete, Add throws InvalidOperationException, and DrainTo
+    ///    returns false once every action added before that has been run.
+    /// </remarks>
+    internal sealed class MpscActionQueue : IDisposable
+    {
+        private struct Slot
+        {
+            public long Sequence;
+            public Action Action;
+        }
+
+        [StructLayout( LayoutKind.Explicit, Size = 128 )]
+        private struct PaddedLong
+        {
+            [FieldOffset( 64 )]
+            public long Value;
+        }
+
+        public const int DefaultCapacity = 1024;
+
+        private readonly Slot[] m_slots;
+        private readonly long m_mask;
+
+        // Keep the producer and consumer cursors on separate cache lines.
+        private PaddedLong m_tail; // next slot to claim (producers)
+        private PaddedLong m_head; // next slot to run (consumer)
+
+        private int m_sleeping;
+        private int m_adding;      // producers between their completion check and publishing
+        private volatile bool m_completed;
+        private readonly ManualResetEventSlim m_wake = new ManualResetEventSlim( false, 0 );
+
+
+        public MpscActionQueue()
+            : this( DefaultCapacity )
+        {
+        }
+
+        public MpscActionQueue( int capacity )
+        {
+            if( (capacity < 2) || (0 != (capacity & (capacity - 1))) )
+                throw new ArgumentOutOfRangeException( nameof( capacity ), capacity, "Capacity must be a power of two." );
+
+            m_slots = new Slot[ capacity ];
+            m_mask = capacity - 1;
+            for( int i = 0; i < capacity; i++ )
+            {
+                m_slots[ i ].Sequence = i;
+            }
+        } // end constructor
+
+
+        public bool IsAddingCompleted { get { return m_completed; } }
+
+        /// <summary>
+        ///    True if adding has been completed and everything added has been drained.
+        /// </summary>
+        public bool IsCompleted
+        {
+            get
+            {
+                return m_completed &&
+                       (0 == Volatile.Read( ref m_adding )) &&
+                       _IsEmpty();
+            }
+        }
+
+
+        public void Add( Action action )
+        {
+            if( null == action )
+                throw new ArgumentNullException( nameof( action ) );
+
+            Interlocked.Increment( ref m_adding );
+            try
+            {
+                if( m_completed )
+                    throw new InvalidOperationException( "The queue has been marked as complete with regards to additions." );
+
+                var spinner = new SpinWait();
+                while( true )
+                {
+                    long pos = Volatile.Read( ref m_tail.Value );
+                    int idx = (int) (pos & m_mask);
+                    long diff = Volatile.Read( ref m_slots[ idx ].Sequence ) - pos;
+
+                    if( 0 == diff )
+                    {
+                        if( pos == Interlocked.CompareExchange( ref m_tail.Value, pos + 1, pos ) )
+                        {
+                            m_slots[ idx ].Action = action;
+                            // Full fence: pairs with the one in _WaitForWork, so that
+                            // either we see the consumer asleep or it sees this slot.
+                            Interlocked.Exchange( ref m_slots[ idx ].Sequence, pos + 1 );
+                            break;
+                        }
+                    }
+                    else if( diff < 0 )
+                    {
+                        // Full; wait for the consumer to make room.
+                        spinner.SpinOnce();
+                    }
+                    // else another producer claimed this slot first; try the next one.
+                }
+            }
+            finally
+            {
+                Interlocked.Decrement( ref m_adding );
+            }
+
+            if( 0 != Volatile.Read( ref m_sleeping ) )
+                m_wake.Set();
+        } // end Add()
+
+
+        public void CompleteAdding()
+        {
+            m_completed = true;
+            Thread.MemoryBarrier();
+            m_wake.Set();
+        } // end CompleteAdding()
+
+
+        /// <summary>
+        ///    Runs every action that has been published, blocking if there are none.
+        ///    Must only be called from the (single) consumer thread. Returns false once
+        ///    the queue is completed and empty.
+        /// </summary>
+        public bool DrainTo( Action< Action > run )
+        {
+            while( true )
+            {
+                int ran = 0;
+                Action action;
+                while( _TryTake( out action ) )
+                {
+                    run( action );
+                    ran++;
+                }
+
+                if( ran > 0 )
+                    return true;
+
+                if( IsCompleted )
+                    return false;
+
+                _WaitForWork();
+            }
+        } // end DrainTo()
+
+
+        private bool _TryTake( out Action action )
+        {
+            long pos = m_head.Value;
+            int idx = (int) (pos & m_mask);
+            if( Volatile.Read( ref m_slots[ idx ].Sequence ) != (pos + 1) )
+            {
+                // Empty, or the producer that claimed the slot hasn't published it yet.
+                action = null;
+                return false;
+            }
+
+            action = m_slots[ idx ].Action;
+            m_slots[ idx ].Action = null;
+            Volatile.Write( ref m_slots[ idx ].Sequence, pos + m_slots.Length );
+            m_head.Value = pos + 1;
+            return true;
+        } // end _TryTake()
+
+
+        private bool _IsEmpty()
+        {
+            long pos = m_head.Value;
+            return Volatile.Read( ref m_slots[ (int) (pos & m_mask) ].Sequence ) != (pos + 1);
+        }
+
+
+        private void _WaitForWork()
+        {
+            m_wake.Reset();
+            Interlocked.Exchange( ref m_sleeping, 1 );
+            try
+            {
+                if( !_IsEmpty() || m_completed )
+                    return;
+
+                m_wake.Wait();
+            }
+            finally
+            {
+                Volatile.Write( ref m_sleeping, 0 );
+            }
+        } // end _WaitForWork()
+
+
+        public void Dispose()
+        {
+            CompleteAdding();
+        }
+    } // end class MpscActionQueue
+}
@@ -120,13 +120,10 @@ private static NamespaceItem _PreLinkValidation( string name, NamespaceItem pare
             // into infinite recursion here.
             if( (null != parent) && !ephemeral )
             {
-                // TODO: pretty inefficient when populating a large directory. Look into using a set instead.
-                foreach( var child in parent.EnumerateChildItems() )
+                NamespaceItem existing;
+                if( parent.TryFindLinkedChild( name, out existing ) )
                 {
-                    if( 0 == Util.Strcmp_OI( child.Name, name ) )
-                    {
-                        throw new ItemExistsException( name, parent );
-                    }
+                    throw new ItemExistsException( name, parent );
                 }
             }
 
@@ -144,9 +141,67 @@ protected NamespaceItem( string name, NamespaceItem parent, bool ephemeral )
             // we'll have to manually set Item here.
             Item = this;
             Name = name;
+
+            if( (null != parent) && !ephemeral )
+                parent.OnChildLinked( this );
+        }
+
+
+        // Computed paths are cached. Any rename, move or removal anywhere in the tree
+        // bumps sm_pathGeneration, which throws all of them away: those are rare
+        // compared to path lookups, and this way we don't have to visit every
+        // descendant of the item that moved. (Adding a brand-new item can't make any
+        // cached path wrong, so that doesn't.)
+        private static int sm_pathGeneration;
+        private int m_pathGeneration = -1;
+        private string m_path;
+        private string m_registryStylePath;
+
+        private static void _InvalidateCachedPaths()
+        {
+            sm_pathGeneration++;
+        }
+
+
+        /// <summary>
+        ///    Called after a child is linked into this item's list of children.
+        /// </summary>
+        internal virtual void OnChildLinked( NamespaceItem child )
+        {
+        }
+
+        /// <summary>
+        ///    Called after a child is unlinked from this item's list of children (and
+        ///    before a child's name changes).
+        /// </summary>
+        internal virtual void OnChildUnlinked( NamespaceItem child )
+        {
         }
 
 
+        public override TreeNode< NamespaceItem > AddChild( TreeNode< NamespaceItem > graft )
+        {
+            var added = base.AddChild( graft );
+
+            // If the graft already had a path cached, it was computed somewhere else
+            // (say, while it was unlinked), so it and everything under it is stale.
+            if( graft.Item.m_pathGeneration == sm_pathGeneration )
+                _InvalidateCachedPaths();
+
+            OnChildLinked( graft.Item );
+            return added;
+        } // end AddChild()
+
+
+        public override TreeNode< NamespaceItem > RemoveChild( TreeNode< NamespaceItem > cutMe )
+        {
+            var removed = base.RemoveChild( cutMe );
+            _InvalidateCachedPaths();
+            OnChildUnlinked( cutMe.Item );
+            return removed;
+        } // end RemoveChild()
+
+
         public bool TryWalkTreeRelative( string path, out NamespaceItem dest )
         {
             dest = null;
@@ -222,6 +277,16 @@ public bool TryWalkTreeRelative( string path, ref List< NamespaceItem > nsPathIt
 
 
         public virtual bool TryFindChild( string childName, out NamespaceItem child )
+        {
+            return TryFindLinkedChild( childName, out child );
+        } // end FindChild()
+
+
+        /// <summary>
+        ///    Like TryFindChild, but only finds children that are actually linked into
+        ///    the tree (not ephemeral ones that a container makes up on the fly).
+        /// </summary>
+        internal virtual bool TryFindLinkedChild( string childName, out NamespaceItem child )
         {
             child = null;
             foreach( var candidate in EnumerateChildItems() )
@@ -233,7 +298,7 @@ public virtual bool TryFindChild( string childName, out NamespaceItem child )
                 }
             }
             return false;
-        } // end FindChild()
+        } // end TryFindLinkedChild()
 
 
         /// <summary>
@@ -241,28 +306,47 @@ public virtual bool TryFindChild( string childName, out NamespaceItem child )
         /// </summary>
         public string ComputePath( bool registryProviderStyle )
         {
-            NamespaceItem item = this;
-            Stack< string > pathStack = new Stack< string >();
-            // We go while item.Parent is not null, rather than while item is not null,
-            // because the root item will have a name, but we need to use String.Empty
-            // for the root instead. (The root of the virtual namespace is always String.Empty.)
-            while( null != item.Parent )
+            if( m_pathGeneration != sm_pathGeneration )
             {
-                pathStack.Push( item.Name );
-                item = item.Parent.Item;
+                m_path = null;
+                m_registryStylePath = null;
+                m_pathGeneration = sm_pathGeneration;
+            }
+
+            string path = registryProviderStyle ? m_registryStylePath : m_path;
+            if( null != path )
+                return path;
+
+            if( null == Parent )
+            {
+                // The root item will have a name, but we need to use String.Empty for
+                // the root instead. (The root of the virtual namespace is always
+                // String.Empty.)
+                path = String.Empty;
+            }
+            else if( registryProviderStyle && (null == Parent.Item.Parent) )
+            {
+                // The non-registry provider style makes a lot more sense to me. But it
+                // causes weirdness with globbing at the root of the namespace--for
+                // instance, if you are at the root, and you type "dir .\Pro[tab]",
+                // you'll end up seeing "dir .\\Process" (note the extra whack).
+                // Removing the root whack by passing 'true' for registryProviderStyle is
+                // just part of the change to enable behavior more like the Registry
+                // provider (wherein tab completion for files at the root does not work
+                // when CWD is a provider-qualified path that is not at the root).
+                path = Name;
             }
-            // The non-registry provider style makes a lot more sense to me. But it causes
-            // weirdness with globbing at the root of the namespace--for instance, if you
-            // are at the root, and you type "dir .\Pro[tab]", you'll end up seeing "dir
-            // .\\Process" (note the extra whack).  Removing the root whack by passing
-            // 'true' for registryProviderStyle is just part of the change to enable
-            // behavior more like the Registry provider (wherein tab completion for files
-            // at the root does not work when CWD is a provider-qualified path that is not
-            // at the root).
-            if( !registryProviderStyle )
-                pathStack.Push( String.Empty ); // for the root of the virtual namespace
-
-            return String.Join( @"\", pathStack );
+            else
+            {
+                path = Parent.Item.ComputePath( registryProviderStyle ) + @"\" + Name;
+            }
+
+            if( registryProviderStyle )
+                m_registryStylePath = path;
+            else
+                m_path = path;
+
+            return path;
         } // end ComputePath()
 
 
@@ -284,17 +368,25 @@ public bool HasChildren
 
 
         /// <summary>
-        ///    Returns true if this NamespaceItem is a parent of the specified item.
+        ///    Returns true if this NamespaceItem is the specified item or one of its
+        ///    ancestors.
         /// </summary>
         public bool Contains( NamespaceItem nsItem )
         {
             if( null == nsItem )
                 throw new ArgumentNullException( "nsItem" );
 
-            string myPath = ComputePath( false );
-            string itsPath = nsItem.ComputePath( false );
+            NamespaceItem item = nsItem;
+            while( true )
+            {
+                if( item == this )
+                    return true;
+
+                if( null == item.Parent )
+                    return false;
 
-            return itsPath.StartsWith( myPath, StringComparison.OrdinalIgnoreCase );
+                item = item.Parent.Item;
+            }
         } // end Contains()
 
 
@@ -400,6 +492,7 @@ public virtual NamespaceItem MoveTo( NamespaceItem destContainer, string destNam
 
             Name = destName;
             destContainer.AddChild( this );
+            _InvalidateCachedPaths();
 
             return this;
         } // end MoveTo()
@@ -416,9 +509,17 @@ public virtual void Rename( string newName )
                 NamespaceItem unused;
                 if( Parent.Item.TryFindChild( newName, out unused ) )
                     throw new ItemExistsException( newName, Parent.Item );
+
+                Parent.Item.OnChildUnlinked( this );
+                Name = newName;
+                Parent.Item.OnChildLinked( this );
+            }
+            else
+            {
+                Name = newName;
             }
 
-            Name = newName;
+            _InvalidateCachedPaths();
         } // end Rename()
 
         public bool TryFindChildAs< TChild >( string childName, out TChild nsChild ) where TChild : NamespaceItem
@@ -891,9 +992,43 @@ private void _CreateChildrenFromObject( object obj )
 
         private bool m_populatedChildren;
 
+        // Linked children by name, so that looking one up (which happens for every
+        // segment of every path the provider is handed) doesn't have to scan all of
+        // them. (_PreLinkValidation, MoveTo and Rename keep names unique.)
+        private readonly Dictionary< string, NamespaceItem > m_childIndex
+            = new Dictionary< string, NamespaceItem >( StringComparer.OrdinalIgnoreCase );
+
+        internal override void OnChildLinked( NamespaceItem child )
+        {
+            Util.Assert( !m_childIndex.ContainsKey( child.Name ) );
+            m_childIndex[ child.Name ] = child;
+        } // end OnChildLinked()
+
+        internal override void OnChildUnlinked( NamespaceItem child )
+        {
+            NamespaceItem indexed;
+            if( m_childIndex.TryGetValue( child.Name, out indexed ) && (indexed == child) )
+                m_childIndex.Remove( child.Name );
+        } // end OnChildUnlinked()
+
+
+        internal override bool TryFindLinkedChild( string childName, out NamespaceItem child )
+        {
+            _PopulateChildren();
+            return m_childIndex.TryGetValue( childName, out child );
+        } // end TryFindLinkedChild()
+
+
         // We want to lazily create the children, so we'll implement the necessary methods as
         // if the children were ephemeral, but we can persist them ourselves here.
         public override IEnumerable< TreeNode< NamespaceItem > > EnumerateChildren()
+        {
+            _PopulateChildren();
+            return base.EnumerateChildren();
+        } // end EnumerateChildren()
+
+
+        private void _PopulateChildren()
         {
             if( !m_populatedChildren )
             {
@@ -947,9 +1082,7 @@ private void _CreateChildrenFromObject( object obj )
                     }
                 }
             } // end if( !m_populatedChildren )
-
-            return base.EnumerateChildren();
-        } // end EnumerateChildren()
+        } // end _PopulateChildren()
 
         public NamespaceItem CreateChild( object representsChild )
         {
@@ -6,6 +6,7 @@
 using System;
 using System.Collections.Generic;
 using System.Diagnostics;
+using System.IO;
 using System.Runtime.InteropServices;
 using System.Threading;
 using DbgEngWrapper;
@@ -720,6 +721,9 @@ private static bool _IsSyntheticTypeId( uint typeId )
 
             _DumpSyntheticTypeInfoForModuleWorker( sm_syntheticTypes, /*hProc,*/ modBase );
             _DumpSyntheticTypeInfoForModuleWorker( sm_reverseSynthPointerTypes, /*hProc,*/ modBase );
+
+            // The module may have a different PDB now.
+            TypeLayoutDiskCache.ForgetModule( modBase );
         } // end DumpSyntheticTypeInfoForModule()
 
 
@@ -867,15 +871,8 @@ private static bool _IsSyntheticTypeId( uint typeId )
                                                            ulong modBase,
                                                            uint typeId )
         {
-            uint numChildren = 0;
-
-            _SymGetTypeInfo( hProcess,
-                             modBase,
-                             typeId,
-                             IMAGEHLP_SYMBOL_TYPE_INFO.TI_GET_CHILDRENCOUNT,
-                             &numChildren );
-
-            return _FindTypeChildrenRaw( hProcess, modBase, typeId, numChildren );
+            return DbgEngDebugger._GlobalDebugger.ExecuteOnDbgEngThread( () =>
+                _FindTypeChildrenRaw_naked( hProcess, modBase, typeId, null ) );
         }
 
         private static unsafe uint[] _FindTypeChildrenRaw( IntPtr hProcess,
@@ -883,20 +880,87 @@ private static bool _IsSyntheticTypeId( uint typeId )
                                                            uint typeId,
                                                            uint numChildren )
         {
-            uint[] buf = new uint[ 2 + numChildren ]; // TI_FINDCHILDREN_PARAMS structure
-            buf[ 0 ] = numChildren; // the "count" field of TI_FINDCHILDREN_PARAMS
+            return DbgEngDebugger._GlobalDebugger.ExecuteOnDbgEngThread( () =>
+                _FindTypeChildrenRaw_naked( hProcess, modBase, typeId, numChildren ) );
+        }
+
+        private static unsafe uint[] _FindTypeChildrenRaw_naked( IntPtr hProcess,
+                                                                 ulong modBase,
+                                                                 uint typeId,
+                                                                 uint? numChildren )
+        {
+            bool cacheable = !_IsSyntheticTypeId( typeId );
+            uint[] buf;
+
+            if( cacheable &&
+                TypeLayoutDiskCache.TryGet( hProcess,
+                                            modBase,
+                                            typeId,
+                                            TypeLayoutDiskCache.RecordKind.Children,
+                                            _ReadUInt32Array,
+                                            out buf ) &&
+                (!numChildren.HasValue || (numChildren.Value == buf[ 0 ])) )
+            {
+                return buf;
+            }
+
+            uint count = 0;
+            if( numChildren.HasValue )
+            {
+                count = numChildren.Value;
+            }
+            else
+            {
+                _SymGetTypeInfo_naked( hProcess,
+                                       modBase,
+                                       typeId,
+                                       IMAGEHLP_SYMBOL_TYPE_INFO.TI_GET_CHILDRENCOUNT,
+                                       &count );
+            }
+
+            buf = new uint[ 2 + count ]; // TI_FINDCHILDREN_PARAMS structure
+            buf[ 0 ] = count; // the "count" field of TI_FINDCHILDREN_PARAMS
 
             fixed( uint* pBuf = buf )
             {
-                _SymGetTypeInfo( hProcess,
-                                 modBase,
-                                 typeId,
-                                 IMAGEHLP_SYMBOL_TYPE_INFO.TI_FINDCHILDREN,
-                                 pBuf );
+                _SymGetTypeInfo_naked( hProcess,
+                                       modBase,
+                                       typeId,
+                                       IMAGEHLP_SYMBOL_TYPE_INFO.TI_FINDCHILDREN,
+                                       pBuf );
+            }
+
+            if( cacheable )
+            {
+                TypeLayoutDiskCache.Add( hProcess,
+                                         modBase,
+                                         typeId,
+                                         TypeLayoutDiskCache.RecordKind.Children,
+                                         ( w ) => _WriteUInt32Array( w, buf ) );
             }
 
             return buf;
-        } // end _FindTypeChildrenRaw()
+        } // end _FindTypeChildrenRaw_naked()
+
+
+        private static uint[] _ReadUInt32Array( BinaryReader reader )
+        {
+            uint[] a = new uint[ TypeLayoutDiskCache.ReadCount( reader, sizeof( uint ) ) ];
+            for( int i = 0; i < a.Length; i++ )
+            {
+                a[ i ] = reader.ReadUInt32();
+            }
+            return a;
+        }
+
+        private static void _WriteUInt32Array( BinaryWriter writer, uint[] a )
+        {
+            writer.Write( a.Length );
+            foreach( uint u in a )
+            {
+                writer.Write( u );
+            }
+        }
 
 
         public static unsafe uint[] FindTypeChildren( WDebugClient debugClient,
@@ -1475,6 +1539,17 @@ internal struct UdtInfoRequest
 
             IntPtr hProcess = _GetHProcForDebugClient( debugClient );
 
+            RawUdtInfo cached;
+            if( TypeLayoutDiskCache.TryGet( hProcess,
+                                            modBase,
+                                            typeId,
+                                            TypeLayoutDiskCache.RecordKind.Udt,
+                                            ( r ) => new RawUdtInfo( r ),
+                                            out cached ) )
+            {
+                return cached;
+            }
+
             UdtInfoRequest uir;
 
             // Since we're only getting info about one id, we use the alternate mode of
@@ -1534,7 +1609,9 @@ internal struct UdtInfoRequest
                     Util.Assert( 0x4f == (reqsValid & 0x4f) ); // we should always be able to get these items for a UDT
                     // If we couldn't get the other properties, their default values of 0 will be fine.
 
-                    return new RawUdtInfo( uir );
+                    var rui = new RawUdtInfo( uir );
+                    TypeLayoutDiskCache.Add( hProcess, modBase, typeId, TypeLayoutDiskCache.RecordKind.Udt, rui.Serialize );
+                    return rui;
                 }
                 finally
                 {
@@ -1616,6 +1693,17 @@ internal unsafe struct DataInfoRequest
 
             IntPtr hProcess = _GetHProcForDebugClient( debugClient );
 
+            RawDataInfo cached;
+            if( TypeLayoutDiskCache.TryGet( hProcess,
+                                            modBase,
+                                            typeId,
+                                            TypeLayoutDiskCache.RecordKind.Data,
+                                            ( r ) => new RawDataInfo( r, modBase ),
+                                            out cached ) )
+            {
+                return cached;
+            }
+
             DataInfoRequest dir;
 
             IntPtr pvtIntPtr = new IntPtr( dir.Value );
@@ -1691,7 +1779,15 @@ internal unsafe struct DataInfoRequest
                     // DbgHelp likes to initialize the Value VARIANT with an int 0 (as
                     // opposed to an empty VARIANT), so we need to use reqsValid to
                     // determine if we should pay attention to the Value or not.
-                    return new RawDataInfo( dir, valueFieldIsValid: 0 != (reqsValid & 0x200) );
+                    var rdi = new RawDataInfo( dir, valueFieldIsValid: 0 != (reqsValid & 0x200) );
+                    if( rdi.CanSerialize )
+                        TypeLayoutDiskCache.Add( hProcess,
+                                                 modBase,
+                                                 typeId,
+                                                 TypeLayoutDiskCache.RecordKind.Data,
+                                                 ( w ) => rdi.Serialize( w, modBase ) );
+
+                    return rdi;
                 }
                 finally
                 {
@@ -1702,6 +1798,212 @@ internal unsafe struct DataInfoRequest
         } // end GetDataInfo_naked()
 
 
+        // For the batched version (GetDataInfos), where the offsets are relative to each
+        // element of the buffer.
+        private static readonly SIZE_T[] sm_dataInfoReqStrideOffsets = new SIZE_T[]
+        {
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "SymTag" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "DataKind" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "TypeId" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "ClassParentId" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "Offset" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "AddressOffset" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "BitPosition" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "Length" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "Address" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "Value" ),
+            Marshal.OffsetOf( typeof( DataInfoRequest ), "SymName" ),
+        };
+
+
+        /// <summary>
+        ///    Like GetDataInfo, but for many type IDs at once (such as all the data
+        ///    members of a UDT), with a single SymGetTypeInfoEx call.
+        /// </summary>
+        public static unsafe RawDataInfo[] GetDataInfos( WDebugClient debugClient,
+                                                         ulong modBase,
+                                                         uint[] typeIds )
+        {
+            return DbgEngDebugger._GlobalDebugger.ExecuteOnDbgEngThread( () =>
+                GetDataInfos_naked( debugClient,
+                                    modBase,
+                                    typeIds ) );
+        }
+
+        private static RawDataInfo[] GetDataInfos_naked( WDebugClient debugClient,
+                                                         ulong modBase,
+                                                         uint[] typeIds )
+        {
+            if( null == typeIds )
+                throw new ArgumentNullException( "typeIds" );
+
+            if( !TypeLayoutDiskCache.Enabled || (typeIds.Length < 2) )
+                return _GetDataInfosFromDbgHelp( debugClient, modBase, typeIds );
+
+            // Only ask dbghelp about the ones that aren't in the disk cache.
+            IntPtr hProcess = _GetHProcForDebugClient( debugClient );
+            var rdis = new RawDataInfo[ typeIds.Length ];
+            var missIdxs = new List< int >();
+            for( int i = 0; i < typeIds.Length; i++ )
+            {
+                if( _IsSyntheticTypeId( typeIds[ i ] ) ||
+                    !TypeLayoutDiskCache.TryGet( hProcess,
+                                                 modBase,
+                                                 typeIds[ i ],
+                                                 TypeLayoutDiskCache.RecordKind.Data,
+                                                 ( r ) => new RawDataInfo( r, modBase ),
+                                                 out rdis[ i ] ) )
+                {
+                    missIdxs.Add( i );
+                }
+            }
+
+            if( 0 == missIdxs.Count )
+                return rdis;
+
+            uint[] missIds = new uint[ missIdxs.Count ];
+            for( int i = 0; i < missIds.Length; i++ )
+            {
+                missIds[ i ] = typeIds[ missIdxs[ i ] ];
+            }
+
+            RawDataInfo[] missRdis = _GetDataInfosFromDbgHelp( debugClient, modBase, missIds );
+            for( int i = 0; i < missIds.Length; i++ )
+            {
+                RawDataInfo missRdi = missRdis[ i ];
+                rdis[ missIdxs[ i ] ] = missRdi;
+                if( missRdi.CanSerialize )
+                {
+                    TypeLayoutDiskCache.Add( hProcess,
+                                             modBase,
+                                             missIds[ i ],
+                                             TypeLayoutDiskCache.RecordKind.Data,
+                                             ( w ) => missRdi.Serialize( w, modBase ) );
+                }
+            }
+
+            return rdis;
+        } // end GetDataInfos_naked()
+
+
+        private static unsafe RawDataInfo[] _GetDataInfosFromDbgHelp( WDebugClient debugClient,
+                                                                      ulong modBase,
+                                                                      uint[] typeIds )
+        {
+            var rdis = new RawDataInfo[ typeIds.Length ];
+            if( typeIds.Length < 2 )
+            {
+                for( int i = 0; i < typeIds.Length; i++ )
+                {
+                    rdis[ i ] = GetDataInfo_naked( debugClient, modBase, typeIds[ i ] );
+                }
+                return rdis;
+            }
+
+            foreach( uint typeId in typeIds )
+            {
+                if( _IsSyntheticTypeId( typeId ) )
+                {
+                    throw new ArgumentException( Util.Sprintf( "There is currently no way to register a synthetic data type, so this can't be right. (typeId {0})",
+                                                               typeId ),
+                                                 "typeIds" );
+                }
+            }
+
+            IntPtr hProcess = _GetHProcForDebugClient( debugClient );
+
+            int reqStride = sizeof( DataInfoRequest );
+            int bufSize = typeIds.Length * reqStride;
+            DataInfoRequest* buf = (DataInfoRequest*) Marshal.AllocHGlobal( bufSize );
+            ulong[] reqsValid = new ulong[ typeIds.Length ];
+            uint entriesFilled = 0;
+
+            // Zeroed before anything can throw, so the finally block can tell which
+            // names need freeing.
+            for( int i = 0; i < typeIds.Length; i++ )
+            {
+                buf[ i ] = default( DataInfoRequest );
+            }
+
+            try
+            {
+                for( int i = 0; i < typeIds.Length; i++ )
+                {
+                    Marshal.GetNativeVariantForObject( null, new IntPtr( buf[ i ].Value ) );
+                }
+
+                var gtip = new IMAGEHLP_GET_TYPE_INFO_PARAMS();
+
+                fixed( uint* pIds = typeIds,
+                             pReqSizes = sm_dataInfoReqSizes )
+                fixed( SIZE_T* pReqOffsets = sm_dataInfoReqStrideOffsets )
+                fixed( ulong* pReqsValid = reqsValid )
+                fixed( IMAGEHLP_SYMBOL_TYPE_INFO* pReqKinds = sm_dataInfoReqKinds )
+                {
+                    gtip.NumIds = (uint) typeIds.Length;
+                    gtip.TypeIds = pIds;
+                    gtip.TagFilter = (ulong) (1L << (int) SymTag.SymTagMax) - 1;
+                    gtip.NumReqs = (uint) sm_dataInfoReqKinds.Length;
+                    gtip.ReqKinds = pReqKinds;
+                    gtip.ReqOffsets = pReqOffsets;
+                    gtip.ReqSizes = pReqSizes;
+                    gtip.ReqStride = (SIZE_T) reqStride;
+                    gtip.BufferSize = (SIZE_T) bufSize;
+                    gtip.Buffer = buf;
+                    gtip.NumReqsValid = (uint) typeIds.Length;
+                    gtip.ReqsValid = pReqsValid;
+
+                    bool itWorked = NativeMethods.SymGetTypeInfoEx( hProcess,
+                                                                    modBase,
+                                                                    gtip );
+                    if( !itWorked )
+                        throw new DbgEngException( Marshal.GetLastWin32Error() );
+
+                    entriesFilled = gtip.EntriesFilled;
+                }
+
+                if( entriesFilled != typeIds.Length )
+                {
+                    // Something in there was bad; the one-at-a-time path will tell us what.
+                    LogManager.Trace( "GetDataInfos: only got {0} of {1} entries; falling back to one at a time.",
+                                      entriesFilled,
+                                      typeIds.Length );
+
+                    for( int i = 0; i < typeIds.Length; i++ )
+                    {
+                        rdis[ i ] = GetDataInfo_naked( debugClient, modBase, typeIds[ i ] );
+                    }
+                    return rdis;
+                }
+
+                for( int i = 0; i < typeIds.Length; i++ )
+                {
+                    // Same checks as GetDataInfo_naked.
+                    Util.Assert( 0 != (reqsValid[ i ] & 0x01) );
+                    if( SymTag.Data != buf[ i ].SymTag )
+                        throw new ArgumentException( Util.Sprintf( "TypeId {0} is not a Data (it's a {1}).",
+                                                                   typeIds[ i ],
+                                                                   buf[ i ].SymTag ) );
+
+                    Util.Assert( 0x407 == (reqsValid[ i ] & 0x407) );
+
+                    rdis[ i ] = new RawDataInfo( buf[ i ], valueFieldIsValid: 0 != (reqsValid[ i ] & 0x200) );
+                }
+
+                return rdis;
+            }
+            finally
+            {
+                for( int i = 0; i < typeIds.Length; i++ )
+                {
+                    if( IntPtr.Zero != buf[ i ].SymName )
+                        Marshal.FreeHGlobal( buf[ i ].SymName );
+                }
+                Marshal.FreeHGlobal( (IntPtr) buf );
+            }
+        } // end _GetDataInfosFromDbgHelp()
+
+
         // Not all of these will be valid, depending on the function.
         private static readonly IMAGEHLP_SYMBOL_TYPE_INFO[] sm_funcTypeInfoReqKinds = new IMAGEHLP_SYMBOL_TYPE_INFO[]
         {                                                          // ReqsValid bits
@@ -2011,6 +2313,17 @@ internal struct BaseClassInfoRequest
 
             IntPtr hProcess = _GetHProcForDebugClient( debugClient );
 
+            RawBaseClassInfo cached;
+            if( TypeLayoutDiskCache.TryGet( hProcess,
+                                            modBase,
+                                            typeId,
+                                            TypeLayoutDiskCache.RecordKind.BaseClass,
+                                            ( r ) => new RawBaseClassInfo( r ),
+                                            out cached ) )
+            {
+                return cached;
+            }
+
             BaseClassInfoRequest bcir;
 
             // Since we're only getting info about one id, we use the alternate mode of
@@ -2087,7 +2400,9 @@ internal struct BaseClassInfoRequest
 
                     Util.Assert( 0 == bcir.VirtualBaseOffset ); // Not an invariant; I just want to see if it ever happens.
 
-                    return new RawBaseClassInfo( bcir );
+                    var rbci = new RawBaseClassInfo( bcir );
+                    TypeLayoutDiskCache.Add( hProcess, modBase, typeId, TypeLayoutDiskCache.RecordKind.BaseClass, rbci.Serialize );
+                    return rbci;
                 }
                 finally
                 {
@@ -2521,6 +2836,17 @@ internal struct EnumInfoRequest
 
             IntPtr hProcess = _GetHProcForDebugClient( debugClient );
 
+            RawEnumInfo cached;
+            if( TypeLayoutDiskCache.TryGet( hProcess,
+                                            modBase,
+                                            typeId,
+                                            TypeLayoutDiskCache.RecordKind.Enum,
+                                            ( r ) => new RawEnumInfo( r ),
+                                            out cached ) )
+            {
+                return cached;
+            }
+
             EnumInfoRequest eir;
 
             // Since we're only getting info about one id, we use the alternate mode of
@@ -2579,7 +2905,9 @@ internal struct EnumInfoRequest
                     Util.Assert( 0x3f == (reqsValid & 0x3f) ); // we should always be able to get these items for an Enum
                     // If we couldn't get the other properties, their default values of 0 will be fine.
 
-                    return new RawEnumInfo( typeId, eir );
+                    var rei = new RawEnumInfo( typeId, eir );
+                    TypeLayoutDiskCache.Add( hProcess, modBase, typeId, TypeLayoutDiskCache.RecordKind.Enum, rei.Serialize );
+                    return rei;
                 }
                 finally
                 {
@@ -2640,6 +2968,20 @@ internal struct EnumInfoRequest
             // number of children, and one to get all the info for all the children at the
             // same type (via SymGetTypeInfoEx).
 
+            bool cacheable = !_IsSyntheticTypeId( typeId );
+            Enumerand[] cached;
+            if( cacheable &&
+                TypeLayoutDiskCache.TryGet( hProcess,
+                                            modBase,
+                                            typeId,
+                                            TypeLayoutDiskCache.RecordKind.Enumerands,
+                                            _ReadEnumerands,
+                                            out cached ) &&
+                ((0 == numEnumerands) || (numEnumerands == cached.Length)) )
+            {
+                return cached;
+            }
+
             uint[] children;
 
             if( 0 == numEnumerands )
@@ -2709,10 +3051,41 @@ internal struct EnumInfoRequest
                 enumerands[ i ] = new Enumerand( name, u );
             }
 
+            if( cacheable )
+            {
+                TypeLayoutDiskCache.Add( hProcess,
+                                         modBase,
+                                         typeId,
+                                         TypeLayoutDiskCache.RecordKind.Enumerands,
+                                         ( w ) => _WriteEnumerands( w, enumerands ) );
+            }
+
             return enumerands;
         } // end GetEnumerands_naked()
 
 
+        private static Enumerand[] _ReadEnumerands( BinaryReader reader )
+        {
+            var enumerands = new Enumerand[ TypeLayoutDiskCache.ReadCount( reader, TypeLayoutDiskCache.c_minEnumerandSize ) ];
+            for( int i = 0; i < enumerands.Length; i++ )
+            {
+                string name = reader.ReadString();
+                enumerands[ i ] = new Enumerand( name, reader.ReadUInt64() );
+            }
+            return enumerands;
+        }
+
+        private static void _WriteEnumerands( BinaryWriter writer, Enumerand[] enumerands )
+        {
+            writer.Write( enumerands.Length );
+            foreach( var e in enumerands )
+            {
+                writer.Write( e.Name );
+                writer.Write( e.Value );
+            }
+        }
+
+
         internal static object ReconstituteConstant( object rawVal, DbgBaseTypeInfo targetType )
         {
             object resizedVal = _ExtendToSize( (dynamic) rawVal, targetType.Size );
@@ -3009,19 +3382,198 @@ private static object _EnsureSignedness( ulong value, bool signed )
             if( 0 == typeId )
                 return SymTag.Null;
 
-            SymTag symTag = 0;
+            return DbgEngDebugger._GlobalDebugger.ExecuteOnDbgEngThread( () =>
+                _GetSymTag_naked( hProcess, modBase, typeId ) );
+        } // end GetSymTag()
+
+
+        private static unsafe SymTag _GetSymTag_naked( IntPtr hProcess,
+                                                       ulong modBase,
+                                                       uint typeId )
+        {
+            bool cacheable = !_IsSyntheticTypeId( typeId );
+            SymTag symTag;
+
+            if( cacheable &&
+                TypeLayoutDiskCache.TryGet( hProcess,
+                                            modBase,
+                                            typeId,
+                                            TypeLayoutDiskCache.RecordKind.SymTag,
+                                            ( r ) => (SymTag) r.ReadUInt32(),
+                                            out symTag ) )
+            {
+                return symTag;
+            }
+
+            symTag = 0;
             // TODO: SymTags should always be available for type info symbols. But if it's
             // some other sort of symbol, allegedly this is supposed to return S_FALSE.
             // Myabe we should have a special exception for "property not available" or
             // something?
-            _SymGetTypeInfo( hProcess,
-                             modBase,
-                             typeId,
-                             IMAGEHLP_SYMBOL_TYPE_INFO.TI_GET_SYMTAG,
-                             &symTag );
+            _SymGetTypeInfo_naked( hProcess,
+                                   modBase,
+                                   typeId,
+                                   IMAGEHLP_SYMBOL_TYPE_INFO.TI_GET_SYMTAG,
+                                   &symTag );
+
+            if( cacheable )
+                _AddSymTagToDiskCache( hProcess, modBase, typeId, symTag );
 
             return symTag;
-        } // end GetSymTag()
+        } // end _GetSymTag_naked()
+
+
+        private static void _AddSymTagToDiskCache( IntPtr hProcess,
+                                                   ulong modBase,
+                                                   uint typeId,
+                                                   SymTag symTag )
+        {
+            TypeLayoutDiskCache.Add( hProcess,
+                                     modBase,
+                                     typeId,
+                                     TypeLayoutDiskCache.RecordKind.SymTag,
+                                     ( w ) => w.Write( (uint) symTag ) );
+        }
+
+
+        private static readonly IMAGEHLP_SYMBOL_TYPE_INFO[] sm_symTagReqKinds = new IMAGEHLP_SYMBOL_TYPE_INFO[]
+        {
+            IMAGEHLP_SYMBOL_TYPE_INFO.TI_GET_SYMTAG,
+        };
+
+        private static readonly uint[] sm_symTagReqSizes = new uint[] { (uint) 4 };
+
+        private static readonly SIZE_T[] sm_symTagReqOffsets = new SIZE_T[] { (SIZE_T) 0 };
+
+
+        /// <summary>
+        ///    Gets the SymTags for many type IDs (such as all the children of a UDT) with
+        ///    a single SymGetTypeInfoEx call.
+        /// </summary>
+        public static unsafe SymTag[] GetSymTags( WDebugClient debugClient,
+                                                  ulong modBase,
+                                                  uint[] typeIds )
+        {
+            return DbgEngDebugger._GlobalDebugger.ExecuteOnDbgEngThread( () =>
+                GetSymTags_naked( _GetHProcForDebugClient( debugClient ),
+                                  modBase,
+                                  typeIds ) );
+        }
+
+        private static SymTag[] GetSymTags_naked( IntPtr hProcess,
+                                                  ulong modBase,
+                                                  uint[] typeIds )
+        {
+            if( null == typeIds )
+                throw new ArgumentNullException( "typeIds" );
+
+            if( !TypeLayoutDiskCache.Enabled )
+                return _GetSymTagsFromDbgHelp( hProcess, modBase, typeIds );
+
+            // Only ask dbghelp about the ones that aren't in the disk cache.
+            var symTags = new SymTag[ typeIds.Length ];
+            var missIdxs = new List< int >();
+            for( int i = 0; i < typeIds.Length; i++ )
+            {
+                uint typeId = typeIds[ i ];
+                if( (0 == typeId) ||
+                    _IsSyntheticTypeId( typeId ) ||
+                    !TypeLayoutDiskCache.TryGet( hProcess,
+                                                 modBase,
+                                                 typeId,
+                                                 TypeLayoutDiskCache.RecordKind.SymTag,
+                                                 ( r ) => (SymTag) r.ReadUInt32(),
+                                                 out symTags[ i ] ) )
+                {
+                    missIdxs.Add( i );
+                }
+            }
+
+            if( 0 == missIdxs.Count )
+                return symTags;
+
+            uint[] missIds = new uint[ missIdxs.Count ];
+            for( int i = 0; i < missIds.Length; i++ )
+            {
+                missIds[ i ] = typeIds[ missIdxs[ i ] ];
+            }
+
+            SymTag[] missTags = _GetSymTagsFromDbgHelp( hProcess, modBase, missIds );
+            for( int i = 0; i < missIds.Length; i++ )
+            {
+                symTags[ missIdxs[ i ] ] = missTags[ i ];
+                if( (0 != missIds[ i ]) && !_IsSyntheticTypeId( missIds[ i ] ) )
+                    _AddSymTagToDiskCache( hProcess, modBase, missIds[ i ], missTags[ i ] );
+            }
+
+            return symTags;
+        } // end GetSymTags_naked()
+
+
+        private static unsafe SymTag[] _GetSymTagsFromDbgHelp( IntPtr hProcess,
+                                                               ulong modBase,
+                                                               uint[] typeIds )
+        {
+            var symTags = new SymTag[ typeIds.Length ];
+
+            // SymGetTypeInfoEx doesn't know about our synthetic types, and GetSymTag
+            // special-cases typeId 0, so if we've got any of those, we do it the slow way.
+            bool canBatch = typeIds.Length > 1;
+            for( int i = 0; canBatch && (i < typeIds.Length); i++ )
+            {
+                if( (0 == typeIds[ i ]) || _IsSyntheticTypeId( typeIds[ i ] ) )
+                    canBatch = false;
+            }
+
+            if( canBatch )
+            {
+                var gtip = new IMAGEHLP_GET_TYPE_INFO_PARAMS();
+                ulong[] reqsValid = new ulong[ typeIds.Length ];
+
+                fixed( uint* pIds = typeIds,
+                             pReqSizes = sm_symTagReqSizes )
+                fixed( SIZE_T* pReqOffsets = sm_symTagReqOffsets )
+                fixed( ulong* pReqsValid = reqsValid )
+                fixed( IMAGEHLP_SYMBOL_TYPE_INFO* pReqKinds = sm_symTagReqKinds )
+                fixed( SymTag* pSymTags = symTags )
+                {
+                    gtip.NumIds = (uint) typeIds.Length;
+                    gtip.TypeIds = pIds;
+                    gtip.TagFilter = (ulong) (1L << (int) SymTag.SymTagMax) - 1;
+                    gtip.NumReqs = (uint) sm_symTagReqKinds.Length;
+                    gtip.ReqKinds = pReqKinds;
+                    gtip.ReqOffsets = pReqOffsets;
+                    gtip.ReqSizes = pReqSizes;
+                    gtip.ReqStride = (SIZE_T) sizeof( SymTag );
+                    gtip.BufferSize = (SIZE_T) (typeIds.Length * sizeof( SymTag ));
+                    gtip.Buffer = pSymTags;
+                    gtip.NumReqsValid = (uint) typeIds.Length;
+                    gtip.ReqsValid = pReqsValid;
+
+                    bool itWorked = NativeMethods.SymGetTypeInfoEx( hProcess,
+                                                                    modBase,
+                                                                    gtip );
+                    if( !itWorked )
+                        throw new DbgEngException( Marshal.GetLastWin32Error() );
+
+                    if( gtip.EntriesFilled == typeIds.Length )
+                        return symTags;
+                }
+
+                // Something in there was bad; the one-at-a-time path below will tell us
+                // what.
+                LogManager.Trace( "GetSymTags: only got {0} of {1} entries; falling back to one at a time.",
+                                  gtip.EntriesFilled,
+                                  typeIds.Length );
+            }
+
+            for( int i = 0; i < typeIds.Length; i++ )
+            {
+                symTags[ i ] = GetSymTag( hProcess, modBase, typeIds[ i ] );
+            }
+
+            return symTags;
+        } // end _GetSymTagsFromDbgHelp()
 
 
         public static IEnumerable< SymbolInfo > EnumTypesByName( WDebugClient debugClient,
@@ -3790,6 +4342,100 @@ private static unsafe IMAGEHLP_MODULEW64 GetModuleInfo_naked( WDebugClient debug
 
             return modInfo;
         } // end GetModuleInfo_naked()
+
+
+        /// <summary>
+        ///    Gets the GUID and age of the matched PDB loaded for the specified module, if
+        ///    there is one and it has type information. Must be called on the dbgeng
+        ///    thread.
+        /// </summary>
+        internal static unsafe bool TryGetPdbIdentity( IntPtr hProcess,
+                                                       ulong modBase,
+                                                       out Guid pdbGuid,
+                                                       out uint pdbAge )
+        {
+            pdbGuid = Guid.Empty;
+            pdbAge = 0;
+
+            IMAGEHLP_MODULEW64 modInfo = new IMAGEHLP_MODULEW64();
+            modInfo.SizeOfStruct = (uint) Marshal.SizeOf( modInfo );
+
+            if( !NativeMethods.SymGetModuleInfo64( hProcess, modBase, &modInfo ) )
+            {
+                LogManager.Trace( "TryGetPdbIdentity: SymGetModuleInfo64 failed for module {0}: {1}",
+                                  Util.FormatQWord( modBase ),
+                                  Marshal.GetLastWin32Error() );
+                return false;
+            }
+
+            if( (SYM_TYPE.Pdb != modInfo.SymType) ||
+                (0 != modInfo.PdbUnmatched) ||
+                (0 == modInfo.TypeInfo) )
+            {
+                return false;
+            }
+
+            byte[] sig = new byte[ 16 ];
+            Marshal.Copy( (IntPtr) modInfo.PdbSig70, sig, 0, sig.Length );
+            pdbGuid = new Guid( sig );
+            pdbAge = modInfo.PdbAge;
+            return Guid.Empty != pdbGuid;
+        } // end TryGetPdbIdentity()
+
+
+        /// <summary>
+        ///    Returns the SymTag, name, and number of children of the specified type ID
+        ///    (with zero/null for anything dbghelp doesn't have). Used by the
+        ///    TypeLayoutDiskCache to check that type IDs haven't changed since a cache
+        ///    file was written; bypasses that cache. Must be called on the dbgeng
+        ///    thread.
+        /// </summary>
+        internal static unsafe TypeLayoutDiskCache.TypeIdentity GetTypeIdentityForValidation( IntPtr hProcess,
+                                                                                              ulong modBase,
+                                                                                              uint typeId )
+        {
+            var identity = new TypeLayoutDiskCache.TypeIdentity();
+
+            SymTag tag = 0;
+            if( !NativeMethods.SymGetTypeInfo( hProcess,
+                                               modBase,
+                                               typeId,
+                                               IMAGEHLP_SYMBOL_TYPE_INFO.TI_GET_SYMTAG,
+                                               &tag ) )
+            {
+                return identity;
+            }
+            identity.Tag = tag;
+
+            uint count = 0;
+            if( NativeMethods.SymGetTypeInfo( hProcess,
+                                              modBase,
+                                              typeId,
+                                              IMAGEHLP_SYMBOL_TYPE_INFO.TI_GET_CHILDRENCOUNT,
+                                              &count ) )
+            {
+                identity.ChildrenCount = count;
+            }
+
+            IntPtr pName = IntPtr.Zero;
+            if( NativeMethods.SymGetTypeInfo( hProcess,
+                                              modBase,
+                                              typeId,
+                                              IMAGEHLP_SYMBOL_TYPE_INFO.TI_GET_SYMNAME,
+                                              &pName ) )
+            {
+                try
+                {
+                    identity.Name = Marshal.PtrToStringUni( pName );
+                }
+                finally
+                {
+                    Marshal.FreeHGlobal( pName );
+                }
+            }
+
+            return identity;
+        } // end GetTypeIdentityForValidation()
     } // end class DbgHelp
 
 
@@ -4318,6 +4964,26 @@ internal RawUdtInfo( DbgHelp.UdtInfoRequest uir )
             ClassParentId       = uir.ClassParentId;
             VirtualTableShapeId = uir.VirtualTableShapeId;
         } // end constructor
+
+        internal RawUdtInfo( BinaryReader reader )
+        {
+            SymName             = TypeLayoutDiskCache.ReadString( reader );
+            UdtKind             = (UdtKind) reader.ReadUInt32();
+            Size                = reader.ReadUInt64();
+            ChildrenCount       = reader.ReadUInt32();
+            ClassParentId       = reader.ReadUInt32();
+            VirtualTableShapeId = reader.ReadUInt32();
+        } // end constructor
+
+        internal void Serialize( BinaryWriter writer )
+        {
+            TypeLayoutDiskCache.WriteString( writer, SymName );
+            writer.Write( (uint) UdtKind );
+            writer.Write( Size );
+            writer.Write( ChildrenCount );
+            writer.Write( ClassParentId );
+            writer.Write( VirtualTableShapeId );
+        } // end Serialize()
     } // end class RawUdtInfo
 
 
@@ -4351,6 +5017,46 @@ internal unsafe RawDataInfo( DbgHelp.DataInfoRequest dir, bool valueFieldIsValid
                 Value      = Marshal.GetObjectForNativeVariant( new IntPtr( dir.Value ) );
             }
         } // end constructor
+
+        // In the disk cache, Address is stored relative to the module base (the same
+        // PDB can be loaded at a different base next time).
+        internal RawDataInfo( BinaryReader reader, ulong modBase )
+        {
+            SymName        = TypeLayoutDiskCache.ReadString( reader );
+            DataKind       = (DataKind) reader.ReadUInt32();
+            TypeId         = reader.ReadUInt32();
+            ClassParentId  = reader.ReadUInt32();
+            Offset         = reader.ReadUInt32();
+            AddressOffset  = reader.ReadUInt32();
+            Address        = reader.ReadUInt64();
+            if( 0 != Address )
+                Address += modBase;
+            BitfieldLength = reader.ReadUInt32();
+            BitPosition    = reader.ReadUInt32();
+            Value          = TypeLayoutDiskCache.ReadPrimitive( reader );
+        } // end constructor
+
+        /// <summary>
+        ///    False if Value is something that we don't know how to persist.
+        /// </summary>
+        internal bool CanSerialize
+        {
+            get { return TypeLayoutDiskCache.CanWritePrimitive( Value ); }
+        }
+
+        internal void Serialize( BinaryWriter writer, ulong modBase )
+        {
+            TypeLayoutDiskCache.WriteString( writer, SymName );
+            writer.Write( (uint) DataKind );
+            writer.Write( TypeId );
+            writer.Write( ClassParentId );
+            writer.Write( Offset );
+            writer.Write( AddressOffset );
+            writer.Write( (0 == Address) ? 0 : (Address - modBase) );
+            writer.Write( BitfieldLength );
+            writer.Write( BitPosition );
+            TypeLayoutDiskCache.WritePrimitive( writer, Value );
+        } // end Serialize()
     } // end class RawDataInfo
 
 
@@ -4429,6 +5135,42 @@ internal RawBaseClassInfo( /*uint bcTypeId,*/ DbgHelp.BaseClassInfoRequest bcir
             IsVirtualBaseClass         = bcir.IsVirtualBaseClass != 0;
             IsIndirectVirtualBaseClass = bcir.IsIndirectVirtualBaseClass != 0;
         } // end constructor
+
+        internal RawBaseClassInfo( BinaryReader reader )
+        {
+            BaseClassTypeName          = TypeLayoutDiskCache.ReadString( reader );
+            BaseClassTypeId            = reader.ReadUInt32();
+            BaseClassSize              = reader.ReadUInt64();
+            Offset                     = reader.ReadUInt32();
+            UdtKind                    = (UdtKind) reader.ReadUInt32();
+            ChildrenCount              = reader.ReadUInt32();
+            IsNested                   = reader.ReadBoolean();
+            ClassParentId              = reader.ReadUInt32();
+            VirtualTableShapeId        = reader.ReadUInt32();
+            VirtualBaseDispIndex       = reader.ReadUInt32();
+            VirtualBaseOffset          = reader.ReadUInt32();
+            VirtualBasePointerOffset   = reader.ReadUInt32();
+            IsVirtualBaseClass         = reader.ReadBoolean();
+            IsIndirectVirtualBaseClass = reader.ReadBoolean();
+        } // end constructor
+
+        internal void Serialize( BinaryWriter writer )
+        {
+            TypeLayoutDiskCache.WriteString( writer, BaseClassTypeName );
+            writer.Write( BaseClassTypeId );
+            writer.Write( BaseClassSize );
+            writer.Write( Offset );
+            writer.Write( (uint) UdtKind );
+            writer.Write( ChildrenCount );
+            writer.Write( IsNested );
+            writer.Write( ClassParentId );
+            writer.Write( VirtualTableShapeId );
+            writer.Write( VirtualBaseDispIndex );
+            writer.Write( VirtualBaseOffset );
+            writer.Write( VirtualBasePointerOffset );
+            writer.Write( IsVirtualBaseClass );
+            writer.Write( IsIndirectVirtualBaseClass );
+        } // end Serialize()
     } // end RawBaseClassInfo
 
 
@@ -4516,6 +5258,26 @@ internal RawEnumInfo( uint typeId, DbgHelp.EnumInfoRequest eir )
             BaseTypeTypeId             = eir.BaseTypeId;
             BaseType                   = (BasicType) eir.BaseType;
         } // end constructor
+
+        internal RawEnumInfo( BinaryReader reader )
+        {
+            TypeId                     = reader.ReadUInt32();
+            Name                       = TypeLayoutDiskCache.ReadString( reader );
+            NumEnumerands              = reader.ReadUInt32();
+            Size                       = reader.ReadUInt64();
+            BaseTypeTypeId             = reader.ReadUInt32();
+            BaseType                   = (BasicType) reader.ReadUInt32();
+        } // end constructor
+
+        internal void Serialize( BinaryWriter writer )
+        {
+            writer.Write( TypeId );
+            TypeLayoutDiskCache.WriteString( writer, Name );
+            writer.Write( NumEnumerands );
+            writer.Write( Size );
+            writer.Write( BaseTypeTypeId );
+            writer.Write( (uint) BaseType );
+        } // end Serialize()
     } // end RawEnumInfo
 
 
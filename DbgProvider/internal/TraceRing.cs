@@ -0,0 +1,668 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.CompilerServices;
+using System.Threading;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    A cheap alternative to LogManager.Trace for trace points on hot paths.
+    /// </summary>
+    /// <remarks>
+    ///    LogManager.Trace formats the message, takes the LogManager lock, and writes
+    ///    the ETW event, all on the calling thread. TraceRing.Trace instead stores a
+    ///    format id and the raw arguments in a per-thread ring buffer, without taking
+    ///    any lock or allocating (for primitive, enum and string arguments). Formatting
+    ///    and writing to the log happen later, when the rings are drained: by a timer
+    ///    every c_FlushIntervalMs, by LogManager.Flush, or by Get-DbgShellLog -Recent
+    ///    (which formats what is in the rings without draining them). Use
+    ///    Measure-TraceRing (in the test module) to see what each costs per call.
+    ///
+    ///    For scale, from a stand-in run rather than Measure-TraceRing on Windows
+    ///    (this file compiled as-is for .NET 8 on Linux x64, with tiered JIT off, and
+    ///    LogManager replaced by a copy of its Trace path writing to an EventSource):
+    ///    a Trace with three arguments took about 100ns on the calling thread, versus
+    ///    1.5-2us for LogManager.Trace (which also allocated 600-900 bytes per call,
+    ///    against about 1 byte, process-wide, for Trace). Draining then cost about
+    ///    2.5-3us per record, on the flusher's thread. About 40ns of the 100ns is
+    ///    Stopwatch.GetTimestamp on that machine.
+    ///
+    ///    Usage: register the format string once, and keep the id around:
+    ///
+    ///       private static readonly int sm_fmtCreatingValue =
+    ///           TraceRing.RegisterFormat( "Creating value for symbol: {0} ({1})" );
+    ///       ...
+    ///       TraceRing.Trace( sm_fmtCreatingValue, this.PathString, valOpts );
+    ///
+    ///    Reference-type arguments are kept as they are and formatted on whatever
+    ///    thread drains the ring, so pass strings (or immutable things whose ToString()
+    ///    does not need the debugger), not live objects.
+    ///
+    ///    If a thread traces more than c_RingSize records between drains, the oldest
+    ///    ones are overwritten; the drain writes a line saying how many were lost.
+    ///    Setting the "UseTraceRing" registry value to 0 makes Trace go straight to
+    ///    LogManager.Trace.
+    ///
+    ///    N.B. Because records are written when the rings are drained, they land in
+    ///    the log up to c_FlushIntervalMs after lines that LogManager.Trace wrote
+    ///    directly, even if they happened first. Each line has the time stamp of when
+    ///    it was traced, not when it was written, so sort by that if the order
+    ///    matters. (LogManager.Trace can't just go through the ring: its arguments are
+    ///    arbitrary objects, which might not format the same way later, or on another
+    ///    thread.) The log header and Get-DbgShellLog say so too.
+    /// </remarks>
+    internal static class TraceRing
+    {
+        private const int c_RingSize = 1024; // must be a power of two
+        private const int c_RingMask = c_RingSize - 1;
+        private const int c_FlushIntervalMs = 250;
+
+        // Record.Sequence while the owning thread is in the middle of writing it.
+        private const long c_Writing = -1;
+
+
+        private enum ArgKind : byte
+        {
+            None = 0,
+            Boolean,
+            Char,
+            SByte,
+            Byte,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Int64,
+            UInt64,
+            Double,
+            Enum,   // Raw is the value; Ref is the enum Type.
+            Object, // Ref is the argument (boxed, if it was a value type).
+        } // end enum ArgKind
+
+
+        private struct Arg
+        {
+            public ulong Raw;
+            public object Ref;
+            public ArgKind Kind;
+        } // end struct Arg
+
+
+        private struct Record
+        {
+            // Zero if never written, c_Writing while being written, else the record's
+            // position in the ring's sequence, plus one.
+            public long Sequence;
+            public long Timestamp; // Stopwatch ticks
+            public int FormatId;
+            public int ArgCount;
+            public Arg Arg0;
+            public Arg Arg1;
+            public Arg Arg2;
+            public Arg Arg3;
+        } // end struct Record
+
+
+        private sealed class Ring
+        {
+            public readonly Record[] Records = new Record[ c_RingSize ];
+            public readonly Thread Owner;
+            public readonly int ManagedThreadId;
+
+            // Only written by the owning thread.
+            public long Head;
+
+            // Only used under sm_drainLock.
+            public long ReadPos;
+
+            public Ring( Thread owner )
+            {
+                Owner = owner;
+                ManagedThreadId = owner.ManagedThreadId;
+            }
+        } // end class Ring
+
+
+        private struct Entry
+        {
+            public long Timestamp;
+            public int Order;
+            public int ManagedThreadId;
+            public Record Record;
+        } // end struct Entry
+
+
+        private static class ArgTraits< T >
+        {
+            public static readonly bool IsEnum = typeof( T ).IsEnum;
+        } // end class ArgTraits< T >
+
+
+        [ThreadStatic]
+        private static Ring sm_ring;
+
+        private static readonly List< Ring > sm_rings = new List< Ring >();
+        private static readonly List< string > sm_formats = new List< string >();
+        private static readonly object sm_drainLock = new object();
+        private static Timer sm_flushTimer;
+        private static bool sm_stoppedFlushing;
+        private static long sm_totalDropped;
+
+        private static readonly bool sm_enabled = 0 != RegistryUtils.GetRegValue( "UseTraceRing", 1 );
+
+        // For converting Stopwatch timestamps to DateTimes.
+        private static readonly long sm_baseUtcTicks = DateTime.UtcNow.Ticks;
+        private static readonly long sm_baseTimestamp = Stopwatch.GetTimestamp();
+        private static readonly double sm_ticksPerTimestamp = (double) TimeSpan.TicksPerSecond / Stopwatch.Frequency;
+
+
+        /// <summary>
+        ///    False if the "UseTraceRing" registry value turned the ring off, in which
+        ///    case Trace goes straight to LogManager.Trace.
+        /// </summary>
+        public static bool IsEnabled { get { return sm_enabled; } }
+
+        /// <summary>
+        ///    How long a record can sit in a ring before the flush timer writes it to
+        ///    the log.
+        /// </summary>
+        public static int FlushIntervalMs { get { return c_FlushIntervalMs; } }
+
+
+        /// <summary>
+        ///    The total number of records that were overwritten before they could be
+        ///    written to the log.
+        /// </summary>
+        public static long DroppedCount { get { return Interlocked.Read( ref sm_totalDropped ); } }
+
+
+        /// <summary>
+        ///    Registers a format string (as for Util.Sprintf), returning the id to pass
+        ///    to Trace. Call once per trace point, not per trace.
+        /// </summary>
+        public static int RegisterFormat( string format )
+        {
+            if( null == format )
+                throw new ArgumentNullException( "format" );
+
+            lock( sm_formats )
+            {
+                sm_formats.Add( format );
+                return sm_formats.Count - 1;
+            }
+        } // end RegisterFormat()
+
+
+        private static string _GetFormat( int formatId )
+        {
+            lock( sm_formats )
+            {
+                if( (formatId < 0) || (formatId >= sm_formats.Count) )
+                    return Util.Sprintf( "(unknown trace format id {0})", formatId );
+
+                return sm_formats[ formatId ];
+            }
+        } // end _GetFormat()
+
+
+        public static void Trace( int formatId )
+        {
+            if( !sm_enabled )
+            {
+                LogManager.Trace( _GetFormat( formatId ), new object[ 0 ] );
+                return;
+            }
+
+            Ring ring = sm_ring ?? _CreateRing();
+            long seq = ring.Head;
+            ref Record r = ref _BeginRecord( ring, seq, formatId, 0 );
+            _EndRecord( ring, ref r, seq );
+        } // end Trace()
+
+
+        public static void Trace< T0 >( int formatId, T0 a0 )
+        {
+            if( !sm_enabled )
+            {
+                LogManager.Trace( _GetFormat( formatId ), a0 );
+                return;
+            }
+
+            Ring ring = sm_ring ?? _CreateRing();
+            long seq = ring.Head;
+            ref Record r = ref _BeginRecord( ring, seq, formatId, 1 );
+            _Store( ref r.Arg0, a0 );
+            _EndRecord( ring, ref r, seq );
+        } // end Trace()
+
+
+        public static void Trace< T0, T1 >( int formatId, T0 a0, T1 a1 )
+        {
+            if( !sm_enabled )
+            {
+                LogManager.Trace( _GetFormat( formatId ), a0, a1 );
+                return;
+            }
+
+            Ring ring = sm_ring ?? _CreateRing();
+            long seq = ring.Head;
+            ref Record r = ref _BeginRecord( ring, seq, formatId, 2 );
+            _Store( ref r.Arg0, a0 );
+            _Store( ref r.Arg1, a1 );
+            _EndRecord( ring, ref r, seq );
+        } // end Trace()
+
+
+        public static void Trace< T0, T1, T2 >( int formatId, T0 a0, T1 a1, T2 a2 )
+        {
+            if( !sm_enabled )
+            {
+                LogManager.Trace( _GetFormat( formatId ), a0, a1, a2 );
+                return;
+            }
+
+            Ring ring = sm_ring ?? _CreateRing();
+            long seq = ring.Head;
+            ref Record r = ref _BeginRecord( ring, seq, formatId, 3 );
+            _Store( ref r.Arg0, a0 );
+            _Store( ref r.Arg1, a1 );
+            _Store( ref r.Arg2, a2 );
+            _EndRecord( ring, ref r, seq );
+        } // end Trace()
+
+
+        public static void Trace< T0, T1, T2, T3 >( int formatId, T0 a0, T1 a1, T2 a2, T3 a3 )
+        {
+            if( !sm_enabled )
+            {
+                LogManager.Trace( _GetFormat( formatId ), a0, a1, a2, a3 );
+                return;
+            }
+
+            Ring ring = sm_ring ?? _CreateRing();
+            long seq = ring.Head;
+            ref Record r = ref _BeginRecord( ring, seq, formatId, 4 );
+            _Store( ref r.Arg0, a0 );
+            _Store( ref r.Arg1, a1 );
+            _Store( ref r.Arg2, a2 );
+            _Store( ref r.Arg3, a3 );
+            _EndRecord( ring, ref r, seq );
+        } // end Trace()
+
+
+        private static Ring _CreateRing()
+        {
+            var ring = new Ring( Thread.CurrentThread );
+            lock( sm_rings )
+            {
+                sm_rings.Add( ring );
+                if( (null == sm_flushTimer) && !sm_stoppedFlushing )
+                    sm_flushTimer = new Timer( _OnFlushTimer, null, c_FlushIntervalMs, c_FlushIntervalMs );
+            }
+            sm_ring = ring;
+            return ring;
+        } // end _CreateRing()
+
+
+        [MethodImpl( MethodImplOptions.AggressiveInlining )]
+        private static ref Record _BeginRecord( Ring ring, long seq, int formatId, int argCount )
+        {
+            ref Record r = ref ring.Records[ (int) (seq & c_RingMask) ];
+
+            // A drain could be copying this slot right now (if we have lapped it). Mark
+            // it before touching anything else, so that the drain can tell its copy is
+            // no good. (The interlocked operation keeps the stores below from being
+            // seen before this one.)
+            Interlocked.Exchange( ref r.Sequence, c_Writing );
+
+            r.Timestamp = Stopwatch.GetTimestamp();
+            r.FormatId = formatId;
+            r.ArgCount = argCount;
+            return ref r;
+        } // end _BeginRecord()
+
+
+        [MethodImpl( MethodImplOptions.AggressiveInlining )]
+        private static void _EndRecord( Ring ring, ref Record r, long seq )
+        {
+            Volatile.Write( ref r.Sequence, seq + 1 );
+            Volatile.Write( ref ring.Head, seq + 1 );
+        } // end _EndRecord()
+
+
+        // The typeof( T ) checks are evaluated when T's instantiation is JITted, so each
+        // instantiation of this is just the one case that applies.
+        [MethodImpl( MethodImplOptions.AggressiveInlining )]
+        private static void _Store< T >( ref Arg arg, T value )
+        {
+            arg.Ref = null;
+            if( typeof( T ) == typeof( int ) )
+            {
+                arg.Kind = ArgKind.Int32;
+                arg.Raw = (ulong) Unsafe.As< T, int >( ref value );
+            }
+            else if( typeof( T ) == typeof( uint ) )
+            {
+                arg.Kind = ArgKind.UInt32;
+                arg.Raw = Unsafe.As< T, uint >( ref value );
+            }
+            else if( typeof( T ) == typeof( long ) )
+            {
+                arg.Kind = ArgKind.Int64;
+                arg.Raw = (ulong) Unsafe.As< T, long >( ref value );
+            }
+            else if( typeof( T ) == typeof( ulong ) )
+            {
+                arg.Kind = ArgKind.UInt64;
+                arg.Raw = Unsafe.As< T, ulong >( ref value );
+            }
+            else if( typeof( T ) == typeof( bool ) )
+            {
+                arg.Kind = ArgKind.Boolean;
+                arg.Raw = Unsafe.As< T, bool >( ref value ) ? 1UL : 0UL;
+            }
+            else if( typeof( T ) == typeof( char ) )
+            {
+                arg.Kind = ArgKind.Char;
+                arg.Raw = Unsafe.As< T, char >( ref value );
+            }
+            else if( typeof( T ) == typeof( byte ) )
+            {
+                arg.Kind = ArgKind.Byte;
+                arg.Raw = Unsafe.As< T, byte >( ref value );
+            }
+            else if( typeof( T ) == typeof( sbyte ) )
+            {
+                arg.Kind = ArgKind.SByte;
+                arg.Raw = (ulong) Unsafe.As< T, sbyte >( ref value );
+            }
+            else if( typeof( T ) == typeof( short ) )
+            {
+                arg.Kind = ArgKind.Int16;
+                arg.Raw = (ulong) Unsafe.As< T, short >( ref value );
+            }
+            else if( typeof( T ) == typeof( ushort ) )
+            {
+                arg.Kind = ArgKind.UInt16;
+                arg.Raw = Unsafe.As< T, ushort >( ref value );
+            }
+            else if( typeof( T ) == typeof( double ) )
+            {
+                arg.Kind = ArgKind.Double;
+                arg.Raw = (ulong) BitConverter.DoubleToInt64Bits( Unsafe.As< T, double >( ref value ) );
+            }
+            else if( ArgTraits< T >.IsEnum )
+            {
+                arg.Kind = ArgKind.Enum;
+                arg.Ref = typeof( T );
+                switch( Unsafe.SizeOf< T >() )
+                {
+                    case 1:
+                        arg.Raw = Unsafe.As< T, byte >( ref value );
+                        break;
+                    case 2:
+                        arg.Raw = Unsafe.As< T, ushort >( ref value );
+                        break;
+                    case 4:
+                        arg.Raw = Unsafe.As< T, uint >( ref value );
+                        break;
+                    default:
+                        arg.Raw = Unsafe.As< T, ulong >( ref value );
+                        break;
+                }
+            }
+            else
+            {
+                // Strings and other reference types are just a reference; other value
+                // types get boxed.
+                arg.Kind = ArgKind.Object;
+                arg.Raw = 0;
+                arg.Ref = value;
+            }
+        } // end _Store()
+
+
+        private static object _Load( ref Arg arg )
+        {
+            switch( arg.Kind )
+            {
+                case ArgKind.Boolean:
+                    return 0 != arg.Raw;
+                case ArgKind.Char:
+                    return (char) arg.Raw;
+                case ArgKind.SByte:
+                    return (sbyte) arg.Raw;
+                case ArgKind.Byte:
+                    return (byte) arg.Raw;
+                case ArgKind.Int16:
+                    return (short) arg.Raw;
+                case ArgKind.UInt16:
+                    return (ushort) arg.Raw;
+                case ArgKind.Int32:
+                    return (int) arg.Raw;
+                case ArgKind.UInt32:
+                    return (uint) arg.Raw;
+                case ArgKind.Int64:
+                    return (long) arg.Raw;
+                case ArgKind.UInt64:
+                    return arg.Raw;
+                case ArgKind.Double:
+                    return BitConverter.Int64BitsToDouble( (long) arg.Raw );
+                case ArgKind.Enum:
+                    return Enum.ToObject( (Type) arg.Ref, arg.Raw );
+                default:
+                    return arg.Ref;
+            }
+        } // end _Load()
+
+
+        private static string _Format( ref Record r )
+        {
+            var inserts = new object[ r.ArgCount ];
+            if( r.ArgCount > 0 ) inserts[ 0 ] = _Load( ref r.Arg0 );
+            if( r.ArgCount > 1 ) inserts[ 1 ] = _Load( ref r.Arg1 );
+            if( r.ArgCount > 2 ) inserts[ 2 ] = _Load( ref r.Arg2 );
+            if( r.ArgCount > 3 ) inserts[ 3 ] = _Load( ref r.Arg3 );
+
+            string fmt = _GetFormat( r.FormatId );
+            try
+            {
+                return Util.Sprintf( fmt, inserts );
+            }
+            catch( Exception e )
+            {
+                // We're formatting long after the fact, and maybe on another thread; an
+                // argument's ToString() could throw. Don't lose the whole drain over it.
+                return Util.Sprintf( "(could not format trace record \"{0}\": {1})",
+                                     fmt,
+                                     Util.GetExceptionMessages( e ) );
+            }
+        } // end _Format()
+
+
+        private static DateTime _ToDateTime( long timestamp )
+        {
+            long ticks = sm_baseUtcTicks + (long) ((timestamp - sm_baseTimestamp) * sm_ticksPerTimestamp);
+            return new DateTime( ticks, DateTimeKind.Utc ).ToLocalTime();
+        } // end _ToDateTime()
+
+
+        // Copies the record at seq out of the ring. Returns false if it has been (or is
+        // being) overwritten.
+        private static bool _TryRead( Ring ring, long seq, out Record record )
+        {
+            ref Record slot = ref ring.Records[ (int) (seq & c_RingMask) ];
+            if( Volatile.Read( ref slot.Sequence ) != (seq + 1) )
+            {
+                record = default( Record );
+                return false;
+            }
+
+            record = slot;
+            Thread.MemoryBarrier();
+            return Volatile.Read( ref slot.Sequence ) == (seq + 1);
+        } // end _TryRead()
+
+
+        private static Ring[] _GetRings()
+        {
+            lock( sm_rings )
+            {
+                return sm_rings.ToArray();
+            }
+        } // end _GetRings()
+
+
+        // Collects the records in [startSeq, head) of each ring; startSeq is either
+        // where the last drain left off, or as far back as the ring goes.
+        private static List< Entry > _Collect( bool drain, out long dropped )
+        {
+            // N.B. Not using Util.Assert here, since Util.Assert traces (and flushes).
+            Debug.Assert( Monitor.IsEntered( sm_drainLock ) );
+
+            var entries = new List< Entry >();
+            dropped = 0;
+            foreach( Ring ring in _GetRings() )
+            {
+                long head = Volatile.Read( ref ring.Head );
+                long start = Math.Max( 0, head - c_RingSize );
+                if( drain )
+                {
+                    if( ring.ReadPos < start )
+                        dropped += start - ring.ReadPos;
+                    else
+                        start = ring.ReadPos;
+                }
+
+                for( long seq = start; seq < head; seq++ )
+                {
+                    Record record;
+                    if( _TryRead( ring, seq, out record ) )
+                    {
+                        entries.Add( new Entry() { Timestamp = record.Timestamp,
+                                                   Order = entries.Count,
+                                                   ManagedThreadId = ring.ManagedThreadId,
+                                                   Record = record } );
+                    }
+                    else if( drain )
+                    {
+                        dropped++;
+                    }
+                }
+
+                if( drain )
+                {
+                    ring.ReadPos = head;
+                    if( !ring.Owner.IsAlive && (Volatile.Read( ref ring.Head ) == head) )
+                    {
+                        lock( sm_rings )
+                        {
+                            sm_rings.Remove( ring );
+                        }
+                    }
+                }
+            } // end foreach( ring )
+
+            // Records from different threads are interleaved by time. (Sort is not
+            // stable, so the order they were collected in breaks ties.)
+            entries.Sort( (x, y) =>
+                {
+                    int cmp = x.Timestamp.CompareTo( y.Timestamp );
+                    return (0 != cmp) ? cmp : x.Order.CompareTo( y.Order );
+                } );
+            return entries;
+        } // end _Collect()
+
+
+        /// <summary>
+        ///    Formats everything traced since the last drain and writes it to the log.
+        /// </summary>
+        /// <remarks>
+        ///    Records are collected under the drain lock, but formatted and written
+        ///    outside it, so a drain never holds the drain lock while waiting for the
+        ///    LogManager lock (LogManager.Flush drains, and can be called with the
+        ///    LogManager lock held).
+        /// </remarks>
+        public static void Drain()
+        {
+            List< Entry > entries;
+            long dropped;
+            lock( sm_drainLock )
+            {
+                entries = _Collect( true, out dropped );
+            }
+
+            if( 0 != dropped )
+            {
+                Interlocked.Add( ref sm_totalDropped, dropped );
+                LogManager.Trace( "(TraceRing: {0} record(s) were overwritten before they could be logged.)",
+                                  dropped );
+            }
+
+            for( int i = 0; i < entries.Count; i++ )
+            {
+                Entry entry = entries[ i ];
+                LogManager.TraceAt( _ToDateTime( entry.Timestamp ),
+                                    entry.ManagedThreadId,
+                                    _Format( ref entry.Record ) );
+            }
+        } // end Drain()
+
+
+        /// <summary>
+        ///    Formats what is currently in the rings (up to c_RingSize records per
+        ///    thread, whether they have been drained to the log yet or not), as they
+        ///    would appear in the log, oldest first. Does not drain anything.
+        /// </summary>
+        public static IReadOnlyList< string > FormatRecent()
+        {
+            List< Entry > entries;
+            long dropped;
+            lock( sm_drainLock )
+            {
+                entries = _Collect( false, out dropped );
+            }
+
+            var lines = new List< string >( entries.Count );
+            for( int i = 0; i < entries.Count; i++ )
+            {
+                Entry entry = entries[ i ];
+                lines.Add( LogManager.FormatLinePrefix( _ToDateTime( entry.Timestamp ), entry.ManagedThreadId ) +
+                           _Format( ref entry.Record ) );
+            }
+            return lines;
+        } // end FormatRecent()
+
+
+        private static void _OnFlushTimer( object state )
+        {
+            // An exception escaping a timer callback would take down the process.
+            try
+            {
+                Drain();
+            }
+            catch( Exception e )
+            {
+                Debug.Fail( Util.Sprintf( "TraceRing drain failed: {0}", e ) );
+            }
+        } // end _OnFlushTimer()
+
+
+        /// <summary>
+        ///    Stops the flush timer (for LogManager shutdown). Does not drain.
+        /// </summary>
+        public static void StopFlushing()
+        {
+            lock( sm_rings )
+            {
+                sm_stoppedFlushing = true;
+                if( null != sm_flushTimer )
+                {
+                    sm_flushTimer.Dispose();
+                    sm_flushTimer = null;
+                }
+            }
+        } // end StopFlushing()
+    } // end class TraceRing
+}
@@ -0,0 +1,978 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Linq;
+using System.Text;
+using Microsoft.Diagnostics.Runtime.Interop;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    A persistent, per-PDB cache of the raw type information that we get out of
+    ///    dbghelp (SymTags, children, UDT / data member / base class / enum info, and
+    ///    enumerands), so that sessions against a build we have seen before don't have
+    ///    to ask dbghelp again.
+    /// </summary>
+    /// <remarks>
+    ///    There is one file per PDB, named for the PDB's GUID and age. The file format
+    ///    (version 2) is:
+    ///
+    ///       Header (64 bytes):
+    ///          uint   magic ("DSTC")
+    ///          uint   version
+    ///          Guid   PDB GUID
+    ///          uint   PDB age
+    ///          uint   number of records
+    ///          long   offset of the index
+    ///          long   offset of the record data
+    ///          ulong  dbghelp.dll file version
+    ///       Index: one 16-byte entry per record, sorted by (typeId, kind):
+    ///          uint   typeId
+    ///          uint   kind
+    ///          uint   offset of the record (relative to the start of the record data)
+    ///          uint   length of the record
+    ///       Record data.
+    ///
+    ///    Addresses in records (static data members) are stored relative to the module
+    ///    base, since the same PDB can be loaded at a different base next time (ASLR, or
+    ///    another dump). (Version 1 stored them as-is.)
+    ///
+    ///    The files live in the user's profile and are written by whichever DbgShell
+    ///    happened to be exiting, so they are not trusted: when a file is opened, every
+    ///    index entry is checked against the size of the file, and if any is out of
+    ///    bounds (or the index is out of order), the whole file is ignored. A record
+    ///    that can't be decoded is treated as a miss.
+    ///
+    ///    Files are mapped read-only and searched in place; records are decoded
+    ///    straight out of the view. Anything new that we learn during a session is kept
+    ///    in memory, and merged into a new copy of the file by Flush (which happens at
+    ///    process exit).
+    ///
+    ///    Type IDs are dbghelp's, and nothing promises that dbghelp hands out the same
+    ///    IDs for the same PDB from one session to the next (although in practice, it
+    ///    does for a given version of dbghelp). So a file is only used if it was
+    ///    written by the same version of dbghelp, and if its records (or a sample of
+    ///    c_numValidationProbes of each kind, for big files) still agree with what
+    ///    dbghelp says about their IDs: the SymTag, and the name and number of
+    ///    children where the record has them. If not, it is ignored, and rewritten at
+    ///    the next flush.
+    /// </remarks>
+    internal static class TypeLayoutDiskCache
+    {
+        internal enum RecordKind : uint
+        {
+            SymTag     = 1,
+            Children   = 2,
+            Udt        = 3,
+            Data       = 4,
+            BaseClass  = 5,
+            Enum       = 6,
+            Enumerands = 7,
+        }
+
+        private const uint c_magic = 0x43545344; // "DSTC"
+        private const uint c_version = 2;
+        private const int c_headerSize = 64;
+        private const int c_indexEntrySize = 16;
+        private const int c_numValidationProbes = 256; // per RecordKind
+
+
+        /// <summary>
+        ///    What dbghelp says about a type ID right now; used to validate cache files.
+        /// </summary>
+        internal struct TypeIdentity
+        {
+            public SymTag Tag;
+            public string Name;
+            public uint ChildrenCount;
+        } // end struct TypeIdentity
+
+
+        internal sealed class CacheFile : IDisposable
+        {
+            public readonly Guid PdbGuid;
+            public readonly uint PdbAge;
+            public readonly string Path;
+
+            private MemoryMappedFile m_map;
+            private MemoryMappedViewAccessor m_view;
+            private unsafe byte* m_pView;
+            private int m_numRecords;
+            private long m_indexOffset;
+            private long m_dataOffset;
+            private bool m_validated;
+
+            // Things learned this session that aren't in the file yet, keyed by
+            // _MakeKey( typeId, kind ).
+            private readonly Dictionary< ulong, byte[] > m_pending = new Dictionary< ulong, byte[] >();
+
+            public bool IsDirty { get { return m_pending.Count > 0; } }
+
+            /// <summary>
+            ///    The number of records in the file (not counting pending ones); zero if
+            ///    there is no file, or it was rejected.
+            /// </summary>
+            public int RecordCount { get { return m_numRecords; } }
+
+
+            public CacheFile( Guid pdbGuid, uint pdbAge, string path )
+            {
+                PdbGuid = pdbGuid;
+                PdbAge = pdbAge;
+                Path = path;
+                _Open();
+            } // end constructor
+
+
+            private static ulong _MakeKey( uint typeId, RecordKind kind )
+            {
+                return (((ulong) typeId) << 32) | (uint) kind;
+            }
+
+
+            private unsafe void _Open()
+            {
+                if( !File.Exists( Path ) )
+                    return;
+
+                try
+                {
+                    m_map = MemoryMappedFile.CreateFromFile( new FileStream( Path,
+                                                                             FileMode.Open,
+                                                                             FileAccess.Read,
+                                                                             FileShare.Read | FileShare.Delete ),
+                                                             null,
+                                                             0,
+                                                             MemoryMappedFileAccess.Read,
+                                                             HandleInheritability.None,
+                                                             leaveOpen: false );
+                    m_view = m_map.CreateViewAccessor( 0, 0, MemoryMappedFileAccess.Read );
+                    byte* p = null;
+                    m_view.SafeMemoryMappedViewHandle.AcquirePointer( ref p );
+                    m_pView = p + m_view.PointerOffset;
+
+                    long length = (long) m_view.SafeMemoryMappedViewHandle.ByteLength - m_view.PointerOffset;
+                    if( !_HeaderLooksGood( length ) || !_IndexLooksGood( length ) )
+                    {
+                        LogManager.Trace( "TypeLayoutDiskCache: ignoring stale or corrupt cache file {0}.", Path );
+                        _Close();
+                    }
+                }
+                catch( Exception e ) when( (e is IOException) || (e is UnauthorizedAccessException) )
+                {
+                    LogManager.Trace( "TypeLayoutDiskCache: could not open {0}: {1}", Path, e );
+                    _Close();
+                }
+            } // end _Open()
+
+
+            private unsafe bool _HeaderLooksGood( long length )
+            {
+                if( length < c_headerSize )
+                    return false;
+
+                if( (c_magic != *(uint*) m_pView) ||
+                    (c_version != *(uint*) (m_pView + 4)) ||
+                    (PdbGuid != *(Guid*) (m_pView + 8)) ||
+                    (PdbAge != *(uint*) (m_pView + 24)) ||
+                    (sm_dbgHelpVersion != *(ulong*) (m_pView + 48)) )
+                {
+                    return false;
+                }
+
+                m_numRecords = *(int*) (m_pView + 28);
+                m_indexOffset = *(long*) (m_pView + 32);
+                m_dataOffset = *(long*) (m_pView + 40);
+
+                // (In this order, so that nothing can overflow.)
+                return (m_numRecords >= 0) &&
+                       (m_indexOffset >= c_headerSize) &&
+                       (m_indexOffset <= m_dataOffset) &&
+                       (m_dataOffset <= length) &&
+                       (m_numRecords <= ((m_dataOffset - m_indexOffset) / c_indexEntrySize));
+            } // end _HeaderLooksGood()
+
+
+            // Checks that every record is inside the file, and that the index is sorted
+            // (_FindRecord depends on it). Must be called after _HeaderLooksGood.
+            private unsafe bool _IndexLooksGood( long length )
+            {
+                long cbData = length - m_dataOffset;
+                ulong prevKey = 0;
+                for( int i = 0; i < m_numRecords; i++ )
+                {
+                    byte* pEntry = m_pView + m_indexOffset + ((long) i * c_indexEntrySize);
+                    uint typeId = *(uint*) pEntry;
+                    RecordKind kind = (RecordKind) (*(uint*) (pEntry + 4));
+                    uint offset = *(uint*) (pEntry + 8);
+                    uint recLength = *(uint*) (pEntry + 12);
+
+                    if( ((long) offset + (long) recLength) > cbData )
+                    {
+                        LogManager.Trace( "TypeLayoutDiskCache: record {0} of {1} is out of bounds ({2} + {3} > {4}).",
+                                          i,
+                                          Path,
+                                          offset,
+                                          recLength,
+                                          cbData );
+                        return false;
+                    }
+
+                    ulong key = _MakeKey( typeId, kind );
+                    if( (i > 0) && (key <= prevKey) )
+                    {
+                        LogManager.Trace( "TypeLayoutDiskCache: index of {0} is out of order at record {1}.", Path, i );
+                        return false;
+                    }
+                    prevKey = key;
+                }
+                return true;
+            } // end _IndexLooksGood()
+
+
+            private unsafe void _Close()
+            {
+                if( null != m_view )
+                {
+                    if( null != m_pView )
+                        m_view.SafeMemoryMappedViewHandle.ReleasePointer();
+
+                    m_view.Dispose();
+                    m_view = null;
+                }
+
+                m_pView = null;
+
+                if( null != m_map )
+                {
+                    m_map.Dispose();
+                    m_map = null;
+                }
+
+                m_numRecords = 0;
+            } // end _Close()
+
+
+            /// <summary>
+            ///    Checks (once) that a sample of each kind of record in the file still
+            ///    matches what dbghelp says about its type ID.
+            /// </summary>
+            public void EnsureValidated( Func< uint, TypeIdentity > getIdentity )
+            {
+                if( m_validated )
+                    return;
+
+                m_validated = true;
+
+                if( 0 == m_numRecords )
+                    return;
+
+                var idxsByKind = new Dictionary< RecordKind, List< int > >();
+                for( int i = 0; i < m_numRecords; i++ )
+                {
+                    uint typeId;
+                    RecordKind kind;
+                    _ReadIndexKey( i, out typeId, out kind );
+
+                    List< int > idxs;
+                    if( !idxsByKind.TryGetValue( kind, out idxs ) )
+                    {
+                        idxs = new List< int >();
+                        idxsByKind.Add( kind, idxs );
+                    }
+                    idxs.Add( i );
+                }
+
+                foreach( var idxs in idxsByKind.Values )
+                {
+                    int step = Math.Max( 1, idxs.Count / c_numValidationProbes );
+                    for( int i = 0; i < idxs.Count; i += step )
+                    {
+                        if( !_RecordStillMatches( idxs[ i ], getIdentity ) )
+                        {
+                            _Close();
+                            return;
+                        }
+                    }
+                }
+            } // end EnsureValidated()
+
+
+            private bool _RecordStillMatches( int idx, Func< uint, TypeIdentity > getIdentity )
+            {
+                uint typeId;
+                RecordKind kind;
+                _ReadIndexKey( idx, out typeId, out kind );
+
+                TypeIdentity expected = new TypeIdentity();
+                bool hasName = false;
+                bool hasChildrenCount = false;
+                try
+                {
+                    using( var reader = _GetRecordReader( idx ) )
+                    {
+                        switch( kind )
+                        {
+                            case RecordKind.SymTag:
+                                expected.Tag = (SymTag) reader.ReadUInt32();
+                                break;
+
+                            case RecordKind.Children:
+                                // Any sort of symbol can have children. The record is a
+                                // TI_FINDCHILDREN_PARAMS: count, start, then the IDs.
+                                expected.Tag = SymTag.Null;
+                                expected.ChildrenCount = (uint) Math.Max( 0, ReadCount( reader, sizeof( uint ) ) - 2 );
+                                hasChildrenCount = true;
+                                break;
+
+                            case RecordKind.Udt:
+                                var rui = new RawUdtInfo( reader );
+                                expected.Tag = SymTag.UDT;
+                                expected.Name = rui.SymName;
+                                expected.ChildrenCount = rui.ChildrenCount;
+                                hasName = hasChildrenCount = true;
+                                break;
+
+                            case RecordKind.Data:
+                                expected.Tag = SymTag.Data;
+                                expected.Name = new RawDataInfo( reader, 0 ).SymName;
+                                hasName = true;
+                                break;
+
+                            case RecordKind.BaseClass:
+                                var rbci = new RawBaseClassInfo( reader );
+                                expected.Tag = SymTag.BaseClass;
+                                expected.Name = rbci.BaseClassTypeName;
+                                expected.ChildrenCount = rbci.ChildrenCount;
+                                hasName = hasChildrenCount = true;
+                                break;
+
+                            case RecordKind.Enum:
+                                var rei = new RawEnumInfo( reader );
+                                expected.Tag = SymTag.Enum;
+                                expected.Name = rei.Name;
+                                expected.ChildrenCount = rei.NumEnumerands;
+                                hasName = hasChildrenCount = true;
+                                break;
+
+                            case RecordKind.Enumerands:
+                                expected.Tag = SymTag.Enum;
+                                expected.ChildrenCount = (uint) ReadCount( reader, c_minEnumerandSize );
+                                hasChildrenCount = true;
+                                break;
+
+                            default:
+                                throw new InvalidDataException( Util.Sprintf( "Unknown record kind: {0}", kind ) );
+                        }
+                    }
+                }
+                catch( Exception e ) when( IsBadRecordException( e ) )
+                {
+                    LogManager.Trace( "TypeLayoutDiskCache: could not decode {0} record for type {1} in {2}: {3}",
+                                      kind,
+                                      typeId,
+                                      Path,
+                                      e );
+                    return false;
+                }
+
+                TypeIdentity actual = new TypeIdentity();
+                try
+                {
+                    actual = getIdentity( typeId );
+                }
+                catch( DbgEngException dee )
+                {
+                    LogManager.Trace( "TypeLayoutDiskCache: validation probe for type {0} failed: {1}", typeId, dee );
+                }
+
+                if( ((SymTag.Null != expected.Tag) && (expected.Tag != actual.Tag)) ||
+                    (hasName && !String.Equals( expected.Name, actual.Name, StringComparison.Ordinal )) ||
+                    (hasChildrenCount && (expected.ChildrenCount != actual.ChildrenCount)) )
+                {
+                    LogManager.Trace( "TypeLayoutDiskCache: type ids in {0} don't match this session ({1} record for id {2}: expected {3} {4} ({5} children), got {6} {7} ({8} children)); ignoring it.",
+                                      Path,
+                                      kind,
+                                      typeId,
+                                      expected.Tag,
+                                      expected.Name,
+                                      expected.ChildrenCount,
+                                      actual.Tag,
+                                      actual.Name,
+                                      actual.ChildrenCount );
+                    return false;
+                }
+                return true;
+            } // end _RecordStillMatches()
+
+
+            private unsafe void _ReadIndexKey( int idx, out uint typeId, out RecordKind kind )
+            {
+                byte* pEntry = m_pView + m_indexOffset + ((long) idx * c_indexEntrySize);
+                typeId = *(uint*) pEntry;
+                kind = (RecordKind) (*(uint*) (pEntry + 4));
+            }
+
+
+            private unsafe BinaryReader _GetRecordReader( int idx )
+            {
+                byte* pEntry = m_pView + m_indexOffset + ((long) idx * c_indexEntrySize);
+                uint offset = *(uint*) (pEntry + 8);
+                uint length = *(uint*) (pEntry + 12);
+                return new BinaryReader( new UnmanagedMemoryStream( m_pView + m_dataOffset + offset, length ),
+                                         Encoding.Unicode );
+            }
+
+
+            private int _FindRecord( uint typeId, RecordKind kind )
+            {
+                ulong key = _MakeKey( typeId, kind );
+                int lo = 0;
+                int hi = m_numRecords - 1;
+                while( lo <= hi )
+                {
+                    int mid = lo + ((hi - lo) / 2);
+                    uint midTypeId;
+                    RecordKind midKind;
+                    _ReadIndexKey( mid, out midTypeId, out midKind );
+                    ulong midKey = _MakeKey( midTypeId, midKind );
+
+                    if( midKey == key )
+                        return mid;
+                    else if( midKey < key )
+                        lo = mid + 1;
+                    else
+                        hi = mid - 1;
+                }
+                return -1;
+            } // end _FindRecord()
+
+
+            public BinaryReader TryGetRecord( uint typeId, RecordKind kind )
+            {
+                byte[] pending;
+                if( m_pending.TryGetValue( _MakeKey( typeId, kind ), out pending ) )
+                    return new BinaryReader( new MemoryStream( pending, false ), Encoding.Unicode );
+
+                int idx = _FindRecord( typeId, kind );
+                if( idx < 0 )
+                    return null;
+
+                return _GetRecordReader( idx );
+            } // end TryGetRecord()
+
+
+            public void AddRecord( uint typeId, RecordKind kind, byte[] data )
+            {
+                if( _FindRecord( typeId, kind ) >= 0 )
+                    return;
+
+                m_pending[ _MakeKey( typeId, kind ) ] = data;
+            } // end AddRecord()
+
+
+            /// <summary>
+            ///    Writes the existing records plus the pending ones to a new file, and
+            ///    swaps it in.
+            /// </summary>
+            public unsafe void Save()
+            {
+                if( !IsDirty )
+                    return;
+
+                var records = new SortedDictionary< ulong, byte[] >( m_pending );
+                for( int i = 0; i < m_numRecords; i++ )
+                {
+                    uint typeId;
+                    RecordKind kind;
+                    _ReadIndexKey( i, out typeId, out kind );
+
+                    byte* pEntry = m_pView + m_indexOffset + ((long) i * c_indexEntrySize);
+                    uint offset = *(uint*) (pEntry + 8);
+                    uint length = *(uint*) (pEntry + 12);
+                    byte[] data = new byte[ length ];
+                    System.Runtime.InteropServices.Marshal.Copy( (IntPtr) (m_pView + m_dataOffset + offset), data, 0, (int) length );
+                    records[ _MakeKey( typeId, kind ) ] = data;
+                }
+
+                bool wasOpen = null != m_map;
+                bool saved = false;
+                string tmpPath = Util.Sprintf( "{0}.{1}.tmp", Path, Process.GetCurrentProcess().Id );
+                try
+                {
+                    Directory.CreateDirectory( System.IO.Path.GetDirectoryName( Path ) );
+
+                    using( var fs = new FileStream( tmpPath, FileMode.Create, FileAccess.Write, FileShare.None ) )
+                    using( var writer = new BinaryWriter( fs ) )
+                    {
+                        long indexOffset = c_headerSize;
+                        long dataOffset = indexOffset + ((long) records.Count * c_indexEntrySize);
+
+                        writer.Write( c_magic );
+                        writer.Write( c_version );
+                        writer.Write( PdbGuid.ToByteArray() );
+                        writer.Write( PdbAge );
+                        writer.Write( records.Count );
+                        writer.Write( indexOffset );
+                        writer.Write( dataOffset );
+                        writer.Write( sm_dbgHelpVersion );
+                        writer.Write( new byte[ c_headerSize - 56 ] );
+
+                        uint recOffset = 0;
+                        foreach( var kvp in records )
+                        {
+                            writer.Write( (uint) (kvp.Key >> 32) );
+                            writer.Write( (uint) kvp.Key );
+                            writer.Write( recOffset );
+                            writer.Write( (uint) kvp.Value.Length );
+                            recOffset += (uint) kvp.Value.Length;
+                        }
+
+                        foreach( var data in records.Values )
+                        {
+                            writer.Write( data );
+                        }
+                    }
+
+                    // Swap the new file in whole, so that another DbgShell never sees a
+                    // partly written one.
+                    _Close();
+                    if( File.Exists( Path ) )
+                        File.Replace( tmpPath, Path, null );
+                    else
+                        File.Move( tmpPath, Path );
+                    m_pending.Clear();
+                    saved = true;
+                }
+                catch( Exception e ) when( (e is IOException) || (e is UnauthorizedAccessException) )
+                {
+                    // Maybe another DbgShell has the file open. We'll try again next time.
+                    LogManager.Trace( "TypeLayoutDiskCache: could not save {0}: {1}", Path, e );
+                }
+                finally
+                {
+                    try
+                    {
+                        File.Delete( tmpPath );
+                    }
+                    catch( Exception e ) when( (e is IOException) || (e is UnauthorizedAccessException) )
+                    {
+                        LogManager.Trace( "TypeLayoutDiskCache: could not delete {0}: {1}", tmpPath, e );
+                    }
+                }
+
+                if( saved || wasOpen )
+                {
+                    _Open();
+
+                    // If we wrote it, we know the IDs are good.
+                    if( saved )
+                        m_validated = true;
+                }
+            } // end Save()
+
+
+            public void Dispose()
+            {
+                _Close();
+            }
+        } // end class CacheFile
+
+
+        private static readonly object sm_syncRoot = new object();
+
+        // What file (if any) to use for each module. A null value means "don't cache
+        // this module" (no PDB, or no type info).
+        private static readonly Dictionary< (IntPtr, ulong), CacheFile > sm_modules
+            = new Dictionary< (IntPtr, ulong), CacheFile >();
+
+        private static readonly Dictionary< (Guid, uint), CacheFile > sm_files
+            = new Dictionary< (Guid, uint), CacheFile >();
+
+        private static readonly ulong sm_dbgHelpVersion = _GetDbgHelpVersion();
+
+        private static int sm_hits;
+        private static int sm_misses;
+
+        public static int CacheHits { get { return sm_hits; } }
+        public static int CacheMisses { get { return sm_misses; } }
+
+
+        static TypeLayoutDiskCache()
+        {
+            AppDomain.CurrentDomain.ProcessExit += ( s, e ) => Flush();
+        }
+
+
+        private static string sm_cacheDirectory = Path.Combine( Environment.GetFolderPath( Environment.SpecialFolder.LocalApplicationData,
+                                                                                           Environment.SpecialFolderOption.DoNotVerify ),
+                                                                "DbgShell",
+                                                                "TypeCache" );
+
+        /// <summary>
+        ///    Where the cache files go. Changing it flushes and closes the current files.
+        /// </summary>
+        public static string CacheDirectory
+        {
+            get { return sm_cacheDirectory; }
+            set
+            {
+                lock( sm_syncRoot )
+                {
+                    Reset();
+                    sm_cacheDirectory = value;
+                }
+            }
+        } // end property CacheDirectory
+
+
+        public static bool Enabled
+        {
+            get
+            {
+                return !String.IsNullOrEmpty( sm_cacheDirectory ) &&
+                       String.IsNullOrEmpty( Environment.GetEnvironmentVariable( "__DisableDiskTypeCache" ) );
+            }
+        }
+
+
+        public static void ResetStatistics()
+        {
+            lock( sm_syncRoot )
+            {
+                sm_hits = 0;
+                sm_misses = 0;
+            }
+        } // end ResetStatistics()
+
+
+        private static ulong _GetDbgHelpVersion()
+        {
+            try
+            {
+                foreach( ProcessModule mod in Process.GetCurrentProcess().Modules )
+                {
+                    if( 0 == Util.Strcmp_OI( mod.ModuleName, "dbghelp.dll" ) )
+                    {
+                        var fvi = mod.FileVersionInfo;
+                        return (((ulong) fvi.FileMajorPart) << 48) |
+                               (((ulong) fvi.FileMinorPart) << 32) |
+                               (((ulong) fvi.FileBuildPart) << 16) |
+                               ((ulong) fvi.FilePrivatePart);
+                    }
+                }
+            }
+            catch( Exception e ) when( (e is InvalidOperationException) || (e is System.ComponentModel.Win32Exception) )
+            {
+                LogManager.Trace( "TypeLayoutDiskCache: could not get dbghelp version: {0}", e );
+            }
+            return 0;
+        } // end _GetDbgHelpVersion()
+
+
+        // Must be called with sm_syncRoot held.
+        private static CacheFile _GetCacheFile( IntPtr hProcess, ulong modBase )
+        {
+            CacheFile file;
+            if( sm_modules.TryGetValue( (hProcess, modBase), out file ) )
+                return file;
+
+            Guid pdbGuid;
+            uint pdbAge;
+            if( Enabled && DbgHelp.TryGetPdbIdentity( hProcess, modBase, out pdbGuid, out pdbAge ) )
+            {
+                if( !sm_files.TryGetValue( (pdbGuid, pdbAge), out file ) )
+                {
+                    string path = Path.Combine( sm_cacheDirectory,
+                                                Util.Sprintf( "{0:N}-{1:x}.dstc", pdbGuid, pdbAge ) );
+                    file = new CacheFile( pdbGuid, pdbAge, path );
+                    sm_files.Add( (pdbGuid, pdbAge), file );
+                }
+
+                file.EnsureValidated( ( typeId ) => DbgHelp.GetTypeIdentityForValidation( hProcess, modBase, typeId ) );
+            }
+
+            sm_modules.Add( (hProcess, modBase), file );
+            return file;
+        } // end _GetCacheFile()
+
+
+        /// <summary>
+        ///    True for the exceptions that decoding a bad record can throw. (The index
+        ///    is checked when a file is opened, so a record can't take us outside the
+        ///    file, but its contents can still be garbage.)
+        /// </summary>
+        internal static bool IsBadRecordException( Exception e )
+        {
+            return (e is EndOfStreamException) ||
+                   (e is InvalidDataException) ||
+                   (e is FormatException) ||
+                   (e is ArgumentException) ||
+                   (e is OverflowException);
+        } // end IsBadRecordException()
+
+
+        // TryGet and Add must be called on the dbgeng thread (they may need to ask
+        // dbghelp about the module).
+
+        public static bool TryGet< T >( IntPtr hProcess,
+                                        ulong modBase,
+                                        uint typeId,
+                                        RecordKind kind,
+                                        Func< BinaryReader, T > read,
+                                        out T value )
+        {
+            value = default( T );
+            if( !Enabled )
+                return false;
+
+            lock( sm_syncRoot )
+            {
+                CacheFile file = _GetCacheFile( hProcess, modBase );
+                if( null == file )
+                    return false;
+
+                using( BinaryReader reader = file.TryGetRecord( typeId, kind ) )
+                {
+                    if( null == reader )
+                    {
+                        sm_misses++;
+                        return false;
+                    }
+
+                    try
+                    {
+                        value = read( reader );
+                    }
+                    catch( Exception e ) when( IsBadRecordException( e ) )
+                    {
+                        LogManager.Trace( "TypeLayoutDiskCache: bad {0} record for type {1} in {2}: {3}",
+                                          kind,
+                                          typeId,
+                                          file.Path,
+                                          e );
+                        value = default( T );
+                        sm_misses++;
+                        return false;
+                    }
+                    sm_hits++;
+                    return true;
+                }
+            }
+        } // end TryGet()
+
+
+        public static void Add( IntPtr hProcess,
+                                ulong modBase,
+                                uint typeId,
+                                RecordKind kind,
+                                Action< BinaryWriter > write )
+        {
+            if( !Enabled )
+                return;
+
+            lock( sm_syncRoot )
+            {
+                CacheFile file = _GetCacheFile( hProcess, modBase );
+                if( null == file )
+                    return;
+
+                using( var ms = new MemoryStream() )
+                {
+                    using( var writer = new BinaryWriter( ms, Encoding.Unicode, leaveOpen: true ) )
+                    {
+                        write( writer );
+                    }
+                    file.AddRecord( typeId, kind, ms.ToArray() );
+                }
+            }
+        } // end Add()
+
+
+        //
+        // Serialization helpers for the Raw*Info classes.
+        //
+
+        internal static void WriteString( BinaryWriter writer, string s )
+        {
+            writer.Write( null != s );
+            if( null != s )
+                writer.Write( s );
+        }
+
+        internal static string ReadString( BinaryReader reader )
+        {
+            return reader.ReadBoolean() ? reader.ReadString() : null;
+        }
+
+        // An enumerand is at least a one-byte string length plus a ulong.
+        internal const int c_minEnumerandSize = 1 + sizeof( ulong );
+
+        /// <summary>
+        ///    Reads the element count of an array, and checks that the rest of the
+        ///    record is big enough to hold that many elements of at least
+        ///    minElementSize bytes each, so that a corrupt count can't make us
+        ///    allocate a huge array.
+        /// </summary>
+        internal static int ReadCount( BinaryReader reader, int minElementSize )
+        {
+            int count = reader.ReadInt32();
+            long cbLeft = reader.BaseStream.Length - reader.BaseStream.Position;
+            if( (count < 0) || (count > (cbLeft / minElementSize)) )
+            {
+                throw new InvalidDataException( Util.Sprintf( "Bad element count in type cache record: {0} (only {1} bytes left).",
+                                                              count,
+                                                              cbLeft ) );
+            }
+            return count;
+        } // end ReadCount()
+
+
+        internal static bool CanWritePrimitive( object value )
+        {
+            if( null == value )
+                return true;
+
+            switch( Type.GetTypeCode( value.GetType() ) )
+            {
+                case TypeCode.Boolean:
+                case TypeCode.Char:
+                case TypeCode.SByte:
+                case TypeCode.Byte:
+                case TypeCode.Int16:
+                case TypeCode.UInt16:
+                case TypeCode.Int32:
+                case TypeCode.UInt32:
+                case TypeCode.Int64:
+                case TypeCode.UInt64:
+                case TypeCode.Single:
+                case TypeCode.Double:
+                case TypeCode.String:
+                    return true;
+                default:
+                    return false;
+            }
+        } // end CanWritePrimitive()
+
+
+        internal static void WritePrimitive( BinaryWriter writer, object value )
+        {
+            if( null == value )
+            {
+                writer.Write( (byte) TypeCode.Empty );
+                return;
+            }
+
+            TypeCode tc = Type.GetTypeCode( value.GetType() );
+            writer.Write( (byte) tc );
+            switch( tc )
+            {
+                case TypeCode.Boolean: writer.Write( (bool) value ); break;
+                case TypeCode.Char:    writer.Write( (char) value ); break;
+                case TypeCode.SByte:   writer.Write( (sbyte) value ); break;
+                case TypeCode.Byte:    writer.Write( (byte) value ); break;
+                case TypeCode.Int16:   writer.Write( (short) value ); break;
+                case TypeCode.UInt16:  writer.Write( (ushort) value ); break;
+                case TypeCode.Int32:   writer.Write( (int) value ); break;
+                case TypeCode.UInt32:  writer.Write( (uint) value ); break;
+                case TypeCode.Int64:   writer.Write( (long) value ); break;
+                case TypeCode.UInt64:  writer.Write( (ulong) value ); break;
+                case TypeCode.Single:  writer.Write( (float) value ); break;
+                case TypeCode.Double:  writer.Write( (double) value ); break;
+                case TypeCode.String:  writer.Write( (string) value ); break;
+                default:
+                    throw new ArgumentException( Util.Sprintf( "Can't persist a value of type {0}.",
+                                                               value.GetType() ),
+                                                 nameof( value ) );
+            }
+        } // end WritePrimitive()
+
+
+        internal static object ReadPrimitive( BinaryReader reader )
+        {
+            TypeCode tc = (TypeCode) reader.ReadByte();
+            switch( tc )
+            {
+                case TypeCode.Empty:   return null;
+                case TypeCode.Boolean: return reader.ReadBoolean();
+                case TypeCode.Char:    return reader.ReadChar();
+                case TypeCode.SByte:   return reader.ReadSByte();
+                case TypeCode.Byte:    return reader.ReadByte();
+                case TypeCode.Int16:   return reader.ReadInt16();
+                case TypeCode.UInt16:  return reader.ReadUInt16();
+                case TypeCode.Int32:   return reader.ReadInt32();
+                case TypeCode.UInt32:  return reader.ReadUInt32();
+                case TypeCode.Int64:   return reader.ReadInt64();
+                case TypeCode.UInt64:  return reader.ReadUInt64();
+                case TypeCode.Single:  return reader.ReadSingle();
+                case TypeCode.Double:  return reader.ReadDouble();
+                case TypeCode.String:  return reader.ReadString();
+                default:
+                    throw new InvalidDataException( Util.Sprintf( "Unexpected type code in type cache record: {0}", tc ) );
+            }
+        } // end ReadPrimitive()
+
+
+        /// <summary>
+        ///    Called when symbols are (re)loaded or unloaded: the module at modBase (or
+        ///    any module, if 0) might now have a different PDB.
+        /// </summary>
+        /// <remarks>
+        ///    This gets called during an event callback, so we must not call into dbgeng.
+        /// </remarks>
+        public static void ForgetModule( ulong modBase )
+        {
+            lock( sm_syncRoot )
+            {
+                if( 0 == modBase )
+                {
+                    sm_modules.Clear();
+                    return;
+                }
+
+                foreach( var key in sm_modules.Keys.Where( ( k ) => k.Item2 == modBase ).ToList() )
+                {
+                    sm_modules.Remove( key );
+                }
+            }
+        } // end ForgetModule()
+
+
+        /// <summary>
+        ///    Writes out everything learned so far.
+        /// </summary>
+        public static void Flush()
+        {
+            lock( sm_syncRoot )
+            {
+                foreach( var file in sm_files.Values )
+                {
+                    file.Save();
+                }
+            }
+        } // end Flush()
+
+
+        /// <summary>
+        ///    Flushes, then closes all the files and forgets all module associations, so
+        ///    that the next lookup behaves like the first one in a new session.
+        /// </summary>
+        public static void Reset()
+        {
+            lock( sm_syncRoot )
+            {
+                Flush();
+
+                foreach( var file in sm_files.Values )
+                {
+                    file.Dispose();
+                }
+
+                sm_files.Clear();
+                sm_modules.Clear();
+            }
+        } // end Reset()
+    } // end class TypeLayoutDiskCache
+}
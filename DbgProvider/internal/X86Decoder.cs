@@ -0,0 +1,281 @@
+using System;
+using System.Runtime.InteropServices;
+
+namespace MS.Dbg
+{
+    //
+    // N.B. The enums and structs here mirror the definitions in
+    // DbgNativeUtil\X86Decoder.h; keep them in sync.
+    //
+
+    internal enum X86Flow : byte
+    {
+        None = 0,
+        Call = 1,           // Direct (relative or far absolute).
+        CallIndirect = 2,
+        Jump = 3,           // Direct (relative or far absolute).
+        JumpIndirect = 4,
+        ConditionalJump = 5,
+        Return = 6,         // Including iret, sysret and sysexit.
+        Interrupt = 7,
+        Syscall = 8,
+    } // end enum X86Flow
+
+
+    [Flags]
+    internal enum X86InstructionFlags : uint
+    {
+        None = 0,
+        ModRm = 0x01,
+        Sib = 0x02,
+        Relative = 0x04,
+        HasBranchTarget = 0x08,
+        HasMemoryAddress = 0x10,
+        RipRelative = 0x20,
+    } // end enum X86InstructionFlags
+
+
+    [Flags]
+    internal enum X86Prefixes : byte
+    {
+        None = 0,
+        Lock = 0x01,
+        Rep = 0x02,
+        RepNE = 0x04,
+        OperandSize = 0x08,
+        AddressSize = 0x10,
+        Segment = 0x20,
+        Vex = 0x40,         // VEX or XOP
+        Evex = 0x80,
+    } // end enum X86Prefixes
+
+
+    internal enum X86OpcodeMap : byte
+    {
+        OneByte = 0,
+        Map0F = 1,
+        Map0F38 = 2,
+        Map0F3A = 3,
+        Map3DNow = 4,       // 0F 0F; Opcode is the trailing byte.
+        Map5 = 5,
+        Map6 = 6,
+        Xop8 = 8,
+        Xop9 = 9,
+        XopA = 10,
+    } // end enum X86OpcodeMap
+
+
+    /// <summary>
+    ///    The decoded form of an x86/x64 instruction (DBGX86_INSTRUCTION). There is no
+    ///    text; dbgeng does that.
+    /// </summary>
+    [StructLayout( LayoutKind.Sequential )]
+    internal struct X86Instruction
+    {
+        public ulong Address;
+        public ulong BranchTarget;      // Only if Flags has HasBranchTarget.
+        public ulong MemoryAddress;     // Only if Flags has HasMemoryAddress.
+        public long Displacement;
+        public ulong Immediate;         // All the immediate bytes, little-endian.
+        public X86InstructionFlags Flags;
+        public byte Length;
+        public X86OpcodeMap OpcodeMap;
+        public byte Opcode;
+        public X86Flow Flow;
+        public X86Prefixes Prefixes;
+        public byte Rex;
+        public byte ModRm;
+        public byte Sib;
+        public byte OperandSize;
+        public byte AddressSize;
+        public byte DisplacementSize;
+        public byte ImmediateSize;
+
+        public bool HasBranchTarget { get { return 0 != (Flags & X86InstructionFlags.HasBranchTarget); } }
+        public bool HasMemoryAddress { get { return 0 != (Flags & X86InstructionFlags.HasMemoryAddress); } }
+        public bool IsCall { get { return (X86Flow.Call == Flow) || (X86Flow.CallIndirect == Flow); } }
+
+        public override string ToString()
+        {
+            return Util.Sprintf( "{0}: {1} byte(s), map {2}, opcode {3:x2}, {4}",
+                                 Util.FormatHalfOrFullQWord( Address ),
+                                 Length,
+                                 OpcodeMap,
+                                 Opcode,
+                                 Flow );
+        }
+    } // end struct X86Instruction
+
+
+    /// <summary>
+    ///    A call instruction found by X86Decoder.FindCalls (DBGX86_CALL_SITE).
+    /// </summary>
+    [StructLayout( LayoutKind.Sequential, Size = 24 )]
+    internal struct X86CallSite
+    {
+        public ulong CallAddress;
+        public ulong Target;            // For indirect calls, the address of the pointer to the target.
+        public byte Length;
+        public X86Flow Flow;            // Call or CallIndirect
+    } // end struct X86CallSite
+
+
+    /// <summary>
+    ///    Wraps the table-driven x86/x64 instruction decoder in DbgNativeUtil.dll.
+    /// </summary>
+    /// <remarks>
+    ///    This only decodes (lengths, prefixes, operands, control flow); it doesn't need
+    ///    the debugger, so it is much cheaper than asking dbgeng to disassemble, and is
+    ///    for when we need to look at a lot of code: checking whether a return address
+    ///    follows a call, scanning for call targets, etc. The caller supplies the code
+    ///    bytes and whatever buffers the results go in, so nothing here allocates.
+    /// </remarks>
+    internal static class X86Decoder
+    {
+        private const int DBGX86_OK = 0;
+
+        public const int MaxInstructionLength = 15;
+
+
+        [DllImport( ExternDll.DbgNativeUtil, CallingConvention = CallingConvention.Cdecl )]
+        private static extern unsafe int DbgX86DecodeInstruction( byte* code,
+                                                                  UIntPtr codeSize,
+                                                                  ulong address,
+                                                                  int is64Bit,
+                                                                  X86Instruction* pInstruction );
+
+        [DllImport( ExternDll.DbgNativeUtil, CallingConvention = CallingConvention.Cdecl )]
+        private static extern unsafe UIntPtr DbgX86DecodeInstructions( byte* code,
+                                                                       UIntPtr codeSize,
+                                                                       ulong address,
+                                                                       int is64Bit,
+                                                                       X86Instruction* pInstructions,
+                                                                       UIntPtr maxInstructions,
+                                                                       out UIntPtr bytesDecoded );
+
+        [DllImport( ExternDll.DbgNativeUtil, CallingConvention = CallingConvention.Cdecl )]
+        private static extern unsafe int DbgX86FindCallBeforeReturn( byte* code,
+                                                                     UIntPtr codeSize,
+                                                                     ulong returnAddress,
+                                                                     int is64Bit,
+                                                                     X86Instruction* pCall );
+
+        [DllImport( ExternDll.DbgNativeUtil, CallingConvention = CallingConvention.Cdecl )]
+        private static extern unsafe UIntPtr DbgX86FindCallTargets( byte* code,
+                                                                    UIntPtr codeSize,
+                                                                    ulong address,
+                                                                    int is64Bit,
+                                                                    X86CallSite* pCallSites,
+                                                                    UIntPtr maxCallSites,
+                                                                    out UIntPtr bytesScanned );
+
+
+        /// <summary>
+        ///    Decodes the instruction at the start of code. Returns false if it is not a
+        ///    valid instruction, or if code ends before the instruction does.
+        /// </summary>
+        public static unsafe bool TryDecode( ReadOnlySpan< byte > code,
+                                             ulong address,
+                                             bool is64Bit,
+                                             out X86Instruction instruction )
+        {
+            X86Instruction tmp;
+            int status;
+            fixed( byte* pCode = code )
+            {
+                status = DbgX86DecodeInstruction( pCode,
+                                                  (UIntPtr) (uint) code.Length,
+                                                  address,
+                                                  is64Bit ? 1 : 0,
+                                                  &tmp );
+            }
+            instruction = tmp;
+            return DBGX86_OK == status;
+        } // end TryDecode()
+
+
+        /// <summary>
+        ///    Decodes consecutive instructions into the instructions span, until it is
+        ///    full, the code runs out, or an instruction can't be decoded. Returns how
+        ///    many were decoded; bytesDecoded is their total length.
+        /// </summary>
+        public static unsafe int DecodeRange( ReadOnlySpan< byte > code,
+                                              ulong address,
+                                              bool is64Bit,
+                                              Span< X86Instruction > instructions,
+                                              out int bytesDecoded )
+        {
+            UIntPtr count;
+            UIntPtr cb;
+            fixed( byte* pCode = code )
+            fixed( X86Instruction* pInstructions = instructions )
+            {
+                count = DbgX86DecodeInstructions( pCode,
+                                                  (UIntPtr) (uint) code.Length,
+                                                  address,
+                                                  is64Bit ? 1 : 0,
+                                                  pInstructions,
+                                                  (UIntPtr) (uint) instructions.Length,
+                                                  out cb );
+            }
+            bytesDecoded = (int) cb.ToUInt32();
+            return (int) count.ToUInt32();
+        } // end DecodeRange()
+
+
+        /// <summary>
+        ///    Checks whether the code right before returnAddress ends with a call
+        ///    instruction (i.e. whether returnAddress looks like a real return address).
+        ///    code should be the bytes that end at returnAddress; MaxInstructionLength
+        ///    of them is enough.
+        /// </summary>
+        public static unsafe bool TryFindCallBefore( ReadOnlySpan< byte > code,
+                                                     ulong returnAddress,
+                                                     bool is64Bit,
+                                                     out X86Instruction call )
+        {
+            X86Instruction tmp;
+            int found;
+            fixed( byte* pCode = code )
+            {
+                found = DbgX86FindCallBeforeReturn( pCode,
+                                                    (UIntPtr) (uint) code.Length,
+                                                    returnAddress,
+                                                    is64Bit ? 1 : 0,
+                                                    &tmp );
+            }
+            call = tmp;
+            return 0 != found;
+        } // end TryFindCallBefore()
+
+
+        /// <summary>
+        ///    Scans code for direct calls, and for indirect calls through absolute or
+        ///    RIP-relative pointers, until the callSites span is full or the code runs
+        ///    out. Returns how many were found; bytesScanned is how far it got (so the
+        ///    caller can continue from there if callSites filled up).
+        /// </summary>
+        public static unsafe int FindCalls( ReadOnlySpan< byte > code,
+                                            ulong address,
+                                            bool is64Bit,
+                                            Span< X86CallSite > callSites,
+                                            out int bytesScanned )
+        {
+            UIntPtr count;
+            UIntPtr cb;
+            fixed( byte* pCode = code )
+            fixed( X86CallSite* pCallSites = callSites )
+            {
+                count = DbgX86FindCallTargets( pCode,
+                                               (UIntPtr) (uint) code.Length,
+                                               address,
+                                               is64Bit ? 1 : 0,
+                                               pCallSites,
+                                               (UIntPtr) (uint) callSites.Length,
+                                               out cb );
+            }
+            bytesScanned = (int) cb.ToUInt32();
+            return (int) count.ToUInt32();
+        } // end FindCalls()
+    } // end class X86Decoder
+}
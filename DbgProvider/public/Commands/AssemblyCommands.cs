@@ -1,5 +1,6 @@
 ﻿using System;
 using System.Collections.Concurrent;
+using System.Collections.Generic;
 using System.Management.Automation;
 using System.Text.RegularExpressions;
 
@@ -100,10 +101,7 @@ protected override void ProcessRecord()
                 }
                 else if( 0 != EndAddress )
                 {
-                    _UnassembleInstructions( addr, ( a ) =>
-                        {
-                            return a <= EndAddress;
-                        } );
+                    _UnassembleInstructions( addr, EndAddress, Int32.MaxValue );
                 }
                 else
                 {
@@ -122,13 +120,7 @@ protected override void ProcessRecord()
                         InstructionCount = -InstructionCount;
                     }
 
-                    int i = 0;
-                    _UnassembleInstructions( addr, ( a ) =>
-                        {
-                            bool keepGoing = i < InstructionCount;
-                            i++;
-                            return keepGoing;
-                        } );
+                    _UnassembleInstructions( addr, UInt64.MaxValue, InstructionCount );
                 }
             }
             catch( DbgProviderException dpe )
@@ -138,7 +130,12 @@ protected override void ProcessRecord()
         } // end ProcessRecord()
 
 
-        private void _UnassembleInstructions( ulong addr, Func< ulong, bool > keepGoing )
+        // How many instructions we ask the debugger for at a time. (Big enough to make
+        // the trips to the dbgeng thread not matter; small enough to get output going
+        // right away.)
+        private const int c_InstructionsPerBatch = 256;
+
+        private void _UnassembleInstructions( ulong addr, ulong lastAddr, int maxInstructions )
         {
             ColorString csBlockId;
 
@@ -162,14 +159,31 @@ private void _UnassembleInstructions( ulong addr, Func< ulong, bool > keepGoing
 
             bool hasCodeBytes = !Debugger.AssemblyOptions.HasFlag( DbgAssemblyOptions.NoCodeBytes );
 
-            while( keepGoing( addr ) )
+            int count = 0;
+            while( (count < maxInstructions) && (addr <= lastAddr) && !Stopping )
             {
-                ulong tmpAddr = addr;
-                string disasm = Debugger.Disassemble( tmpAddr, out addr ).Trim();
-                WriteObject( _ParseDisassembly( tmpAddr,
-                                                disasm,
-                                                csBlockId,
-                                                hasCodeBytes ) );
+                int batchSize = Math.Min( maxInstructions - count, c_InstructionsPerBatch );
+                ulong nextAddr;
+                var batch = Debugger.DisassembleRange( addr, lastAddr, batchSize, out nextAddr );
+                foreach( var instr in batch )
+                {
+                    WriteObject( instr.WithBlockId( csBlockId ) );
+                }
+                count += batch.Count;
+                addr = nextAddr;
+
+                if( (batch.Count < batchSize) && (addr <= lastAddr) )
+                {
+                    // DisassembleRange stopped early, so there's probably no code here.
+                    // Disassemble it by itself to get the usual error (which will throw).
+                    ulong tmpAddr = addr;
+                    string disasm = Debugger.Disassemble( tmpAddr, out addr ).Trim();
+                    WriteObject( _ParseDisassembly( tmpAddr,
+                                                    disasm,
+                                                    csBlockId,
+                                                    hasCodeBytes ) );
+                    count++;
+                }
             }
             DbgProvider.SetAutoRepeatCommand( Util.Sprintf( "{0} -Address 0x{1} -InstructionCount {2}",
                                                             MyInvocation.InvocationName,
@@ -181,6 +195,17 @@ private void _UnassembleInstructions( ulong addr, Func< ulong, bool > keepGoing
 
         private void _UnassembleWholeFunction( ulong addr )
         {
+            DbgDisassembly[] cached = Debugger.TryGetCachedWholeFunctionDisassembly( addr );
+            if( null != cached )
+            {
+                foreach( var instr in cached )
+                {
+                    WriteObject( instr );
+                }
+                NextAddrToDisassemble = addr;
+                return;
+            }
+
             using( BlockingCollection< string > output = new BlockingCollection<string>() )
             {
                 var ufTask = Debugger.InvokeDbgEngCommandAsync( Util.Sprintf( "uf {0:x}", addr ),
@@ -189,9 +214,10 @@ private void _UnassembleWholeFunction( ulong addr )
                 ufTask.ContinueWith( ( x ) => output.CompleteAdding() );
 
                 bool hasCodeBytes = !Debugger.AssemblyOptions.HasFlag( DbgAssemblyOptions.NoCodeBytes );
+                WholeFunctionDisasmParser parser;
                 using( var pipe = GetPipelineCallback() )
                 {
-                    var parser = new WholeFunctionDisasmParser( pipe, hasCodeBytes );
+                    parser = new WholeFunctionDisasmParser( pipe, hasCodeBytes );
                     foreach( string line in output.GetConsumingEnumerable() ) // TODO: should this be cancellable?
                     {
                         parser.AddLine( line );
@@ -200,6 +226,12 @@ private void _UnassembleWholeFunction( ulong addr )
 
                 Util.Await( ufTask ); // in case it threw.
 
+                // Only clean results get cached: warnings (like "Flow analysis was
+                // incomplete") could be about a transient problem, like symbols that
+                // haven't been found yet.
+                if( !parser.SawProblems && (parser.Disassembly.Count > 0) )
+                    Debugger.CacheWholeFunctionDisassembly( addr, parser.Disassembly.ToArray() );
+
                 NextAddrToDisassemble = addr;
             } // end using( output )
         } // end _UnassembleWholeFunction()
@@ -242,6 +274,19 @@ private void _UnassembleWholeFunction( ulong addr )
                                                           string s,
                                                           ColorString blockId,
                                                           bool hasCodeBytes )
+        {
+            return _ParseDisassembly( address, s, blockId, hasCodeBytes, 0, null );
+        }
+
+        // The length and code bytes, if known (like from WDebugControl.DisassembleRange),
+        // save having to guess the length from the text (which has no code bytes in it
+        // when the NoCodeBytes option is on).
+        internal static DbgDisassembly _ParseDisassembly( ulong address,
+                                                          string s,
+                                                          ColorString blockId,
+                                                          bool hasCodeBytes,
+                                                          int length,
+                                                          byte[] knownCodeBytes )
         {
             // Example inputs:
             //
@@ -357,12 +402,19 @@ private void _UnassembleWholeFunction( ulong addr )
                 Util.Assert( 1 == matchCount );
             }
 
+            if( null != knownCodeBytes )
+                codeBytes = knownCodeBytes;
+
+            if( (0 == length) && (null != codeBytes) )
+                length = codeBytes.Length;
+
             return new DbgDisassembly( address,
                                        codeBytes,
                                        instruction,
                                        arguments,
                                        blockId,
-                                       cs.MakeReadOnly() );
+                                       cs.MakeReadOnly(),
+                                       length );
         } // end _ParseDisassembly()
 
 
@@ -381,6 +433,18 @@ private enum WfdState
             private bool m_hasCodeBytes;
             private WfdState m_state;
             private ColorString m_currentBlockId;
+            private List< DbgDisassembly > m_disassembly = new List< DbgDisassembly >();
+            private bool m_sawProblems;
+
+            /// <summary>
+            ///    Everything written to the pipeline so far.
+            /// </summary>
+            public IReadOnlyList< DbgDisassembly > Disassembly { get { return m_disassembly; } }
+
+            /// <summary>
+            ///    True if any warnings or errors were written.
+            /// </summary>
+            public bool SawProblems { get { return m_sawProblems; } }
 
             // TODO: Is anybody crazy enough to programmatically consume the disassembly
             // objects? If so, I could stick a flag on them saying if we ran into flow
@@ -399,6 +463,13 @@ public WholeFunctionDisasmParser( IPipelineCallback pipeline, bool hasCodeBytes
             } // end constructor
 
 
+            private void _WriteDisassembly( DbgDisassembly disasm )
+            {
+                m_disassembly.Add( disasm );
+                m_pipeline.WriteObject( disasm );
+            } // end _WriteDisassembly()
+
+
             public void AddLine( string s )
             {
                 switch( m_state )
@@ -409,10 +480,10 @@ public void AddLine( string s )
                             // It's not a block ID... this can happen when "Flow
                             // analysis was incomplete".
                             m_currentBlockId = new ColorString( ConsoleColor.DarkGray, "<unknown>" ).MakeReadOnly();
-                            m_pipeline.WriteObject( _ParseDisassembly( 0, // will get parsed out of s
-                                                                       s,
-                                                                       m_currentBlockId,
-                                                                       m_hasCodeBytes ) );
+                            _WriteDisassembly( _ParseDisassembly( 0, // will get parsed out of s
+                                                                  s,
+                                                                  m_currentBlockId,
+                                                                  m_hasCodeBytes ) );
                         }
                         else
                         {
@@ -428,10 +499,10 @@ public void AddLine( string s )
                         }
                         else
                         {
-                            m_pipeline.WriteObject( _ParseDisassembly( 0, // will get parsed out of s
-                                                                       s,
-                                                                       m_currentBlockId,
-                                                                       m_hasCodeBytes ) );
+                            _WriteDisassembly( _ParseDisassembly( 0, // will get parsed out of s
+                                                                  s,
+                                                                  m_currentBlockId,
+                                                                  m_hasCodeBytes ) );
                         }
                         break;
 
@@ -441,12 +512,14 @@ public void AddLine( string s )
                         if( s.StartsWith( "Flow analysis", StringComparison.OrdinalIgnoreCase ) )
                         {
                             //m_flowAnalysisWarning = true;
+                            m_sawProblems = true;
                             m_pipeline.WriteWarning( s );
                             m_state = WfdState.DontKnow;
                             break;
                         }
                         else if( s.StartsWith( "*** WARNING: ", StringComparison.OrdinalIgnoreCase ) )
                         {
+                            m_sawProblems = true;
                             m_pipeline.WriteWarning( s.Substring( 13 ) ); // trim off what will become redundant "WARNING" label.
                             m_state = WfdState.DontKnow;
                             break;
@@ -458,6 +531,7 @@ public void AddLine( string s )
                                                                 "ErrorDuringUnassemble",
                                                                 ErrorCategory.ReadError );
                             try { throw dpe; } catch( Exception ) { } // give it a stack.
+                            m_sawProblems = true;
                             m_pipeline.WriteError( dpe );
                             m_state = WfdState.DontKnow;
                             break;
@@ -468,6 +542,7 @@ public void AddLine( string s )
                                                                 "NoCodeFound",
                                                                 ErrorCategory.ReadError );
                             try { throw dpe; } catch( Exception ) { } // give it a stack.
+                            m_sawProblems = true;
                             m_pipeline.WriteError( dpe );
                             m_state = WfdState.DontKnow; // actually, we should be done now.
                             break;
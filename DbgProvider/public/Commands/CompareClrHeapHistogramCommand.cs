@@ -0,0 +1,141 @@
+﻿using Microsoft.Diagnostics.Runtime;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Management.Automation;
+
+namespace MS.Dbg.Commands
+{
+    /// <summary>
+    ///    Compares heap statistics (Get-ClrHeap -Statistics) from an earlier dump with
+    ///    those of the current process (or others piped in), and outputs the types whose
+    ///    object counts or sizes changed, biggest change first. Types are matched by
+    ///    name and module file name.
+    /// </summary>
+    [Cmdlet( VerbsData.Compare, "ClrHeapHistogram", DefaultParameterSetName = c_PathParamSet )]
+    [OutputType( typeof( ClrHeapHistogramDelta ) )]
+    public class CompareClrHeapHistogramCommand : DbgBaseCommand
+    {
+        private const string c_PathParamSet = "PathParamSet";
+        private const string c_HistogramParamSet = "HistogramParamSet";
+
+        /// <summary>
+        ///    A file written by Get-ClrHeap -Statistics -Path.
+        /// </summary>
+        [Parameter( Mandatory = true, Position = 0, ParameterSetName = c_PathParamSet )]
+        [ValidateNotNullOrEmpty]
+        public string BaselinePath { get; set; }
+
+        [Parameter( Mandatory = true, Position = 0, ParameterSetName = c_HistogramParamSet )]
+        [ValidateNotNull]
+        public ClrTypeStatistics[] Baseline { get; set; }
+
+        /// <summary>
+        ///    The statistics to compare against the baseline. If none are given, those of
+        ///    the current process are taken (estimating retained sizes if the baseline
+        ///    has them).
+        /// </summary>
+        [Parameter( Mandatory = false, Position = 1, ValueFromPipeline = true )]
+        public ClrTypeStatistics[] Current { get; set; }
+
+        /// <summary>
+        ///    How many segments to walk at once, if the statistics of the current process
+        ///    have to be taken. The default (0) means one per processor.
+        /// </summary>
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 0, 1024 )]
+        public int ThrottleLimit { get; set; }
+
+
+        protected override void BeginProcessing()
+        {
+            base.BeginProcessing();
+
+            if( null != Baseline )
+                return;
+
+            string path = SessionState.Path.GetUnresolvedProviderPathFromPSPath( BaselinePath );
+            try
+            {
+                Baseline = ClrHeapHistogram.Load( path ).ToArray();
+            }
+            catch( Exception e ) when( (e is IOException) ||
+                                       (e is InvalidDataException) ||
+                                       (e is UnauthorizedAccessException) )
+            {
+                throw new DbgProviderException( Util.Sprintf( "Could not read heap statistics {0}: {1}",
+                                                              path,
+                                                              e.Message ),
+                                                "HistogramReadFailed",
+                                                ErrorCategory.ReadError,
+                                                e,
+                                                path );
+            }
+        } // end BeginProcessing()
+
+
+        private List< ClrTypeStatistics > m_current;
+
+        protected override void ProcessRecord()
+        {
+            if( null == Current )
+                return;
+
+            if( null == m_current )
+                m_current = new List< ClrTypeStatistics >();
+
+            m_current.AddRange( Current );
+        } // end ProcessRecord()
+
+
+        protected override void EndProcessing()
+        {
+            _Compare();
+            base.EndProcessing();
+        } // end EndProcessing()
+
+
+        private void _Compare()
+        {
+            if( null != m_current )
+            {
+                _WriteDeltas( m_current );
+                return;
+            }
+
+            var process = Debugger.GetCurrentUModeProcess();
+
+            if( null == process )
+            {
+                SafeWriteError( "No current user-mode process.",
+                                "NoUmodeProcess",
+                                ErrorCategory.NotImplemented,
+                                null );
+                return;
+            }
+
+            bool estimateRetainedSize = ClrHeapHistogram.HasRetainedSizes( Baseline );
+            var current = new List< ClrTypeStatistics >();
+            foreach( var runtime in process.ClrRuntimes )
+            {
+                current.AddRange( GetClrHeapCommand.GetStatistics( process,
+                                                                   runtime,
+                                                                   estimateRetainedSize,
+                                                                   ThrottleLimit,
+                                                                   CancelTS.Token ) );
+            }
+
+            _WriteDeltas( current );
+        } // end _Compare()
+
+
+        private void _WriteDeltas( IList< ClrTypeStatistics > current )
+        {
+            foreach( var delta in ClrHeapHistogram.Compare( Baseline, current ) )
+            {
+                WriteObject( delta );
+            }
+        } // end _WriteDeltas()
+    } // end class CompareClrHeapHistogramCommand
+}
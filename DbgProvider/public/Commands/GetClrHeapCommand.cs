@@ -1,12 +1,65 @@
 ﻿using Microsoft.Diagnostics.Runtime;
+using System;
+using System.Collections.Generic;
+using System.IO;
 using System.Management.Automation;
+using System.Threading;
 
 namespace MS.Dbg.Commands
 {
     [Cmdlet( VerbsCommon.Get, "ClrHeap" )]
     [OutputType( typeof( ClrHeap ) )]
+    [OutputType( typeof( ClrTypeStatistics ) )]
     public class GetClrHeapCommand : DbgBaseCommand
     {
+        /// <summary>
+        ///    Instead of the heap, output the number of objects and total size of each
+        ///    type on it (like !dumpheap -stat). Segments are walked in parallel, or if
+        ///    the heap has been indexed (New-ClrHeapIndex), the index is used instead.
+        ///    Nothing is kept per heap object: memory use is one entry per type.
+        /// </summary>
+        [Parameter( Mandatory = false )]
+        public SwitchParameter Statistics { get; set; }
+
+        /// <summary>
+        ///    How many segments to walk at once when computing -Statistics. The default
+        ///    (0) means one per processor.
+        /// </summary>
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 0, 1024 )]
+        public int ThrottleLimit { get; set; }
+
+        /// <summary>
+        ///    With -Statistics, also estimate the retained size of each type: the size of
+        ///    its objects plus the size of the objects that only they refer to. This takes
+        ///    an extra pass over the heap.
+        /// </summary>
+        [Parameter( Mandatory = false )]
+        public SwitchParameter EstimateRetainedSize { get; set; }
+
+        /// <summary>
+        ///    With -Statistics, also save them to this file, to compare with another dump
+        ///    of the same process later (Compare-ClrHeapHistogram). (If there is more than
+        ///    one CLR in the process, the statistics for the second and later ones go to
+        ///    "{Path}.clr{N}".)
+        /// </summary>
+        [Parameter( Mandatory = false )]
+        [ValidateNotNullOrEmpty]
+        public string Path { get; set; }
+
+        protected override void BeginProcessing()
+        {
+            base.BeginProcessing();
+
+            if( !Statistics && (EstimateRetainedSize || !String.IsNullOrEmpty( Path )) )
+            {
+                ThrowTerminatingError( new ArgumentException( "-EstimateRetainedSize and -Path go with -Statistics." ),
+                                       "StatisticsParamsWithoutStatistics",
+                                       ErrorCategory.InvalidArgument,
+                                       null );
+            }
+        } // end BeginProcessing()
+
         protected override void ProcessRecord()
         {
             //var process = Debugger.GetCurrentTarget() as DbgUModeProcess;
@@ -18,12 +71,77 @@ protected override void ProcessRecord()
                                 "NoUmodeProcess",
                                 ErrorCategory.NotImplemented,
                                 null );
+                return;
             }
+            string path = null;
+            if( !String.IsNullOrEmpty( Path ) )
+                path = SessionState.Path.GetUnresolvedProviderPathFromPSPath( Path );
+
+            int runtimeNum = 0;
             foreach( var runtime in process.ClrRuntimes )
             {
                 var heap = runtime.GetHeap();
-                WriteObject( heap );
+                if( Statistics )
+                {
+                    var stats = GetStatistics( process,
+                                               runtime,
+                                               EstimateRetainedSize,
+                                               ThrottleLimit,
+                                               CancelTS.Token );
+                    if( null != path )
+                    {
+                        string thisPath = (0 == runtimeNum) ? path : Util.Sprintf( "{0}.clr{1}", path, runtimeNum );
+                        _Save( stats, thisPath );
+                    }
+
+                    foreach( var stat in stats )
+                    {
+                        WriteObject( stat );
+                    }
+                }
+                else
+                {
+                    WriteObject( heap );
+                }
+                runtimeNum++;
             }
         }
+
+
+        private void _Save( IList< ClrTypeStatistics > stats, string path )
+        {
+            try
+            {
+                ClrHeapHistogram.Save( stats, path );
+            }
+            catch( Exception e ) when( (e is IOException) || (e is UnauthorizedAccessException) )
+            {
+                WriteError( new DbgProviderException( Util.Sprintf( "Could not write heap statistics {0}: {1}",
+                                                                    path,
+                                                                    e.Message ),
+                                                      "HistogramWriteFailed",
+                                                      ErrorCategory.WriteError,
+                                                      e,
+                                                      path ) );
+            }
+        } // end _Save()
+
+
+        /// <summary>
+        ///    Gets the type statistics for the runtime's heap, from its index if it has
+        ///    been indexed (New-ClrHeapIndex), else by walking the heap.
+        /// </summary>
+        internal static IList< ClrTypeStatistics > GetStatistics( DbgUModeProcess process,
+                                                                  ClrRuntime runtime,
+                                                                  bool estimateRetainedSize,
+                                                                  int throttleLimit,
+                                                                  CancellationToken cancelToken )
+        {
+            var index = process.TryGetClrHeapIndex( runtime );
+            if( null != index )
+                return index.GetTypeStatistics( estimateRetainedSize, cancelToken );
+
+            return runtime.GetHeap().GetTypeStatistics( throttleLimit, estimateRetainedSize, cancelToken );
+        } // end GetStatistics()
     }
 }
@@ -15,8 +15,17 @@ public class GetClrObjectCommand : DbgBaseCommand
         [ValidateNotNullOrEmpty]
         public ClrHeap[] ClrHeap { get; set; }
 
+        /// <summary>
+        ///    Walk heap segments on several threads at once. Objects are still output in
+        ///    address order.
+        /// </summary>
+        [Parameter( Mandatory = false )]
+        public SwitchParameter Parallel { get; set; }
+
         protected override void ProcessRecord()
         {
+            var process = Debugger.GetCurrentUModeProcess();
+
             if( ClrHeap == null )
             {
                 ClrHeap = Debugger
@@ -36,6 +45,27 @@ protected override void ProcessRecord()
                                                           ErrorCategory.InvalidArgument,
                                                           heap ) );
                 }
+                else if( _TryGetIndex( process, heap, out ClrHeapIndex index ) )
+                {
+                    for( int i = 0; i < index.Count; i++ )
+                    {
+                        var clrType = index.GetObjectType( i );
+                        if( clrType != null )
+                        {
+                            WriteObject( new ClrObject( index.GetAddress( i ), clrType ) );
+                        }
+                    }
+                }
+                else if( Parallel )
+                {
+                    foreach( var obj in heap.EnumerateObjects( 0, ordered: true ) )
+                    {
+                        if( obj.Type != null )
+                        {
+                            WriteObject( new ClrObject( obj.Address, obj.Type ) );
+                        }
+                    }
+                }
                 else
                 {
                     foreach( var address in heap.EnumerateObjectAddresses() )
@@ -49,5 +79,18 @@ protected override void ProcessRecord()
                 }
             } // end foreach( heap )
         } // end ProcessRecord()
+
+
+        private static bool _TryGetIndex( DbgUModeProcess process, ClrHeap heap, out ClrHeapIndex index )
+        {
+            index = null;
+            if( null == process )
+                return false;
+
+            // Only if the heap has been indexed (New-ClrHeapIndex); we don't build one
+            // just for this.
+            index = process.TryGetClrHeapIndex( heap.Runtime );
+            return (null != index) && (index.Heap == heap);
+        } // end _TryGetIndex()
     } // end GetClrObjectCommand
 }
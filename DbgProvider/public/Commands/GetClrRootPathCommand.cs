@@ -0,0 +1,91 @@
+﻿using Microsoft.Diagnostics.Runtime;
+using System;
+using System.Management.Automation;
+
+namespace MS.Dbg.Commands
+{
+    /// <summary>
+    ///    Finds what keeps a managed object alive: chains of references from GC roots
+    ///    to the object (like SOS's !gcroot). By default, finds one shortest path; with
+    ///    -All, finds a path from every root that reaches the object.
+    /// </summary>
+    /// <remarks>
+    ///    If the heap has been indexed (New-ClrHeapIndex), references are read from the
+    ///    index.
+    /// </remarks>
+    [Cmdlet( VerbsCommon.Get, "ClrRootPath" )]
+    [OutputType( typeof( GCRootPath ) )]
+    public class GetClrRootPathCommand : DbgBaseCommand
+    {
+        [Parameter( Mandatory = true,
+                    Position = 0,
+                    ValueFromPipeline = true,
+                    ValueFromPipelineByPropertyName = true )]
+        [AddressTransformation]
+        public ulong Address { get; set; }
+
+        /// <summary>
+        ///    Output a path from each root that keeps the object alive, instead of just
+        ///    one shortest path.
+        /// </summary>
+        [Parameter( Mandatory = false )]
+        public SwitchParameter All { get; set; }
+
+        /// <summary>
+        ///    The most threads to mark the heap with. 0 (the default) means one per
+        ///    processor.
+        /// </summary>
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 0, 1024 )]
+        public int ThrottleLimit { get; set; }
+
+
+        protected override void ProcessRecord()
+        {
+            var process = Debugger.GetCurrentUModeProcess();
+
+            if( null == process )
+            {
+                SafeWriteError( "No current user-mode process.",
+                                "NoUmodeProcess",
+                                ErrorCategory.NotImplemented,
+                                null );
+                return;
+            }
+
+            foreach( var runtime in process.ClrRuntimes )
+            {
+                var heap = runtime.GetHeap();
+                if( !heap.CanWalkHeap || !heap.IsInHeap( Address ) )
+                    continue;
+
+                var finder = new GCRootFinder( heap );
+                finder.DegreeOfParallelism = ThrottleLimit;
+
+                var index = process.TryGetClrHeapIndex( runtime );
+                if( (null != index) && (index.Heap == heap) )
+                    finder.Index = index;
+
+                if( All )
+                {
+                    foreach( var path in finder.FindAllPaths( Address, CancelTS.Token ) )
+                    {
+                        WriteObject( path );
+                    }
+                }
+                else
+                {
+                    var path = finder.FindShortestPath( Address, CancelTS.Token );
+                    if( null != path )
+                        WriteObject( path );
+                }
+                return;
+            }
+
+            WriteError( new DbgProviderException( Util.Sprintf( "Address 0x{0:x} is not on a managed heap.", Address ),
+                                                  "NotOnManagedHeap",
+                                                  ErrorCategory.InvalidArgument,
+                                                  Address ) );
+        } // end ProcessRecord()
+    } // end class GetClrRootPathCommand
+}
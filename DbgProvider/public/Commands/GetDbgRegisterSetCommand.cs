@@ -5,12 +5,17 @@ namespace MS.Dbg.Commands
 {
     [Cmdlet( VerbsCommon.Get, "DbgRegisterSet", DefaultParameterSetName = "RegisterSet" )]
     [OutputType( typeof( DbgRegisterSetBase ), ParameterSetName = new string[] { "RegisterSet" } )]
+    [OutputType( typeof( DbgRegisterSnapshot ), ParameterSetName = new string[] { "Snapshot" } )]
     public class GetDbgRegisterSetCommand : DbgBaseCommand
     {
         [Parameter( Position = 0, Mandatory = true, ParameterSetName = "History" )]
         [ValidateNotNullOrEmpty()]
         public string Id { get; set; }
 
+        // Gets just the general-purpose registers, but for every thread, all at once.
+        [Parameter( Mandatory = true, ParameterSetName = "Snapshot" )]
+        public SwitchParameter AllThreads { get; set; }
+
 
         protected override void ProcessRecord()
         {
@@ -21,6 +26,10 @@ protected override void ProcessRecord()
                 powershell.AddParameter( "Id", Id );
                 powershell.Invoke();
             }
+            else if( ParameterSetName.Equals( "Snapshot" ) )
+            {
+                SafeWriteObject( DbgRegisterSnapshot.Capture( Debugger ) );
+            }
             else
             {
                 string path = this.CurrentProviderLocation( DbgProvider.ProviderId ).ProviderPath;
@@ -4,6 +4,17 @@
 
 namespace MS.Dbg.Commands
 {
+    /// <summary>
+    ///    Gets the paths of the DbgShell log files (newest first), or just the current
+    ///    one, or the most recent trace ring records.
+    /// </summary>
+    /// <remarks>
+    ///    N.B. Lines from the trace ring (see TraceRing) are written to the log when the
+    ///    rings are drained, up to TraceRing.FlushIntervalMs after they were traced, so
+    ///    in a log file they can come after lines that were traced later. Their time
+    ///    stamps are still when they were traced. -Recent output is in time stamp
+    ///    order, but only has trace ring records.
+    /// </remarks>
     [Cmdlet( VerbsCommon.Get, "DbgShellLog" )]
     [OutputType( typeof( string ) )]
     public class GetDbgShellLogCommand : DbgBaseCommand
@@ -11,12 +22,27 @@ public class GetDbgShellLogCommand : DbgBaseCommand
         [Parameter]
         public SwitchParameter Current { get; set; }
 
+        /// <summary>
+        ///    Outputs the most recent trace ring records (see TraceRing), formatted as
+        ///    they would be in the log, including ones that have not been written to the
+        ///    log yet.
+        /// </summary>
+        [Parameter]
+        public SwitchParameter Recent { get; set; }
+
 
         protected override void ProcessRecord()
         {
             base.ProcessRecord();
 
-            if( Current )
+            if( Recent )
+            {
+                foreach( string line in TraceRing.FormatRecent() )
+                {
+                    WriteObject( line );
+                }
+            }
+            else if( Current )
             {
                 WriteObject( LogManager.CurrentLogFile );
             }
@@ -1,5 +1,6 @@
 ﻿using System;
 using System.Collections.Generic;
+using System.Linq;
 using System.Management.Automation;
 
 namespace MS.Dbg.Commands
@@ -11,6 +12,7 @@ public class GetDbgStackCommand : DbgBaseCommand
         private const string c_MaxFrameCountParamSet = "MaxFrameCountParamSet";
         private const string c_ContextPathParamSet = "ContextPathParamSet";
         private const string c_ThreadParamSet = "ThreadParamSet";
+        private const string c_AllThreadsParamSet = "AllThreadsParamSet";
 
         // The path in the debugger namespace that indicates the context we should
         // be getting the stack for.
@@ -38,20 +40,35 @@ public class GetDbgStackCommand : DbgBaseCommand
         [ThreadTransformation]
         public DbgUModeThreadInfo[] Thread { get; set; }
 
+
+        // Gets the stacks for all threads in the current process, like "~* k". When the
+        // target is a dump, the stacks are walked ahead of the rest of the pipeline.
+        [Parameter( Mandatory = true,
+                    ParameterSetName = c_AllThreadsParamSet )]
+        public SwitchParameter AllThreads { get; set; }
+
         // TODO: options for how the stack should be displayed
 
         protected override void ProcessRecord()
         {
+            if( AllThreads )
+            {
+                _WriteStacks( Debugger.EnumerateThreads().ToList() );
+                return;
+            }
+
             if( null != Thread )
             {
+                var threads = new List< DbgUModeThreadInfo >( Thread.Length );
                 foreach( var t in Thread )
                 {
                     if( null != t )
-                        WriteObject( t.GetStackWithMaxFrames( MaxFrameCount ) );
+                        threads.Add( t );
                     else
                         SafeWriteWarning( "Null entry in -Thread parameter array." );
                 }
 
+                _WriteStacks( threads );
                 return;
             }
 
@@ -94,5 +111,14 @@ protected override void ProcessRecord()
                 }
             } // end foreach( path )
         } // end ProcessRecord()
+
+
+        private void _WriteStacks( IList< DbgUModeThreadInfo > threads )
+        {
+            foreach( var stack in DbgStackInfo.GetStacks( Debugger, threads, MaxFrameCount, CancelTS.Token ) )
+            {
+                WriteObject( stack );
+            }
+        } // end _WriteStacks()
     } // end class GetDbgStackCommand
 }
@@ -0,0 +1,49 @@
+﻿using Microsoft.Diagnostics.Runtime;
+using System.Management.Automation;
+
+namespace MS.Dbg.Commands
+{
+    /// <summary>
+    ///    Walks the managed heap(s) of the current dump once, and writes an index of
+    ///    every object (address, MethodTable, size and references) next to the dump.
+    ///    Later Get-ClrObject and Get-ClrHeap -Statistics queries against the same dump
+    ///    read the index instead of walking the heap again.
+    /// </summary>
+    [Cmdlet( VerbsCommon.New, "ClrHeapIndex" )]
+    [OutputType( typeof( ClrHeapIndex ) )]
+    public class NewClrHeapIndexCommand : DbgBaseCommand
+    {
+        protected override void ProcessRecord()
+        {
+            var process = Debugger.GetCurrentUModeProcess();
+
+            if( null == process )
+            {
+                SafeWriteError( "No current user-mode process.",
+                                "NoUmodeProcess",
+                                ErrorCategory.NotImplemented,
+                                null );
+                return;
+            }
+
+            foreach( var runtime in process.ClrRuntimes )
+            {
+                if( !runtime.GetHeap().CanWalkHeap )
+                {
+                    WriteError( new DbgProviderException( "Cannot walk heap",
+                                                          "HeapNotWalkable",
+                                                          ErrorCategory.InvalidArgument,
+                                                          runtime.GetHeap() ) );
+                    continue;
+                }
+
+                var index = process.BuildClrHeapIndex( runtime );
+                LogManager.Trace( "Wrote heap index {0}: {1} objects, {2} references.",
+                                  index.Path,
+                                  index.Count,
+                                  index.ReferenceCount );
+                WriteObject( index );
+            }
+        } // end ProcessRecord()
+    } // end class NewClrHeapIndexCommand
+}
@@ -57,6 +57,12 @@ public class DbgValueConverterInfo : IHaveTemplateTypeName
         /// </summary>
         public readonly IDbgValueConverter Converter;
 
+        /// <summary>
+        ///    True for the compiled converters that are built into DbgProvider (as
+        ///    opposed to registered by a script).
+        /// </summary>
+        public readonly bool IsBuiltIn;
+
         /// <summary>
         ///    The script that registered this converter.
         /// </summary>
@@ -100,6 +106,13 @@ public DbgValueConverterInfo( string typeName, IDbgValueConverter converter, str
             Converter = converter;
             SourceScript = sourceScript;
         } // end constructor
+
+
+        internal DbgValueConverterInfo( string typeName, IDbgValueConverter converter, bool isBuiltIn )
+            : this( typeName, converter, (string) null )
+        {
+            IsBuiltIn = isBuiltIn;
+        } // end constructor
     } // end class DbgValueConverterInfo
 
 
@@ -134,9 +147,26 @@ private static DbgValueConversionManagerInfo _Singleton
             }
         }
 
+        /// <summary>
+        ///    Turns off the built-in (compiled) converters, so that the script
+        ///    converters get used instead. Can also be turned off with the
+        ///    __DisableBuiltInValueConverters environment variable.
+        /// </summary>
+        internal static bool DisableBuiltInConverters { get; set; }
+            = !String.IsNullOrEmpty( Environment.GetEnvironmentVariable( "__DisableBuiltInValueConverters" ) );
+
         public static DbgValueConverterInfo ChooseConverterForSymbol( DbgSymbol symbol )
         {
-            return _Singleton.ChooseConverterForSymbol( symbol );
+            return _Singleton.ChooseConverterForSymbol( symbol, false );
+        }
+
+        /// <summary>
+        ///    Like ChooseConverterForSymbol, but never picks a built-in converter (for
+        ///    when the built-in converter could not handle the symbol).
+        /// </summary>
+        internal static DbgValueConverterInfo ChooseNonBuiltInConverterForSymbol( DbgSymbol symbol )
+        {
+            return _Singleton.ChooseConverterForSymbol( symbol, true );
         }
 
         public static IEnumerable< DbgValueConverterInfo > EnumerateAllConvertersForSymbol( DbgSymbol symbol )
@@ -151,7 +181,7 @@ public static void RegisterConverter( DbgValueConverterInfo converterInfo )
 
         public static IEnumerable< DbgValueConverterInfo > GetEntries()
         {
-            return _Singleton.EnumerateEntries();
+            return _Singleton.EnumerateEntries( true );
         }
 
         public static IEnumerable< DbgValueConverterInfo > GetMatchingEntries( string modFilter,
@@ -13,6 +13,17 @@ public class DbgDisassembly : ISupportColor
         public readonly string Arguments;
         public readonly ColorString BlockId;
 
+        /// <summary>
+        ///    The length of the instruction, in bytes (0 if not known).
+        /// </summary>
+        public readonly int Length;
+
+        /// <summary>
+        ///    The target of a direct branch or call instruction (0 for other
+        ///    instructions, and for indirect branches).
+        /// </summary>
+        public readonly ulong BranchTarget;
+
         private ColorString m_colorString;
 
         internal DbgDisassembly( ulong address,
@@ -21,6 +32,23 @@ public class DbgDisassembly : ISupportColor
                                  string arguments,
                                  ColorString blockId,
                                  ColorString colorString )
+            : this( address,
+                    codeBytes,
+                    instruction,
+                    arguments,
+                    blockId,
+                    colorString,
+                    (null == codeBytes) ? 0 : codeBytes.Length )
+        {
+        }
+
+        internal DbgDisassembly( ulong address,
+                                 byte[] codeBytes,
+                                 string instruction,
+                                 string arguments,
+                                 ColorString blockId,
+                                 ColorString colorString,
+                                 int length )
         {
             if( 0 == address )
                 throw new ArgumentOutOfRangeException( "address", address, "There shouldn't be any code at address 0." );
@@ -43,9 +71,109 @@ public class DbgDisassembly : ISupportColor
             Arguments = arguments;
             BlockId = blockId;
             m_colorString = colorString;
+            Length = length;
+            BranchTarget = _ParseBranchTarget( instruction, arguments );
         } // constructor
 
 
+        private DbgDisassembly( DbgDisassembly other, ColorString blockId )
+        {
+            Address = other.Address;
+            CodeBytes = other.CodeBytes;
+            Instruction = other.Instruction;
+            Arguments = other.Arguments;
+            BlockId = String.IsNullOrEmpty( blockId ) ? null : blockId;
+            m_colorString = other.m_colorString;
+            Length = other.Length;
+            BranchTarget = other.BranchTarget;
+        } // copy constructor
+
+
+        /// <summary>
+        ///    Returns a copy of this instruction with a different BlockId (cached
+        ///    instructions are stored without one).
+        /// </summary>
+        internal DbgDisassembly WithBlockId( ColorString blockId )
+        {
+            return new DbgDisassembly( this, blockId );
+        }
+
+
+        // ARM condition codes, for recognizing conditional branches like "bne".
+        private static readonly string[] sm_armConditions = new string[]
+        {
+            "eq", "ne", "cs", "hs", "cc", "lo", "mi", "pl", "vs", "vc", "hi", "ls", "ge", "lt", "gt", "le", "al"
+        };
+
+        private static bool _IsDirectBranchMnemonic( string instruction )
+        {
+            string mn = instruction.ToLowerInvariant();
+
+            // x86/x64: jmp, jcc, jecxz, call, loop/loope/loopne.
+            if( (mn[ 0 ] == 'j') || (mn == "call") || mn.StartsWith( "loop", StringComparison.Ordinal ) )
+                return true;
+
+            // ARM/THUMB2/ARM64: b, bl, blx, b.cond (ARM64), bcond, cbz, cbnz, tbz, tbnz
+            // (possibly with a THUMB2 width suffix, like "beq.w").
+            if( mn.EndsWith( ".w", StringComparison.Ordinal ) || mn.EndsWith( ".n", StringComparison.Ordinal ) )
+                mn = mn.Substring( 0, mn.Length - 2 );
+
+            if( (mn == "b") || (mn == "bl") || (mn == "blx") ||
+                (mn == "cbz") || (mn == "cbnz") || (mn == "tbz") || (mn == "tbnz") )
+            {
+                return true;
+            }
+
+            if( mn.StartsWith( "b.", StringComparison.Ordinal ) )
+                return true;
+
+            if( (3 == mn.Length) && (mn[ 0 ] == 'b') )
+                return 0 <= Array.IndexOf( sm_armConditions, mn.Substring( 1 ) );
+
+            return false;
+        } // end _IsDirectBranchMnemonic()
+
+
+        /// <summary>
+        ///    dbgeng puts the target of a direct branch at the end of the arguments,
+        ///    either bare ("jmp 00007ff6`ece87d60"), or in parentheses after its
+        ///    symbolic name ("je foo+0x22 (01131650)"). For indirect branches (like
+        ///    "call dword ptr [foo (0113c078)]"), the address shown is where the target
+        ///    is stored, so we don't report those.
+        /// </summary>
+        internal static ulong _ParseBranchTarget( string instruction, string arguments )
+        {
+            if( String.IsNullOrEmpty( arguments ) || !_IsDirectBranchMnemonic( instruction ) )
+                return 0;
+
+            string s = arguments.Trim();
+            if( s.EndsWith( ")", StringComparison.Ordinal ) )
+            {
+                int openIdx = s.LastIndexOf( '(' );
+                if( openIdx < 0 )
+                    return 0;
+
+                s = s.Substring( openIdx + 1, s.Length - openIdx - 2 );
+            }
+            else
+            {
+                // Conditional ARM64 branches have other operands first ("cbz x0,<target>").
+                int commaIdx = s.LastIndexOf( ',' );
+                if( commaIdx >= 0 )
+                    s = s.Substring( commaIdx + 1 );
+
+                if( s.StartsWith( "#", StringComparison.Ordinal ) )
+                    s = s.Substring( 1 );
+            }
+
+            ulong target;
+            if( !DbgProvider.TryParseHexOrDecimalNumber( s, out target ) )
+                return 0;
+
+            return target;
+        } // end _ParseBranchTarget()
+
+
         public ColorString ToColorString()
         {
             return m_colorString;
@@ -2067,12 +2067,111 @@ private void _AddModule( DbgModuleInfo modInfo )
 
         public DbgModuleInfo GetModuleByAddress( ulong addrInModule )
         {
-            // I could cache here?
             var process = GetCurrentTarget();
+
+            // Most lookups (symbolizing pointers, stack frames, etc.) hit modules on the
+            // target's (cached) module lists, which are indexed by address.
+            if( (0 != addrInModule) && (null != process) )
+            {
+                DbgModuleInfo mod = process.TryFindModuleByAddress( addrInModule );
+                if( null != mod )
+                    return mod;
+            }
+
+            // Otherwise we ask dbgeng, which also gets us the usual error if there is no
+            // such module.
             return new DbgModuleInfo( this, addrInModule, process );
         } // end GetModuleByAddress()
 
 
+        /// <summary>
+        ///    Gets symbol names for a batch of addresses (like TryGetNameByOffset does for
+        ///    one), in a single trip to the dbgeng thread. The offsets must be sorted
+        ///    (duplicates are fine). For offsets that could not be symbolized, the name
+        ///    is null.
+        /// </summary>
+        /// <remarks>
+        ///    Names for addresses in loaded modules are cached (per target, by module
+        ///    and RVA) until the module's symbols change, so symbolizing the same region
+        ///    of memory again does not need dbgeng at all.
+        /// </remarks>
+        public string[] TryGetNamesByOffsets( IReadOnlyList< ulong > sortedOffsets, out ulong[] displacements )
+        {
+            if( null == sortedOffsets )
+                throw new ArgumentNullException( "sortedOffsets" );
+
+            for( int i = 1; i < sortedOffsets.Count; i++ )
+            {
+                if( sortedOffsets[ i ] < sortedOffsets[ i - 1 ] )
+                    throw new ArgumentException( "The offsets must be sorted.", "sortedOffsets" );
+            }
+
+            var names = new string[ sortedOffsets.Count ];
+            var disps = new ulong[ sortedOffsets.Count ];
+            displacements = disps;
+            if( 0 == sortedOffsets.Count )
+                return names;
+
+            ExecuteOnDbgEngThread( () =>
+                {
+                    DbgTarget target = GetCurrentTargetInternal();
+                    WDebugSymbols ds = (WDebugSymbols) DebuggerInterface;
+
+                    for( int i = 0; i < sortedOffsets.Count; i++ )
+                    {
+                        ulong offset = sortedOffsets[ i ];
+                        if( (i > 0) && (offset == sortedOffsets[ i - 1 ]) )
+                        {
+                            names[ i ] = names[ i - 1 ];
+                            disps[ i ] = disps[ i - 1 ];
+                            continue;
+                        }
+
+                        // We only cache names for loaded modules: anything else (unloaded
+                        // modules, JIT'ed code, etc.) could change out from under us
+                        // without a symbol notification.
+                        DbgModuleInfo mod = null;
+                        if( null != target )
+                        {
+                            mod = target.TryFindModuleByAddress( offset );
+                            if( (null != mod) && mod.IsUnloaded )
+                                mod = null;
+                        }
+
+                        DbgTarget.SymbolNameEntry entry;
+                        uint rva = 0;
+                        if( null != mod )
+                        {
+                            rva = (uint) (offset - mod.BaseAddress);
+                            if( target.TryGetSymbolName( mod.BaseAddress, rva, out entry ) )
+                            {
+                                names[ i ] = entry.Name;
+                                disps[ i ] = entry.Displacement;
+                                continue;
+                            }
+                        }
+
+                        string name;
+                        ulong disp;
+                        int hr = ds.GetNameByOffsetWide( offset, out name, out disp );
+                        if( 0 != hr )
+                        {
+                            name = null;
+                            disp = 0xffffffffffffffff;
+                        }
+
+                        names[ i ] = name;
+                        disps[ i ] = disp;
+
+                        if( null != mod )
+                            target.AddSymbolName( mod.BaseAddress, rva, new DbgTarget.SymbolNameEntry( name, disp ) );
+                    }
+                } );
+
+            return names;
+        } // end TryGetNamesByOffsets()
+
+
         public IEnumerable< DbgModuleInfo > GetModuleByName( string moduleName )
         {
             return GetModuleByName( moduleName, DEBUG_GETMOD.NO_UNLOADED_MODULES );
@@ -2224,17 +2323,344 @@ Exception makeException( DbgProviderException inner = null )
                 } );
         } // end _CreateNtdllSymbolForAddress
 
+        private readonly MemoryPageCache m_memCache = new MemoryPageCache();
+
+        /// <summary>
+        ///    The size of the pages held by the target memory cache: 4K or 64K.
+        ///    Changing it empties the cache.
+        /// </summary>
+        public int MemoryCachePageSize
+        {
+            get { return m_memCache.PageSize; }
+            set { m_memCache.PageSize = value; }
+        }
+
+        /// <summary>
+        ///    The maximum number of bytes of target memory to cache. Setting it to 0
+        ///    effectively disables the cache.
+        /// </summary>
+        public long MemoryCacheBudget
+        {
+            get { return m_memCache.Budget; }
+            set { m_memCache.Budget = value; }
+        }
+
+        public void PurgeMemoryCache()
+        {
+            m_memCache.Clear();
+            DiscardMemCacheKey();
+        }
+
+
+        private sealed class MemCacheKey
+        {
+            public readonly uint SysIdx;
+            public readonly ulong ProcIdx;
+
+            public MemCacheKey( uint sysIdx, ulong procIdx )
+            {
+                SysIdx = sysIdx;
+                ProcIdx = procIdx;
+            }
+        } // end class MemCacheKey
+
+        // What _TryGetMemCacheKey last got from dbgeng, or null if it needs to ask
+        // again.
+        private volatile MemCacheKey m_memCacheKey;
+
+        /// <summary>
+        ///    Must be called whenever dbgeng's current system or process (or implicit
+        ///    process) might have changed.
+        /// </summary>
+        internal void DiscardMemCacheKey()
+        {
+            m_memCacheKey = null;
+        }
+
+        /// <summary>
+        ///    Gets the system and process that ReadVirtual will read from (dbgeng's
+        ///    current ones), to key the memory cache with. Returns false if there isn't
+        ///    one, in which case the cache should be bypassed. Must be called on the
+        ///    dbgeng thread.
+        /// </summary>
+        /// <remarks>
+        ///    N.B. This does not use m_cachedContext: the cached context can be partial
+        ///    (DEBUG_ANY_ID) or null (after ForceRebuildProcessTree), and things like
+        ///    DbgRegisterSnapshot switch threads around it. Instead the key is asked of
+        ///    dbgeng once and kept in m_memCacheKey until something that can change the
+        ///    current system or process calls DiscardMemCacheKey: SetCurrentDbgEngContext
+        ///    and the other setters here, ForceRebuildProcessTree, DbgRegisterSnapshot,
+        ///    and the ChangeEngineState callback (for commands like "|1s").
+        /// </remarks>
+        private bool _TryGetMemCacheKey( out uint sysIdx, out ulong procIdx )
+        {
+            MemCacheKey key = m_memCacheKey;
+            if( null == key )
+            {
+                key = _QueryMemCacheKey();
+                if( null == key )
+                {
+                    sysIdx = DEBUG_ANY_ID;
+                    procIdx = DEBUG_ANY_ID;
+                    return false;
+                }
+                m_memCacheKey = key;
+            }
+
+            sysIdx = key.SysIdx;
+            procIdx = key.ProcIdx;
+            return true;
+        } // end _TryGetMemCacheKey()
+
+
+        private MemCacheKey _QueryMemCacheKey()
+        {
+            uint sysIdx;
+            if( (0 != m_debugSystemObjects.GetCurrentSystemId( out sysIdx )) || (DEBUG_ANY_ID == sysIdx) )
+                return null;
+
+            DEBUG_CLASS targetClass;
+            DEBUG_CLASS_QUALIFIER qualifier;
+            if( 0 != m_debugControl.GetDebuggeeType( out targetClass, out qualifier ) )
+                return null;
+
+            if( DEBUG_CLASS.KERNEL == targetClass )
+            {
+                // User-mode addresses depend on the implicit process.
+                ulong procAddr;
+                if( 0 != m_debugSystemObjects.GetImplicitProcessDataOffset( out procAddr ) )
+                    return null;
+
+                return new MemCacheKey( sysIdx, procAddr );
+            }
+
+            uint procId;
+            if( (0 != m_debugSystemObjects.GetCurrentProcessId( out procId )) || (DEBUG_ANY_ID == procId) )
+                return null;
+
+            return new MemCacheKey( sysIdx, procId );
+        } // end _QueryMemCacheKey()
+
+
+        /// <summary>
+        ///    Has the same semantics as IDebugDataSpaces.ReadVirtual (including returning
+        ///    S_OK with fewer bytes than requested if we run into unreadable memory), but
+        ///    serves what it can from the page cache. Must be called on the dbgeng
+        ///    thread.
+        /// </summary>
+        private unsafe int _ReadVirtualCached( ulong address, uint length, byte* dest, out uint bytesRead )
+        {
+            uint pageSize = (uint) m_memCache.PageSize;
+
+            // Big reads would just churn the cache.
+            if( (0 == length) ||
+                (length > (pageSize * 16)) ||
+                (m_memCache.Budget < pageSize) ||
+                (address + length < address) ) // wraps
+            {
+                return m_debugDataSpaces.ReadVirtualDirect( address, length, dest, out bytesRead );
+            }
+
+            uint sysIdx;
+            ulong procIdx;
+            if( !_TryGetMemCacheKey( out sysIdx, out procIdx ) )
+            {
+                return m_debugDataSpaces.ReadVirtualDirect( address, length, dest, out bytesRead );
+            }
+
+            uint done = 0;
+            bytesRead = 0;
+
+            while( done < length )
+            {
+                ulong curAddr = address + done;
+                ulong pageAddr = m_memCache.GetPageAddress( curAddr );
+                uint offsetInPage = (uint) (curAddr - pageAddr);
+                uint cb = Math.Min( pageSize - offsetInPage, length - done );
+
+                byte[] page = m_memCache.TryGetPage( sysIdx, procIdx, pageAddr );
+                if( null == page )
+                {
+                    page = new byte[ pageSize ];
+                    uint pageBytesRead;
+                    int hr;
+                    fixed( byte* pPage = page )
+                    {
+                        hr = m_debugDataSpaces.ReadVirtualDirect( pageAddr, pageSize, pPage, out pageBytesRead );
+                    }
+
+                    if( (0 == hr) && (pageBytesRead == pageSize) )
+                    {
+                        m_memCache.AddPage( sysIdx, procIdx, () => IsLive, pageAddr, page );
+                    }
+                    else
+                    {
+                        // Part of this page is unreadable. Let dbgeng sort out exactly how
+                        // much of the rest of the request it can satisfy.
+                        uint tailBytesRead;
+                        hr = m_debugDataSpaces.ReadVirtualDirect( curAddr, length - done, dest + done, out tailBytesRead );
+                        if( 0 == done )
+                        {
+                            bytesRead = tailBytesRead;
+                            return hr;
+                        }
+
+                        bytesRead = done + ((0 == hr) ? tailBytesRead : 0);
+                        return 0;
+                    }
+                }
+
+                fixed( byte* pPage = page )
+                {
+                    Buffer.MemoryCopy( pPage + offsetInPage, dest + done, cb, cb );
+                }
+                done += cb;
+            } // end while( done < length )
+
+            bytesRead = done;
+            return 0;
+        } // end _ReadVirtualCached()
+
+
+        private const int c_MaxPrefetchBatchPages = 256;
+
+        /// <summary>
+        ///    Pulls the pages covering the specified range into the memory cache.
+        /// </summary>
+        internal void PrefetchMem( ulong address, uint length )
+        {
+            PrefetchMem( new ulong[] { address }, length );
+        }
+
+        /// <summary>
+        ///    Pulls the pages covering each (addresses[i], length) range into the memory
+        ///    cache, using batched reads for the pages that are not already there.
+        /// </summary>
+        /// <remarks>
+        ///    This is for walking pointer-linked structures (like STL tree and list
+        ///    nodes) a level at a time: prefetch all the nodes you know about, then read
+        ///    them the usual way, and they come out of the cache instead of costing a
+        ///    separate trip to dbgeng each.
+        ///
+        ///    Pages that cannot be read in full are just skipped (the real reads will
+        ///    report the error), and we never prefetch more than half of the cache
+        ///    budget, so that prefetching cannot evict everything else.
+        /// </remarks>
+        internal unsafe void PrefetchMem( IReadOnlyList< ulong > addresses, uint length )
+        {
+            if( null == addresses )
+                throw new ArgumentNullException( nameof( addresses ) );
+
+            if( (0 == length) || (0 == addresses.Count) )
+                return;
+
+            ExecuteOnDbgEngThread( () =>
+                {
+                    uint pageSize = (uint) m_memCache.PageSize;
+                    long maxPages = m_memCache.Budget / pageSize / 2;
+                    if( 0 == maxPages )
+                        return;
+
+                    uint sysIdx;
+                    ulong procIdx;
+                    if( !_TryGetMemCacheKey( out sysIdx, out procIdx ) )
+                        return;
+
+                    var seen = new HashSet< ulong >();
+                    var needed = new List< ulong >();
+                    foreach( ulong address in addresses )
+                    {
+                        if( address + length < address ) // wraps
+                            continue;
+
+                        ulong last = m_memCache.GetPageAddress( address + length - 1 );
+                        for( ulong pageAddr = m_memCache.GetPageAddress( address ); ; pageAddr += pageSize )
+                        {
+                            if( seen.Add( pageAddr ) && !m_memCache.ContainsPage( sysIdx, procIdx, pageAddr ) )
+                            {
+                                needed.Add( pageAddr );
+                                if( needed.Count >= maxPages )
+                                    break;
+                            }
+
+                            if( pageAddr == last )
+                                break;
+                        }
+
+                        if( needed.Count >= maxPages )
+                            break;
+                    } // end foreach( address )
+
+                    for( int start = 0; start < needed.Count; start += c_MaxPrefetchBatchPages )
+                    {
+                        int count = Math.Min( c_MaxPrefetchBatchPages, needed.Count - start );
+                        var offsets = new ulong[ count ];
+                        var lengths = new uint[ count ];
+                        var bytesRead = new uint[ count ];
+                        var results = new int[ count ];
+                        for( int i = 0; i < count; i++ )
+                        {
+                            offsets[ i ] = needed[ start + i ];
+                            lengths[ i ] = pageSize;
+                        }
+
+                        byte[] buf = new byte[ (long) count * pageSize ];
+                        fixed( byte* pBuf = buf )
+                        {
+                            m_debugDataSpaces.ReadVirtualBatch( offsets,
+                                                                lengths,
+                                                                pBuf,
+                                                                (uint) buf.Length,
+                                                                bytesRead,
+                                                                results );
+                        }
+
+                        for( int i = 0; i < count; i++ )
+                        {
+                            if( (0 != results[ i ]) || (bytesRead[ i ] != pageSize) )
+                                continue;
+
+                            byte[] page = new byte[ pageSize ];
+                            Buffer.BlockCopy( buf, (int) (i * pageSize), page, 0, (int) pageSize );
+                            m_memCache.AddPage( sysIdx, procIdx, () => IsLive, offsets[ i ], page );
+                        }
+                    } // end for( each batch )
+                } );
+        } // end PrefetchMem()
+
+
+        internal void InvalidateMemoryCache( ulong address, ulong length )
+        {
+            m_memCache.Invalidate( address, length );
+        }
+
+        internal void InvalidateMemoryCacheForLiveTargets()
+        {
+            m_memCache.InvalidateLive();
+        }
+
+
         public byte[] ReadMem( ulong address, uint lengthDesired )
         {
             return ReadMem( address, lengthDesired, true );
         }
 
-        public byte[] ReadMem( ulong address, uint lengthDesired, bool failIfReadSmaller )
+        public unsafe byte[] ReadMem( ulong address, uint lengthDesired, bool failIfReadSmaller )
         {
             return ExecuteOnDbgEngThread( () =>
                 {
-                    byte[] raw;
-                    _CheckMemoryReadHr( address, m_debugDataSpaces.ReadVirtual( address, lengthDesired, out raw ) );
+                    byte[] raw = new byte[ lengthDesired ];
+                    uint bytesRead;
+                    fixed( byte* pRaw = raw )
+                    {
+                        _CheckMemoryReadHr( address, _ReadVirtualCached( address, lengthDesired, pRaw, out bytesRead ) );
+                    }
+
+                    if( bytesRead != lengthDesired )
+                    {
+                        Array.Resize( ref raw, (int) bytesRead );
+                    }
+
                     if( raw.Length != lengthDesired )
                     {
                         string addrString = DbgProvider.FormatAddress( address, TargetIs32Bit, true );
@@ -2257,11 +2683,20 @@ public byte[] ReadMem( ulong address, uint lengthDesired, bool failIfReadSmaller
                 } );
         } // end ReadMem()
 
-        public T ReadMemAs< T >( ulong address ) where T : unmanaged
+        public unsafe T ReadMemAs< T >( ulong address ) where T : unmanaged
         {
             return ExecuteOnDbgEngThread( () =>
                 {
-                    _CheckMemoryReadHr( address, m_debugDataSpaces.ReadVirtualValue( address, out T tempValue ) );
+                    T tempValue;
+                    int hr = _ReadVirtualCached( address, (uint) sizeof( T ), (byte*) &tempValue, out uint bytesRead );
+
+                    // Since we are reading a single discrete value, treat under-read as failure.
+                    if( (0 == hr) && (bytesRead < sizeof( T )) )
+                    {
+                        hr = HR_ERROR_READ_FAULT;
+                    }
+
+                    _CheckMemoryReadHr( address, hr );
                     return tempValue;
                 } );
         }
@@ -2282,10 +2717,10 @@ public byte[] ReadMem( ulong address, uint lengthDesired, bool failIfReadSmaller
                     using( var memHandle = fillMe.Pin() )
                     {
                         _CheckMemoryReadHr( address,
-                                            m_debugDataSpaces.ReadVirtualDirect( address,
-                                                                                 lengthDesired,
-                                                                                 (byte*) memHandle.Pointer,
-                                                                                 out uint bytesRead ) );
+                                            _ReadVirtualCached( address,
+                                                                lengthDesired,
+                                                                (byte*) memHandle.Pointer,
+                                                                out uint bytesRead ) );
 
 
                         if( lengthDesired != bytesRead )
@@ -2340,6 +2775,7 @@ public unsafe void WriteMem( ulong address, byte* changes, uint cbChanges )
             ExecuteOnDbgEngThread( () =>
                 {
                     uint written = 0;
+                    m_memCache.Invalidate( address, cbChanges );
                     int hr = m_debugDataSpaces.WriteVirtual( address, changes, cbChanges, out written );
                     _HandleWriteMemError( hr, address, cbChanges, written );
                 } );
@@ -2364,19 +2800,70 @@ public unsafe void WriteMem( ulong address, byte* changes, uint cbChanges )
         } // end WriteMem()
 
 
-        public bool TryReadMem( ulong address, uint lengthDesired, bool failIfReadSmaller, out byte[] mem )
+        public unsafe bool TryReadMem( ulong address, uint lengthDesired, bool failIfReadSmaller, out byte[] mem )
         {
             byte[] tmpMem = null;
             var retval = ExecuteOnDbgEngThread( () =>
                 {
-                    int hr = m_debugDataSpaces.ReadVirtual( address, lengthDesired, out tmpMem );
-                    return _TryCheckMemoryReadHr( hr ) && (tmpMem.Length == lengthDesired || !failIfReadSmaller);
+                    byte[] raw = new byte[ lengthDesired ];
+                    uint bytesRead;
+                    int hr;
+                    fixed( byte* pRaw = raw )
+                    {
+                        hr = _ReadVirtualCached( address, lengthDesired, pRaw, out bytesRead );
+                    }
+
+                    if( !_TryCheckMemoryReadHr( hr ) )
+                        return false;
+
+                    if( bytesRead != lengthDesired )
+                    {
+                        Array.Resize( ref raw, (int) bytesRead );
+                    }
+
+                    tmpMem = raw;
+                    return (bytesRead == lengthDesired) || !failIfReadSmaller;
                 } );
             mem = tmpMem;
             return retval;
         } // end TryReadMem()
 
 
+        /// <summary>
+        ///    Reads a batch of (address, length) ranges from the target's memory in one
+        ///    trip to the dbgeng thread. The data for each range is packed into fillMe
+        ///    back-to-back, in order. The HRESULT and number of bytes read for each range
+        ///    are returned in results and bytesRead, so a bad range does not stop the
+        ///    batch. Returns true if every range was read in full.
+        /// </summary>
+        public unsafe bool TryReadMemBatch( ulong[] addresses,
+                                            uint[] lengths,
+                                            Memory< byte > fillMe,
+                                            uint[] bytesRead,
+                                            int[] results )
+        {
+            if( null == addresses )
+                throw new ArgumentNullException( nameof( addresses ) );
+
+            if( null == lengths )
+                throw new ArgumentNullException( nameof( lengths ) );
+
+            return ExecuteOnDbgEngThread( () =>
+                {
+                    using( var memHandle = fillMe.Pin() )
+                    {
+                        int hr = m_debugDataSpaces.ReadVirtualBatch( addresses,
+                                                                     lengths,
+                                                                     (byte*) memHandle.Pointer,
+                                                                     (uint) fillMe.Length,
+                                                                     bytesRead,
+                                                                     results );
+                        return 0 == hr;
+                    }
+                } );
+        } // end TryReadMemBatch()
+
+
         private void _CheckMemoryReadHr( ulong address, int hr )
         {
             // Seems odd that we could get E_NOINTERFACE from ReadVirtual... but it can
@@ -3823,12 +4310,16 @@ public IEnumerable<DbgNamedTypeInfo> GetTypeInfoByName( string pattern )
         } // end _GetTypeInfoByName()
 
 
-        internal string _TryGetImplementingTypeNameFromVTableAddr( ulong vtableAddr,
+        /// <summary>
+        ///    Reads the vtable pointer at vtableAddr, and gets the name of the type that
+        ///    the vtable belongs to (from the vtable's symbolic name). Results are cached
+        ///    per target (if a target is supplied).
+        /// </summary>
+        internal string _TryGetImplementingTypeNameFromVTableAddr( DbgTarget target,
+                                                                   ulong vtableAddr,
                                                                    out ulong firstSlotAddr )
         {
             firstSlotAddr = 0;
-            ulong disp;
-            string vtableSymName;
 
             if( !TryReadMemAs_pointer( vtableAddr, out firstSlotAddr ) )
             {
@@ -3838,6 +4329,28 @@ public IEnumerable<DbgNamedTypeInfo> GetTypeInfoByName( string pattern )
                 return null;
             }
 
+            if( null == target )
+                return _TryGetImplementingTypeNameFromVTable( firstSlotAddr );
+
+            DbgTarget.VTableTypeEntry entry;
+            if( target.TryGetVTableType( firstSlotAddr, out entry ) )
+            {
+                DbgTypeInfo._CountVTableCacheLookup( true );
+                return entry.ImplementingTypeName;
+            }
+
+            DbgTypeInfo._CountVTableCacheLookup( false );
+            string implementingTypeName = _TryGetImplementingTypeNameFromVTable( firstSlotAddr );
+            target.AddVTableType( firstSlotAddr, implementingTypeName );
+            return implementingTypeName;
+        } // end _TryGetImplementingTypeNameFromVTableAddr()
+
+
+        private string _TryGetImplementingTypeNameFromVTable( ulong firstSlotAddr )
+        {
+            ulong disp;
+            string vtableSymName;
+
             if( !TryGetNameByOffset( firstSlotAddr, out vtableSymName, out disp ) )
             {
                 LogManager.Trace( "Warning: failed getting symbolic name ({0}). Probably bad data.",
@@ -3860,7 +4373,7 @@ public IEnumerable<DbgNamedTypeInfo> GetTypeInfoByName( string pattern )
 
             string implementingTypeName = vtableSymName.Substring( 0, vtableSymName.Length - vftableSuffix.Length );
             return implementingTypeName;
-        } // end _TryGetImplementingTypeNameFromVTableAddr()
+        } // end _TryGetImplementingTypeNameFromVTable()
 
 
         /// <summary>
@@ -3891,12 +4404,41 @@ internal DbgUdtTypeInfo _TryGetUdtForTypeNameExact( string implementingTypeName
         } // end _TryGetUdtForTypeNameExact()
 
 
+        /// <summary>
+        ///    Like _TryGetUdtForTypeNameExact, but uses (and fills in) the target's
+        ///    vtable -> type cache. The implementingTypeName should have come from
+        ///    _TryGetImplementingTypeNameFromVTableAddr, for the same target and vtable.
+        /// </summary>
+        internal DbgUdtTypeInfo _TryGetUdtForVTable( DbgTarget target,
+                                                     ulong firstSlotAddr,
+                                                     string implementingTypeName )
+        {
+            DbgTarget.VTableTypeEntry entry = null;
+            if( (null != target) && target.TryGetVTableType( firstSlotAddr, out entry ) )
+            {
+                if( entry.UdtResolved )
+                    return entry.Udt;
+            }
+
+            var udt = _TryGetUdtForTypeNameExact( implementingTypeName );
+
+            // (If the entry is gone, the cache got flushed in the meantime, and the
+            // result may already be stale; don't put it back.)
+            if( null != entry )
+                entry.SetUdt( udt );
+
+            return udt;
+        } // end _TryGetUdtForVTable()
+
+
         public DbgUdtTypeInfo TryGuessTypeForAddress( ulong addr )
         {
             DbgUdtTypeInfo udt = null;
 
+            DbgTarget target = GetCurrentTarget();
             ulong firstSlotPtr;
-            string implementingTypeName = _TryGetImplementingTypeNameFromVTableAddr( addr, // hopefully the vtable is at offset 0
+            string implementingTypeName = _TryGetImplementingTypeNameFromVTableAddr( target,
+                                                                                     addr, // hopefully the vtable is at offset 0
                                                                                      out firstSlotPtr );
 
             if( !String.IsNullOrEmpty( implementingTypeName ) )
@@ -3905,7 +4447,7 @@ public DbgUdtTypeInfo TryGuessTypeForAddress( ulong addr )
                                   Util.FormatHalfOrFullQWord( addr ),
                                   implementingTypeName );
 
-                udt = _TryGetUdtForTypeNameExact( implementingTypeName );
+                udt = _TryGetUdtForVTable( target, firstSlotPtr, implementingTypeName );
 
                 if( null == udt )
                 {
@@ -4145,6 +4687,191 @@ public string Disassemble( ulong address, out ulong endAddress )
         } // end Disassemble()
 
 
+        // The most instructions we disassemble in one trip to native code.
+        private const int c_MaxDisassemblyBatch = 512;
+
+        /// <summary>
+        ///    Disassembles consecutive instructions, starting at address, until there
+        ///    are maxInstructions of them, or the next one would start after
+        ///    lastAddress. Stops early (without an error) at the first instruction that
+        ///    can't be disassembled (like when there is no code there). nextAddress is
+        ///    the address after the last instruction returned.
+        /// </summary>
+        /// <remarks>
+        ///    Instructions are disassembled in batches, one trip to native code per
+        ///    batch. For dumps, instructions in loaded modules are cached per target (by
+        ///    module and RVA), so disassembling the same code again does not need dbgeng
+        ///    at all.
+        ///
+        ///    The returned instructions do not have a BlockId.
+        /// </remarks>
+        internal IReadOnlyList< DbgDisassembly > DisassembleRange( ulong address,
+                                                                   ulong lastAddress,
+                                                                   int maxInstructions,
+                                                                   out ulong nextAddress )
+        {
+            var instructions = new List< DbgDisassembly >();
+            ulong cur = address;
+            ExecuteOnDbgEngThread( () =>
+                {
+                    DEBUG_ASMOPT options;
+                    CheckHr( m_debugControl.GetAssemblyOptions( out options ) );
+                    bool hasCodeBytes = !options.HasFlag( DEBUG_ASMOPT.NO_CODE_BYTES );
+
+                    DbgTarget target = GetCurrentTargetInternal();
+                    if( (null != target) && !target.DisassemblyCacheEnabled )
+                        target = null;
+
+                    if( null != target )
+                        _CheckDisassemblyCacheKey( target, options );
+
+                    while( (instructions.Count < maxInstructions) && (cur <= lastAddress) )
+                    {
+                        DbgDisassembly instr;
+                        DbgModuleInfo mod = _TryGetModuleForDisassemblyCache( target, cur );
+                        if( (null != mod) &&
+                            target.TryGetDisassembly( mod.BaseAddress, (uint) (cur - mod.BaseAddress), out instr ) )
+                        {
+                            instructions.Add( instr );
+                            cur += (ulong) instr.Length;
+                            continue;
+                        }
+
+                        WDisassembledInstruction[] batch;
+                        int hr = m_debugControl.DisassembleRange( cur,
+                                                                  lastAddress,
+                                                                  (uint) Math.Min( maxInstructions - instructions.Count,
+                                                                                   c_MaxDisassemblyBatch ),
+                                                                  (DEBUG_DISASM) 0,
+                                                                  out batch );
+                        if( 0 != hr )
+                        {
+                            LogManager.Trace( "DisassembleRange: the batch starting at {0} stopped early: {1}",
+                                              Util.FormatHalfOrFullQWord( cur ),
+                                              Util.FormatErrorCode( hr ) );
+                        }
+
+                        bool stop = (0 != hr) || (0 == batch.Length);
+                        foreach( var wdi in batch )
+                        {
+                            try
+                            {
+                                instr = Commands.ReadDbgDisassemblyCommand._ParseDisassembly( wdi.Offset,
+                                                                                              wdi.Disassembly.Trim(),
+                                                                                              null,
+                                                                                              hasCodeBytes,
+                                                                                              (int) wdi.Length,
+                                                                                              wdi.CodeBytes );
+                            }
+                            catch( DbgMemoryAccessException )
+                            {
+                                // No code here. The caller decides what to do about that.
+                                stop = true;
+                                break;
+                            }
+
+                            instructions.Add( instr );
+                            cur = wdi.Offset + wdi.Length;
+
+                            mod = _TryGetModuleForDisassemblyCache( target, wdi.Offset );
+                            if( (null != mod) && (0 != wdi.Length) && (null != wdi.CodeBytes) )
+                                target.AddDisassembly( mod.BaseAddress, (uint) (wdi.Offset - mod.BaseAddress), instr );
+                        }
+
+                        if( stop )
+                            break;
+                    } // end while( more instructions )
+                } );
+
+            nextAddress = cur;
+            return instructions;
+        } // end DisassembleRange()
+
+
+        private static DbgModuleInfo _TryGetModuleForDisassemblyCache( DbgTarget target, ulong address )
+        {
+            if( null == target )
+                return null;
+
+            // Only loaded modules: an unloaded module's address range could have
+            // something else in it now.
+            DbgModuleInfo mod = target.TryFindModuleByAddress( address );
+            if( (null != mod) && mod.IsUnloaded )
+                mod = null;
+
+            return mod;
+        } // end _TryGetModuleForDisassemblyCache()
+
+
+        /// <summary>
+        ///    Gets the cached whole-function disassembly for the specified address, if
+        ///    there is one (see CacheWholeFunctionDisassembly).
+        /// </summary>
+        internal DbgDisassembly[] TryGetCachedWholeFunctionDisassembly( ulong address )
+        {
+            return ExecuteOnDbgEngThread( () =>
+                {
+                    DbgTarget target = _GetTargetForWholeFunctionCache();
+                    DbgModuleInfo mod = _TryGetModuleForDisassemblyCache( target, address );
+                    DbgDisassembly[] instructions = null;
+                    if( null != mod )
+                    {
+                        target.TryGetWholeFunctionDisassembly( mod.BaseAddress,
+                                                               (uint) (address - mod.BaseAddress),
+                                                               out instructions );
+                    }
+                    return instructions;
+                } );
+        } // end TryGetCachedWholeFunctionDisassembly()
+
+
+        /// <summary>
+        ///    Caches the whole-function disassembly for the specified address, if the
+        ///    current target supports caching disassembly (see DisassembleRange), and
+        ///    the address is in a loaded module.
+        /// </summary>
+        internal void CacheWholeFunctionDisassembly( ulong address, DbgDisassembly[] instructions )
+        {
+            if( null == instructions )
+                throw new ArgumentNullException( "instructions" );
+
+            ExecuteOnDbgEngThread( () =>
+                {
+                    DbgTarget target = _GetTargetForWholeFunctionCache();
+                    DbgModuleInfo mod = _TryGetModuleForDisassemblyCache( target, address );
+                    if( null != mod )
+                    {
+                        target.AddWholeFunctionDisassembly( mod.BaseAddress,
+                                                            (uint) (address - mod.BaseAddress),
+                                                            instructions );
+                    }
+                } );
+        } // end CacheWholeFunctionDisassembly()
+
+
+        // N.B. Must be called on the dbgeng thread.
+        private DbgTarget _GetTargetForWholeFunctionCache()
+        {
+            DbgTarget target = GetCurrentTargetInternal();
+            if( (null == target) || !target.DisassemblyCacheEnabled )
+                return null;
+
+            DEBUG_ASMOPT options;
+            CheckHr( m_debugControl.GetAssemblyOptions( out options ) );
+            _CheckDisassemblyCacheKey( target, options );
+            return target;
+        } // end _GetTargetForWholeFunctionCache()
+
+
+        // N.B. Must be called on the dbgeng thread.
+        private void _CheckDisassemblyCacheKey( DbgTarget target, DEBUG_ASMOPT options )
+        {
+            IMAGE_FILE_MACHINE effmach;
+            CheckHr( m_debugControl.GetEffectiveProcessorType( out effmach ) );
+            target.CheckDisassemblyOptions( (DbgAssemblyOptions) options, effmach );
+        } // end _CheckDisassemblyCacheKey()
+
+
         public ulong GetNearInstruction( ulong address, int delta )
         {
             ulong nearAddress = 0;
@@ -4199,6 +4926,7 @@ public void SetCurrentDbgEngSystemId( uint sysId )
         {
             ExecuteOnDbgEngThread( () =>
                 {
+                    DiscardMemCacheKey();
                     CheckHr( m_debugSystemObjects.SetCurrentSystemId( sysId ) );
                 } );
         } // end GetCurrentDbgEngSystemId()
@@ -4226,6 +4954,7 @@ public void SetCurrentProcessId( uint dbgEngId )
         {
             ExecuteOnDbgEngThread( () =>
                 {
+                    DiscardMemCacheKey();
                     CheckHr( m_debugSystemObjects.SetCurrentProcessId( dbgEngId ) );
                 } );
         }
@@ -4383,6 +5112,8 @@ public void SetCurrentDbgEngContext( DbgEngContext context, bool temporary, bool
 
             ExecuteOnDbgEngThread( () =>
                 {
+                    DiscardMemCacheKey();
+
                     bool noException = false;
                     uint sId = m_cachedContext.SystemIndex;
                     ulong pIdOrAddr = m_cachedContext.ProcessIndexOrAddress;
@@ -5021,6 +5752,7 @@ internal TargetType GetCurrentTargetTypes()
         public void ForceRebuildProcessTree()
         {
             m_cachedContext = null;
+            DiscardMemCacheKey();
             m_sysTree = null;
 
             // We need to hold on to the DbgTarget objects, as they contain important
@@ -5116,6 +5848,7 @@ public void UpdateNamespace()
                 {
                     bool removed = m_targets.Remove( target.Context );
                     Util.Assert( removed );
+                    target.DiscardClrHeapIndexes();
                     if( !String.IsNullOrEmpty( target.TargetFriendlyName ) )
                         m_usedTargetNames.Remove( target.TargetFriendlyName );
                 }
@@ -5178,6 +5911,7 @@ public void UpdateNamespace()
                 {
                     bool removed = m_targets.Remove( target.Context );
                     Util.Assert( removed );
+                    target.DiscardClrHeapIndexes();
                     if( !String.IsNullOrEmpty( target.TargetFriendlyName ) )
                         m_usedTargetNames.Remove( target.TargetFriendlyName );
                 }
@@ -6063,6 +6797,7 @@ public void SetImplicitProcessDataOffset( ulong process )
         {
             ExecuteOnDbgEngThread( () =>
                 {
+                    DiscardMemCacheKey();
                     CheckHr( m_debugSystemObjects.SetImplicitProcessDataOffset( process ) );
                 } );
         }
@@ -1,5 +1,5 @@
 ﻿using System;
-using System.Collections.Concurrent;
+using System.Runtime.ExceptionServices;
 using System.Threading;
 using System.Threading.Tasks;
 
@@ -31,16 +31,19 @@ private static DbgEngThread _ProcureDbgEngThread()
 
 
             private object m_syncRoot = new object();
-            private bool m_disposed;
+            private volatile bool m_disposed;
             private Thread m_dbgEngThread;
             private bool _IsOnPipelineThread { get { return Thread.CurrentThread == m_dbgEngThread; } }
             // This queue is used by other threads to queue actions that need to be run on the
-            // dbgeng thread.
-            private BlockingCollection< Action > m_q = new BlockingCollection< Action >();
+            // dbgeng thread. Every cross-thread call goes through it, so it is lock-free,
+            // and the dbgeng thread drains whatever has piled up in one batch.
+            private MpscActionQueue m_q = new MpscActionQueue();
+            private readonly Action< Action > m_runQueuedAction;
 
 
             private DbgEngThread()
             {
+                m_runQueuedAction = _RunQueuedAction;
                 // TODO: Do we need to set the apartment state?
                 m_dbgEngThread = new Thread( _ThreadProcProcessActions );
                 m_dbgEngThread.IsBackground = true;
@@ -52,6 +55,7 @@ private DbgEngThread()
             // For "guest mode".
             private DbgEngThread( Thread existingThread )
             {
+                m_runQueuedAction = _RunQueuedAction;
                 m_dbgEngThread = existingThread;
                 if( String.IsNullOrEmpty( m_dbgEngThread.Name ) )
                     m_dbgEngThread.Name = "Dedicated DbgEng Thread (host-supplied)";
@@ -67,7 +71,7 @@ internal void ResetQ()
                 Util.Assert( m_q.IsCompleted );
 
                 m_q.Dispose();
-                m_q = new BlockingCollection< Action >();
+                m_q = new MpscActionQueue();
 
                 // Maybe this isn't a program invariant... but I'm not expecting windbg to
                 // switch threads on me.
@@ -137,14 +141,102 @@ public Task ExecuteAsync( Action a )
 
             public TRet Execute< TRet >( Func< TRet > f )
             {
-                return Util.Await( ExecuteAsync( f ) );
+                // (QueueAction would run it inline anyway.)
+                if( _IsOnPipelineThread )
+                    return f();
+
+                return SyncCall< TRet >.Execute( this, f, null );
             }
 
             public void Execute( Action a )
             {
-                Util.Await( ExecuteAsync( a ) );
+                if( _IsOnPipelineThread )
+                {
+                    a();
+                    return;
+                }
+
+                SyncCall< object >.Execute( this, null, a );
             }
 
+
+            /// <summary>
+            ///    The completion object for a synchronous cross-thread call. Each thread
+            ///    keeps one around (per return type) for reuse, so a synchronous Execute
+            ///    does not need a Task, a TaskCompletionSource, or a closure.
+            /// </summary>
+            private sealed class SyncCall< TRet >
+            {
+                [ThreadStatic]
+                private static SyncCall< TRet > t_cached;
+
+                private readonly ManualResetEventSlim m_done = new ManualResetEventSlim();
+                private readonly Action m_run;
+                private Func< TRet > m_func;
+                private Action m_action;
+                private TRet m_result;
+                private ExceptionDispatchInfo m_error;
+
+                private SyncCall()
+                {
+                    m_run = _Run;
+                }
+
+                private void _Run()
+                {
+                    try
+                    {
+                        if( null != m_func )
+                            m_result = m_func();
+                        else
+                            m_action();
+                    }
+                    catch( Exception e )
+                    {
+                        m_error = ExceptionDispatchInfo.Capture( e );
+                    }
+                    finally
+                    {
+                        m_done.Set();
+                    }
+                } // end _Run()
+
+                public static TRet Execute( DbgEngThread thread, Func< TRet > func, Action action )
+                {
+                    // If this is a nested call on this thread (Wait can pump messages on an
+                    // STA thread), the cached object is in use, and we just make a new one.
+                    SyncCall< TRet > call = t_cached ?? new SyncCall< TRet >();
+                    t_cached = null;
+
+                    call.m_func = func;
+                    call.m_action = action;
+                    try
+                    {
+                        thread.QueueAction( call.m_run );
+                        call.m_done.Wait();
+
+                        if( null != call.m_error )
+                            call.m_error.Throw();
+
+                        return call.m_result;
+                    }
+                    finally
+                    {
+                        // If the call never ran (or is somehow still running), it can't
+                        // be reused.
+                        if( call.m_done.IsSet )
+                        {
+                            call.m_func = null;
+                            call.m_action = null;
+                            call.m_result = default( TRet );
+                            call.m_error = null;
+                            call.m_done.Reset();
+                            t_cached = call;
+                        }
+                    }
+                } // end Execute()
+            } // end class SyncCall
+
             private static void _CrashOnException( Action action )
             {
                 try
@@ -168,16 +260,18 @@ public void SignalDone()
             private void _ThreadProcProcessActions()
             {
                 //Console.WriteLine( "DbgEngThread apartment state: {0}", Thread.CurrentThread.GetApartmentState() );
-                foreach( Action action in m_q.GetConsumingEnumerable() )
+                while( !m_disposed && m_q.DrainTo( m_runQueuedAction ) )
                 {
-                    lock( m_syncRoot )
-                    {
-                        if( m_disposed )
-                            return;
-                    }
-                    _CrashOnException( action );
                 }
             } // end _ThreadProcProcessActions()
+
+            private void _RunQueuedAction( Action action )
+            {
+                if( m_disposed )
+                    return;
+
+                _CrashOnException( action );
+            } // end _RunQueuedAction()
         } // end class DbgEngThread
     } // end class DbgEngDebugger
 }
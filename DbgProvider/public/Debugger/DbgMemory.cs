@@ -46,6 +46,10 @@ public class DbgMemory : ISupportColor, ICloneable
         private bool m_is32Bit;
         private Func< ulong, ColorString > m_lookupSymbol;
 
+        // If we were given a debugger (instead of a symbol lookup function), we can
+        // look up all the symbols for a display at once.
+        private DbgEngDebugger m_debugger;
+
         public readonly ulong StartAddress;
 
         public uint Length { get { return (uint) m_bytes.Length; } }
@@ -71,7 +75,7 @@ public DbgMemory( byte[] bytes, DbgEngDebugger debugger )
                           byte[] bytes,
                           bool is32bit,
                           DbgEngDebugger debugger )
-            : this( address, bytes, is32bit, false, (x) => _DefaultSymLookup( debugger, x ) )
+            : this( address, bytes, is32bit, false, debugger )
         {
         }
 
@@ -83,6 +87,7 @@ public DbgMemory( byte[] bytes, DbgEngDebugger debugger )
                           DbgEngDebugger debugger )
             : this( address, bytes, is32bit, isBigEndian, (x) => _DefaultSymLookup( debugger, x ) )
         {
+            m_debugger = debugger;
         }
 
         public DbgMemory( ulong address,
@@ -526,6 +531,12 @@ private static ColorString _ZeroPad( ulong val, int desiredLen )
                 numColumns = 1;
             }
 
+            Func< ulong, ColorString > lookupSymbol = m_lookupSymbol;
+            if( addtlInfo.HasFlag( AddtlInfo.Symbols ) && (null != m_debugger) )
+            {
+                lookupSymbol = _BatchSymLookup();
+            }
+
             int desiredLen = elemSize * 2;
             ColorString cs = new ColorString();
             StringBuilder sbChars = new StringBuilder( 20 );
@@ -574,7 +585,7 @@ private static ColorString _ZeroPad( ulong val, int desiredLen )
                     ColorString csSym = ColorString.Empty;
                     if( val > 4096 ) // don't even bother trying if it's too low.
                     {
-                        csSym = m_lookupSymbol( val );
+                        csSym = lookupSymbol( val );
                         if( csSym.Length > 0 )
                             cs.Append( " " ).Append( csSym );
                     }
@@ -713,19 +724,64 @@ private static ColorString _DefaultSymLookup( DbgEngDebugger debugger, ulong add
             string symName;
             if( debugger.TryGetNameByOffset( addr, out symName, out disp ) )
             {
-                ColorString cs = DbgProvider.ColorizeSymbol( symName );
-                if( disp != 0 )
-                    cs.AppendPushPopFg( ConsoleColor.Gray, "+" + disp.ToString( "x" ) );
-
-                return cs;
+                return _FormatSymbol( symName, disp );
             }
             return ColorString.Empty;
         } // end _DefaultSymLookup()
 
 
+        private static ColorString _FormatSymbol( string symName, ulong disp )
+        {
+            ColorString cs = DbgProvider.ColorizeSymbol( symName );
+            if( disp != 0 )
+                cs.AppendPushPopFg( ConsoleColor.Gray, "+" + disp.ToString( "x" ) );
+
+            return cs;
+        } // end _FormatSymbol()
+
+
+        /// <summary>
+        ///    Looks up symbols for all the pointers in this memory in one batch (instead
+        ///    of a trip to the dbgeng thread for each one), and returns a lookup function
+        ///    that just hands out the results.
+        /// </summary>
+        private Func< ulong, ColorString > _BatchSymLookup()
+        {
+            var vals = new List< ulong >( Count );
+            for( int idx = 0; idx < Count; idx++ )
+            {
+                ulong val = (ulong) this[ idx ];
+                if( val > 4096 ) // same cutoff as _FormatBlocks
+                    vals.Add( val );
+            }
+
+            vals.Sort();
+
+            ulong[] disps;
+            string[] names = m_debugger.TryGetNamesByOffsets( vals, out disps );
+
+            var symbols = new Dictionary< ulong, ColorString >( vals.Count );
+            for( int i = 0; i < vals.Count; i++ )
+            {
+                if( (null != names[ i ]) && !symbols.ContainsKey( vals[ i ] ) )
+                    symbols.Add( vals[ i ], _FormatSymbol( names[ i ], disps[ i ] ).MakeReadOnly() );
+            }
+
+            return ( x ) =>
+            {
+                ColorString cs;
+                if( symbols.TryGetValue( x, out cs ) )
+                    return cs;
+
+                return ColorString.Empty;
+            };
+        } // end _BatchSymLookup()
+
+
         public object Clone()
         {
             var clone = new DbgMemory( StartAddress, m_bytes, m_is32Bit, IsBigEndian, m_lookupSymbol );
+            clone.m_debugger = m_debugger;
             clone.DefaultDisplayFormat = DefaultDisplayFormat;
             clone.DefaultDisplayColumns = DefaultDisplayColumns;
             return clone;
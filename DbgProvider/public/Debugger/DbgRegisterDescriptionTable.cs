@@ -0,0 +1,197 @@
+using System;
+using System.Collections.Generic;
+using Microsoft.Diagnostics.Runtime.Interop;
+using DbgEngWrapper;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    The names and descriptions of dbgeng's registers for a particular (effective)
+    ///    processor type, by dbgeng register index.
+    /// </summary>
+    /// <remarks>
+    ///    These are fixed for a processor type, so they are fetched from dbgeng once
+    ///    and kept (as CvRegMap does for its maps), instead of calling
+    ///    GetDescriptionWide for every register every time we look at a register set.
+    ///    The number of registers can differ between targets of the same processor type
+    ///    (it depends on which extended register sets the processor has), so tables are
+    ///    keyed by processor type and register count.
+    ///
+    ///    N.B. Tables are built and looked up on the dbgeng thread.
+    /// </remarks>
+    internal sealed class DbgRegisterDescriptionTable
+    {
+        public readonly IMAGE_FILE_MACHINE Machine;
+
+        private readonly string[] m_names;
+        private readonly DEBUG_REGISTER_DESCRIPTION[] m_descriptions;
+        private readonly Dictionary< string, uint > m_indexByName;
+        private readonly uint[] m_generalPurpose;
+
+
+        public int Count { get { return m_names.Length; } }
+
+
+        /// <summary>
+        ///    The dbgeng indexes of the general-purpose registers (including the
+        ///    instruction pointer, flags and segment registers, where there are such
+        ///    things), in the usual display order.
+        /// </summary>
+        public IReadOnlyList< uint > GeneralPurposeRegisters { get { return m_generalPurpose; } }
+
+
+        public string GetName( uint index )
+        {
+            return m_names[ index ];
+        }
+
+        public DEBUG_REGISTER_DESCRIPTION GetDescription( uint index )
+        {
+            return m_descriptions[ index ];
+        }
+
+        public bool TryGetIndex( string name, out uint index )
+        {
+            return m_indexByName.TryGetValue( name, out index );
+        }
+
+
+        private DbgRegisterDescriptionTable( IMAGE_FILE_MACHINE machine,
+                                             string[] names,
+                                             DEBUG_REGISTER_DESCRIPTION[] descriptions )
+        {
+            Machine = machine;
+            m_names = names;
+            m_descriptions = descriptions;
+
+            m_indexByName = new Dictionary< string, uint >( names.Length, StringComparer.OrdinalIgnoreCase );
+            for( uint i = 0; i < names.Length; i++ )
+            {
+                // (First one wins, if dbgeng ever gives us a duplicate.)
+                if( !m_indexByName.ContainsKey( names[ i ] ) )
+                    m_indexByName.Add( names[ i ], i );
+            }
+
+            m_generalPurpose = _FindGeneralPurposeRegisters();
+        } // end constructor
+
+
+        private uint[] _FindGeneralPurposeRegisters()
+        {
+            var indexes = new List< uint >();
+            string[] gpNames;
+            if( s_GeneralPurposeNames.TryGetValue( Machine, out gpNames ) )
+            {
+                foreach( string name in gpNames )
+                {
+                    uint idx;
+                    if( m_indexByName.TryGetValue( name, out idx ) )
+                        indexes.Add( idx );
+                }
+            }
+            else
+            {
+                // Don't know this one; take all the full-sized integer registers.
+                for( uint i = 0; i < m_descriptions.Length; i++ )
+                {
+                    if( (0 == (m_descriptions[ i ].Flags & DEBUG_REGISTER.SUB_REGISTER)) &&
+                        ((DEBUG_VALUE_TYPE.INT32 == m_descriptions[ i ].Type) ||
+                         (DEBUG_VALUE_TYPE.INT64 == m_descriptions[ i ].Type)) )
+                    {
+                        indexes.Add( i );
+                    }
+                }
+            }
+            return indexes.ToArray();
+        } // end _FindGeneralPurposeRegisters()
+
+
+        /// <summary>
+        ///    Gets the table for the current effective processor type, building it if
+        ///    necessary. Must be called on the dbgeng thread.
+        /// </summary>
+        public static DbgRegisterDescriptionTable GetCurrent( WDebugControl debugControl,
+                                                              WDebugRegisters debugRegisters )
+        {
+            IMAGE_FILE_MACHINE machine;
+            _CheckHr( debugControl.GetEffectiveProcessorType( out machine ) );
+
+            uint numRegs;
+            _CheckHr( debugRegisters.GetNumberRegisters( out numRegs ) );
+
+            var key = new KeyValuePair< IMAGE_FILE_MACHINE, uint >( machine, numRegs );
+            DbgRegisterDescriptionTable table;
+            if( !s_Tables.TryGetValue( key, out table ) )
+            {
+                table = _Build( debugRegisters, machine, numRegs );
+                s_Tables.Add( key, table );
+            }
+            return table;
+        } // end GetCurrent()
+
+
+        private static DbgRegisterDescriptionTable _Build( WDebugRegisters debugRegisters,
+                                                           IMAGE_FILE_MACHINE machine,
+                                                           uint numRegs )
+        {
+            LogManager.Trace( "Building register description table for {0} ({1} registers).",
+                              machine,
+                              numRegs );
+
+            var names = new string[ numRegs ];
+            var descriptions = new DEBUG_REGISTER_DESCRIPTION[ numRegs ];
+
+            // INT460e158e: dbgeng gives us "xmm7/3" again in place of "xmm8/3".
+            bool sawXmm73Already = false;
+            for( uint i = 0; i < numRegs; i++ )
+            {
+                string name;
+                _CheckHr( debugRegisters.GetDescriptionWide( i, out name, out descriptions[ i ] ) );
+                if( 0 == Util.Strcmp_OI( "xmm7/3", name ) )
+                {
+                    if( !sawXmm73Already )
+                    {
+                        sawXmm73Already = true;
+                    }
+                    else
+                    {
+                        // INT460e158e: dbgeng meant to say "xmm8/3".
+                        name = "xmm8/3";
+                    }
+                }
+                names[ i ] = name;
+            }
+
+            return new DbgRegisterDescriptionTable( machine, names, descriptions );
+        } // end _Build()
+
+
+        private static void _CheckHr( int hr )
+        {
+            if( hr < 0 )
+                throw new DbgEngException( hr );
+        }
+
+
+        private static Dictionary< KeyValuePair< IMAGE_FILE_MACHINE, uint >, DbgRegisterDescriptionTable > s_Tables
+            = new Dictionary< KeyValuePair< IMAGE_FILE_MACHINE, uint >, DbgRegisterDescriptionTable >();
+
+
+        private static IReadOnlyDictionary< IMAGE_FILE_MACHINE, string[] > s_GeneralPurposeNames
+            = new Dictionary< IMAGE_FILE_MACHINE, string[] >()
+        {
+            { IMAGE_FILE_MACHINE.AMD64, new string[] { "rax", "rbx", "rcx", "rdx", "rsi", "rdi",
+                                                       "rip", "rsp", "rbp",
+                                                       "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+                                                       "efl", "cs", "ss", "ds", "es", "fs", "gs" } },
+
+            { IMAGE_FILE_MACHINE.I386, new string[] { "eax", "ebx", "ecx", "edx", "esi", "edi",
+                                                      "eip", "esp", "ebp",
+                                                      "efl", "cs", "ss", "ds", "es", "fs", "gs" } },
+
+            { IMAGE_FILE_MACHINE.THUMB2, new string[] { "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7",
+                                                        "r8", "r9", "r10", "r11", "r12",
+                                                        "sp", "lr", "pc", "cpsr" } },
+        };
+    } // end class DbgRegisterDescriptionTable
+}
@@ -290,19 +290,21 @@ public override object Value
             return debugger.ExecuteOnDbgEngThread( () =>
                 {
                     WDebugRegisters dr = (WDebugRegisters) debugger.DebuggerInterface;
-                    DEBUG_REGISTER_DESCRIPTION desc;
-
-                    string name;
-                    StaticCheckHr( dr.GetDescriptionWide( registerIndex,
-                                                          out name,
-                                                          out desc ) );
+                    WDebugControl dc = (WDebugControl) debugger.DebuggerInterface;
+                    var table = DbgRegisterDescriptionTable.GetCurrent( dc, dr );
+                    if( registerIndex >= table.Count )
+                        throw new ArgumentOutOfRangeException( "registerIndex" );
 
                     // Don't use dr.GetValue, because it won't respect the context.
                     DEBUG_VALUE[] dvs;
                     StaticCheckHr( dr.GetValues2( DEBUG_REGSRC.FRAME,
                                                   new uint[] { registerIndex },
                                                   out dvs ) );
-                    return new DbgRegisterInfo( debugger, name, dvs[ 0 ], desc, registerIndex );
+                    return new DbgRegisterInfo( debugger,
+                                                table.GetName( registerIndex ),
+                                                dvs[ 0 ],
+                                                table.GetDescription( registerIndex ),
+                                                registerIndex );
                 } );
         } // end factory
 
@@ -115,33 +115,22 @@ private DbgRegisterInfo _GetRegister( string registerName )
         {
             using( new DbgEngContextSaver( Debugger, StackFrame.Context ) )
             {
-                uint numRegs;
-                CheckHr( m_debugRegisters.GetNumberRegisters( out numRegs ) );
+                // The names and descriptions don't change, so they come from the table
+                // (which gets them from dbgeng just once per processor type); only the
+                // values have to be fetched each time.
+                var table = DbgRegisterDescriptionTable.GetCurrent( m_debugControl, m_debugRegisters );
 
                 DEBUG_VALUE[] regVals;
 
-                CheckHr( m_debugRegisters.GetValues2( DEBUG_REGSRC.FRAME, numRegs, 0, out regVals ) );
+                CheckHr( m_debugRegisters.GetValues2( DEBUG_REGSRC.FRAME, (uint) table.Count, 0, out regVals ) );
 
-                // INT460e158e: dbgeng gives us "xmm7/3" again in place of "xmm8/3".
-                bool sawXmm73Already = false;
                 for( uint i = 0; i < regVals.Length; i++ )
                 {
-                    string name;
-                    DEBUG_REGISTER_DESCRIPTION desc;
-                    CheckHr( m_debugRegisters.GetDescriptionWide( i, out name, out desc ) );
-                    if( 0 == Util.Strcmp_OI( "xmm7/3", name ) )
-                    {
-                        if( !sawXmm73Already )
-                        {
-                            sawXmm73Already = true;
-                        }
-                        else
-                        {
-                            // INT460e158e: dbgeng meant to say "xmm8/3".
-                            name = "xmm8/3";
-                        }
-                    }
-                    yield return new DbgRegisterInfo( Debugger, name, regVals[ i ], desc, i );
+                    yield return new DbgRegisterInfo( Debugger,
+                                                      table.GetName( i ),
+                                                      regVals[ i ],
+                                                      table.GetDescription( i ),
+                                                      i );
                 }
             } // end using( context saver )
         } // end _EnumerateRegisters()
@@ -0,0 +1,262 @@
+using System;
+using System.Collections.Generic;
+using Microsoft.Diagnostics.Runtime.Interop;
+using DbgEngWrapper;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    A thread in a DbgRegisterSnapshot.
+    /// </summary>
+    public struct DbgRegisterSnapshotThread
+    {
+        public readonly uint DbgEngId;
+        public readonly uint SystemThreadId;
+
+        /// <summary>
+        ///    False if the thread's registers could not be read (in which case its values
+        ///    in the snapshot are all zero).
+        /// </summary>
+        public readonly bool IsValid;
+
+        internal DbgRegisterSnapshotThread( uint dbgEngId, uint systemThreadId, bool isValid )
+        {
+            DbgEngId = dbgEngId;
+            SystemThreadId = systemThreadId;
+            IsValid = isValid;
+        }
+
+        public override string ToString()
+        {
+            return Util.Sprintf( "{0} (0x{1:x})", DbgEngId, SystemThreadId );
+        }
+    } // end struct DbgRegisterSnapshotThread
+
+
+    /// <summary>
+    ///    The general-purpose registers of every thread in the current process (or, in
+    ///    kernel mode, every processor), captured all at once.
+    /// </summary>
+    /// <remarks>
+    ///    Getting a DbgRegisterSetBase for each thread means switching the dbgeng
+    ///    context to each thread (and back), and getting every register for each,
+    ///    vector and floating point registers included. When you only want the
+    ///    integer registers of a lot of threads (triage scripts looking at the
+    ///    instruction and stack pointers of every thread in a dump, for instance), this
+    ///    gets them all in one trip to the dbgeng thread, and stores them compactly:
+    ///    one ulong per register per thread, in a single array.
+    ///
+    ///    The values are from each thread's own context (frame 0), not the current
+    ///    scope frame.
+    /// </remarks>
+    public class DbgRegisterSnapshot : DebuggerObject
+    {
+        private readonly string[] m_registerNames;
+        private readonly Dictionary< string, int > m_registerIndex;
+        private readonly DbgRegisterSnapshotThread[] m_threads;
+        private readonly ulong[] m_values; // m_threads.Length rows of m_registerNames.Length values
+
+        public IMAGE_FILE_MACHINE Machine { get; private set; }
+
+        public IReadOnlyList< string > RegisterNames { get { return m_registerNames; } }
+
+        public IReadOnlyList< DbgRegisterSnapshotThread > Threads { get { return m_threads; } }
+
+
+        private DbgRegisterSnapshot( DbgEngDebugger debugger,
+                                     IMAGE_FILE_MACHINE machine,
+                                     string[] registerNames,
+                                     DbgRegisterSnapshotThread[] threads,
+                                     ulong[] values )
+            : base( debugger )
+        {
+            Machine = machine;
+            m_registerNames = registerNames;
+            m_threads = threads;
+            m_values = values;
+
+            m_registerIndex = new Dictionary< string, int >( registerNames.Length, StringComparer.OrdinalIgnoreCase );
+            for( int i = 0; i < registerNames.Length; i++ )
+            {
+                m_registerIndex[ registerNames[ i ] ] = i;
+            }
+        } // end constructor
+
+
+        /// <summary>
+        ///    Returns the index of the specified register in RegisterNames, or -1 if it
+        ///    isn't in the snapshot.
+        /// </summary>
+        public int GetRegisterIndex( string registerName )
+        {
+            int idx;
+            if( (null == registerName) || !m_registerIndex.TryGetValue( registerName, out idx ) )
+                return -1;
+
+            return idx;
+        } // end GetRegisterIndex()
+
+
+        public ulong GetValue( int threadIndex, int registerIndex )
+        {
+            if( (threadIndex < 0) || (threadIndex >= m_threads.Length) )
+                throw new ArgumentOutOfRangeException( "threadIndex" );
+
+            if( (registerIndex < 0) || (registerIndex >= m_registerNames.Length) )
+                throw new ArgumentOutOfRangeException( "registerIndex" );
+
+            return m_values[ (threadIndex * m_registerNames.Length) + registerIndex ];
+        } // end GetValue()
+
+
+        public ulong GetValue( int threadIndex, string registerName )
+        {
+            int registerIndex = GetRegisterIndex( registerName );
+            if( registerIndex < 0 )
+            {
+                throw new DbgProviderException( Util.Sprintf( "Register '{0}' not available.",
+                                                              registerName ),
+                                                "NoSuchRegister",
+                                                System.Management.Automation.ErrorCategory.ObjectNotFound,
+                                                registerName );
+            }
+            return GetValue( threadIndex, registerIndex );
+        } // end GetValue()
+
+
+        /// <summary>
+        ///    Gets (a copy of) all the register values for a thread, in RegisterNames
+        ///    order.
+        /// </summary>
+        public ulong[] GetValues( int threadIndex )
+        {
+            if( (threadIndex < 0) || (threadIndex >= m_threads.Length) )
+                throw new ArgumentOutOfRangeException( "threadIndex" );
+
+            var values = new ulong[ m_registerNames.Length ];
+            Array.Copy( m_values, threadIndex * m_registerNames.Length, values, 0, values.Length );
+            return values;
+        } // end GetValues()
+
+
+        /// <summary>
+        ///    Returns the index in Threads of the thread with the specified system
+        ///    thread id, or -1 if there isn't one.
+        /// </summary>
+        public int FindThreadBySystemId( uint systemThreadId )
+        {
+            for( int i = 0; i < m_threads.Length; i++ )
+            {
+                if( m_threads[ i ].SystemThreadId == systemThreadId )
+                    return i;
+            }
+            return -1;
+        } // end FindThreadBySystemId()
+
+
+        /// <summary>
+        ///    Captures the general-purpose registers of every thread of the current
+        ///    process.
+        /// </summary>
+        public static DbgRegisterSnapshot Capture( DbgEngDebugger debugger )
+        {
+            if( null == debugger )
+                throw new ArgumentNullException( "debugger" );
+
+            return debugger.ExecuteOnDbgEngThread( () =>
+                {
+                    var dso = (WDebugSystemObjects) debugger.DebuggerInterface;
+                    var dr = (WDebugRegisters) debugger.DebuggerInterface;
+                    var dc = (WDebugControl) debugger.DebuggerInterface;
+
+                    uint numThreads;
+                    StaticCheckHr( dso.GetNumberThreads( out numThreads ) );
+
+                    uint[] debuggerIds;
+                    uint[] sysTids;
+                    StaticCheckHr( dso.GetThreadIdsByIndex( 0, numThreads, out debuggerIds, out sysTids ) );
+
+                    // Switching threads directly (rather than through
+                    // SetCurrentDbgEngContext) keeps the per-thread cost down to what
+                    // dbgeng itself needs. But it goes around the debugger's cached
+                    // context (and resets the scope frame), so we have to force the
+                    // original thread and frame back when we are done. (A
+                    // DbgEngContextSaver won't do: it would see that the context it is
+                    // restoring is the same as the cached one, and do nothing.)
+                    DbgEngContext oldContext = debugger.GetCurrentDbgEngContext();
+                    try
+                    {
+                        var table = DbgRegisterDescriptionTable.GetCurrent( dc, dr );
+                        IReadOnlyList< uint > gpRegs = table.GeneralPurposeRegisters;
+
+                        var indexes = new uint[ gpRegs.Count ];
+                        var names = new string[ gpRegs.Count ];
+                        var types = new DEBUG_VALUE_TYPE[ gpRegs.Count ];
+                        for( int i = 0; i < indexes.Length; i++ )
+                        {
+                            indexes[ i ] = gpRegs[ i ];
+                            names[ i ] = table.GetName( gpRegs[ i ] );
+                            types[ i ] = table.GetDescription( gpRegs[ i ] ).Type;
+                        }
+
+                        var threads = new DbgRegisterSnapshotThread[ numThreads ];
+                        var values = new ulong[ (int) numThreads * indexes.Length ];
+
+                        // We switch threads behind the debugger's back.
+                        debugger.DiscardMemCacheKey();
+                        for( int t = 0; t < numThreads; t++ )
+                        {
+                            bool isValid = false;
+                            int hr = dso.SetCurrentThreadId( debuggerIds[ t ] );
+                            if( 0 == hr )
+                            {
+                                DEBUG_VALUE[] regVals;
+                                hr = dr.GetValues2( DEBUG_REGSRC.DEBUGGEE, indexes, out regVals );
+                                if( 0 == hr )
+                                {
+                                    int row = t * indexes.Length;
+                                    for( int i = 0; i < regVals.Length; i++ )
+                                    {
+                                        values[ row + i ] = _ToUInt64( regVals[ i ], types[ i ] );
+                                    }
+                                    isValid = true;
+                                }
+                            }
+
+                            if( !isValid )
+                            {
+                                LogManager.Trace( "DbgRegisterSnapshot: could not get registers for thread {0} (0x{1:x}): {2}",
+                                                  debuggerIds[ t ],
+                                                  sysTids[ t ],
+                                                  Util.FormatErrorCode( hr ) );
+                            }
+
+                            threads[ t ] = new DbgRegisterSnapshotThread( debuggerIds[ t ], sysTids[ t ], isValid );
+                        }
+
+                        return new DbgRegisterSnapshot( debugger, table.Machine, names, threads, values );
+                    }
+                    finally
+                    {
+                        debugger.SetCurrentDbgEngContext( oldContext, true, force: true );
+                    }
+                } );
+        } // end Capture()
+
+
+        private static ulong _ToUInt64( DEBUG_VALUE val, DEBUG_VALUE_TYPE type )
+        {
+            switch( type )
+            {
+                case DEBUG_VALUE_TYPE.INT8:
+                    return val.I8;
+                case DEBUG_VALUE_TYPE.INT16:
+                    return val.I16;
+                case DEBUG_VALUE_TYPE.INT32:
+                    return val.I32;
+                default:
+                    return val.I64;
+            }
+        } // end _ToUInt64()
+    } // end class DbgRegisterSnapshot
+}
@@ -16,6 +16,11 @@ private class DbgShellDebugClientDataReader : IDataReader
             private DbgTarget m_target;
             private bool m_closed;
 
+            // For user-mode dump targets, ClrMd reads go straight to a memory-mapped
+            // view of the dump file: no trip to the dbgeng thread, no context swap.
+            // Null for live targets, or if we could not open the dump.
+            private IDataReader m_dumpFileReader;
+
             private void _CheckClosed()
             {
                 // Our implementation doesn't actually close anything, so just an assert
@@ -28,11 +33,50 @@ public DbgShellDebugClientDataReader( DbgEngDebugger umd, DbgTarget proc )
             {
                 m_umd = umd;
                 m_target = proc;
+
+                if( !m_target.IsLive && !m_target.IsKernel )
+                {
+                    m_dumpFileReader = _TryOpenDumpFileReader();
+                }
             }
 
+            private IDataReader _TryOpenDumpFileReader()
+            {
+                try
+                {
+                    string dumpFile;
+                    using( new DbgEngContextSaver( m_umd, m_target.Context ) )
+                    {
+                        dumpFile = m_umd.GetDumpFile( 0, out uint type );
+                    }
+
+                    if( String.IsNullOrEmpty( dumpFile ) )
+                        return null;
+
+                    LogManager.Trace( "ClrMd memory reads for {0} will come from the dump file directly: {1}",
+                                      m_target.Context,
+                                      dumpFile );
+
+                    return DataTarget.CreateDumpDataReader( dumpFile );
+                }
+                catch( Exception e )
+                {
+                    // We can always fall back to going through dbgeng.
+                    LogManager.Trace( "Could not open the dump file for direct reads; will read through dbgeng: {0}",
+                                      Util.GetExceptionMessages( e ) );
+                    return null;
+                }
+            } // end _TryOpenDumpFileReader()
+
             public void Close()
             {
                 m_closed = true;
+
+                if( null != m_dumpFileReader )
+                {
+                    m_dumpFileReader.Close();
+                    m_dumpFileReader = null;
+                }
             }
 
             public void Flush()
@@ -84,8 +128,8 @@ public IList<ModuleInfo> EnumerateModules()
             public void GetVersionInfo( ulong baseAddress, out VersionInfo version )
             {
                 _CheckClosed();
-                var mod = m_target.Modules.Where( ( x ) => x.BaseAddress == baseAddress ).FirstOrDefault();
-                if( null == mod )
+                var mod = m_target.TryFindModuleByBase( baseAddress );
+                if( (null == mod) || mod.IsUnloaded )
                 {
                     Util.Fail( "Bogus base address?" );
                     version = new VersionInfo();
@@ -109,6 +153,16 @@ public unsafe bool ReadMemory( ulong address, byte[] buffer, int bytesRequested,
                 if( null == buffer )
                     throw new ArgumentNullException( "buffer" );
 
+                // Not everything that dbgeng can show us is in the dump file (for
+                // instance, it can fill in image pages from the module files on disk),
+                // so if we come up short, we still give dbgeng a shot.
+                if( (null != m_dumpFileReader) &&
+                    m_dumpFileReader.ReadMemory( address, buffer, bytesRequested, out bytesRead ) &&
+                    (bytesRead == bytesRequested) )
+                {
+                    return true;
+                }
+
                 int tmpBytesRead = 0;
                 bool bResult = m_umd.ExecuteOnDbgEngThread( () =>
                     {
@@ -117,10 +171,10 @@ public unsafe bool ReadMemory( ulong address, byte[] buffer, int bytesRequested,
                             fixed( byte* pBuf = buffer )
                             {
                                 uint uiBytesRead;
-                                int hr = m_umd.m_debugDataSpaces.ReadVirtualDirect( address,
-                                                                                    (uint) bytesRequested,
-                                                                                    pBuf,
-                                                                                    out uiBytesRead );
+                                int hr = m_umd._ReadVirtualCached( address,
+                                                                   (uint) bytesRequested,
+                                                                   pBuf,
+                                                                   out uiBytesRead );
                                 tmpBytesRead = (int) uiBytesRead;
                                 return hr == 0;
                             }
@@ -136,16 +190,23 @@ public unsafe bool ReadMemory( ulong address, IntPtr buffer, int bytesRequested,
                 if( ((UInt64) buffer.ToInt64()) < 4096 )
                     throw new ArgumentException( "The buffer pointer is bad." );
 
+                if( (null != m_dumpFileReader) &&
+                    m_dumpFileReader.ReadMemory( address, buffer, bytesRequested, out bytesRead ) &&
+                    (bytesRead == bytesRequested) )
+                {
+                    return true;
+                }
+
                 int tmpBytesRead = 0;
                 bool bResult = m_umd.ExecuteOnDbgEngThread( () =>
                     {
                         using( new DbgEngContextSaver( m_umd, m_target.Context ) )
                         {
                             uint uiBytesRead;
-                            int hr = m_umd.m_debugDataSpaces.ReadVirtualDirect( address,
-                                                                                (uint) bytesRequested,
-                                                                                (byte*) buffer,
-                                                                                out uiBytesRead );
+                            int hr = m_umd._ReadVirtualCached( address,
+                                                               (uint) bytesRequested,
+                                                               (byte*) buffer,
+                                                               out uiBytesRead );
                             tmpBytesRead = (int) uiBytesRead;
                             return hr == 0;
                         } // end using( ctx )
@@ -256,18 +317,39 @@ public unsafe bool GetThreadContext( uint threadID, uint contextFlags, uint cont
                 }
             }
 
-            public ulong ReadPointerUnsafe( ulong addr )
+            public unsafe ulong ReadPointerUnsafe( ulong addr )
             {
                 _CheckClosed();
+                if( null != m_dumpFileReader )
+                {
+                    ulong ptr = 0;
+                    int cbPtr = m_target.Is32Bit ? 4 : 8;
+                    if( m_dumpFileReader.ReadMemory( addr, new IntPtr( &ptr ), cbPtr, out int bytesRead ) &&
+                        (bytesRead == cbPtr) )
+                    {
+                        return ptr;
+                    }
+                }
+
                 using( new DbgEngContextSaver( m_umd, m_target.Context ) )
                 {
                     return m_umd.ReadMemAs_pointer( addr );
                 }
             }
 
-            public uint ReadDwordUnsafe( ulong addr )
+            public unsafe uint ReadDwordUnsafe( ulong addr )
             {
                 _CheckClosed();
+                if( null != m_dumpFileReader )
+                {
+                    uint dw = 0;
+                    if( m_dumpFileReader.ReadMemory( addr, new IntPtr( &dw ), 4, out int bytesRead ) &&
+                        (bytesRead == 4) )
+                    {
+                        return dw;
+                    }
+                }
+
                 using( new DbgEngContextSaver( m_umd, m_target.Context ) )
                 {
                     return m_umd.ReadMemAs_UInt32( addr );
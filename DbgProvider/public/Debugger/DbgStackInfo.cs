@@ -2,6 +2,7 @@
 using System.Collections.Generic;
 using System.Linq;
 using System.Text;
+using System.Threading;
 using Microsoft.Diagnostics.Runtime;
 using Microsoft.Diagnostics.Runtime.Interop;
 using DbgEngWrapper;
@@ -80,7 +81,9 @@ internal DbgStackInfo WithMaxFrameCount( int maxFrames )
             get
             {
                 if( null == m_frames )
-                    EnumerateStackFrames();
+                {
+                    Debugger.ExecuteOnDbgEngThread( () => _EnsureFrames() );
+                }
 
                 return m_frames.AsReadOnly();
             }
@@ -88,139 +91,292 @@ internal DbgStackInfo WithMaxFrameCount( int maxFrames )
 
 
         public IEnumerable< DbgStackFrameInfo > EnumerateStackFrames()
+        {
+            return EnumerateStackFrames( CancellationToken.None );
+        } // end EnumerateStackFrames()
+
+
+        /// <summary>
+        ///    Enumerates the frames of the stack, walking it as they are enumerated (if
+        ///    it has not been walked already). If cancelToken is signaled, the
+        ///    enumeration stops (without an error) before the next walk.
+        /// </summary>
+        public IEnumerable< DbgStackFrameInfo > EnumerateStackFrames( CancellationToken cancelToken )
         {
             if( null != m_frames )
             {
                 return m_frames;
             }
 
-            m_frames = new List< DbgStackFrameInfo >();
+            return _StreamStackFrames( cancelToken );
+        } // end EnumerateStackFrames()
+
+
+        private IEnumerable< DbgStackFrameInfo > _StreamStackFrames( CancellationToken cancelToken )
+        {
+            var frames = new List< DbgStackFrameInfo >();
+            ManagedFrameMatcher matcher = null;
+            int maxFrames = _GetMaxFramesToWalk();
+            int requested = (0 == maxFrames) ? c_firstChunkFrameCount : Math.Min( c_firstChunkFrameCount, maxFrames );
+
+            while( true )
+            {
+                // Each chunk is walked only once the consumer has taken everything from
+                // the last one, so there is never more than a chunk of frames waiting,
+                // and nothing left running on the dbgeng thread if the consumer stops.
+                int emitted = frames.Count;
+                bool complete = Debugger.ExecuteOnDbgEngThread( () => _WalkStack( requested,
+                                                                                  maxFrames,
+                                                                                  frames,
+                                                                                  ref matcher ) );
+
+                for( int i = emitted; i < frames.Count; i++ )
+                {
+                    yield return frames[ i ];
+                }
+
+                if( complete )
+                {
+                    m_frames = frames;
+                    yield break;
+                }
+
+                // If the consumer stopped early (or gets canceled here), we don't have
+                // all the frames, and the next enumeration will have to walk the stack
+                // again.
+                if( cancelToken.IsCancellationRequested )
+                    yield break;
+
+                requested = maxFrames;
+            }
+        } // end _StreamStackFrames()
+
+
+        /// <summary>
+        ///    Walks the whole stack (up to MaxFrameCount frames), if it has not been
+        ///    walked already. Must be called on the dbgeng thread.
+        /// </summary>
+        private void _EnsureFrames()
+        {
+            if( null != m_frames )
+                return;
+
+            var frames = new List< DbgStackFrameInfo >();
+            ManagedFrameMatcher matcher = null;
+            int maxFrames = _GetMaxFramesToWalk();
+            _WalkStack( maxFrames, maxFrames, frames, ref matcher );
+            m_frames = frames;
+        } // end _EnsureFrames()
+
+
+        // The first chunk should be enough for things like "Get-DbgStack | select -First 5",
+        // or for finding the frame you are looking for near the top of the stack.
+        private const int c_firstChunkFrameCount = 16;
+
+        // 0 means "all the frames". (Don't ask WDebugControl.GetStackTraceEx for some
+        // huge number instead: it allocates an array that big up front, whereas for 0 it
+        // starts small and grows it as needed.)
+        private int _GetMaxFramesToWalk()
+        {
+            return (MaxFrameCount > 0) ? MaxFrameCount : 0;
+        }
+
+        /// <summary>
+        ///    Walks the stack from the top, asking for up to requested frames (0 for all
+        ///    of them), and adds the ones beyond what frames already has to it. Returns
+        ///    true if that was the whole walk (the stack ended first, or requested is
+        ///    maxFrames). Must be called on the dbgeng thread.
+        /// </summary>
+        /// <remarks>
+        ///    dbgeng can't resume a stack walk from where a previous one left off (the
+        ///    frameOffset parameter of GetStackTraceEx is a frame address, not a frame
+        ///    index, and starting a walk from the middle of an x64 stack needs a full
+        ///    register context anyway). So when frames are streamed, the first chunk
+        ///    (c_firstChunkFrameCount frames) is walked on its own, and if the stack
+        ///    goes deeper, it is walked once more from the top for everything else. A
+        ///    full streamed walk therefore re-walks at most c_firstChunkFrameCount
+        ///    frames; callers that want all the frames up front (Frames, GetStacks)
+        ///    walk just once.
+        /// </remarks>
+        private bool _WalkStack( int requested,
+                                 int maxFrames,
+                                 List< DbgStackFrameInfo > frames,
+                                 ref ManagedFrameMatcher matcher )
+        {
+            using( new DbgEngContextSaver( Debugger, Context ) )
+            {
+                WDebugControl dc = (WDebugControl) Debugger.DebuggerInterface;
+
+                DEBUG_STACK_FRAME_EX[] nativeFrames;
+                int hr = dc.GetStackTraceEx( 0, // frameOffset
+                                             0, // stackOffset
+                                             0, // instructionOffset
+                                             requested,
+                                             out nativeFrames );
+
+                CheckHr( hr );
+
+                if( (nativeFrames.Length > frames.Count) && (null == matcher) )
+                    matcher = _CreateManagedFrameMatcher();
+
+                for( int i = frames.Count; i < nativeFrames.Length; i++ )
+                {
+                    frames.Add( new DbgStackFrameInfo( Debugger,
+                                                       m_thread,
+                                                       nativeFrames[ i ],
+                                                       matcher.Match( nativeFrames[ i ].InstructionOffset ) ) );
+                }
+
+                return (0 == requested) ||
+                       (nativeFrames.Length < requested) ||
+                       ((maxFrames > 0) && (requested >= maxFrames));
+            } // end using( context saver )
+        } // end _WalkStack()
+
+
+        private ManagedFrameMatcher _CreateManagedFrameMatcher()
+        {
+            IList< ClrThread > managedThreads;
 
-            bool noException = false;
             try
             {
-                return Debugger.ExecuteOnDbgEngThread( () =>
-                    {
-                        using( new DbgEngContextSaver( Debugger, Context ) )
-                        {
-                            WDebugControl dc = (WDebugControl) Debugger.DebuggerInterface;
-
-                            /* TODO: I guess frameOffset doesn't do what I think it does... or maybe I need to file a bug.
-                            //int stride = 64;
-                            int stride = 3;
-                            ulong frameOffset = 0;
-                            int hr = 0;
-                            DEBUG_STACK_FRAME_EX[] frames = new DEBUG_STACK_FRAME_EX[ stride ];
-                            while( true )
-                            {
-                                uint framesFilled = 0;
-                                hr = dc.GetStackTraceEx( frameOffset, 0, 0, frames, frames.Length, out framesFilled );
-
-                                CheckHr( hr );
-
-                                if( 0 == framesFilled )
-                                    break;
-
-                                for( int i = 0; i < framesFilled; i++ )
-                                {
-                                    var newFrame = new StackFrameInfo( Debugger, frames[ i ] );
-                                    m_frames.Add( newFrame );
-                                    //yield return newFrame; hmm, can't mix an iterator with the straight 'return' above
-                                }
-
-                                frameOffset += 3;
-                            } // while( keep requesting more frames )
-                            */
-
-                            DEBUG_STACK_FRAME_EX[] frames;
-                            int hr = dc.GetStackTraceEx( 0, // frameOffset
-                                                         0, // stackOffset
-                                                         0, // instructionOffset
-                                                         MaxFrameCount,
-                                                         out frames );
-
-                            CheckHr( hr );
-
-                            int[] managedFrameIndices;
-
-                            try
-                            {
-                                managedFrameIndices = new int[ Thread.ManagedThreads.Count ];
-                            }
-                            catch( InvalidOperationException ioe )
-                            {
-                                //
-                                // Likely "Mismatched architecture between this process
-                                // and the dac." No managed code information for you, sir.
-                                //
-
-                                DbgProvider.RequestExecuteBeforeNextPrompt(
-                                        Util.Sprintf( "Write-Warning 'Could not get managed thread/frame information: {0}'",
-                                                      System.Management.Automation.Language.CodeGeneration.EscapeSingleQuotedStringContent( Util.GetExceptionMessages( ioe ) ) ) );
-                                managedFrameIndices = new int[ 0 ];
-
-                                // (and remember not to keep trying to get managed info)
-                                Debugger.ClrMdDisabled = true;
-                            }
-
-                            foreach( var nativeFrame in frames )
-                            {
-                                ClrStackFrame managedFrame = null;
-                                for( int i = 0; i < managedFrameIndices.Length; i++ )
-                                {
-                                    var mThread = Thread.ManagedThreads[ i ];
-                                    int mFrameIdx = managedFrameIndices[ i ];
-                                    // It's possible that a thread is marked as a managed
-                                    // thread, but has no stack frames. (I've seen this,
-                                    // for instance, at the final breakpoint of a managed
-                                    // app.)
-                                    if( 0 == mThread.StackTrace.Count )
-                                        continue;
-
-                                    if( mFrameIdx >= mThread.StackTrace.Count )
-                                    {
-                                        // We've exhausted the managed frames for this
-                                        // particular managed thread.
-                                        continue;
-                                    }
-
-                                    var mFrame = mThread.StackTrace[ mFrameIdx ];
-                                    while( (0 == mFrame.InstructionPointer) &&
-                                           (mFrameIdx < (mThread.StackTrace.Count - 1)) ) // still at least one more frame below?
-                                    {
-                                        // It's some sort of "helper" or GC frame or
-                                        // something, which we need to skip.
-                                        mFrameIdx++;
-                                        managedFrameIndices[ i ] = mFrameIdx;
-                                        mFrame = mThread.StackTrace[ mFrameIdx ];
-                                    }
-
-                                    if( nativeFrame.InstructionOffset == mFrame.InstructionPointer )
-                                    {
-                                        managedFrame = mFrame;
-                                        managedFrameIndices[ i ] += 1;
-                                        break;
-                                    }
-                                }
-
-                                var newFrame = new DbgStackFrameInfo( Debugger,
-                                                                      m_thread,
-                                                                      nativeFrame,
-                                                                      managedFrame );
-                                m_frames.Add( newFrame );
-                            }
-
-                            noException = true;
-                            return m_frames;
-                        } // end using( context saver )
-                    } );
+                managedThreads = Thread.ManagedThreads;
             }
-            finally
+            catch( InvalidOperationException ioe )
             {
-                if( !noException )
-                    m_frames = null; // so we can try again (handy for debugging)
+                //
+                // Likely "Mismatched architecture between this process
+                // and the dac." No managed code information for you, sir.
+                //
+
+                DbgProvider.RequestExecuteBeforeNextPrompt(
+                        Util.Sprintf( "Write-Warning 'Could not get managed thread/frame information: {0}'",
+                                      System.Management.Automation.Language.CodeGeneration.EscapeSingleQuotedStringContent( Util.GetExceptionMessages( ioe ) ) ) );
+                managedThreads = new ClrThread[ 0 ];
+
+                // (and remember not to keep trying to get managed info)
+                Debugger.ClrMdDisabled = true;
             }
-        } // end EnumerateStackFrames()
+
+            return new ManagedFrameMatcher( managedThreads );
+        } // end _CreateManagedFrameMatcher()
+
+
+        /// <summary>
+        ///    Matches native frames, top to bottom, with the frames of the managed
+        ///    thread(s) (one per runtime) that correspond to the native thread.
+        /// </summary>
+        private sealed class ManagedFrameMatcher
+        {
+            private readonly IList< ClrStackFrame >[] m_managedStacks;
+            private readonly int[] m_managedFrameIndices;
+
+            public ManagedFrameMatcher( IList< ClrThread > managedThreads )
+            {
+                m_managedStacks = new IList< ClrStackFrame >[ managedThreads.Count ];
+                m_managedFrameIndices = new int[ managedThreads.Count ];
+
+                for( int i = 0; i < m_managedStacks.Length; i++ )
+                {
+                    m_managedStacks[ i ] = managedThreads[ i ].StackTrace;
+                }
+            } // end constructor
+
+            public ClrStackFrame Match( ulong instructionOffset )
+            {
+                for( int i = 0; i < m_managedStacks.Length; i++ )
+                {
+                    var mStack = m_managedStacks[ i ];
+                    int mFrameIdx = m_managedFrameIndices[ i ];
+                    // It's possible that a thread is marked as a managed
+                    // thread, but has no stack frames. (I've seen this,
+                    // for instance, at the final breakpoint of a managed
+                    // app.)
+                    if( 0 == mStack.Count )
+                        continue;
+
+                    if( mFrameIdx >= mStack.Count )
+                    {
+                        // We've exhausted the managed frames for this
+                        // particular managed thread.
+                        continue;
+                    }
+
+                    var mFrame = mStack[ mFrameIdx ];
+                    while( (0 == mFrame.InstructionPointer) &&
+                           (mFrameIdx < (mStack.Count - 1)) ) // still at least one more frame below?
+                    {
+                        // It's some sort of "helper" or GC frame or
+                        // something, which we need to skip.
+                        mFrameIdx++;
+                        m_managedFrameIndices[ i ] = mFrameIdx;
+                        mFrame = mStack[ mFrameIdx ];
+                    }
+
+                    if( instructionOffset == mFrame.InstructionPointer )
+                    {
+                        m_managedFrameIndices[ i ] += 1;
+                        return mFrame;
+                    }
+                }
+                return null;
+            } // end Match()
+        } // end class ManagedFrameMatcher
+
+
+        /// <summary>
+        ///    Gets the stacks for a set of threads.
+        /// </summary>
+        /// <remarks>
+        ///    When the target can't be stepped (a dump), nothing can change the threads'
+        ///    register contexts while we are busy, so all the stacks are walked on the
+        ///    dbgeng thread, ahead of and concurrently with the consumer (which is
+        ///    typically busy formatting the stacks it already has). dbgeng itself is
+        ///    single-threaded, so the walks themselves are still done one at a time.
+        ///
+        ///    For targets that can be stepped (live targets, and iDNA traces, which can
+        ///    be moved to a different position), each stack is walked lazily, as it is
+        ///    enumerated.
+        /// </remarks>
+        internal static IEnumerable< DbgStackInfo > GetStacks( DbgEngDebugger debugger,
+                                                               IList< DbgUModeThreadInfo > threads,
+                                                               int maxFrames,
+                                                               CancellationToken cancelToken )
+        {
+            if( null == debugger )
+                throw new ArgumentNullException( "debugger" );
+
+            if( null == threads )
+                throw new ArgumentNullException( "threads" );
+
+            if( (threads.Count < 2) || debugger.CanStep )
+                return threads.Select( ( t ) => t.GetStackWithMaxFrames( maxFrames ) );
+
+            return debugger.StreamFromDbgEngThread< DbgStackInfo >( cancelToken, ( ct, emit ) =>
+                {
+                    foreach( var thread in threads )
+                    {
+                        if( ct.IsCancellationRequested )
+                            break;
+
+                        var stack = thread.GetStackWithMaxFrames( maxFrames );
+                        try
+                        {
+                            stack._EnsureFrames();
+                        }
+                        catch( DbgEngException dee )
+                        {
+                            // Leave it un-walked; the consumer will get the error when
+                            // it enumerates the frames, just as it would have if we had
+                            // not walked ahead.
+                            LogManager.Trace( "GetStacks: walk failed for thread {0}: {1}",
+                                              thread.DebuggerId,
+                                              Util.GetExceptionMessages( dee ) );
+                        }
+                        emit( stack );
+                    }
+                } );
+        } // end GetStacks()
 
 
         private DbgStackFrameInfo m_topFrame;
@@ -496,6 +496,11 @@ public PSObject GetStockValue()
 
         private DbgValueCache< PSObject > m_valueCache = new DbgValueCache< PSObject >();
 
+        // This happens for every symbol value we create; it goes through the trace
+        // ring instead of straight to the log.
+        private static readonly int sm_fmtCreatingValue =
+            TraceRing.RegisterFormat( "Creating value for symbol: {0} ({1})" );
+
         public PSObject GetValue( bool skipConversion, bool skipDerivedTypeDetection )
         {
             ValueOptions valOpts = DbgValueCache< PSObject >.ComputeValueOptions( skipConversion,
@@ -505,9 +510,7 @@ public PSObject GetValue( bool skipConversion, bool skipDerivedTypeDetection )
 
             if( null == val )
             {
-                LogManager.Trace( "Creating value for symbol: {0} ({1})",
-                                  this.PathString,
-                                  valOpts );
+                TraceRing.Trace( sm_fmtCreatingValue, this.PathString, valOpts );
 
                 if( IsConstant )
                     val = DbgValue.CreateWrapperPso( this, GetConstantValue() );
@@ -3,8 +3,14 @@
 using System.Collections.ObjectModel;
 using System.Collections.Concurrent;
 using System.Diagnostics;
+using System.IO;
 using System.Linq;
+using System.Management.Automation;
+using System.Security.Cryptography;
+using System.Text;
+using System.Threading;
 using Microsoft.Diagnostics.Runtime;
+using Microsoft.Diagnostics.Runtime.Interop;
 
 namespace MS.Dbg
 {
@@ -130,12 +136,17 @@ public string Path
         private List< DbgModuleInfo > m_unloadedModules;
         private IList< DbgModuleInfo > m_unloadedModulesRo;
 
+        // Built lazily from m_modules and m_unloadedModules, and thrown away whenever
+        // they are.
+        private volatile ModuleAddressIndex m_moduleIndex;
+
         private void _LoadModuleInfo()
         {
             if( null == m_modules )
             {
                 using( new DbgEngContextSaver( Debugger, Context ) )
                 {
+                    m_moduleIndex = null;
                     Debugger.GetModuleInfo( out m_modules, out m_unloadedModules );
                     m_modulesRo = m_modules.AsReadOnly();
                     m_unloadedModulesRo = m_unloadedModules.AsReadOnly();
@@ -170,6 +181,48 @@ private void _LoadModuleInfo()
         } // end property UnloadedModules
 
 
+        private ModuleAddressIndex _GetModuleIndex()
+        {
+            ModuleAddressIndex index = m_moduleIndex;
+            if( null == index )
+            {
+                IList< DbgModuleInfo > modules = Modules;
+                IList< DbgModuleInfo > unloadedModules = UnloadedModules;
+                List< DbgModuleInfo > source = m_modules;
+
+                // Loaded modules go first, so that they win over any unloaded modules
+                // that used to be at the same address (same as GetModuleByOffset).
+                index = ModuleAddressIndex.Build( modules.Concat( unloadedModules ) );
+
+                // Don't cache it if the module lists got thrown away while we were
+                // building it.
+                if( (null != source) && (source == m_modules) )
+                    m_moduleIndex = index;
+            }
+            return index;
+        } // end _GetModuleIndex()
+
+
+        /// <summary>
+        ///    Finds the module (loaded, or else unloaded) containing the specified
+        ///    address, using the cached module lists. Returns null if there isn't one.
+        /// </summary>
+        internal DbgModuleInfo TryFindModuleByAddress( ulong addressInModule )
+        {
+            return _GetModuleIndex().FindByAddress( addressInModule );
+        } // end TryFindModuleByAddress()
+
+
+        /// <summary>
+        ///    Finds the module (loaded, or else unloaded) at the specified base address,
+        ///    using the cached module lists. Returns null if there isn't one.
+        /// </summary>
+        internal DbgModuleInfo TryFindModuleByBase( ulong baseAddress )
+        {
+            return _GetModuleIndex().FindByBase( baseAddress );
+        } // end TryFindModuleByBase()
+
+
         protected static ColorString _SummarizeLoadedModules( List< object > modObjList, int maxWidth )
         {
             return _SummarizeModuleList( true, modObjList, maxWidth );
@@ -240,6 +293,7 @@ internal void AddModule( DbgModuleInfo modInfo )
                     m_modules.Add( modInfo );
                 }
             }
+            m_moduleIndex = null;
         } // end AddModule()
 
 
@@ -247,6 +301,7 @@ internal void ModuleUnloaded( string imageBaseName, ulong imageOffset )
         {
             // TODO: for now we'll just refresh everything
             m_modules = null;
+            m_moduleIndex = null;
         } // end ModuleUnloaded
 
 
@@ -282,6 +337,11 @@ public void DiscardCachedModuleInfo()
             RefreshModuleInfo(); // Need to tell modules to dump their cache for anyone holding onto a reference
             m_modules = null;
             m_unloadedModules = null;
+            m_moduleIndex = null;
+            m_vtableTypes.Clear();
+            m_symbolNames.Clear();
+            _DiscardDisassembly();
+            DiscardClrHeapIndexes();
 
             // We'll also dump the per-module user-cached stuff (but preserve the "global"
             // (modBase:0) user cache).
@@ -322,6 +382,13 @@ public void DiscardUserCacheForModule( ulong modBase )
         /// </remarks>
         internal void BumpSymbolCookie( ulong modBase )
         {
+            // We don't know which vtables belong to which module (and negative results
+            // for any module could change), so they all go.
+            m_vtableTypes.Clear();
+
+            // Same for disassembly: code in any module can refer to symbols in this one.
+            _DiscardDisassembly();
+
             if( 0 != modBase )
             {
                 int curCookie;
@@ -335,9 +402,12 @@ internal void BumpSymbolCookie( ulong modBase )
                 }
 
                 DiscardUserCacheForModule( modBase );
+                m_symbolNames.TryRemove( modBase, out _ );
             }
             else // modBase is 0
             {
+                m_symbolNames.Clear();
+
                 // We need to bump all the cookies.
                 foreach( var key in m_symbolCookies.Keys.ToArray() )
                 {
@@ -364,6 +434,227 @@ internal int GetSymbolCookie( ulong modBase )
         } // end GetSymbolCookie()
 
 
+        //
+        // VTable -> type cache
+        //
+        // Derived type detection looks up the symbolic name of an object's vtable, and
+        // then the type with that name. All objects of a given type share a vtable, so
+        // enumerating 100k COM objects does the same few hundred lookups over and over.
+        // So we cache the results (including failures) by vtable address. Module loads
+        // and unloads and symbol changes throw the whole thing away (see
+        // DiscardCachedModuleInfo and BumpSymbolCookie).
+        //
+
+        internal sealed class VTableTypeEntry
+        {
+            /// <summary>
+            ///    Null if the vtable did not have a usable symbolic name.
+            /// </summary>
+            public readonly string ImplementingTypeName;
+
+            private DbgUdtTypeInfo m_udt;
+            private volatile bool m_udtResolved;
+
+            public VTableTypeEntry( string implementingTypeName )
+            {
+                ImplementingTypeName = implementingTypeName;
+            }
+
+            /// <summary>
+            ///    Whether the type has been looked up yet (Udt can be null even if it
+            ///    has, if the type could not be found).
+            /// </summary>
+            public bool UdtResolved { get { return m_udtResolved; } }
+
+            public DbgUdtTypeInfo Udt { get { return m_udt; } }
+
+            public void SetUdt( DbgUdtTypeInfo udt )
+            {
+                m_udt = udt;
+                m_udtResolved = true;
+            }
+        } // end class VTableTypeEntry
+
+
+        private readonly ConcurrentDictionary< ulong, VTableTypeEntry > m_vtableTypes
+            = new ConcurrentDictionary< ulong, VTableTypeEntry >();
+
+        internal bool TryGetVTableType( ulong vtableAddr, out VTableTypeEntry entry )
+        {
+            return m_vtableTypes.TryGetValue( vtableAddr, out entry );
+        }
+
+        internal VTableTypeEntry AddVTableType( ulong vtableAddr, string implementingTypeName )
+        {
+            return m_vtableTypes.GetOrAdd( vtableAddr, new VTableTypeEntry( implementingTypeName ) );
+        }
+
+        internal int GetVTableTypeCacheSize()
+        {
+            return m_vtableTypes.Count;
+        }
+
+
+        //
+        // Symbol name cache
+        //
+        // Symbolizing memory (like "dps") looks up the names of the same code and data
+        // addresses over and over. Names (including failures) are cached per module, by
+        // RVA, and a module's names are thrown away when its symbols change (see
+        // BumpSymbolCookie) or the module lists are refreshed.
+        //
+
+        internal sealed class SymbolNameEntry
+        {
+            /// <summary>
+            ///    Null if the address could not be symbolized.
+            /// </summary>
+            public readonly string Name;
+            public readonly ulong Displacement;
+
+            public SymbolNameEntry( string name, ulong displacement )
+            {
+                Name = name;
+                Displacement = displacement;
+            }
+        } // end class SymbolNameEntry
+
+
+        private readonly ConcurrentDictionary< ulong, ConcurrentDictionary< uint, SymbolNameEntry > > m_symbolNames
+            = new ConcurrentDictionary< ulong, ConcurrentDictionary< uint, SymbolNameEntry > >();
+
+        internal bool TryGetSymbolName( ulong modBase, uint rva, out SymbolNameEntry entry )
+        {
+            entry = null;
+            ConcurrentDictionary< uint, SymbolNameEntry > modNames;
+            return m_symbolNames.TryGetValue( modBase, out modNames ) &&
+                   modNames.TryGetValue( rva, out entry );
+        }
+
+        internal void AddSymbolName( ulong modBase, uint rva, SymbolNameEntry entry )
+        {
+            var modNames = m_symbolNames.GetOrAdd( modBase,
+                                                   ( _ ) => new ConcurrentDictionary< uint, SymbolNameEntry >() );
+            modNames[ rva ] = entry;
+        }
+
+
+        //
+        // Disassembly cache
+        //
+        // Code in image modules never changes in a dump, so disassembled instructions
+        // are cached per module, by RVA, as is whole-function ("uf") disassembly, by
+        // the RVA of the address it was asked for. The text depends on symbols, on the
+        // assembly options and on the effective processor type (a WOW64 process can be
+        // disassembled as x86 or as x64), so everything is thrown away when any
+        // symbols change (see BumpSymbolCookie), when the module lists are refreshed,
+        // or when the options or processor type are not what they were when the cache
+        // was filled. It is also thrown away when it reaches its budget of
+        // c_DisassemblyCacheBudget instructions (a few hundred bytes each), rather
+        // than growing with every function anyone has ever looked at.
+        //
+
+        private sealed class ModuleDisassembly
+        {
+            public readonly ConcurrentDictionary< uint, DbgDisassembly > Instructions
+                = new ConcurrentDictionary< uint, DbgDisassembly >();
+
+            public readonly ConcurrentDictionary< uint, DbgDisassembly[] > WholeFunctions
+                = new ConcurrentDictionary< uint, DbgDisassembly[] >();
+        } // end class ModuleDisassembly
+
+
+        private const int c_DisassemblyCacheBudget = 64 * 1024;
+
+        private readonly ConcurrentDictionary< ulong, ModuleDisassembly > m_disassembly
+            = new ConcurrentDictionary< ulong, ModuleDisassembly >();
+
+        // Instructions in m_disassembly, counting each instruction of each whole function.
+        private int m_disassemblyCount;
+
+        private DbgAssemblyOptions m_disassemblyOptions;
+        private IMAGE_FILE_MACHINE m_disassemblyProcessorType;
+
+        /// <summary>
+        ///    Live targets can modify their code, so we only cache disassembly for
+        ///    dumps.
+        /// </summary>
+        internal bool DisassemblyCacheEnabled { get { return !IsLive; } }
+
+        /// <summary>
+        ///    Throws away cached disassembly that was produced with different assembly
+        ///    options, or for a different effective processor type.
+        /// </summary>
+        internal void CheckDisassemblyOptions( DbgAssemblyOptions options, IMAGE_FILE_MACHINE effectiveProcessorType )
+        {
+            if( (options != m_disassemblyOptions) ||
+                (effectiveProcessorType != m_disassemblyProcessorType) )
+            {
+                _DiscardDisassembly();
+                m_disassemblyOptions = options;
+                m_disassemblyProcessorType = effectiveProcessorType;
+            }
+        } // end CheckDisassemblyOptions()
+
+        private void _DiscardDisassembly()
+        {
+            m_disassembly.Clear();
+            Volatile.Write( ref m_disassemblyCount, 0 );
+        } // end _DiscardDisassembly()
+
+        /// <summary>
+        ///    Counts count newly-cached instructions, discarding everything if that
+        ///    takes the cache over its budget.
+        /// </summary>
+        private void _CountDisassembly( int count )
+        {
+            if( Interlocked.Add( ref m_disassemblyCount, count ) > c_DisassemblyCacheBudget )
+            {
+                LogManager.Trace( "Disassembly cache is over budget; discarding it." );
+                _DiscardDisassembly();
+            }
+        } // end _CountDisassembly()
+
+        internal int GetDisassemblyCacheSize()
+        {
+            return Volatile.Read( ref m_disassemblyCount );
+        }
+
+        internal bool TryGetDisassembly( ulong modBase, uint rva, out DbgDisassembly instruction )
+        {
+            instruction = null;
+            ModuleDisassembly modDisasm;
+            return m_disassembly.TryGetValue( modBase, out modDisasm ) &&
+                   modDisasm.Instructions.TryGetValue( rva, out instruction );
+        }
+
+        internal void AddDisassembly( ulong modBase, uint rva, DbgDisassembly instruction )
+        {
+            var modDisasm = m_disassembly.GetOrAdd( modBase, ( _ ) => new ModuleDisassembly() );
+            if( modDisasm.Instructions.TryAdd( rva, instruction ) )
+                _CountDisassembly( 1 );
+        }
+
+        internal bool TryGetWholeFunctionDisassembly( ulong modBase, uint rva, out DbgDisassembly[] instructions )
+        {
+            instructions = null;
+            ModuleDisassembly modDisasm;
+            return m_disassembly.TryGetValue( modBase, out modDisasm ) &&
+                   modDisasm.WholeFunctions.TryGetValue( rva, out instructions );
+        }
+
+        internal void AddWholeFunctionDisassembly( ulong modBase, uint rva, DbgDisassembly[] instructions )
+        {
+            // (A function too big for the whole budget is just not cached.)
+            if( instructions.Length > c_DisassemblyCacheBudget )
+                return;
+
+            var modDisasm = m_disassembly.GetOrAdd( modBase, ( _ ) => new ModuleDisassembly() );
+            if( modDisasm.WholeFunctions.TryAdd( rva, instructions ) )
+                _CountDisassembly( instructions.Length );
+        }
+
+
         //
         // User cache stuff
         //
@@ -625,11 +916,220 @@ public bool ClrMdDisabled
                     {
                         m_clrRuntimes = null;
                     }
+                    DiscardClrHeapIndexes(); // they're keyed by the old runtimes
                 } // end if( transition )
             } // end set
         } // end property ClrMdDisabled
 
 
+        //
+        // ClrMd heap indexes: for a dump, the heap can be indexed once (see
+        // ClrHeapIndex), and later heap queries read the index instead of walking the
+        // heap all over again. Index files go next to the dump (or under
+        // LocalApplicationData, if we can't write there), and are keyed by the identity
+        // of the dump.
+        //
+
+        private Dictionary< ClrRuntime, ClrHeapIndex > m_clrHeapIndexes;
+        private string m_dumpFile;
+        private Guid m_dumpIdentity;
+
+        /// <summary>
+        ///    Returns the current heap index for the specified runtime, or null if there
+        ///    isn't one.
+        /// </summary>
+        internal ClrHeapIndex TryGetClrHeapIndex( ClrRuntime runtime )
+        {
+            if( null == m_clrHeapIndexes )
+                m_clrHeapIndexes = new Dictionary< ClrRuntime, ClrHeapIndex >();
+
+            ClrHeapIndex index;
+            if( m_clrHeapIndexes.TryGetValue( runtime, out index ) )
+                return index; // (null if we already looked and didn't find one)
+
+            Guid id;
+            string[] paths = _GetClrHeapIndexPaths( runtime, out id );
+            if( null != paths )
+            {
+                foreach( string path in paths )
+                {
+                    index = ClrHeapIndex.TryOpen( runtime.GetHeap(), path, id );
+                    if( null != index )
+                    {
+                        LogManager.Trace( "Using heap index {0} ({1} objects).", path, index.Count );
+                        break;
+                    }
+                }
+            }
+
+            m_clrHeapIndexes[ runtime ] = index;
+            return index;
+        } // end TryGetClrHeapIndex()
+
+
+        /// <summary>
+        ///    Closes any heap indexes we have open (each one keeps its file mapped). They
+        ///    will be opened again if needed.
+        /// </summary>
+        internal void DiscardClrHeapIndexes()
+        {
+            if( null == m_clrHeapIndexes )
+                return;
+
+            foreach( var index in m_clrHeapIndexes.Values )
+            {
+                index?.Dispose();
+            }
+
+            m_clrHeapIndexes = null;
+        } // end DiscardClrHeapIndexes()
+
+
+        /// <summary>
+        ///    Walks the heap for the specified runtime and writes a new index for it,
+        ///    replacing any existing one.
+        /// </summary>
+        internal ClrHeapIndex BuildClrHeapIndex( ClrRuntime runtime )
+        {
+            Guid id;
+            string[] paths = _GetClrHeapIndexPaths( runtime, out id );
+            if( null == paths )
+            {
+                throw new DbgProviderException( "Heap indexes can only be built for dump targets.",
+                                                "HeapIndexRequiresDump",
+                                                ErrorCategory.InvalidOperation,
+                                                this );
+            }
+
+            if( null == m_clrHeapIndexes )
+                m_clrHeapIndexes = new Dictionary< ClrRuntime, ClrHeapIndex >();
+
+            // The old index has its file mapped, so let go of it first.
+            ClrHeapIndex old;
+            if( m_clrHeapIndexes.TryGetValue( runtime, out old ) && (null != old) )
+                old.Dispose();
+
+            m_clrHeapIndexes.Remove( runtime );
+
+            Exception lastError = null;
+            foreach( string path in paths )
+            {
+                try
+                {
+                    Directory.CreateDirectory( Path.GetDirectoryName( path ) );
+                    ClrHeapIndex index = ClrHeapIndex.Build( runtime.GetHeap(), path, id );
+                    m_clrHeapIndexes[ runtime ] = index;
+                    return index;
+                }
+                catch( Exception e ) when( (e is IOException) || (e is UnauthorizedAccessException) )
+                {
+                    LogManager.Trace( "Could not write heap index {0}: {1}", path, e );
+                    lastError = e;
+                }
+            }
+
+            throw new DbgProviderException( Util.Sprintf( "Could not write a heap index: {0}",
+                                                          Util.GetExceptionMessages( lastError ) ),
+                                            "HeapIndexWriteFailed",
+                                            ErrorCategory.WriteError,
+                                            lastError,
+                                            this );
+        } // end BuildClrHeapIndex()
+
+
+        /// <summary>
+        ///    Returns the places an index for the specified runtime could be (next to
+        ///    the dump first), or null if this isn't a dump target.
+        /// </summary>
+        private string[] _GetClrHeapIndexPaths( ClrRuntime runtime, out Guid dumpIdentity )
+        {
+            dumpIdentity = Guid.Empty;
+            if( IsLive || IsKernel )
+                return null;
+
+            if( null == m_dumpFile )
+            {
+                string dumpFile = null;
+                try
+                {
+                    using( new DbgEngContextSaver( Debugger, Context ) )
+                    {
+                        dumpFile = Debugger.GetDumpFile( 0, out uint type );
+                    }
+
+                    if( !String.IsNullOrEmpty( dumpFile ) )
+                        m_dumpIdentity = _GetDumpIdentity( dumpFile );
+                }
+                catch( Exception e ) when( (e is DbgEngException) ||
+                                           (e is IOException) ||
+                                           (e is UnauthorizedAccessException) ||
+                                           (e is CryptographicException) ||
+                                           (e is InvalidOperationException) ) // no usable hash algorithm
+                {
+                    LogManager.Trace( "Could not identify the dump file for heap indexes: {0}", e );
+                    dumpFile = null;
+                }
+
+                m_dumpFile = dumpFile ?? String.Empty;
+            }
+
+            if( 0 == m_dumpFile.Length )
+                return null;
+
+            dumpIdentity = m_dumpIdentity;
+            int runtimeIdx = 0;
+            for( ; runtimeIdx < ClrRuntimes.Count; runtimeIdx++ )
+            {
+                if( ClrRuntimes[ runtimeIdx ] == runtime )
+                    break;
+            }
+
+            return new string[]
+            {
+                Util.Sprintf( "{0}.clr{1}.heapidx", m_dumpFile, runtimeIdx ),
+                Path.Combine( Environment.GetFolderPath( Environment.SpecialFolder.LocalApplicationData,
+                                                         Environment.SpecialFolderOption.DoNotVerify ),
+                              "DbgShell",
+                              "HeapIndex",
+                              Util.Sprintf( "{0:N}-clr{1}.heapidx", m_dumpIdentity, runtimeIdx ) ),
+            };
+        } // end _GetClrHeapIndexPaths()
+
+
+        /// <summary>
+        ///    Identifies a dump by its size, timestamp, and the checksum and timestamp
+        ///    in its header, without reading the whole thing.
+        /// </summary>
+        /// <remarks>
+        ///    This is a SHA-256 (the FIPS-validated implementation, so that it works when
+        ///    FIPS mode is enforced, unlike MD5) truncated to the size of a Guid.
+        /// </remarks>
+        private static Guid _GetDumpIdentity( string dumpFile )
+        {
+            var fi = new FileInfo( dumpFile );
+            byte[] header = new byte[ 32 ]; // MINIDUMP_HEADER
+            using( var fs = new FileStream( dumpFile, FileMode.Open, FileAccess.Read, FileShare.ReadWrite | FileShare.Delete ) )
+            {
+                fs.Read( header, 0, header.Length );
+            }
+
+            using( var ms = new MemoryStream() )
+            using( var sha = new SHA256CryptoServiceProvider() )
+            {
+                using( var writer = new BinaryWriter( ms, Encoding.UTF8, leaveOpen: true ) )
+                {
+                    writer.Write( fi.Length );
+                    writer.Write( fi.LastWriteTimeUtc.Ticks );
+                    writer.Write( header );
+                }
+                byte[] hash = sha.ComputeHash( ms.ToArray() );
+                byte[] guidBytes = new byte[ 16 ];
+                Array.Copy( hash, guidBytes, guidBytes.Length );
+                return new Guid( guidBytes );
+            }
+        } // end _GetDumpIdentity()
+
+
         // TODO: Should this be internal?
         public void SetContext()
         {
@@ -232,24 +232,19 @@ private static bool _TrySafeConversions( DbgSymbol symbol, out object val, out b
                     return false;
                 }
 
-                sm_userConversionDepth++;
+                val = _ApplyUserSVC( cdi, symbol, out converterApplied );
 
-                try
-                {
-                    val = cdi.Converter.Convert( symbol );
-                    if( null != val )
-                    {
-                        converterApplied = cdi.TypeName.FullName;
-                        LogManager.Trace( "Applied converter for symbol {0}: {1}",
-                                          symbol.Name,
-                                          converterApplied );
-                    }
-                }
-                finally
+                if( (null == val) && cdi.IsBuiltIn )
                 {
-                    sm_userConversionDepth--;
-                    if( 0 == sm_userConversionDepth )
-                        sm_addrBreadcrumbs.Clear();
+                    // The built-in converter did not recognize the layout (a different
+                    // STL version, say). A script converter might still know what to do.
+                    LogManager.Trace( "Built-in converter for {0} declined symbol {1}; looking for a script converter.",
+                                      cdi.TypeName,
+                                      symbol.Name );
+
+                    cdi = DbgValueConversionManager.ChooseNonBuiltInConverterForSymbol( symbol );
+                    if( null != cdi )
+                        val = _ApplyUserSVC( cdi, symbol, out converterApplied );
                 }
             }
             else
@@ -313,6 +308,35 @@ private static bool _TrySafeConversions( DbgSymbol symbol, out object val, out b
         } // end _TryUserSVC()
 
 
+        private static readonly int sm_fmtAppliedConverter =
+            TraceRing.RegisterFormat( "Applied converter for symbol {0}: {1}" );
+
+        private static object _ApplyUserSVC( DbgValueConverterInfo cdi,
+                                             DbgSymbol symbol,
+                                             out string converterApplied )
+        {
+            converterApplied = null;
+            sm_userConversionDepth++;
+
+            try
+            {
+                object val = cdi.Converter.Convert( symbol );
+                if( null != val )
+                {
+                    converterApplied = cdi.TypeName.FullName;
+                    TraceRing.Trace( sm_fmtAppliedConverter, symbol.Name, converterApplied );
+                }
+                return val;
+            }
+            finally
+            {
+                sm_userConversionDepth--;
+                if( 0 == sm_userConversionDepth )
+                    sm_addrBreadcrumbs.Clear();
+            }
+        } // end _ApplyUserSVC()
+
+
         private static readonly Dictionary< string, Func< DbgSymbol, object > > sm_knownTypeConverters
             = new Dictionary< string, Func< DbgSymbol, object > >()
             {
@@ -654,7 +678,8 @@ private static void _CheckForRunawayUserConversion( DbgSymbol symbol )
 
             ulong vtableAddr = (ulong) (((long) symbol.Address) + vtableOffset);
             ulong firstSlotPtr;
-            string implementingTypeName = dbgr._TryGetImplementingTypeNameFromVTableAddr( vtableAddr,
+            string implementingTypeName = dbgr._TryGetImplementingTypeNameFromVTableAddr( symbol.Target,
+                                                                                          vtableAddr,
                                                                                           out firstSlotPtr );
 
             if( null == implementingTypeName )
@@ -666,7 +691,7 @@ private static void _CheckForRunawayUserConversion( DbgSymbol symbol )
                 return false;
             }
 
-            derivedType = dbgr._TryGetUdtForTypeNameExact( implementingTypeName );
+            derivedType = dbgr._TryGetUdtForVTable( symbol.Target, firstSlotPtr, implementingTypeName );
             if( null == derivedType )
             {
                 LogManager.Trace( "Unable to get type info for derived type: {0}",
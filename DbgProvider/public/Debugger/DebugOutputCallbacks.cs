@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Runtime.InteropServices;
 using System.Text;
 using Microsoft.Diagnostics.Runtime.Interop;
 using DbgEngWrapper;
@@ -8,7 +9,7 @@ namespace MS.Dbg
     public partial class DbgEngDebugger : DebuggerObject
     {
         // TODO: Implement IDebugOutputCallbacks2 instead.
-        private sealed class DebugOutputCallbacks : IDebugOutputCallbacksImp
+        private sealed class DebugOutputCallbacks : IDebugOutputLinesCallbacksImp
         {
             private string m_prefix;
             public string Prefix
@@ -45,8 +46,16 @@ public CircularBuffer<string> RecentDbgEngOutput
             }
 
             // DbgEng sends output in chunks smaller than a whole line, so need to buffer.
+            // (Only used if we are given chunks via Output; normally the native adapter
+            // does the buffering and calls OutputLines.)
             private StringBuilder m_sb = new StringBuilder();
 
+            // Set by the native adapter; gets it to hand over any partial line.
+            private Action m_flushAdapter;
+
+            // For gluing the prefix onto lines without an intermediate string.
+            private char[] m_lineBuf = new char[ 256 ];
+
             public DebugOutputCallbacks( string prefix, Action< string > consumeLine )
             {
                 if( null == prefix )
@@ -100,8 +109,58 @@ public int Output( DEBUG_OUTPUT Mask, string Text )
                 return 0;
             } // end Output()
 
+
+            public unsafe int OutputLines( DEBUG_OUTPUT Mask, IntPtr Text, IntPtr LineEnds, int Count )
+            {
+                try
+                {
+                    // TODO: powershell-ize, using Mask (each batch has a single Mask)
+                    char* pText = (char*) Text;
+                    int* pLineEnds = (int*) LineEnds;
+                    int start = 0;
+                    for( int i = 0; i < Count; i++ )
+                    {
+                        int end = pLineEnds[ i ];
+                        var line = _MakeLine( pText + start, end - start );
+                        start = end;
+                        m_recentDbgEngOutput.Add( line );
+                        m_ConsumeLine( line );
+                    }
+                }
+                catch( Exception e )
+                {
+                    Util.FailFast( "Unexpected exception in output callback", e );
+                }
+                return 0;
+            } // end OutputLines()
+
+
+            private unsafe string _MakeLine( char* pChars, int cch )
+            {
+                if( 0 == m_prefix.Length )
+                    return new string( pChars, 0, cch );
+
+                int total = m_prefix.Length + cch;
+                if( m_lineBuf.Length < total )
+                    m_lineBuf = new char[ Math.Max( total, m_lineBuf.Length * 2 ) ];
+
+                m_prefix.CopyTo( 0, m_lineBuf, 0, m_prefix.Length );
+                Marshal.Copy( (IntPtr) pChars, m_lineBuf, m_prefix.Length, cch );
+                return new string( m_lineBuf, 0, total );
+            } // end _MakeLine()
+
+
+            public void SetFlushCallback( Action Flush )
+            {
+                m_flushAdapter = Flush;
+            }
+
+
             public void Flush()
             {
+                if( null != m_flushAdapter )
+                    m_flushAdapter();
+
                 if( 0 != m_sb.Length )
                 {
                     m_ConsumeLine( m_sb.ToString() );
@@ -414,6 +414,12 @@ public int ChangeDebuggeeState( DEBUG_CDS Flags, ulong Argument )
             {
                 try
                 {
+                    if( 0 != (Flags & DEBUG_CDS.DATA) )
+                    {
+                        // Somebody wrote to target memory (we don't get told where).
+                        m_debugger.PurgeMemoryCache();
+                    }
+
                     var eventArgs = new DebuggeeStateChangedEventArgs( m_debugger, Flags, Argument );
                     int retVal = _RaiseEvent( m_debugger.DebuggeeStateChanged, eventArgs );
                     if( _ShouldOutput( retVal, eventArgs ) )
@@ -435,6 +441,12 @@ public int ChangeEngineState( DEBUG_CES Flags, ulong Argument )
                 try
                 {
                     var eventArgs = new EngineStateChangedEventArgs( m_debugger, Flags, Argument );
+                    if( eventArgs.Flags.HasFlag( DEBUG_CES.CURRENT_THREAD ) )
+                    {
+                        // Maybe a command like "|1s" or ".process" switched processes.
+                        m_debugger.DiscardMemCacheKey();
+                    }
+
                     if( eventArgs.Flags.HasFlag( DEBUG_CES.EVENT_FILTERS ) )
                     {
                         // Need to refresh our filters.
@@ -461,6 +473,11 @@ public int ChangeEngineState( DEBUG_CES Flags, ulong Argument )
                         // the symbol path has changed when that happens. As a workaround,
                         // we'll dump our cached symbol path here.
                         m_debugger.m_sympath = null;
+
+                        // System and process IDs get re-used when targets come and go, so
+                        // cached memory could get attributed to the wrong target.
+                        m_debugger.PurgeMemoryCache();
+
                         // Another oddity with the symbol path: before attaching to any
                         // system, dbgeng will say that the symbol path is blank. Then,
                         // once it gets attached to something, it will append the value of
@@ -490,6 +507,9 @@ public int ChangeEngineState( DEBUG_CES Flags, ulong Argument )
                     if( eventArgs.Flags.HasFlag( DEBUG_CES.EXECUTION_STATUS ) )
                     {
                         m_executionStatusCookie++;
+
+                        // Memory in a live target may have changed; dumps don't change.
+                        m_debugger.InvalidateMemoryCacheForLiveTargets();
                     }
 
                     int retVal = _RaiseEvent( m_debugger.EngineStateChanged, eventArgs );
@@ -0,0 +1,1001 @@
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Management.Automation;
+using System.Text;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    Compiled value converters for the MSVC STL containers: basic_string, vector,
+    ///    map/multimap, set/multiset, list, forward_list, and hash_map/unordered_map.
+    /// </summary>
+    /// <remarks>
+    ///    These take over from the script converters in Debugger.Converters.stl.ps1,
+    ///    which go through the stock value (and PowerShell) for every node, and build
+    ///    the whole collection up front whether or not anybody looks at it. Here we
+    ///    find the container's bookkeeping members using the type layout and read them
+    ///    straight out of target memory, and element values are not created until
+    ///    somebody asks for them.
+    ///
+    ///    Tree nodes are read a level at a time, with each level's nodes prefetched
+    ///    into the memory cache in one batched read. Vector storage is prefetched in
+    ///    windows as it is indexed.
+    ///
+    ///    Several STL versions are handled by searching for members by name (in base
+    ///    classes too), and by digging through the compressed pairs (_Mypair._Myval2)
+    ///    that newer versions wrap the container state in. If a container does not
+    ///    look the way we expect, the converter returns null, and the script converter
+    ///    (if there is one) gets a shot at it. vector&lt;bool&gt;, unique_ptr, and
+    ///    basic_path are left to the scripts.
+    /// </remarks>
+    internal static class StlValueConverters
+    {
+        // We don't trust _Mysize for sizing things up front; if the container is
+        // corrupt, it could be anything.
+        private const int c_MaxInitialCapacity = 1024;
+
+        // A corrupt std::string could claim to be gigabytes long.
+        private const ulong c_MaxStringChars = 64 * 1024;
+
+        private const int c_MaxStateDepth = 4;
+
+
+        internal static IEnumerable< DbgValueConverterInfo > CreateConverterInfos()
+        {
+            var listConverter = new ListConverter();
+            var mapConverter = new MapConverter();
+            var setConverter = new SetConverter();
+            var hashMapConverter = new HashMapConverter();
+
+            yield return new DbgValueConverterInfo( "!std::basic_string<?*>", new StringConverter(), isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!std::vector<?*>", new VectorConverter(), isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!std::map<?*>", mapConverter, isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!std::multimap<?*>", mapConverter, isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!std::set<?*>", setConverter, isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!std::multiset<?*>", setConverter, isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!std::list<?*>", listConverter, isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!std::forward_list<?*>", new ForwardListConverter(), isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!stdext::hash_map<?*>", hashMapConverter, isBuiltIn: true );
+            yield return new DbgValueConverterInfo( "!std::unordered_map<?*>", hashMapConverter, isBuiltIn: true );
+        } // end CreateConverterInfos()
+
+
+        //
+        // Layout helpers
+        //
+
+        private static DbgNamedTypeInfo _StripTypedefs( DbgNamedTypeInfo type )
+        {
+            while( type is DbgTypedefTypeInfo )
+            {
+                type = ((DbgTypedefTypeInfo) type).RepresentedType;
+            }
+            return type;
+        } // end _StripTypedefs()
+
+
+        /// <summary>
+        ///    Finds a (non-bitfield) data member by name, in the type or any of its base
+        ///    classes. The offset is from the start of the type.
+        /// </summary>
+        private static bool _TryFindMember( DbgNamedTypeInfo type,
+                                            string name,
+                                            out uint offset,
+                                            out DbgNamedTypeInfo memberType )
+        {
+            offset = 0;
+            memberType = null;
+
+            var udt = _StripTypedefs( type ) as DbgUdtTypeInfo;
+            if( null == udt )
+                return false;
+
+            if( udt.Members.HasItemNamed( name ) )
+            {
+                var member = udt.Members[ name ];
+                if( member.IsBitfield )
+                    return false;
+
+                offset = member.Offset;
+                memberType = _StripTypedefs( member.DataType );
+                return true;
+            }
+
+            foreach( var baseClass in udt.BaseClasses )
+            {
+                uint offsetInBase;
+                if( _TryFindMember( baseClass, name, out offsetInBase, out memberType ) )
+                {
+                    offset = baseClass.Offset + offsetInBase;
+                    return true;
+                }
+            }
+            return false;
+        } // end _TryFindMember()
+
+
+        /// <summary>
+        ///    Finds the part of a container that holds its state (the part with a
+        ///    member called keyMember). Newer STLs wrap the state in one or more
+        ///    compressed pairs (_Mypair._Myval2, sometimes _Mypair._Myval2._Myval2),
+        ///    so we dig through those until we find it.
+        /// </summary>
+        private static bool _TryFindState( DbgNamedTypeInfo containerType,
+                                           string keyMember,
+                                           out uint offset,
+                                           out DbgNamedTypeInfo stateType )
+        {
+            offset = 0;
+            stateType = _StripTypedefs( containerType );
+
+            for( int depth = 0; depth <= c_MaxStateDepth; depth++ )
+            {
+                uint memberOffset;
+                DbgNamedTypeInfo memberType;
+                if( _TryFindMember( stateType, keyMember, out memberOffset, out memberType ) )
+                    return true;
+
+                if( !_TryFindMember( stateType, "_Mypair", out memberOffset, out memberType ) &&
+                    !_TryFindMember( stateType, "_Myval2", out memberOffset, out memberType ) )
+                {
+                    break;
+                }
+
+                offset += memberOffset;
+                stateType = memberType;
+            }
+
+            stateType = null;
+            return false;
+        } // end _TryFindState()
+
+
+        private static ulong _ReadSizeT( DbgEngDebugger debugger, ulong address, DbgNamedTypeInfo type )
+        {
+            if( 4 == type.Size )
+                return debugger.ReadMemAs_UInt32( address );
+            else
+                return debugger.ReadMemAs_UInt64( address );
+        } // end _ReadSizeT()
+
+
+        private static int _InitialCapacity( ulong size )
+        {
+            return (int) Math.Min( size, (ulong) c_MaxInitialCapacity );
+        }
+
+
+        /// <summary>
+        ///    Where to find things in a node-based container (list, forward_list, and
+        ///    the trees behind map and set), relative to the container and to the nodes.
+        /// </summary>
+        private sealed class NodeLayout
+        {
+            public uint HeadOffset;     // _Myhead, from the start of the container
+            public bool HasSize;        // forward_list does not keep track of its size
+            public uint SizeOffset;     // _Mysize, from the start of the container
+            public DbgNamedTypeInfo SizeType;
+
+            public DbgNamedTypeInfo NodeType;
+            public uint ValOffset;      // _Myval, from the start of a node
+            public DbgNamedTypeInfo ValType;
+
+            // For lists:
+            public uint NextOffset;
+
+            // For trees:
+            public uint LeftOffset;
+            public uint ParentOffset;
+            public uint RightOffset;
+            public uint IsNilOffset;
+
+
+            private static bool _TryCreateCommon( DbgNamedTypeInfo containerType,
+                                                  bool needSize,
+                                                  out NodeLayout layout )
+            {
+                layout = null;
+
+                uint stateOffset;
+                DbgNamedTypeInfo stateType;
+                if( !_TryFindState( containerType, "_Myhead", out stateOffset, out stateType ) )
+                    return false;
+
+                uint headOffset;
+                DbgNamedTypeInfo headType;
+                _TryFindMember( stateType, "_Myhead", out headOffset, out headType );
+
+                var headPtrType = headType as DbgPointerTypeInfo;
+                if( null == headPtrType )
+                    return false;
+
+                var nodeType = _StripTypedefs( headPtrType.PointeeType );
+
+                uint valOffset;
+                DbgNamedTypeInfo valType;
+                if( !_TryFindMember( nodeType, "_Myval", out valOffset, out valType ) )
+                    return false;
+
+                var l = new NodeLayout();
+                l.HeadOffset = stateOffset + headOffset;
+                l.NodeType = nodeType;
+                l.ValOffset = valOffset;
+                l.ValType = valType;
+
+                uint sizeOffset;
+                DbgNamedTypeInfo sizeType;
+                if( _TryFindMember( stateType, "_Mysize", out sizeOffset, out sizeType ) )
+                {
+                    l.HasSize = true;
+                    l.SizeOffset = stateOffset + sizeOffset;
+                    l.SizeType = sizeType;
+                }
+                else if( needSize )
+                {
+                    return false;
+                }
+
+                layout = l;
+                return true;
+            } // end _TryCreateCommon()
+
+
+            private bool _TryFindNodeMember( string name, out uint offset )
+            {
+                DbgNamedTypeInfo dontCare;
+                return _TryFindMember( NodeType, name, out offset, out dontCare );
+            }
+
+
+            public static NodeLayout TryCreateForList( DbgNamedTypeInfo containerType, bool needSize )
+            {
+                NodeLayout l;
+                if( !_TryCreateCommon( containerType, needSize, out l ) ||
+                    !l._TryFindNodeMember( "_Next", out l.NextOffset ) )
+                {
+                    return null;
+                }
+                return l;
+            } // end TryCreateForList()
+
+
+            public static NodeLayout TryCreateForTree( DbgNamedTypeInfo containerType )
+            {
+                NodeLayout l;
+                if( !_TryCreateCommon( containerType, true, out l ) ||
+                    !l._TryFindNodeMember( "_Left", out l.LeftOffset ) ||
+                    !l._TryFindNodeMember( "_Parent", out l.ParentOffset ) ||
+                    !l._TryFindNodeMember( "_Right", out l.RightOffset ) ||
+                    !l._TryFindNodeMember( "_Isnil", out l.IsNilOffset ) )
+                {
+                    return null;
+                }
+                return l;
+            } // end TryCreateForTree()
+
+
+            public ulong ReadSize( DbgEngDebugger debugger, ulong containerAddr )
+            {
+                Util.Assert( HasSize );
+                return _ReadSizeT( debugger, containerAddr + SizeOffset, SizeType );
+            }
+        } // end class NodeLayout
+
+
+        //
+        // Node walkers. These return the addresses of the nodes' _Myval members, in
+        // order. They only read memory, so we run them on the dbgeng thread, which
+        // saves a thread switch for every read.
+        //
+
+        /// <summary>
+        ///    Walks a bidirectional list (std::list, and the list inside hash_map and
+        ///    unordered_map), which is circular through a sentinel head node.
+        /// </summary>
+        private static List< ulong > _WalkList( DbgEngDebugger debugger, NodeLayout layout, ulong containerAddr )
+        {
+            return debugger.ExecuteOnDbgEngThread( () =>
+                {
+                    ulong size = layout.ReadSize( debugger, containerAddr );
+                    var vals = new List< ulong >( _InitialCapacity( size ) );
+
+                    ulong head = debugger.ReadMemAs_pointer( containerAddr + layout.HeadOffset );
+                    if( (0 == head) || (0 == size) )
+                        return vals;
+
+                    ulong cur = debugger.ReadMemAs_pointer( head + layout.NextOffset );
+                    while( cur != head )
+                    {
+                        if( 0 == cur )
+                        {
+                            LogManager.Trace( "List at {0}: unexpected null _Next pointer.",
+                                              DbgProvider.FormatUInt64( containerAddr, true ) );
+                            break;
+                        }
+
+                        if( (ulong) vals.Count >= size )
+                        {
+                            // Either _Mysize is wrong, or there is a loop that does not
+                            // go through the head.
+                            LogManager.Trace( "List at {0}: more nodes than _Mysize ({1}); stopping.",
+                                              DbgProvider.FormatUInt64( containerAddr, true ),
+                                              size );
+                            break;
+                        }
+
+                        vals.Add( cur + layout.ValOffset );
+                        cur = debugger.ReadMemAs_pointer( cur + layout.NextOffset );
+                    }
+                    return vals;
+                } );
+        } // end _WalkList()
+
+
+        /// <summary>
+        ///    Walks a singly-linked, null-terminated list (std::forward_list).
+        /// </summary>
+        private static List< ulong > _WalkForwardList( DbgEngDebugger debugger, NodeLayout layout, ulong containerAddr )
+        {
+            return debugger.ExecuteOnDbgEngThread( () =>
+                {
+                    var vals = new List< ulong >();
+                    var seen = new HashSet< ulong >();
+
+                    ulong cur = debugger.ReadMemAs_pointer( containerAddr + layout.HeadOffset );
+                    while( 0 != cur )
+                    {
+                        if( !seen.Add( cur ) )
+                        {
+                            LogManager.Trace( "Forward list at {0}: loop detected at node {1}; stopping.",
+                                              DbgProvider.FormatUInt64( containerAddr, true ),
+                                              DbgProvider.FormatUInt64( cur, true ) );
+                            break;
+                        }
+
+                        vals.Add( cur + layout.ValOffset );
+                        cur = debugger.ReadMemAs_pointer( cur + layout.NextOffset );
+                    }
+                    return vals;
+                } );
+        } // end _WalkForwardList()
+
+
+        /// <summary>
+        ///    Walks the red-black tree behind map, multimap, set, and multiset, and
+        ///    returns the nodes in order.
+        /// </summary>
+        /// <remarks>
+        ///    The head node is a sentinel: its _Parent is the root, and child pointers
+        ///    that point at the head mean "no child".
+        ///
+        ///    First we go breadth-first, a level at a time, prefetching all of the
+        ///    nodes in the level with one batched read, and remembering each node's
+        ///    children. Then the in-order walk just uses what we remembered. Bad nodes
+        ///    (null, or with _Isnil set) are skipped (along with their subtrees), like
+        ///    the script converter did, so that one bad pointer does not cost us the
+        ///    whole tree.
+        /// </remarks>
+        private static List< ulong > _WalkTree( DbgEngDebugger debugger, NodeLayout layout, ulong containerAddr )
+        {
+            return debugger.ExecuteOnDbgEngThread( () =>
+                {
+                    ulong size = layout.ReadSize( debugger, containerAddr );
+                    var vals = new List< ulong >( _InitialCapacity( size ) );
+
+                    ulong head = debugger.ReadMemAs_pointer( containerAddr + layout.HeadOffset );
+                    if( (0 == head) || (0 == size) )
+                        return vals;
+
+                    ulong root = debugger.ReadMemAs_pointer( head + layout.ParentOffset );
+
+                    // We only need the node "header" (the links and _Isnil), which comes
+                    // before _Myval.
+                    uint headerSize = Math.Max( layout.LeftOffset, Math.Max( layout.RightOffset, layout.IsNilOffset ) );
+                    headerSize += (uint) debugger.PointerSize;
+
+                    var children = new Dictionary< ulong, KeyValuePair< ulong, ulong > >( _InitialCapacity( size ) );
+                    var level = new List< ulong >();
+                    if( (0 != root) && (head != root) )
+                        level.Add( root );
+
+                    while( level.Count > 0 )
+                    {
+                        debugger.PrefetchMem( level, headerSize );
+
+                        var nextLevel = new List< ulong >( level.Count * 2 );
+                        foreach( ulong node in level )
+                        {
+                            if( children.ContainsKey( node ) )
+                            {
+                                LogManager.Trace( "Tree at {0}: node {1} seen twice; skipping.",
+                                                  DbgProvider.FormatUInt64( containerAddr, true ),
+                                                  DbgProvider.FormatUInt64( node, true ) );
+                                continue;
+                            }
+
+                            if( (ulong) children.Count >= size )
+                            {
+                                LogManager.Trace( "Tree at {0}: more nodes than _Mysize ({1}); stopping.",
+                                                  DbgProvider.FormatUInt64( containerAddr, true ),
+                                                  size );
+                                break;
+                            }
+
+                            if( 0 != debugger.ReadMemAs_byte( node + layout.IsNilOffset ) )
+                            {
+                                LogManager.Trace( "Tree at {0}: _Isnil unexpectedly non-zero for node {1}; skipping it.",
+                                                  DbgProvider.FormatUInt64( containerAddr, true ),
+                                                  DbgProvider.FormatUInt64( node, true ) );
+                                continue;
+                            }
+
+                            ulong left = debugger.ReadMemAs_pointer( node + layout.LeftOffset );
+                            ulong right = debugger.ReadMemAs_pointer( node + layout.RightOffset );
+                            children.Add( node, new KeyValuePair< ulong, ulong >( left, right ) );
+
+                            _AddChild( containerAddr, head, node, "Left", left, nextLevel );
+                            _AddChild( containerAddr, head, node, "Right", right, nextLevel );
+                        }
+                        level = nextLevel;
+                    } // end while( more levels )
+
+                    // In-order: left subtree, node, right subtree. Anything that isn't in
+                    // 'children' (the head, or a node we skipped) is an empty subtree.
+                    var stack = new Stack< ulong >();
+                    ulong cur = root;
+                    while( children.ContainsKey( cur ) || (stack.Count > 0) )
+                    {
+                        while( children.ContainsKey( cur ) )
+                        {
+                            stack.Push( cur );
+                            cur = children[ cur ].Key;
+                        }
+
+                        cur = stack.Pop();
+                        vals.Add( cur + layout.ValOffset );
+                        cur = children[ cur ].Value;
+
+                        if( vals.Count > children.Count )
+                        {
+                            // Can only happen if the links form a loop.
+                            LogManager.Trace( "Tree at {0}: loop detected; stopping.",
+                                              DbgProvider.FormatUInt64( containerAddr, true ) );
+                            break;
+                        }
+                    }
+                    return vals;
+                } );
+        } // end _WalkTree()
+
+
+        private static void _AddChild( ulong containerAddr,
+                                       ulong head,
+                                       ulong parent,
+                                       string which,
+                                       ulong child,
+                                       List< ulong > nextLevel )
+        {
+            if( head == child )
+                return;
+
+            if( 0 == child )
+            {
+                LogManager.Trace( "Tree at {0}: {1} child unexpectedly null for node {2}.",
+                                  DbgProvider.FormatUInt64( containerAddr, true ),
+                                  which,
+                                  DbgProvider.FormatUInt64( parent, true ) );
+                return;
+            }
+
+            nextLevel.Add( child );
+        } // end _AddChild()
+
+
+        /// <summary>
+        ///    Creates a PsIndexedDictionary that is filled in (with the pair.first and
+        ///    pair.second values of each node) the first time somebody looks at it.
+        /// </summary>
+        private static PsIndexedDictionary _CreatePairDictionary( DbgSymbol symbol,
+                                                                  DbgNamedTypeInfo pairType,
+                                                                  ulong sizeHint,
+                                                                  Func< List< ulong > > walk )
+        {
+            uint firstOffset, secondOffset;
+            DbgNamedTypeInfo firstType, secondType;
+            if( !_TryFindMember( pairType, "first", out firstOffset, out firstType ) ||
+                !_TryFindMember( pairType, "second", out secondOffset, out secondType ) )
+            {
+                return null;
+            }
+
+            var debugger = symbol.Debugger;
+            return new PsIndexedDictionary( _InitialCapacity( sizeHint ),
+                                            ( d ) =>
+                                            {
+                                                var pairAddrs = walk();
+                                                for( int i = 0; i < pairAddrs.Count; i++ )
+                                                {
+                                                    var keySym = new DbgSimpleSymbol( debugger,
+                                                                                      Util.Sprintf( "{0}[{1}].first", symbol.Name, i ),
+                                                                                      firstType,
+                                                                                      pairAddrs[ i ] + firstOffset );
+                                                    var valSym = new DbgSimpleSymbol( debugger,
+                                                                                      Util.Sprintf( "{0}[{1}].second", symbol.Name, i ),
+                                                                                      secondType,
+                                                                                      pairAddrs[ i ] + secondOffset );
+                                                    d.Add( DbgValue.CreateDbgValue( keySym ),
+                                                           DbgValue.CreateDbgValue( valSym ) );
+                                                }
+                                            },
+                                            () => symbol.GetStockValue().ToString() );
+        } // end _CreatePairDictionary()
+
+
+        //
+        // The converters
+        //
+
+        private abstract class StlConverter : IDbgValueConverter
+        {
+            public object Convert( DbgSymbol symbol )
+            {
+                // We read the container's members ourselves, so it has to be in memory.
+                if( symbol.IsValueInRegister || symbol.IsValueUnavailable || (0 == symbol.Address) )
+                    return null;
+
+                return DoConvert( symbol );
+            }
+
+            protected abstract object DoConvert( DbgSymbol symbol );
+        } // end class StlConverter
+
+
+        /// <summary>
+        ///    N.B. This always produces a System.String. (The script converter it
+        ///    replaces returned a string for short strings, but the _Ptr DbgValue (a
+        ///    char pointer, which displays as the string) for long ones.) Strings
+        ///    longer than c_MaxStringChars are cut off there, with a "…" on the end to
+        ///    show it.
+        /// </summary>
+        private sealed class StringConverter : StlConverter
+        {
+            protected override object DoConvert( DbgSymbol symbol )
+            {
+                uint stateOffset;
+                DbgNamedTypeInfo stateType;
+                if( !_TryFindState( symbol.Type, "_Bx", out stateOffset, out stateType ) )
+                    return null;
+
+                uint bxOffset, sizeOffset, bufOffset, ptrOffset;
+                DbgNamedTypeInfo bxType, sizeType, bufType, ptrType;
+                if( !_TryFindMember( stateType, "_Bx", out bxOffset, out bxType ) ||
+                    !_TryFindMember( stateType, "_Mysize", out sizeOffset, out sizeType ) ||
+                    !_TryFindMember( bxType, "_Buf", out bufOffset, out bufType ) ||
+                    !_TryFindMember( bxType, "_Ptr", out ptrOffset, out ptrType ) )
+                {
+                    return null;
+                }
+
+                var bufArrayType = bufType as DbgArrayTypeInfo;
+                if( null == bufArrayType )
+                    return null;
+
+                ulong charSize = bufArrayType.ArrayElementType.Size;
+                if( (1 != charSize) && (2 != charSize) )
+                    return null; // Unusual character size.
+
+                var debugger = symbol.Debugger;
+                ulong state = symbol.Address + stateOffset;
+                ulong size = _ReadSizeT( debugger, state + sizeOffset, sizeType );
+
+                // Small-string optimization: short strings live right in _Bx._Buf. The
+                // string is in "large" mode when the capacity (_Myres) does not fit in
+                // the buffer. (Shrinking a large string does not put it back in the
+                // buffer, so looking at the size alone is not enough.)
+                bool large;
+                uint resOffset;
+                DbgNamedTypeInfo resType;
+                if( _TryFindMember( stateType, "_Myres", out resOffset, out resType ) )
+                    large = _ReadSizeT( debugger, state + resOffset, resType ) >= bufArrayType.Count;
+                else
+                    large = size >= bufArrayType.Count;
+
+                ulong data;
+                if( large )
+                    data = debugger.ReadMemAs_pointer( state + bxOffset + ptrOffset );
+                else
+                    data = state + bxOffset + bufOffset;
+
+                bool truncated = false;
+                if( size > c_MaxStringChars )
+                {
+                    LogManager.Trace( "String {0} claims {1} characters; only reading {2}.",
+                                      symbol.Name,
+                                      size,
+                                      c_MaxStringChars );
+                    size = c_MaxStringChars;
+                    truncated = true;
+                }
+
+                if( 0 == size )
+                    return String.Empty;
+
+                string str = debugger.ReadMemAs_String( data,
+                                                        (uint) (size * charSize),
+                                                        (1 == charSize) ? Encoding.Default : Encoding.Unicode );
+                if( truncated )
+                    str += "…";
+
+                return str;
+            } // end DoConvert()
+        } // end class StringConverter
+
+
+        private sealed class VectorConverter : StlConverter
+        {
+            protected override object DoConvert( DbgSymbol symbol )
+            {
+                // N.B. vector<bool> has _Myvec instead, so we won't find the state, and
+                // it goes to its own script converter.
+                uint stateOffset;
+                DbgNamedTypeInfo stateType;
+                if( !_TryFindState( symbol.Type, "_Myfirst", out stateOffset, out stateType ) )
+                    return null;
+
+                uint firstOffset, lastOffset, endOffset;
+                DbgNamedTypeInfo firstType, dontCare;
+                if( !_TryFindMember( stateType, "_Myfirst", out firstOffset, out firstType ) ||
+                    !_TryFindMember( stateType, "_Mylast", out lastOffset, out dontCare ) ||
+                    !_TryFindMember( stateType, "_Myend", out endOffset, out dontCare ) )
+                {
+                    return null;
+                }
+
+                var firstPtrType = firstType as DbgPointerTypeInfo;
+                if( null == firstPtrType )
+                    return null;
+
+                var elemType = firstPtrType.PointeeType;
+                ulong elemSize = elemType.Size;
+                if( 0 == elemSize )
+                    return null;
+
+                var debugger = symbol.Debugger;
+                ulong state = symbol.Address + stateOffset;
+                ulong first = debugger.ReadMemAs_pointer( state + firstOffset );
+                ulong last = debugger.ReadMemAs_pointer( state + lastOffset );
+                ulong end = debugger.ReadMemAs_pointer( state + endOffset );
+
+                if( 0 == first )
+                    return new StlVectorView( symbol, elemType, 0, 0, 0 );
+
+                if( (last < first) ||
+                    (end < last) ||
+                    (0 != ((last - first) % elemSize)) ||
+                    (((last - first) / elemSize) > Int32.MaxValue) )
+                {
+                    throw new DbgProviderException( Util.Sprintf( "Vector {0} looks corrupt: _Myfirst {1}, _Mylast {2}, _Myend {3}.",
+                                                                  symbol.Name,
+                                                                  DbgProvider.FormatUInt64( first, true ),
+                                                                  DbgProvider.FormatUInt64( last, true ),
+                                                                  DbgProvider.FormatUInt64( end, true ) ),
+                                                    "CorruptStlVector",
+                                                    ErrorCategory.InvalidData,
+                                                    symbol );
+                }
+
+                return new StlVectorView( symbol,
+                                          elemType,
+                                          first,
+                                          (int) ((last - first) / elemSize),
+                                          (end - first) / elemSize );
+            } // end DoConvert()
+        } // end class VectorConverter
+
+
+        private sealed class ListConverter : StlConverter
+        {
+            protected override object DoConvert( DbgSymbol symbol )
+            {
+                var layout = NodeLayout.TryCreateForList( symbol.Type, needSize: true );
+                if( null == layout )
+                    return null;
+
+                var debugger = symbol.Debugger;
+                ulong addr = symbol.Address;
+                return new StlNodeCollectionView( symbol,
+                                                  layout.ValType,
+                                                  () => _WalkList( debugger, layout, addr ) );
+            }
+        } // end class ListConverter
+
+
+        private sealed class ForwardListConverter : StlConverter
+        {
+            protected override object DoConvert( DbgSymbol symbol )
+            {
+                var layout = NodeLayout.TryCreateForList( symbol.Type, needSize: false );
+                if( null == layout )
+                    return null;
+
+                var debugger = symbol.Debugger;
+                ulong addr = symbol.Address;
+                return new StlNodeCollectionView( symbol,
+                                                  layout.ValType,
+                                                  () => _WalkForwardList( debugger, layout, addr ) );
+            }
+        } // end class ForwardListConverter
+
+
+        private sealed class SetConverter : StlConverter
+        {
+            protected override object DoConvert( DbgSymbol symbol )
+            {
+                var layout = NodeLayout.TryCreateForTree( symbol.Type );
+                if( null == layout )
+                    return null;
+
+                var debugger = symbol.Debugger;
+                ulong addr = symbol.Address;
+
+                // Sets are ordered (and a multiset can have duplicates), so rather than
+                // a set we use a list.
+                return new StlNodeCollectionView( symbol,
+                                                  layout.ValType,
+                                                  () => _WalkTree( debugger, layout, addr ) );
+            }
+        } // end class SetConverter
+
+
+        private sealed class MapConverter : StlConverter
+        {
+            // map and multimap are the same for our purposes; the PsIndexedDictionary
+            // can handle duplicate keys.
+            protected override object DoConvert( DbgSymbol symbol )
+            {
+                var layout = NodeLayout.TryCreateForTree( symbol.Type );
+                if( null == layout )
+                    return null;
+
+                var debugger = symbol.Debugger;
+                ulong addr = symbol.Address;
+                return _CreatePairDictionary( symbol,
+                                              layout.ValType,
+                                              layout.ReadSize( debugger, addr ),
+                                              () => _WalkTree( debugger, layout, addr ) );
+            }
+        } // end class MapConverter
+
+
+        private sealed class HashMapConverter : StlConverter
+        {
+            // The hash table has some fancy stuff... but it also keeps all the elements
+            // in a list, for easy iteration. We'll just use that.
+            protected override object DoConvert( DbgSymbol symbol )
+            {
+                uint stateOffset;
+                DbgNamedTypeInfo stateType;
+                if( !_TryFindState( symbol.Type, "_List", out stateOffset, out stateType ) )
+                    return null;
+
+                uint listOffset;
+                DbgNamedTypeInfo listType;
+                _TryFindMember( stateType, "_List", out listOffset, out listType );
+
+                var layout = NodeLayout.TryCreateForList( listType, needSize: true );
+                if( null == layout )
+                    return null;
+
+                var debugger = symbol.Debugger;
+                ulong listAddr = symbol.Address + stateOffset + listOffset;
+                return _CreatePairDictionary( symbol,
+                                              layout.ValType,
+                                              layout.ReadSize( debugger, listAddr ),
+                                              () => _WalkList( debugger, layout, listAddr ) );
+            }
+        } // end class HashMapConverter
+    } // end class StlValueConverters
+
+
+    /// <summary>
+    ///    A read-only view of the elements of an STL container, as produced by the
+    ///    built-in STL value converters. Element values are not created until they
+    ///    are asked for.
+    /// </summary>
+    public abstract class StlCollectionView : IReadOnlyList< PSObject >
+    {
+        private readonly DbgSymbol m_symbol;
+        private readonly DbgNamedTypeInfo m_elemType;
+        private Dictionary< int, PSObject > m_elemCache;
+
+
+        internal StlCollectionView( DbgSymbol symbol, DbgNamedTypeInfo elemType )
+        {
+            m_symbol = symbol ?? throw new ArgumentNullException( nameof( symbol ) );
+            m_elemType = elemType ?? throw new ArgumentNullException( nameof( elemType ) );
+        } // end constructor
+
+
+        internal DbgEngDebugger Debugger { get { return m_symbol.Debugger; } }
+
+        internal abstract ulong GetElementAddress( int idx );
+
+        /// <summary>
+        ///    Called before creating the value for an element that is not cached yet
+        ///    (a chance to prefetch memory).
+        /// </summary>
+        internal virtual void PrepareElement( int idx )
+        {
+        }
+
+
+        public abstract int Count { get; }
+
+
+        public PSObject this[ int idx ]
+        {
+            get
+            {
+                if( (idx >= Count) || (idx < 0) )
+                {
+                    throw new ArgumentOutOfRangeException( "idx",
+                                                           idx,
+                                                           Util.Sprintf( "Index {0} is out of range. Valid indices are [0 - {1}].",
+                                                                         idx,
+                                                                         Count - 1 ) );
+                }
+
+                if( null == m_elemCache )
+                    m_elemCache = new Dictionary< int, PSObject >( Math.Min( 256, Count ) );
+
+                PSObject val;
+                if( !m_elemCache.TryGetValue( idx, out val ) )
+                {
+                    PrepareElement( idx );
+                    var elemSym = new DbgSimpleSymbol( m_symbol.Debugger,
+                                                       Util.Sprintf( "{0}[{1}]", m_symbol.Name, idx ),
+                                                       m_elemType,
+                                                       GetElementAddress( idx ) );
+                    val = DbgValue.CreateDbgValue( elemSym );
+                    m_elemCache.Add( idx, val );
+                }
+                return val;
+            }
+        } // end indexer
+
+
+        public IEnumerator< PSObject > GetEnumerator()
+        {
+            for( int i = 0; i < Count; i++ )
+            {
+                yield return this[ i ];
+            }
+        }
+
+        IEnumerator IEnumerable.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+
+        // Preserve the original ToString() so we get the type name 'n stuff.
+        public override string ToString()
+        {
+            return m_symbol.GetStockValue().ToString();
+        }
+    } // end class StlCollectionView
+
+
+    /// <summary>
+    ///    The elements of a std::vector.
+    /// </summary>
+    public sealed class StlVectorView : StlCollectionView
+    {
+        // How much of the vector's storage to prefetch at a time.
+        private const ulong c_PrefetchWindow = 64 * 1024;
+
+        private readonly ulong m_first;
+        private readonly int m_count;
+        private readonly ulong m_capacity;
+        private readonly ulong m_elemSize;
+
+        // What we've prefetched most recently: [m_prefetchedStart, m_prefetchedEnd)
+        private ulong m_prefetchedStart;
+        private ulong m_prefetchedEnd;
+
+
+        internal StlVectorView( DbgSymbol symbol,
+                                DbgNamedTypeInfo elemType,
+                                ulong first,
+                                int count,
+                                ulong capacity )
+            : base( symbol, elemType )
+        {
+            m_first = first;
+            m_count = count;
+            m_capacity = capacity;
+            m_elemSize = elemType.Size;
+        } // end constructor
+
+
+        public override int Count { get { return m_count; } }
+
+        public int Size()
+        {
+            return m_count;
+        }
+
+        public ulong Capacity()
+        {
+            return m_capacity;
+        }
+
+
+        internal override ulong GetElementAddress( int idx )
+        {
+            return m_first + ((ulong) idx * m_elemSize);
+        }
+
+
+        internal override void PrepareElement( int idx )
+        {
+            ulong addr = GetElementAddress( idx );
+            if( (addr >= m_prefetchedStart) && ((addr + m_elemSize) <= m_prefetchedEnd) )
+                return;
+
+            ulong storageEnd = GetElementAddress( m_count );
+            ulong length = Math.Min( Math.Max( c_PrefetchWindow, m_elemSize ), storageEnd - addr );
+            if( length > UInt32.MaxValue )
+                return;
+
+            Debugger.PrefetchMem( addr, (uint) length );
+            m_prefetchedStart = addr;
+            m_prefetchedEnd = addr + length;
+        } // end PrepareElement()
+    } // end class StlVectorView
+
+
+    /// <summary>
+    ///    The elements of a node-based STL container (list, forward_list, set,
+    ///    multiset). The nodes are found the first time somebody looks at the
+    ///    elements (or asks how many there are).
+    /// </summary>
+    public sealed class StlNodeCollectionView : StlCollectionView
+    {
+        private Func< List< ulong > > m_walk;
+        private List< ulong > m_elemAddrs;
+
+
+        internal StlNodeCollectionView( DbgSymbol symbol,
+                                        DbgNamedTypeInfo elemType,
+                                        Func< List< ulong > > walk )
+            : base( symbol, elemType )
+        {
+            m_walk = walk;
+        } // end constructor
+
+
+        private List< ulong > _ElemAddrs
+        {
+            get
+            {
+                if( null == m_elemAddrs )
+                {
+                    m_elemAddrs = m_walk();
+                    m_walk = null;
+                }
+                return m_elemAddrs;
+            }
+        }
+
+
+        public override int Count { get { return _ElemAddrs.Count; } }
+
+
+        internal override ulong GetElementAddress( int idx )
+        {
+            return _ElemAddrs[ idx ];
+        }
+    } // end class StlNodeCollectionView
+}
@@ -35,7 +35,16 @@ public DbgNamedTypeInfo DataType
                 throw new ArgumentNullException( "debugger" );
 
             RawDataInfo rdi = DbgHelp.GetDataInfo( debugger.DebuggerInterface, module.BaseAddress, typeId );
+            return CreateFromRawInfo( debugger, module, typeId, rdi );
+        } // end GetDataTypeInfo()
+
 
+        // For when the RawDataInfo was already obtained (such as by DbgHelp.GetDataInfos).
+        internal static DbgDataTypeInfo CreateFromRawInfo( DbgEngDebugger debugger,
+                                                           DbgModuleInfo module,
+                                                           uint typeId,
+                                                           RawDataInfo rdi )
+        {
             switch( rdi.DataKind )
             {
                 case DataKind.Member:
@@ -46,7 +55,7 @@ public DbgNamedTypeInfo DataType
                 default:
                     return new DbgDataTypeInfo( debugger, module, typeId, rdi );
             }
-        } // end GetDataTypeInfo()
+        } // end CreateFromRawInfo()
                                                
 
         protected DbgDataTypeInfo( DbgEngDebugger debugger,
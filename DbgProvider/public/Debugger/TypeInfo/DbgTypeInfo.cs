@@ -1,7 +1,9 @@
 ﻿using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics;
 using System.Linq;
+using System.Threading;
 using DbgEngWrapper;
 using Microsoft.Diagnostics.Runtime.Interop;
 
@@ -395,24 +397,72 @@ protected uint[] GetChildrenIds( uint numChildren )
         // Looking up type information is expensive. Caching DbgTypeInfo objects can cut
         // down the time to create values for large objects by > 50%.
         //
-        //                         target context         modBase           typeId
-        private static Dictionary< DbgTarget, Dictionary< ulong, Dictionary< uint, DbgTypeInfo > > > sm_typeCache = null;
+        // Type lookups happen on every member access of every DbgValue, from formatting
+        // and ClrMd worker threads as well as the pipeline thread, so the cache is a
+        // single flat ConcurrentDictionary (lock-free reads; writes only contend with
+        // writes to the same stripe), and the hit/miss counters are striped too.
+        //
+
+        private struct TypeCacheKey : IEquatable< TypeCacheKey >
+        {
+            public readonly DbgTarget Target;
+            public readonly ulong ModBase;
+            public readonly uint TypeId;
+
+            public TypeCacheKey( DbgTarget target, ulong modBase, uint typeId )
+            {
+                Target = target;
+                ModBase = modBase;
+                TypeId = typeId;
+            }
+
+            public bool Equals( TypeCacheKey other )
+            {
+                return (TypeId == other.TypeId) &&
+                       (ModBase == other.ModBase) &&
+                       (Target == other.Target);
+            }
+
+            public override bool Equals( object obj )
+            {
+                return (obj is TypeCacheKey) && Equals( (TypeCacheKey) obj );
+            }
+
+            public override int GetHashCode()
+            {
+                // Type IDs are small and dense within a module, so they go in the low
+                // bits; module bases differ mostly in their upper bits.
+                ulong h = ((ulong) TypeId * 0x9E3779B97F4A7C15UL) ^ ModBase ^ (ModBase >> 32);
+                return ((int) h ^ (int) (h >> 32)) ^ Target.GetHashCode();
+            }
+        } // end struct TypeCacheKey
+
+
+        private static readonly ConcurrentDictionary< TypeCacheKey, DbgTypeInfo > sm_typeCache
+            = new ConcurrentDictionary< TypeCacheKey, DbgTypeInfo >( 4 * Environment.ProcessorCount, 4096 );
+
+        private static readonly bool sm_typeCacheDisabled
+            = !String.IsNullOrEmpty( Environment.GetEnvironmentVariable( "__DisableTypeCache" ) );
+
+        private static int sm_cacheEventsHooked;
 
         private static void _InitCache()
         {
-            if( null != sm_typeCache )
+            if( 0 != Volatile.Read( ref sm_cacheEventsHooked ) )
                 return;
 
-            sm_typeCache = new Dictionary< DbgTarget, Dictionary< ulong, Dictionary< uint, DbgTypeInfo > > >();
-            DbgEngDebugger._GlobalDebugger.UmProcessRemoved += _GlobalDebugger_ProcessRemoved;
-            DbgEngDebugger._GlobalDebugger.KmTargetRemoved += _GlobalDebugger_KmTargetRemoved;
+            if( 0 == Interlocked.Exchange( ref sm_cacheEventsHooked, 1 ) )
+            {
+                DbgEngDebugger._GlobalDebugger.UmProcessRemoved += _GlobalDebugger_ProcessRemoved;
+                DbgEngDebugger._GlobalDebugger.KmTargetRemoved += _GlobalDebugger_KmTargetRemoved;
+            }
         } // end _InitCache()
 
         private static void _GlobalDebugger_ProcessRemoved( object sender, UmProcessRemovedEventArgs e )
         {
             foreach( var procToRemove in e.Removed )
             {
-                sm_typeCache.Remove( procToRemove );
+                _RemoveFromCache( ( key ) => key.Target == procToRemove );
             } // end foreach( procToRemove )
         } // end _GlobalDebugger_ProcessRemoved()
 
@@ -423,83 +473,102 @@ private static void _GlobalDebugger_KmTargetRemoved( object sender, KmTargetRemo
             {
                 // What if we have types cached under a more-specific context? Let's just
                 // dump everything with a matching system id.
+                _RemoveFromCache( ( key ) => key.Target.DbgEngSystemId == targetToRemove.DbgEngSystemId );
+            } // end foreach( targetToRemove )
+        } // end _GlobalDebugger_KmTargetRemoved()
 
-                var toRemove = sm_typeCache.Keys.Where(
-                    (key) => key.DbgEngSystemId == targetToRemove.DbgEngSystemId ).ToList();
 
-                foreach( var removeMe in toRemove )
+        private static void _RemoveFromCache( Func< TypeCacheKey, bool > predicate )
+        {
+            // Enumerating a ConcurrentDictionary doesn't lock it (or take a snapshot), so
+            // this is safe to do while other threads are using it.
+            foreach( var kvp in sm_typeCache )
+            {
+                if( predicate( kvp.Key ) )
                 {
-                    sm_typeCache.Remove( targetToRemove );
+                    DbgTypeInfo dontCare;
+                    sm_typeCache.TryRemove( kvp.Key, out dontCare );
                 }
-            } // end foreach( targetToRemove )
-        } // end _GlobalDebugger_KmTargetRemoved()
+            }
+        } // end _RemoveFromCache()
+
+
+        // Each stripe is on its own cache line.
+        private const int c_counterStripes = 16;
+        private const int c_counterStride = 16; // longs
+        private static readonly long[] sm_cacheHitStripes = new long[ c_counterStripes * c_counterStride ];
+        private static readonly long[] sm_cacheMissStripes = new long[ c_counterStripes * c_counterStride ];
+
+        // The per-target vtable -> type cache (see DbgTarget.VTableTypeEntry) reports
+        // its statistics here too.
+        private static readonly long[] sm_vtableCacheHitStripes = new long[ c_counterStripes * c_counterStride ];
+        private static readonly long[] sm_vtableCacheMissStripes = new long[ c_counterStripes * c_counterStride ];
+
+        // And so does the target memory cache (see MemoryPageCache), so that all the
+        // cache statistics are in one place.
+        private static readonly long[] sm_memoryCacheHitStripes = new long[ c_counterStripes * c_counterStride ];
+        private static readonly long[] sm_memoryCacheMissStripes = new long[ c_counterStripes * c_counterStride ];
+
+        private static void _CountCacheLookup( bool hit )
+        {
+            int idx = (Environment.CurrentManagedThreadId & (c_counterStripes - 1)) * c_counterStride;
+            Interlocked.Increment( ref (hit ? sm_cacheHitStripes : sm_cacheMissStripes)[ idx ] );
+        }
+
+        internal static void _CountVTableCacheLookup( bool hit )
+        {
+            int idx = (Environment.CurrentManagedThreadId & (c_counterStripes - 1)) * c_counterStride;
+            Interlocked.Increment( ref (hit ? sm_vtableCacheHitStripes : sm_vtableCacheMissStripes)[ idx ] );
+        }
 
+        internal static void _CountMemoryCacheLookup( bool hit )
+        {
+            int idx = (Environment.CurrentManagedThreadId & (c_counterStripes - 1)) * c_counterStride;
+            Interlocked.Increment( ref (hit ? sm_memoryCacheHitStripes : sm_memoryCacheMissStripes)[ idx ] );
+        }
 
-        private static TValue _GetCacheEntryOrCreate< TKey, TValue >( TKey key, Dictionary< TKey, TValue > cache )
-            where TValue : new()
+        private static int _SumStripes( long[] stripes )
         {
-            TValue val = default( TValue );
-            if( !cache.TryGetValue( key, out val ) )
+            long total = 0;
+            for( int i = 0; i < stripes.Length; i += c_counterStride )
             {
-                val = new TValue();
-                cache.Add( key, val );
+                total += Volatile.Read( ref stripes[ i ] );
             }
-            return val;
-        } // end _GetCacheEntryOrCreate()
+            return (int) total;
+        }
 
-        private static object sm_syncRoot = new object();
+        public static int CacheHits { get { return _SumStripes( sm_cacheHitStripes ); } }
+        public static int CacheMisses { get { return _SumStripes( sm_cacheMissStripes ); } }
 
-        private static int sm_cacheHits;
-        private static int sm_cacheMisses;
+        public static int VTableCacheHits { get { return _SumStripes( sm_vtableCacheHitStripes ); } }
+        public static int VTableCacheMisses { get { return _SumStripes( sm_vtableCacheMissStripes ); } }
 
-        public static int CacheHits { get { return sm_cacheHits; } }
-        public static int CacheMisses { get { return sm_cacheMisses; } }
+        public static int MemoryCacheHits { get { return _SumStripes( sm_memoryCacheHitStripes ); } }
+        public static int MemoryCacheMisses { get { return _SumStripes( sm_memoryCacheMissStripes ); } }
 
         public static void ResetCacheStatistics()
         {
-            lock( sm_syncRoot )
+            for( int i = 0; i < sm_cacheHitStripes.Length; i += c_counterStride )
             {
-                sm_cacheHits = 0;
-                sm_cacheMisses = 0;
+                Volatile.Write( ref sm_cacheHitStripes[ i ], 0 );
+                Volatile.Write( ref sm_cacheMissStripes[ i ], 0 );
+                Volatile.Write( ref sm_vtableCacheHitStripes[ i ], 0 );
+                Volatile.Write( ref sm_vtableCacheMissStripes[ i ], 0 );
+                Volatile.Write( ref sm_memoryCacheHitStripes[ i ], 0 );
+                Volatile.Write( ref sm_memoryCacheMissStripes[ i ], 0 );
             }
         } // end ResetCacheStatistics()
 
         public static void PurgeCache()
         {
-            lock( sm_syncRoot )
-            {
-                if( null == sm_typeCache )
-                    return;
-
-                sm_typeCache.Clear();
-            }
+            sm_typeCache.Clear();
         } // end PurgeCache()
 
         public static int GetCacheSize()
         {
-            lock( sm_syncRoot )
-            {
-                if( null == sm_typeCache )
-                    return 0;
-
-                int total = 0;
-                foreach( var modCache in sm_typeCache.Values )
-                {
-                    foreach( var typeCache in modCache.Values )
-                    {
-                        total += typeCache.Count;
-                    }
-                }
-                return total;
-            }
+            return sm_typeCache.Count;
         } // end GetCacheSize()
 
-    //  // For debugging purposes only.
-    //  public static Dictionary< DbgTarget, Dictionary< ulong, Dictionary< uint, DbgTypeInfo > > > GetCache()
-    //  {
-    //      return sm_typeCache;
-    //  }
-
         private static ulong _AdjustModBase( ulong moduleBase,
                                              uint typeId,
                                              DbgTarget target )
@@ -528,72 +597,59 @@ public static int GetCacheSize()
                                               DbgTarget target,
                                               out DbgTypeInfo typeInfo )
         {
-            if( !String.IsNullOrEmpty( Environment.GetEnvironmentVariable( "__DisableTypeCache" ) ) )
+            if( sm_typeCacheDisabled )
             {
                 typeInfo = null;
                 return false;
             }
 
-            lock( sm_syncRoot )
-            {
-                _InitCache();
-
-                moduleBase = _AdjustModBase( moduleBase, typeId, target );
-                var perProcModCache = _GetCacheEntryOrCreate( target, sm_typeCache );
-                var perModTypeCache = _GetCacheEntryOrCreate( moduleBase, perProcModCache );
-                bool retVal = perModTypeCache.TryGetValue( typeId, out typeInfo );
+            moduleBase = _AdjustModBase( moduleBase, typeId, target );
+            bool retVal = sm_typeCache.TryGetValue( new TypeCacheKey( target, moduleBase, typeId ),
+                                                    out typeInfo );
 
-                if( retVal )
+            if( retVal )
+            {
+                // Before deciding if this is actually a hit, check that the type is
+                // still valid (maybe its symbols got reloaded since we cached it).
+                if( !typeInfo._CheckValid() )
                 {
-                    // Before deciding if this is actually a hit, check that the type is
-                    // still valid (maybe its symbols got reloaded since we cached it).
-                    if( !typeInfo._CheckValid() )
-                    {
-                        retVal = false;
-                        typeInfo = null;
+                    retVal = false;
+                    typeInfo = null;
 
-                        // If it's not valid for this type, it's not valid for any other
-                        // types in the module.
-                        perProcModCache.Remove( moduleBase );
-                    }
+                    // If it's not valid for this type, it's not valid for any other
+                    // types in the module.
+                    _RemoveFromCache( ( key ) => (key.ModBase == moduleBase) && (key.Target == target) );
                 }
+            }
 
+            _CountCacheLookup( retVal );
 
-                if( retVal )
-                    sm_cacheHits++;
-                else
-                    sm_cacheMisses++;
-
-             // LogManager.Trace( "DbgTypeInfo._TryGetFromCache: modbase {0}, typeId {1}: found? {2}",
-             //                   Util.FormatQWord( moduleBase ),
-             //                   typeId,
-             //                   retVal );
-                return retVal;
-            }
+         // LogManager.Trace( "DbgTypeInfo._TryGetFromCache: modbase {0}, typeId {1}: found? {2}",
+         //                   Util.FormatQWord( moduleBase ),
+         //                   typeId,
+         //                   retVal );
+            return retVal;
         } // end _TryGetFromCache()
 
         private static void _AddToCache( DbgTypeInfo typeInfo )
         {
-            if( !String.IsNullOrEmpty( Environment.GetEnvironmentVariable( "__DisableTypeCache" ) ) )
+            if( sm_typeCacheDisabled )
             {
                 return;
             }
 
-            lock( sm_syncRoot )
-            {
-                _InitCache();
-
-             // LogManager.Trace( "DbgTypeInfo._AddToCache: modbase {0}, typeId {1}",
-             //                   Util.FormatQWord( typeInfo.Module.BaseAddress ),
-             //                   typeInfo.TypeId );
-                var perProcCache = _GetCacheEntryOrCreate( typeInfo.Target, sm_typeCache );
-                var perModCache = _GetCacheEntryOrCreate( typeInfo.Module.BaseAddress, perProcCache );
-                // Two threads could have both had a cache miss for the same type and then
-                // subsequently try to add the type to the cache, so we don't fail if it
-                // already exists.
-                //perModCache.Add( typeInfo.TypeId, typeInfo );
-                perModCache[ typeInfo.TypeId ] = typeInfo;
-            }
+            _InitCache();
+
+         // LogManager.Trace( "DbgTypeInfo._AddToCache: modbase {0}, typeId {1}",
+         //                   Util.FormatQWord( typeInfo.Module.BaseAddress ),
+         //                   typeInfo.TypeId );
+
+            // Two threads could have both had a cache miss for the same type and then
+            // subsequently try to add the type to the cache, so we don't fail if it
+            // already exists.
+            sm_typeCache[ new TypeCacheKey( typeInfo.Target,
+                                            typeInfo.Module.BaseAddress,
+                                            typeInfo.TypeId ) ] = typeInfo;
         } // end _AddToCache()
 
         public static DbgTypeInfo GetTypeInfo( DbgEngDebugger debugger,
@@ -695,6 +751,77 @@ private static void _AddToCache( DbgTypeInfo typeInfo )
             return typeInfo;
         }
 
+        /// <summary>
+        ///    Gets type info for many type IDs from the same module at once (such as all
+        ///    the children of a UDT). Anything not already in the cache is loaded in a
+        ///    single trip to the dbgeng thread, with batched dbghelp requests for the
+        ///    SymTags and for data members.
+        /// </summary>
+        public static DbgTypeInfo[] GetTypeInfos( DbgEngDebugger debugger,
+                                                  DbgModuleInfo module,
+                                                  uint[] typeIds )
+        {
+            if( null == debugger )
+                throw new ArgumentNullException( "debugger" );
+
+            if( null == typeIds )
+                throw new ArgumentNullException( "typeIds" );
+
+            var typeInfos = new DbgTypeInfo[ typeIds.Length ];
+            var toLoad = new List< int >();
+            for( int i = 0; i < typeIds.Length; i++ )
+            {
+                if( !_TryGetFromCache( module.BaseAddress, typeIds[ i ], module.Target, out typeInfos[ i ] ) )
+                    toLoad.Add( i );
+            }
+
+            if( 0 == toLoad.Count )
+                return typeInfos;
+
+            debugger.ExecuteOnDbgEngThread( () =>
+                {
+                    // Generated types don't come from dbghelp; they go the usual route.
+                    var batch = new List< int >( toLoad.Count );
+                    foreach( int i in toLoad )
+                    {
+                        if( IsDbgGeneratedType( typeIds[ i ] ) )
+                            typeInfos[ i ] = _LoadTypeInfo( debugger, module, typeIds[ i ] );
+                        else
+                            batch.Add( i );
+                    }
+
+                    SymTag[] symTags = DbgHelp.GetSymTags( debugger.DebuggerInterface,
+                                                           module.BaseAddress,
+                                                           batch.Select( ( i ) => typeIds[ i ] ).ToArray() );
+
+                    var dataIdxs = new List< int >();
+                    for( int j = 0; j < batch.Count; j++ )
+                    {
+                        if( SymTag.Data == symTags[ j ] )
+                            dataIdxs.Add( batch[ j ] );
+                        else
+                            typeInfos[ batch[ j ] ] = _LoadTypeInfo( debugger, module, typeIds[ batch[ j ] ], symTags[ j ] );
+                    }
+
+                    RawDataInfo[] rdis = DbgHelp.GetDataInfos( debugger.DebuggerInterface,
+                                                               module.BaseAddress,
+                                                               dataIdxs.Select( ( i ) => typeIds[ i ] ).ToArray() );
+                    for( int j = 0; j < dataIdxs.Count; j++ )
+                    {
+                        int i = dataIdxs[ j ];
+                        typeInfos[ i ] = DbgDataTypeInfo.CreateFromRawInfo( debugger, module, typeIds[ i ], rdis[ j ] );
+                    }
+                } );
+
+            foreach( int i in toLoad )
+            {
+                _AddToCache( typeInfos[ i ] );
+            }
+
+            return typeInfos;
+        } // end GetTypeInfos()
+
+
         private static DbgTypeInfo _LoadTypeInfo( DbgEngDebugger debugger,
                                                   DbgModuleInfo module,
                                                   uint typeId,
@@ -452,9 +452,9 @@ private void _PopulateMembers()
 
             var childrenIds = GetChildrenIds( m_numChildren ); // _EnsureValid() called here
             var children    = new List< DbgTypeInfo >( childrenIds.Length );
-            foreach( var childId in childrenIds )
+            // Big UDTs can have hundreds of children, so we get them all in one go.
+            foreach( var child in DbgTypeInfo.GetTypeInfos( Debugger, Module, childrenIds ) )
             {
-                var child = DbgTypeInfo.GetTypeInfo( Debugger, Module, childId );
                 children.Add( child );
 
                 if( child is DbgDataMemberTypeInfo )
@@ -0,0 +1,308 @@
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Collections.ObjectModel;
+using System.Management.Automation;
+using System.Management.Automation.Language;
+using System.Runtime.CompilerServices;
+
+namespace MS.Dbg.Formatting
+{
+    /// <summary>
+    ///    A formatting script (a table column, list item, etc.), analyzed once so that
+    ///    simple scripts can be evaluated without running a pipeline.
+    /// </summary>
+    /// <remarks>
+    ///    Running a script for every cell means setting up a nested pipeline every
+    ///    time, which for big tables is most of the cost of formatting. But lots of
+    ///    column scripts are just things like "$_.Name" or "$_.get_Address()", or the
+    ///    "$PipeOutputIndex.ToString()" index column. Those are bound to direct
+    ///    member accessors, which are evaluated on the PSObject without PowerShell
+    ///    getting involved.
+    ///
+    ///    Direct evaluation only handles the happy path: if anything is out of the
+    ///    ordinary (a missing member, an exception, a collection in the middle of a
+    ///    member chain (member enumeration), etc.), TryEvaluate returns false, and the
+    ///    caller runs the script the normal way, which gets the right behavior (and
+    ///    errors) in all the corner cases.
+    ///
+    ///    Scripts are compiled once per ScriptBlock instance (i.e. once per view
+    ///    definition), and cached for as long as the ScriptBlock is alive.
+    /// </remarks>
+    internal sealed class CompiledFormatScript
+    {
+        private static readonly ConditionalWeakTable< ScriptBlock, CompiledFormatScript > sm_cache
+            = new ConditionalWeakTable< ScriptBlock, CompiledFormatScript >();
+
+        /// <summary>
+        ///    Lets you compare direct evaluation against running every script in a
+        ///    pipeline. Can also be turned off with the __DisableCompiledFormatScripts
+        ///    environment variable, in case direct evaluation ever gets something wrong.
+        /// </summary>
+        internal static bool Disabled { get; set; }
+            = !String.IsNullOrEmpty( Environment.GetEnvironmentVariable( "__DisableCompiledFormatScripts" ) );
+
+
+        private enum Root
+        {
+            InputObject,
+            PipeOutputIndex,
+        }
+
+        private struct Step
+        {
+            public readonly string Name;
+            public readonly bool IsMethodCall;
+
+            public Step( string name, bool isMethodCall )
+            {
+                Name = name;
+                IsMethodCall = isMethodCall;
+            }
+        } // end struct Step
+
+
+        public ScriptBlock Script { get; }
+
+        private readonly bool m_canEvaluateDirectly;
+        private readonly Root m_root;
+        private readonly Step[] m_steps;
+
+
+        public static CompiledFormatScript Get( ScriptBlock script )
+        {
+            if( null == script )
+                throw new ArgumentNullException( "script" );
+
+            return sm_cache.GetValue( script, ( s ) => new CompiledFormatScript( s ) );
+        } // end Get()
+
+
+        private CompiledFormatScript( ScriptBlock script )
+        {
+            Script = script;
+
+            Root root;
+            Step[] steps;
+            m_canEvaluateDirectly = _TryCompile( script, out root, out steps );
+            m_root = root;
+            m_steps = steps;
+        } // end constructor
+
+
+        public bool CanEvaluateDirectly { get { return m_canEvaluateDirectly && !Disabled; } }
+
+
+        /// <summary>
+        ///    Tries to evaluate the script without a pipeline. If successful, results
+        ///    holds what the pipeline would have output.
+        /// </summary>
+        public bool TryEvaluate( PSObject inputObject, int pipeIndex, out Collection< PSObject > results )
+        {
+            results = null;
+            if( !CanEvaluateDirectly )
+                return false;
+
+            object cur;
+            if( Root.PipeOutputIndex == m_root )
+                cur = pipeIndex;
+            else
+                cur = inputObject;
+
+            try
+            {
+                for( int i = 0; i < m_steps.Length; i++ )
+                {
+                    if( !_TryEvaluateStep( cur, m_steps[ i ], out cur ) )
+                        return false;
+                }
+            }
+            catch( RuntimeException )
+            {
+                // Let the pipeline produce the error in the usual way.
+                return false;
+            }
+
+            results = new Collection< PSObject >();
+
+            // Like the pipeline would, unroll collections (but only one level).
+            IEnumerable enumerable = LanguagePrimitives.GetEnumerable( cur );
+            if( null != enumerable )
+            {
+                foreach( object item in enumerable )
+                {
+                    results.Add( (null == item) ? null : PSObject.AsPSObject( item ) );
+                }
+            }
+            else
+            {
+                results.Add( (null == cur) ? null : PSObject.AsPSObject( cur ) );
+            }
+            return true;
+        } // end TryEvaluate()
+
+
+        private static bool _TryEvaluateStep( object target, Step step, out object result )
+        {
+            result = null;
+
+            // Member access on $null is an error under StrictMode, and member access on
+            // a collection does member enumeration. We leave both to PowerShell.
+            if( (null == target) ||
+                ((target is PSObject) && (null == ((PSObject) target).BaseObject)) )
+            {
+                return false;
+            }
+
+            PSObject pso = PSObject.AsPSObject( target );
+            object baseObj = pso.BaseObject;
+            if( (baseObj is IEnumerable) && !(baseObj is string) )
+                return false;
+
+            if( step.IsMethodCall )
+            {
+                PSMethodInfo mi = pso.Methods[ step.Name ];
+                if( null == mi )
+                    return false;
+
+                result = mi.Invoke();
+                return true;
+            }
+
+            PSPropertyInfo pi = pso.Properties[ step.Name ];
+            if( null == pi )
+                return false;
+
+            result = pi.Value;
+            return true;
+        } // end _TryEvaluateStep()
+
+
+        /// <summary>
+        ///    Recognizes scripts that consist of nothing but a member chain on $_ (or
+        ///    $PSItem, or $PipeOutputIndex), where the members are properties, or calls
+        ///    to getters or ToString() with no arguments. For example:
+        ///
+        ///       { $_.Name }
+        ///       { $_.get_Module().Name }
+        ///       { $PipeOutputIndex.ToString() }
+        /// </summary>
+        private static bool _TryCompile( ScriptBlock script, out Root root, out Step[] steps )
+        {
+            root = Root.InputObject;
+            steps = null;
+
+            ScriptBlockAst sbAst = script.Ast as ScriptBlockAst;
+            if( null == sbAst )
+                return false;
+
+            if( (null != sbAst.ParamBlock) ||
+                (null != sbAst.DynamicParamBlock) ||
+                (null != sbAst.BeginBlock) ||
+                (null != sbAst.ProcessBlock) ||
+                (null == sbAst.EndBlock) )
+            {
+                return false;
+            }
+
+            NamedBlockAst end = sbAst.EndBlock;
+            if( ((null != end.Traps) && (end.Traps.Count > 0)) ||
+                (1 != end.Statements.Count) )
+            {
+                return false;
+            }
+
+            PipelineAst pipeline = end.Statements[ 0 ] as PipelineAst;
+            if( (null == pipeline) || (1 != pipeline.PipelineElements.Count) )
+                return false;
+
+            CommandExpressionAst cmdExpr = pipeline.PipelineElements[ 0 ] as CommandExpressionAst;
+            if( (null == cmdExpr) || (cmdExpr.Redirections.Count > 0) )
+                return false;
+
+            var reversedSteps = new List< Step >();
+            ExpressionAst expr = cmdExpr.Expression;
+            while( true )
+            {
+                // (InvokeMemberExpressionAst derives from MemberExpressionAst, so check
+                // it first.)
+                InvokeMemberExpressionAst invokeAst = expr as InvokeMemberExpressionAst;
+                if( null != invokeAst )
+                {
+                    string name;
+                    if( invokeAst.Static ||
+                        ((null != invokeAst.Arguments) && (invokeAst.Arguments.Count > 0)) ||
+                        !_TryGetMemberName( invokeAst.Member, out name ) )
+                    {
+                        return false;
+                    }
+
+                    if( !name.StartsWith( "get_", StringComparison.OrdinalIgnoreCase ) &&
+                        (0 != Util.Strcmp_OI( name, "ToString" )) )
+                    {
+                        // Other methods might have side effects, and might get called
+                        // twice if we have to fall back to the pipeline.
+                        return false;
+                    }
+
+                    reversedSteps.Add( new Step( name, isMethodCall: true ) );
+                    expr = invokeAst.Expression;
+                    continue;
+                }
+
+                MemberExpressionAst memberAst = expr as MemberExpressionAst;
+                if( null != memberAst )
+                {
+                    string name;
+                    if( memberAst.Static || !_TryGetMemberName( memberAst.Member, out name ) )
+                        return false;
+
+                    reversedSteps.Add( new Step( name, isMethodCall: false ) );
+                    expr = memberAst.Expression;
+                    continue;
+                }
+
+                break;
+            } // end while( walking down the member chain )
+
+            VariableExpressionAst varAst = expr as VariableExpressionAst;
+            if( (null == varAst) || varAst.Splatted )
+                return false;
+
+            string varName = varAst.VariablePath.UserPath;
+            if( (0 == Util.Strcmp_OI( varName, "_" )) ||
+                (0 == Util.Strcmp_OI( varName, "PSItem" )) )
+            {
+                root = Root.InputObject;
+            }
+            else if( 0 == Util.Strcmp_OI( varName, "PipeOutputIndex" ) )
+            {
+                // Just "$PipeOutputIndex" would be fine, but it's never used that way.
+                if( 0 == reversedSteps.Count )
+                    return false;
+
+                root = Root.PipeOutputIndex;
+            }
+            else
+            {
+                return false;
+            }
+
+            reversedSteps.Reverse();
+            steps = reversedSteps.ToArray();
+            return true;
+        } // end _TryCompile()
+
+
+        private static bool _TryGetMemberName( CommandElementAst member, out string name )
+        {
+            name = null;
+            StringConstantExpressionAst sce = member as StringConstantExpressionAst;
+            if( (null == sce) || (StringConstantType.BareWord != sce.StringConstantType) )
+                return false;
+
+            name = sce.Value;
+            return !String.IsNullOrEmpty( name );
+        } // end _TryGetMemberName()
+    } // end class CompiledFormatScript
+}
@@ -680,16 +680,51 @@ protected string RenderScriptValue( PSObject inputObject, ScriptBlock script )
         protected static int sm_renderScriptCallDepth;
 #endif
 
-        private static readonly ScriptBlock sm_pipeIndexScript = ScriptBlock.Create( "$PipeOutputIndex = $args[0]" );
+        private CmdletInfo m_forEachObjectCmdlet;
+
+        // Scripts bound to m_preservedScriptContext, so that we only bind each one once
+        // per context.
+        private PSModuleInfo m_boundScriptsContext;
+        private Dictionary< ScriptBlock, ScriptBlock > m_boundScripts;
+
+        private ScriptBlock _BindToPreservedContext( ScriptBlock script )
+        {
+            if( m_boundScriptsContext != m_preservedScriptContext )
+            {
+                m_boundScriptsContext = m_preservedScriptContext;
+                m_boundScripts = new Dictionary< ScriptBlock, ScriptBlock >();
+            }
+
+            ScriptBlock bound;
+            if( !m_boundScripts.TryGetValue( script, out bound ) )
+            {
+                bound = m_preservedScriptContext.NewBoundScriptBlock( script );
+                m_boundScripts.Add( script, bound );
+            }
+            return bound;
+        } // end _BindToPreservedContext()
 
         protected string RenderScriptValue( PSObject inputObject,
                                             ScriptBlock script,
                                             bool dontGroupMultipleResults )
         {
+            // Simple scripts (like "$_.Name") don't need a pipeline.
+            Collection< PSObject > directResults;
+            if( CompiledFormatScript.Get( script ).TryEvaluate( inputObject, m_pipeIndex, out directResults ) )
+            {
+                if( 0 == directResults.Count )
+                    return null;
+
+                return ObjectsToMarkedUpString( directResults,
+                                                "{0}", // <-- IMPORTANT: this prevents infinite recursion via Format-AltSingleLine
+                                                null,
+                                                dontGroupMultipleResults ).ToString();
+            }
+
             // Let the script also use context created by the custom header script (if any).
             if( m_preservedScriptContext != null )
             {
-                script = m_preservedScriptContext.NewBoundScriptBlock( script );
+                script = _BindToPreservedContext( script );
             }
 
 #if DEBUG
@@ -735,9 +770,15 @@ protected string RenderScriptValue( PSObject inputObject, ScriptBlock script )
                     // Note that StrictMode will be enforced for value converters, because
                     // they execute in the scope of Debugger.Formatting.psm1, which sets
                     // StrictMode.
-                    InvokeCommand.InvokeScript(false, sm_pipeIndexScript, null, m_pipeIndex);
-                    var info = InvokeCommand.GetCmdlet( "ForEach-Object" );
-                    shell.AddCommand( info ).AddParameter( "Process", script );
+
+                    // (This is the same as running "$PipeOutputIndex = $args[0]", minus
+                    // the cost of running a script.)
+                    SessionState.PSVariable.Set( "PipeOutputIndex", m_pipeIndex );
+
+                    if( null == m_forEachObjectCmdlet )
+                        m_forEachObjectCmdlet = InvokeCommand.GetCmdlet( "ForEach-Object" );
+
+                    shell.AddCommand( m_forEachObjectCmdlet ).AddParameter( "Process", script );
                     results = shell.Invoke( new[] { inputObject } );
                 }
                 catch( RuntimeException e )
@@ -162,6 +162,11 @@ IEnumerator IEnumerable.GetEnumerator()
         private Dictionary< string, List< PSObject > > m_stringDict;
         private bool m_isReadOnly;
 
+        // For dictionaries that are filled in on first use (see the constructor that
+        // takes a populate callback).
+        private Action< PsIndexedDictionary > m_populate;
+        private Func< string > m_toString;
+
 
         public PsIndexedDictionary()
         {
@@ -177,6 +182,55 @@ public PsIndexedDictionary( int capacity )
             m_stringDict = new Dictionary< string, List< PSObject > >( capacity, StringComparer.OrdinalIgnoreCase );
         }
 
+        /// <summary>
+        ///    Creates a read-only dictionary whose items are not produced until somebody
+        ///    looks at it: populate is called (once) on first access, to Add the items.
+        ///    Building the keys means creating and formatting a value for every one of
+        ///    them, so this lets a big std::map be displayed in summary form (toString
+        ///    supplies the ToString() result) without paying for that.
+        /// </summary>
+        internal PsIndexedDictionary( int capacity,
+                                      Action< PsIndexedDictionary > populate,
+                                      Func< string > toString )
+            : this( capacity )
+        {
+            m_populate = populate ?? throw new ArgumentNullException( nameof( populate ) );
+            m_toString = toString;
+        }
+
+
+        private void _EnsurePopulated()
+        {
+            if( null == m_populate )
+                return;
+
+            var populate = m_populate;
+            m_populate = null; // (so that populate can Add)
+            try
+            {
+                populate( this );
+            }
+            catch
+            {
+                // Don't leave it half-filled (and writable): throw away whatever did
+                // get added, so that the next look at it tries again.
+                m_indexList.Clear();
+                m_dict.Clear();
+                m_stringDict.Clear();
+                m_populate = populate;
+                throw;
+            }
+            m_isReadOnly = true;
+        } // end _EnsurePopulated()
+
+        public override string ToString()
+        {
+            if( null != m_toString )
+                return m_toString();
+
+            return base.ToString();
+        }
+
 
         private void _CheckReadOnly()
         {
@@ -209,6 +263,7 @@ private static string _CreateStringKey( PSObject psoKey )
 
         public void Add( PSObject key, PSObject value )
         {
+            _EnsurePopulated();
             _CheckReadOnly();
             m_indexList.Add( new KeyValuePair< PSObject, PSObject >( key, value ) );
             List< PSObject > list;
@@ -232,22 +287,32 @@ public void Add( PSObject key, PSObject value )
 
         public bool ContainsKey( PSObject key )
         {
+            _EnsurePopulated();
             return m_dict.ContainsKey( key );
         }
 
         public bool ContainsKey( string stringKey )
         {
+            _EnsurePopulated();
             return m_stringDict.ContainsKey( stringKey );
         }
 
         public IEnumerable< PSObject > Keys
         {
-            get { return m_dict.Keys; }
+            get
+            {
+                _EnsurePopulated();
+                return m_dict.Keys;
+            }
         }
 
         public ICollection< String > StringKeys
         {
-            get { return m_stringDict.Keys; }
+            get
+            {
+                _EnsurePopulated();
+                return m_stringDict.Keys;
+            }
         }
 
         #region ICollection< KeyValuePair< PSObject, PSObject > > Members
@@ -256,18 +321,26 @@ public bool ContainsKey( string stringKey )
         // number will be smaller than m_indexList.Count.
         public int Count
         {
-            get { return m_dict.Count; }
+            get
+            {
+                _EnsurePopulated();
+                return m_dict.Count;
+            }
         }
 
         // For things with duplicate keys (like multimap), this includes duplicates.
         public int UncollapsedCount
         {
-            get { return m_indexList.Count; }
+            get
+            {
+                _EnsurePopulated();
+                return m_indexList.Count;
+            }
         }
 
         public bool IsReadOnly
         {
-            get { return m_isReadOnly; }
+            get { return m_isReadOnly || (null != m_populate); }
         }
 
         #endregion
@@ -276,6 +349,7 @@ public bool IsReadOnly
 
         public IEnumerator< KeyValuePair< PSObject, PSObject > > GetIndividualItemEnumerator()
         {
+            _EnsurePopulated();
             return m_indexList.GetEnumerator();
         }
 
@@ -298,6 +372,7 @@ IEnumerator IEnumerable.GetEnumerator()
 
         public bool TryGetValue( PSObject key, out IReadOnlyList< PSObject > value )
         {
+            _EnsurePopulated();
             List< PSObject > list;
             if( m_dict.TryGetValue( key, out list ) )
             {
@@ -310,6 +385,7 @@ public bool TryGetValue( PSObject key, out IReadOnlyList< PSObject > value )
 
         public bool TryGetValue( string stringKey, out IReadOnlyList< PSObject > value )
         {
+            _EnsurePopulated();
             List< PSObject > list;
             if( m_stringDict.TryGetValue( stringKey, out list ) )
             {
@@ -324,6 +400,7 @@ public bool TryGetValue( string stringKey, out IReadOnlyList< PSObject > value )
         {
             get
             {
+                _EnsurePopulated();
                 foreach( var val in m_dict.Values )
                 {
                     yield return new ReadOnlyCollection< PSObject >( val );
@@ -335,6 +412,7 @@ public bool TryGetValue( string stringKey, out IReadOnlyList< PSObject > value )
         {
             get
             {
+                _EnsurePopulated();
                 return new ReadOnlyCollection< PSObject >( m_dict[ key ] );
             }
         }
@@ -343,6 +421,7 @@ public bool TryGetValue( string stringKey, out IReadOnlyList< PSObject > value )
         {
             get
             {
+                _EnsurePopulated();
                 return new ReadOnlyCollection< PSObject >( m_stringDict[ stringKey ] );
             }
         }
@@ -352,6 +431,7 @@ public bool TryGetValue( string stringKey, out IReadOnlyList< PSObject > value )
         IEnumerator< KeyValuePair< PSObject, IReadOnlyList< PSObject > > >
         IEnumerable< KeyValuePair< PSObject, IReadOnlyList< PSObject > > >.GetEnumerator()
         {
+            _EnsurePopulated();
             foreach( var kvp in m_dict )
             {
                 yield return new KeyValuePair< PSObject, IReadOnlyList< PSObject > >(
@@ -368,6 +448,7 @@ public bool TryGetValue( string stringKey, out IReadOnlyList< PSObject > value )
         {
             get
             {
+                _EnsurePopulated();
                 if( null == m_valByIndexAdapter )
                 {
                     m_valByIndexAdapter = new IndexAdapter( m_indexList, IndexAdapterReturns.Values );
@@ -382,6 +463,7 @@ public bool TryGetValue( string stringKey, out IReadOnlyList< PSObject > value )
         {
             get
             {
+                _EnsurePopulated();
                 if( null == m_keyByIndexAdapter )
                 {
                     m_keyByIndexAdapter = new IndexAdapter( m_indexList, IndexAdapterReturns.Keys );
@@ -396,6 +478,7 @@ public bool TryGetValue( string stringKey, out IReadOnlyList< PSObject > value )
         {
             get
             {
+                _EnsurePopulated();
                 if( null == m_kvpByIndex )
                 {
                     m_kvpByIndex = new IndexAdapter( m_indexList, IndexAdapterReturns.Both );
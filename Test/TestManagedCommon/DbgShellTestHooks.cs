@@ -0,0 +1,1162 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Management.Automation;
+using System.Runtime.InteropServices;
+using System.Threading;
+using DbgEngWrapper;
+using Microsoft.Diagnostics.Runtime;
+using Microsoft.Diagnostics.Runtime.Interop;
+using Microsoft.Diagnostics.Runtime.Utilities;
+
+namespace MS.Dbg
+{
+    /// <summary>
+    ///    Entry points for Pester tests that need to get at DbgShell internals (this
+    ///    assembly can see them; script can't).
+    /// </summary>
+    public static class DbgShellTestHooks
+    {
+        //
+        // TypeLayoutDiskCache
+        //
+
+        private static byte[] _Serialize( Action< BinaryWriter > write )
+        {
+            using( var ms = new MemoryStream() )
+            {
+                using( var writer = new BinaryWriter( ms, System.Text.Encoding.Unicode, leaveOpen: true ) )
+                {
+                    write( writer );
+                }
+                return ms.ToArray();
+            }
+        } // end _Serialize()
+
+
+        private static RawDataInfo _MakeStaticMemberInfo( ulong address )
+        {
+            var dir = new DbgHelp.DataInfoRequest();
+            dir.SymTag = SymTag.Data;
+            dir.DataKind = DataKind.StaticMember;
+            dir.Address = address;
+            return new RawDataInfo( dir, valueFieldIsValid: false );
+        } // end _MakeStaticMemberInfo()
+
+
+        /// <summary>
+        ///    Saves a static data member record with the given address to a type cache
+        ///    file for a module loaded at savedModBase, then loads it back for the same
+        ///    module loaded at loadedModBase, and returns the address it comes back with.
+        /// </summary>
+        public static ulong RoundTripStaticMemberAddress( string cacheDirectory,
+                                                          ulong address,
+                                                          ulong savedModBase,
+                                                          ulong loadedModBase )
+        {
+            Guid pdbGuid = Guid.NewGuid();
+            string path = Path.Combine( cacheDirectory, Util.Sprintf( "{0:N}-1.dstc", pdbGuid ) );
+            RawDataInfo rdi = _MakeStaticMemberInfo( address );
+
+            using( var file = new TypeLayoutDiskCache.CacheFile( pdbGuid, 1, path ) )
+            {
+                file.AddRecord( 42,
+                                TypeLayoutDiskCache.RecordKind.Data,
+                                _Serialize( ( w ) => rdi.Serialize( w, savedModBase ) ) );
+                file.Save();
+            }
+
+            using( var file = new TypeLayoutDiskCache.CacheFile( pdbGuid, 1, path ) )
+            {
+                if( 1 != file.RecordCount )
+                    throw new InvalidDataException( Util.Sprintf( "Expected 1 record; got {0}.", file.RecordCount ) );
+
+                using( BinaryReader reader = file.TryGetRecord( 42, TypeLayoutDiskCache.RecordKind.Data ) )
+                {
+                    return new RawDataInfo( reader, loadedModBase ).Address;
+                }
+            }
+        } // end RoundTripStaticMemberAddress()
+
+
+        /// <summary>
+        ///    Writes a type cache file with a couple of records, damages it as
+        ///    specified ("None", "Truncate", "BadOffset", "BadLength" or "Unsorted"),
+        ///    opens it again, and returns how many records the cache will use from it.
+        /// </summary>
+        public static int OpenDamagedTypeCacheFile( string cacheDirectory, string damage )
+        {
+            Guid pdbGuid = Guid.NewGuid();
+            string path = Path.Combine( cacheDirectory, Util.Sprintf( "{0:N}-1.dstc", pdbGuid ) );
+
+            using( var file = new TypeLayoutDiskCache.CacheFile( pdbGuid, 1, path ) )
+            {
+                file.AddRecord( 1,
+                                TypeLayoutDiskCache.RecordKind.Data,
+                                _Serialize( ( w ) => _MakeStaticMemberInfo( 0x1000 ).Serialize( w, 0 ) ) );
+                file.AddRecord( 2,
+                                TypeLayoutDiskCache.RecordKind.Data,
+                                _Serialize( ( w ) => _MakeStaticMemberInfo( 0x2000 ).Serialize( w, 0 ) ) );
+                file.Save();
+            }
+
+            // See the file format in TypeLayoutDiskCache: a 64-byte header, then 16-byte
+            // index entries of (typeId, kind, offset, length).
+            const int c_firstEntry = 64;
+            const int c_entrySize = 16;
+            using( var fs = new FileStream( path, FileMode.Open, FileAccess.ReadWrite ) )
+            using( var writer = new BinaryWriter( fs ) )
+            {
+                switch( damage )
+                {
+                    case "None":
+                        break;
+                    case "Truncate":
+                        fs.SetLength( fs.Length - 1 );
+                        break;
+                    case "BadOffset":
+                        fs.Seek( c_firstEntry + 8, SeekOrigin.Begin );
+                        writer.Write( 0xfffffff0u );
+                        break;
+                    case "BadLength":
+                        fs.Seek( c_firstEntry + c_entrySize + 12, SeekOrigin.Begin );
+                        writer.Write( 0x7fffffffu );
+                        break;
+                    case "Unsorted":
+                        fs.Seek( c_firstEntry, SeekOrigin.Begin );
+                        writer.Write( 2u );
+                        fs.Seek( c_firstEntry + c_entrySize, SeekOrigin.Begin );
+                        writer.Write( 1u );
+                        break;
+                    default:
+                        throw new ArgumentException( Util.Sprintf( "Unknown damage: {0}", damage ), "damage" );
+                }
+            }
+
+            using( var file = new TypeLayoutDiskCache.CacheFile( pdbGuid, 1, path ) )
+            {
+                if( (0 == file.RecordCount) &&
+                    ((null != file.TryGetRecord( 1, TypeLayoutDiskCache.RecordKind.Data )) ||
+                     (null != file.TryGetRecord( 2, TypeLayoutDiskCache.RecordKind.Data ))) )
+                {
+                    throw new InvalidDataException( "A rejected file should not produce records." );
+                }
+                return file.RecordCount;
+            }
+        } // end OpenDamagedTypeCacheFile()
+
+
+        //
+        // ClrMD MemoryReader
+        //
+
+        /// <summary>
+        ///    Pretend target memory: [Base, Base + Size) is readable, and each pointer-sized
+        ///    slot in it holds its own address. Counts the reads that come to it.
+        /// </summary>
+        private class SyntheticDataReader : IDataReader
+        {
+            public readonly ulong Base;
+            public readonly ulong Size;
+            public int Reads;
+
+            public SyntheticDataReader( ulong baseAddress, ulong size )
+            {
+                Base = baseAddress;
+                Size = size;
+            }
+
+            public bool ReadMemory( ulong address, IntPtr buffer, int bytesRequested, out int bytesRead )
+            {
+                Reads++;
+                bytesRead = 0;
+                if( (address < Base) || (address >= Base + Size) )
+                    return false;
+
+                bytesRead = (int) Math.Min( (ulong) bytesRequested, Base + Size - address );
+                for( int i = 0; i < bytesRead; i++ )
+                {
+                    ulong slot = (address + (ulong) i) & ~7UL;
+                    int shift = (int) ((address + (ulong) i) - slot) * 8;
+                    Marshal.WriteByte( buffer, i, (byte) (slot >> shift) );
+                }
+                return true;
+            }
+
+            public bool ReadMemory( ulong address, byte[] buffer, int bytesRequested, out int bytesRead )
+            {
+                var h = GCHandle.Alloc( buffer, GCHandleType.Pinned );
+                try
+                {
+                    return ReadMemory( address, h.AddrOfPinnedObject(), bytesRequested, out bytesRead );
+                }
+                finally
+                {
+                    h.Free();
+                }
+            }
+
+            public uint GetPointerSize() { return 8; }
+            public Architecture GetArchitecture() { return Architecture.Amd64; }
+            public bool IsMinidump { get { return false; } }
+            public void Close() { }
+            public void Flush() { }
+            public IList< ModuleInfo > EnumerateModules() { return new ModuleInfo[ 0 ]; }
+            public void GetVersionInfo( ulong baseAddress, out VersionInfo version ) { version = new VersionInfo(); }
+            public ulong GetThreadTeb( uint thread ) { return 0; }
+            public IEnumerable< uint > EnumerateAllThreads() { return new uint[ 0 ]; }
+            public bool VirtualQuery( ulong addr, out VirtualQueryData vq ) { vq = new VirtualQueryData(); return false; }
+            public bool GetThreadContext( uint threadID, uint contextFlags, uint contextSize, IntPtr context ) { return false; }
+            public bool GetThreadContext( uint threadID, uint contextFlags, uint contextSize, byte[] context ) { return false; }
+            public ulong ReadPointerUnsafe( ulong addr ) { throw new NotImplementedException(); }
+            public uint ReadDwordUnsafe( ulong addr ) { throw new NotImplementedException(); }
+        } // end class SyntheticDataReader
+
+
+        /// <summary>
+        ///    Scans 'pages' pages of synthetic memory front to back the way the heap walk
+        ///    does (calling Prefetch with 'readAheadPages' as it crosses onto each new
+        ///    page), checks every pointer it reads, and returns how many reads went to the
+        ///    data reader.
+        /// </summary>
+        public static int CountLinearScanReads( int pages, int readAheadPages )
+        {
+            const ulong c_base = 0x10000000;
+            const int c_pageSize = MemoryReader.DefaultPageSize;
+
+            var dataReader = new SyntheticDataReader( c_base, (ulong) pages * c_pageSize );
+            var reader = new MemoryReader( dataReader, 64 * c_pageSize );
+
+            ulong page = 0;
+            for( ulong addr = c_base; addr < c_base + dataReader.Size; addr += 0x40 )
+            {
+                if( (addr & ~(ulong) (c_pageSize - 1)) != page )
+                {
+                    page = addr & ~(ulong) (c_pageSize - 1);
+                    if( readAheadPages > 0 )
+                        reader.Prefetch( addr, readAheadPages );
+                }
+
+                ulong value;
+                if( !reader.ReadPtr( addr, out value ) || (value != addr) )
+                {
+                    throw new InvalidDataException( Util.Sprintf( "Bad read at {0:x}: {1:x}", addr, value ) );
+                }
+            }
+
+            return dataReader.Reads;
+        } // end CountLinearScanReads()
+
+
+        /// <summary>
+        ///    Fills a small (one set, 4-way) cache, uses the first page again, then has
+        ///    Prefetch look at (but not read) the rest. Returns true if the page that
+        ///    gets evicted by the next miss is still the least recently *used* one (that
+        ///    is, Prefetch's probing didn't count as a use).
+        /// </summary>
+        public static bool PrefetchProbeLeavesLruAlone()
+        {
+            const ulong c_base = 0x10000000;
+            const int c_pageSize = MemoryReader.DefaultPageSize;
+
+            var dataReader = new SyntheticDataReader( c_base, 16 * c_pageSize );
+            var reader = new MemoryReader( dataReader, 4 * c_pageSize, c_pageSize, 4 );
+
+            ulong value;
+            for( int i = 0; i < 4; i++ )
+                reader.ReadPtr( c_base + (ulong) (i * c_pageSize), out value );
+
+            // Pages 1, 2, 3 are now older than page 0.
+            reader.ReadPtr( c_base, out value );
+
+            // Everything from page 1 through page 3 is here, so this has nothing to read;
+            // but it has to look at pages 1 through 3 to find that out.
+            int readsBefore = dataReader.Reads;
+            reader.Prefetch( c_base, 3 );
+            if( dataReader.Reads != readsBefore )
+                return false;
+
+            // A miss now should evict page 1, not page 0.
+            reader.ReadPtr( c_base + (ulong) (4 * c_pageSize), out value );
+            return reader.Contains( c_base ) && !reader.Contains( c_base + (ulong) c_pageSize );
+        } // end PrefetchProbeLeavesLruAlone()
+
+
+        //
+        // ClrMD heap
+        //
+
+        /// <summary>
+        ///    Counts the objects on the heap and adds up their sizes by type the way the
+        ///    baseline does (one object at a time, with ClrHeap.EnumerateObjects()), for
+        ///    checking the parallel and indexed versions against.
+        /// </summary>
+        public static IList< ClrTypeStatistics > GetSerialTypeStatistics( ClrHeap heap )
+        {
+            return GetSerialTypeStatistics( heap, false );
+        } // end GetSerialTypeStatistics()
+
+
+        /// <summary>
+        ///    Like GetSerialTypeStatistics( heap ), but can also estimate retained sizes,
+        ///    by counting every object's distinct referrers in a dictionary (rather than
+        ///    the bitmaps that ClrHeap.GetTypeStatistics uses).
+        /// </summary>
+        public static IList< ClrTypeStatistics > GetSerialTypeStatistics( ClrHeap heap, bool estimateRetainedSizes )
+        {
+            Dictionary< ulong, int > referrers = null;
+            if( estimateRetainedSizes )
+            {
+                referrers = new Dictionary< ulong, int >();
+                foreach( ClrObject obj in heap.EnumerateObjects() )
+                {
+                    if( null == obj.Type )
+                        continue;
+
+                    foreach( ulong r in _GetDistinctRefs( obj ) )
+                    {
+                        int n;
+                        referrers.TryGetValue( r, out n );
+                        referrers[ r ] = n + 1;
+                    }
+                }
+
+                // Roots count as (more than one) referrer.
+                foreach( ClrRoot root in heap.EnumerateRoots() )
+                {
+                    referrers[ root.Object ] = 2;
+                }
+            }
+
+            var stats = new Dictionary< ClrType, ClrTypeStatistics >();
+            foreach( ClrObject obj in heap.EnumerateObjects() )
+            {
+                if( null == obj.Type )
+                    continue;
+
+                ClrTypeStatistics entry;
+                if( !stats.TryGetValue( obj.Type, out entry ) )
+                {
+                    entry = new ClrTypeStatistics( obj.Type );
+                    stats.Add( obj.Type, entry );
+                }
+
+                ulong retained = 0;
+                if( null != referrers )
+                {
+                    retained = obj.Size;
+                    foreach( ulong r in _GetDistinctRefs( obj ) )
+                    {
+                        int n;
+                        ClrType type;
+                        if( referrers.TryGetValue( r, out n ) &&
+                            (1 == n) &&
+                            (null != (type = heap.GetObjectType( r ))) )
+                        {
+                            retained += type.GetSize( r );
+                        }
+                    }
+                }
+                entry.Add( 1, obj.Size, retained );
+            }
+            return ClrTypeStatistics.Sort( stats.Values );
+        } // end GetSerialTypeStatistics()
+
+
+        private static HashSet< ulong > _GetDistinctRefs( ClrObject obj )
+        {
+            var refs = new HashSet< ulong >();
+            obj.Type.EnumerateRefsOfObjectCarefully( obj.Address, ( r, offset ) => refs.Add( r ) );
+            return refs;
+        } // end _GetDistinctRefs()
+
+
+        private class TypeTotals
+        {
+            public long Count;
+            public ulong TotalSize;
+            public ulong RetainedSize;
+        } // end class TypeTotals
+
+
+        private static Dictionary< string, TypeTotals > _TotalsByTypeName( IEnumerable< ClrTypeStatistics > stats )
+        {
+            var totals = new Dictionary< string, TypeTotals >();
+            foreach( var stat in stats )
+            {
+                TypeTotals total;
+                if( !totals.TryGetValue( stat.TypeName, out total ) )
+                {
+                    total = new TypeTotals();
+                    totals.Add( stat.TypeName, total );
+                }
+                total.Count += stat.Count;
+                total.TotalSize += stat.TotalSize;
+                total.RetainedSize += stat.RetainedSize;
+            }
+            return totals;
+        } // end _TotalsByTypeName()
+
+
+        /// <summary>
+        ///    Compares two sets of type statistics (by type name). Returns null if they
+        ///    have the same types, with the same counts, total sizes and retained sizes;
+        ///    otherwise a description of the first difference.
+        /// </summary>
+        public static string CompareTypeStatistics( IEnumerable< ClrTypeStatistics > expected,
+                                                    IEnumerable< ClrTypeStatistics > actual )
+        {
+            var e = _TotalsByTypeName( expected );
+            var a = _TotalsByTypeName( actual );
+
+            foreach( var kvp in e )
+            {
+                TypeTotals other;
+                if( !a.TryGetValue( kvp.Key, out other ) )
+                    return Util.Sprintf( "Missing type: {0}", kvp.Key );
+
+                if( (other.Count != kvp.Value.Count) ||
+                    (other.TotalSize != kvp.Value.TotalSize) ||
+                    (other.RetainedSize != kvp.Value.RetainedSize) )
+                {
+                    return Util.Sprintf( "{0}: expected {1} objects, {2} bytes ({3} retained); got {4} objects, {5} bytes ({6} retained)",
+                                         kvp.Key,
+                                         kvp.Value.Count,
+                                         kvp.Value.TotalSize,
+                                         kvp.Value.RetainedSize,
+                                         other.Count,
+                                         other.TotalSize,
+                                         other.RetainedSize );
+                }
+            }
+
+            foreach( var key in a.Keys )
+            {
+                if( !e.ContainsKey( key ) )
+                    return Util.Sprintf( "Unexpected type: {0}", key );
+            }
+
+            return null;
+        } // end CompareTypeStatistics()
+
+
+        /// <summary>
+        ///    Walks the heap with EnumerateObjects( degreeOfParallelism, ordered ) and
+        ///    compares what comes back with the baseline serial EnumerateObjects(): the
+        ///    same objects, with the same types, and (if ordered) in the same order.
+        ///    Returns null if they match; else the first difference.
+        /// </summary>
+        public static string CompareParallelWalk( ClrHeap heap, int degreeOfParallelism, bool ordered )
+        {
+            var serial = new List< ClrObject >( heap.EnumerateObjects() );
+            var parallel = new List< ClrObject >( heap.EnumerateObjects( degreeOfParallelism, ordered ) );
+
+            if( serial.Count != parallel.Count )
+                return Util.Sprintf( "Serial walk found {0} objects; parallel walk found {1}.", serial.Count, parallel.Count );
+
+            if( !ordered )
+            {
+                serial.Sort( ( x, y ) => x.Address.CompareTo( y.Address ) );
+                parallel.Sort( ( x, y ) => x.Address.CompareTo( y.Address ) );
+            }
+
+            for( int i = 0; i < serial.Count; i++ )
+            {
+                if( (serial[ i ].Address != parallel[ i ].Address) || (serial[ i ].Type?.Name != parallel[ i ].Type?.Name) )
+                {
+                    return Util.Sprintf( "Object {0}: serial walk has {1:x} ({2}); parallel walk has {3:x} ({4}).",
+                                         i,
+                                         serial[ i ].Address,
+                                         serial[ i ].Type?.Name,
+                                         parallel[ i ].Address,
+                                         parallel[ i ].Type?.Name );
+                }
+            }
+            return null;
+        } // end CompareParallelWalk()
+
+
+        /// <summary>
+        ///    Returns true if GetTypeStatistics gives up (OperationCanceledException)
+        ///    when handed a token that is already canceled.
+        /// </summary>
+        public static bool TypeStatisticsHonorCancellation( ClrHeap heap )
+        {
+            using( var cts = new System.Threading.CancellationTokenSource() )
+            {
+                cts.Cancel();
+                try
+                {
+                    heap.GetTypeStatistics( 0, cts.Token );
+                    return false;
+                }
+                catch( OperationCanceledException )
+                {
+                    return true;
+                }
+            }
+        } // end TypeStatisticsHonorCancellation()
+
+
+        private static string _CheckPath( ClrHeap heap, ulong target, GCRootPath path )
+        {
+            if( (0 == path.Objects.Count) ||
+                (path.Objects[ 0 ] != path.Root.Object) ||
+                (path.Objects[ path.Objects.Count - 1 ] != target) )
+            {
+                return Util.Sprintf( "Path doesn't go from the root to {0:x}: {1}", target, path );
+            }
+
+            for( int i = 0; i < path.Objects.Count - 1; i++ )
+            {
+                ulong from = path.Objects[ i ];
+                ulong to = path.Objects[ i + 1 ];
+                bool found = false;
+                heap.GetObjectType( from )?.EnumerateRefsOfObjectCarefully( from, ( r, o ) => found |= (r == to) );
+                if( !found )
+                    return Util.Sprintf( "{0:x} does not refer to {1:x} in path {2}", from, to, path );
+            }
+            return null;
+        } // end _CheckPath()
+
+
+        // (Keyed by description, since each search enumerates the roots afresh.)
+        private static HashSet< string > _FindAllPaths( ClrHeap heap,
+                                                      ulong target,
+                                                      int degreeOfParallelism,
+                                                      long markingMemoryBudget,
+                                                      List< string > problems )
+        {
+            var finder = new GCRootFinder( heap );
+            finder.DegreeOfParallelism = degreeOfParallelism;
+            finder.MarkingMemoryBudget = markingMemoryBudget;
+
+            var roots = new HashSet< string >();
+            foreach( var path in finder.FindAllPaths( target, System.Threading.CancellationToken.None ) )
+            {
+                string problem = _CheckPath( heap, target, path );
+                if( null != problem )
+                    problems.Add( problem );
+
+                roots.Add( Util.Sprintf( "{0} {1:x} -> {2:x}", path.Root.Kind, path.Root.Address, path.Root.Object ) );
+            }
+            return roots;
+        } // end _FindAllPaths()
+
+
+        /// <summary>
+        ///    For up to maxTargets objects spread across the heap, finds all root paths
+        ///    single-threaded, then with several workers (with the default marking
+        ///    budget, and with one so small that only one worker fits), and checks that
+        ///    they find paths from the same roots, that every path is a real chain of
+        ///    references (checked with the baseline EnumerateRefsOfObjectCarefully), and
+        ///    that FindShortestPath agrees about whether there is one. Returns null if
+        ///    all is well; else the problems found.
+        /// </summary>
+        public static string CompareRootPaths( ClrHeap heap, int maxTargets )
+        {
+            var all = new List< ulong >();
+            foreach( ulong obj in heap.EnumerateObjectAddresses() )
+            {
+                all.Add( obj );
+            }
+
+            var problems = new List< string >();
+            int step = Math.Max( 1, all.Count / maxTargets );
+            for( int i = 0; i < all.Count; i += step )
+            {
+                ulong target = all[ i ];
+                var serial = _FindAllPaths( heap, target, 1, 0, problems );
+                var parallel = _FindAllPaths( heap, target, Environment.ProcessorCount * 2, 0, problems );
+                var starved = _FindAllPaths( heap, target, Environment.ProcessorCount * 2, 1, problems );
+
+                if( !serial.SetEquals( parallel ) || !serial.SetEquals( starved ) )
+                {
+                    problems.Add( Util.Sprintf( "{0:x}: paths from {1} roots single-threaded, {2} in parallel, {3} on a tiny budget.",
+                                                target,
+                                                serial.Count,
+                                                parallel.Count,
+                                                starved.Count ) );
+                }
+
+                var shortest = new GCRootFinder( heap ).FindShortestPath( target, System.Threading.CancellationToken.None );
+                if( (null == shortest) != (0 == serial.Count) )
+                {
+                    problems.Add( Util.Sprintf( "{0:x}: FindShortestPath and FindAllPaths disagree.", target ) );
+                }
+                else if( null != shortest )
+                {
+                    string problem = _CheckPath( heap, target, shortest );
+                    if( null != problem )
+                        problems.Add( problem );
+                }
+            }
+
+            return (0 == problems.Count) ? null : String.Join( Environment.NewLine, problems );
+        } // end CompareRootPaths()
+
+
+        //
+        // PsIndexedDictionary
+        //
+
+        /// <summary>
+        ///    Makes a lazily-populated PsIndexedDictionary whose populate callback adds an
+        ///    item and then fails the first time it is called, and checks that the
+        ///    failure doesn't leave it half-filled or writable, and that the next look
+        ///    populates it properly. Returns null if all is well; else what went wrong.
+        /// </summary>
+        public static string CheckPopulateFailureRecovery()
+        {
+            int calls = 0;
+            var dict = new PsIndexedDictionary( 2,
+                                                ( d ) =>
+                                                {
+                                                    calls++;
+                                                    d.Add( new PSObject( "one" ), new PSObject( 1 ) );
+                                                    if( 1 == calls )
+                                                        throw new InvalidOperationException( "Simulated failure." );
+
+                                                    d.Add( new PSObject( "two" ), new PSObject( 2 ) );
+                                                },
+                                                () => "lazy" );
+            try
+            {
+                int count = dict.Count;
+                return Util.Sprintf( "The first look should have failed (Count: {0}).", count );
+            }
+            catch( InvalidOperationException )
+            {
+            }
+
+            if( !dict.IsReadOnly )
+                return "The dictionary became writable.";
+
+            if( 2 != dict.Count )
+                return Util.Sprintf( "Expected 2 items after the retry; got {0}.", dict.Count );
+
+            if( 2 != calls )
+                return Util.Sprintf( "Expected 2 populate calls; got {0}.", calls );
+
+            if( !dict.IsReadOnly )
+                return "The dictionary is not read-only after populating.";
+
+            return null;
+        } // end CheckPopulateFailureRecovery()
+
+
+        //
+        // Disassembly
+        //
+
+        public static ulong ParseBranchTarget( string instruction, string arguments )
+        {
+            return DbgDisassembly._ParseBranchTarget( instruction, arguments );
+        }
+
+        /// <summary>
+        ///    The number of instructions in the current target's disassembly cache.
+        /// </summary>
+        public static int GetDisassemblyCacheSize( DbgEngDebugger debugger )
+        {
+            DbgTarget target = debugger.GetCurrentTarget();
+            return null == target ? 0 : target.GetDisassemblyCacheSize();
+        } // end GetDisassemblyCacheSize()
+
+
+        //
+        // TraceRing
+        //
+
+        private static readonly int sm_fmtTraceRingTest = TraceRing.RegisterFormat( "DbgShellTestHooks: {0} ({1})" );
+
+        /// <summary>
+        ///    Traces a message through the trace ring. Returns false if the ring is
+        ///    turned off (in which case the message went straight to the log).
+        /// </summary>
+        public static bool TraceThroughRing( string message, int number )
+        {
+            TraceRing.Trace( sm_fmtTraceRingTest, message, number );
+            return TraceRing.IsEnabled;
+        } // end TraceThroughRing()
+
+
+        //
+        // DbgEngThread queue
+        //
+
+        /// <summary>
+        ///    Has 'producers' threads each add 'countPerProducer' actions to an
+        ///    MpscActionQueue with the given capacity (small enough, and the producers
+        ///    spin on a full ring), while one consumer thread drains it. Checks that every
+        ///    action ran exactly once, on the consumer, in the order each producer added
+        ///    them, and that Add fails once adding is complete. Returns null if all is
+        ///    well; else what went wrong.
+        /// </summary>
+        public static string CheckMpscActionQueue( int producers, int countPerProducer, int capacity )
+        {
+            var q = new MpscActionQueue( capacity );
+            var nextExpected = new int[ producers ];
+            var problems = new List< string >();
+            int consumerThreadId = 0;
+            int ran = 0;
+
+            var consumer = new Thread( () =>
+                {
+                    consumerThreadId = Thread.CurrentThread.ManagedThreadId;
+                    while( q.DrainTo( ( a ) => a() ) )
+                    {
+                    }
+                } );
+            consumer.Start();
+
+            var threads = new Thread[ producers ];
+            for( int p = 0; p < producers; p++ )
+            {
+                int producer = p;
+                threads[ p ] = new Thread( () =>
+                    {
+                        for( int i = 0; i < countPerProducer; i++ )
+                        {
+                            int seq = i;
+                            q.Add( () =>
+                                {
+                                    // Only the consumer runs these, so no locking needed
+                                    // (other than for 'problems', which we only look at
+                                    // once it has finished).
+                                    ran++;
+                                    if( Thread.CurrentThread.ManagedThreadId != consumerThreadId )
+                                        problems.Add( "An action ran on some thread other than the consumer." );
+
+                                    if( seq != nextExpected[ producer ] )
+                                    {
+                                        problems.Add( Util.Sprintf( "Producer {0}: expected action {1}; got {2}.",
+                                                                    producer,
+                                                                    nextExpected[ producer ],
+                                                                    seq ) );
+                                    }
+                                    nextExpected[ producer ] = seq + 1;
+                                } );
+                        }
+                    } );
+                threads[ p ].Start();
+            }
+
+            foreach( var t in threads )
+                t.Join();
+
+            q.CompleteAdding();
+            if( !consumer.Join( 30000 ) )
+                return "The consumer did not finish.";
+
+            if( !q.IsCompleted )
+                problems.Add( "The queue is not completed after being drained." );
+
+            try
+            {
+                q.Add( () => { } );
+                problems.Add( "Add should have failed after CompleteAdding." );
+            }
+            catch( InvalidOperationException )
+            {
+            }
+
+            if( ran != (producers * countPerProducer) )
+                problems.Add( Util.Sprintf( "Expected {0} actions to run; {1} did.", producers * countPerProducer, ran ) );
+
+            return (0 == problems.Count) ? null : String.Join( Environment.NewLine, problems );
+        } // end CheckMpscActionQueue()
+
+
+        //
+        // DbgEng output
+        //
+
+        private sealed class CapturingLinesCallbacks : IDebugOutputLinesCallbacksImp
+        {
+            public readonly List< string > Lines = new List< string >();
+            public Action FlushAdapter;
+
+            public int Output( DEBUG_OUTPUT Mask, string Text )
+            {
+                Lines.Add( "(Output called instead of OutputLines)" );
+                return 0;
+            }
+
+            public int OutputLines( DEBUG_OUTPUT Mask, IntPtr Text, IntPtr LineEnds, int Count )
+            {
+                int start = 0;
+                for( int i = 0; i < Count; i++ )
+                {
+                    int end = Marshal.ReadInt32( LineEnds, i * sizeof( int ) );
+                    Lines.Add( Util.Sprintf( "{0}: {1}",
+                                             Mask,
+                                             Marshal.PtrToStringUni( Text + (start * sizeof( char )), end - start ) ) );
+                    start = end;
+                }
+                return 0;
+            }
+
+            public void SetFlushCallback( Action Flush )
+            {
+                FlushAdapter = Flush;
+            }
+        } // end class CapturingLinesCallbacks
+
+
+        /// <summary>
+        ///    Sends each chunk through dbgeng (on a separate client, with masks[ i ] as
+        ///    its output mask) to a set of line callbacks, then flushes them if 'flush' is
+        ///    true. Returns what the callbacks got, in order: a "Mask: line" string for
+        ///    each line, and a "--" after each chunk (so you can tell which chunk got a
+        ///    line delivered).
+        /// </summary>
+        public static IList< string > CaptureDbgEngOutputLines( DbgEngDebugger debugger,
+                                                               string[] chunks,
+                                                               DEBUG_OUTPUT[] masks,
+                                                               bool flush )
+        {
+            var callbacks = new CapturingLinesCallbacks();
+            debugger.ExecuteOnDbgEngThread( () =>
+                {
+                    WDebugClient client;
+                    int hr = debugger.DebuggerInterface.CreateClient( out client );
+                    if( 0 != hr )
+                        throw new DbgEngException( hr );
+
+                    using( client )
+                    using( var control = (WDebugControl) client )
+                    {
+                        hr = client.SetOutputMask( DEBUG_OUTPUT.NORMAL | DEBUG_OUTPUT.ERROR | DEBUG_OUTPUT.WARNING | DEBUG_OUTPUT.VERBOSE );
+                        if( 0 != hr )
+                            throw new DbgEngException( hr );
+
+                        hr = client.SetOutputCallbacksWide( callbacks );
+                        if( 0 != hr )
+                            throw new DbgEngException( hr );
+
+                        try
+                        {
+                            for( int i = 0; i < chunks.Length; i++ )
+                            {
+                                control.ControlledOutputWide( DEBUG_OUTCTL.THIS_CLIENT, masks[ i ], chunks[ i ] );
+                                callbacks.Lines.Add( "--" );
+                            }
+
+                            if( flush )
+                                callbacks.FlushAdapter();
+                        }
+                        finally
+                        {
+                            client.SetOutputCallbacksWide( null );
+                        }
+                    }
+                } );
+            return callbacks.Lines;
+        } // end CaptureDbgEngOutputLines()
+
+
+        //
+        // DumpReader
+        //
+
+        /// <summary>
+        ///    Opens dumpPath (which must be the dump the debugger currently has loaded)
+        ///    with a DumpReader, and checks that reading through its chunk index agrees
+        ///    with dbgeng: at the start and end of every memory range, across the gaps
+        ///    between them, and at 'randomReads' random addresses. Returns null if all is
+        ///    well; else (the first several of) what went wrong.
+        /// </summary>
+        public static string CompareDumpReaderWithDebugger( DbgEngDebugger debugger,
+                                                            string dumpPath,
+                                                            int randomReads,
+                                                            int seed )
+        {
+            var problems = new List< string >();
+            using( var reader = new DumpReader( dumpPath ) )
+            {
+                var ranges = new List< VirtualQueryData >( reader.EnumerateMemoryRanges( 0, UInt64.MaxValue ) );
+                if( 0 == ranges.Count )
+                    return "No memory ranges in the dump.";
+
+                _CheckDumpRead( debugger, reader, ranges, ranges[ 0 ].BaseAddress - 1, 8, problems );
+
+                foreach( var range in ranges )
+                {
+                    ulong end = range.BaseAddress + range.Size;
+                    _CheckDumpRead( debugger, reader, ranges, range.BaseAddress, 8, problems );
+                    _CheckDumpRead( debugger, reader, ranges, end - Math.Min( range.Size, 8 ), 8, problems );
+                    // Runs off the end, or into the next range:
+                    _CheckDumpRead( debugger, reader, ranges, end - 1, 8, problems );
+                    // In the gap, or the start of the next range:
+                    _CheckDumpRead( debugger, reader, ranges, end, 8, problems );
+                }
+
+                var rand = new Random( seed );
+                for( int i = 0; i < randomReads; i++ )
+                {
+                    var range = ranges[ rand.Next( ranges.Count ) ];
+                    ulong addr = range.BaseAddress + (ulong) (rand.NextDouble() * range.Size);
+                    _CheckDumpRead( debugger, reader, ranges, addr, 1 + rand.Next( 64 ), problems );
+                }
+            }
+
+            return (0 == problems.Count) ? null : String.Join( Environment.NewLine, problems );
+        } // end CompareDumpReaderWithDebugger()
+
+
+        // The index of the last range that starts at or below addr, or -1.
+        private static int _FindRange( List< VirtualQueryData > ranges, ulong addr )
+        {
+            int lo = 0;
+            int hi = ranges.Count - 1;
+            int found = -1;
+            while( lo <= hi )
+            {
+                int mid = lo + ((hi - lo) / 2);
+                if( ranges[ mid ].BaseAddress <= addr )
+                {
+                    found = mid;
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid - 1;
+                }
+            }
+            return found;
+        } // end _FindRange()
+
+
+        private static void _CheckDumpRead( DbgEngDebugger debugger,
+                                            DumpReader reader,
+                                            List< VirtualQueryData > ranges,
+                                            ulong addr,
+                                            int size,
+                                            List< string > problems )
+        {
+            if( problems.Count >= 10 )
+                return;
+
+            // What the dump reader should get: everything that's in the dump from addr
+            // on, up to the first byte that isn't (or 'size' bytes).
+            int expectedSize = 0;
+            bool inOneRange = false;
+            int idx = _FindRange( ranges, addr );
+            ulong next = addr;
+            while( (idx >= 0) &&
+                   (idx < ranges.Count) &&
+                   (expectedSize < size) &&
+                   (ranges[ idx ].BaseAddress <= next) &&
+                   ((next - ranges[ idx ].BaseAddress) < ranges[ idx ].Size) )
+            {
+                ulong available = ranges[ idx ].Size - (next - ranges[ idx ].BaseAddress);
+                int take = (int) Math.Min( available, (ulong) (size - expectedSize) );
+                if( 0 == expectedSize )
+                    inOneRange = (take == size);
+
+                expectedSize += take;
+                next += (ulong) take;
+                idx++;
+            }
+
+            var buf = new byte[ size ];
+            int got = reader.ReadPartialMemory( addr, buf, size );
+            if( got != expectedSize )
+            {
+                problems.Add( Util.Sprintf( "ReadPartialMemory( 0x{0:x}, {1} ) read {2} bytes; expected {3}.",
+                                            addr, size, got, expectedSize ) );
+                return;
+            }
+
+            if( 0 == got )
+                return;
+
+            byte[] mem;
+            if( !debugger.TryReadMem( addr, (uint) got, true, out mem ) )
+            {
+                problems.Add( Util.Sprintf( "The debugger could not read {0} bytes at 0x{1:x}.", got, addr ) );
+                return;
+            }
+
+            for( int i = 0; i < got; i++ )
+            {
+                if( buf[ i ] != mem[ i ] )
+                {
+                    problems.Add( Util.Sprintf( "The byte at 0x{0:x} is 0x{1:x2} from the DumpReader, but 0x{2:x2} from the debugger.",
+                                                addr + (ulong) i, buf[ i ], mem[ i ] ) );
+                    return;
+                }
+            }
+
+            if( (8 == size) && (8 == IntPtr.Size) )
+            {
+                // The unsafe read only works within a single chunk (one that straddles
+                // two gets 0, even if they are contiguous).
+                ulong expected = inOneRange ? BitConverter.ToUInt64( buf, 0 ) : 0;
+                ulong ptr = reader.ReadPointerUnsafe( addr );
+                if( ptr != expected )
+                {
+                    problems.Add( Util.Sprintf( "ReadPointerUnsafe( 0x{0:x} ) returned 0x{1:x}; expected 0x{2:x}.",
+                                                addr, ptr, expected ) );
+                }
+            }
+        } // end _CheckDumpRead()
+
+
+        //
+        // X86Decoder
+        //
+
+        private static string _DescribeX86Instruction( X86Instruction instr )
+        {
+            if( instr.HasBranchTarget )
+                return Util.Sprintf( "{0} {1} 0x{2:x}", instr.Length, instr.Flow, instr.BranchTarget );
+            else if( instr.HasMemoryAddress )
+                return Util.Sprintf( "{0} {1} [0x{2:x}]", instr.Length, instr.Flow, instr.MemoryAddress );
+            else
+                return Util.Sprintf( "{0} {1}", instr.Length, instr.Flow );
+        } // end _DescribeX86Instruction()
+
+
+        /// <summary>
+        ///    Decodes the instruction at the start of code (at address), and returns its
+        ///    length, flow and branch target or memory address (like "5 Call 0x1015" or
+        ///    "6 CallIndirect [0x2000]"); or null if it doesn't decode.
+        /// </summary>
+        public static string DecodeX86Instruction( byte[] code, ulong address, bool is64Bit )
+        {
+            X86Instruction instr;
+            if( !X86Decoder.TryDecode( code, address, is64Bit, out instr ) )
+                return null;
+
+            return _DescribeX86Instruction( instr );
+        } // end DecodeX86Instruction()
+
+
+        /// <summary>
+        ///    Looks for a call that ends at returnAddress, in code (which ends there).
+        ///    Returns it the way DecodeX86Instruction does, with its address in front; or
+        ///    null if there isn't one.
+        /// </summary>
+        public static string FindX86CallBefore( byte[] code, ulong returnAddress, bool is64Bit )
+        {
+            X86Instruction call;
+            if( !X86Decoder.TryFindCallBefore( code, returnAddress, is64Bit, out call ) )
+                return null;
+
+            return Util.Sprintf( "0x{0:x}: {1}", call.Address, _DescribeX86Instruction( call ) );
+        } // end FindX86CallBefore()
+
+
+        /// <summary>
+        ///    Has dbgeng disassemble (up to) 'instructions' instructions, starting at the
+        ///    first direct call target in the module, and checks X86Decoder against it:
+        ///    instruction lengths, direct branch targets, and that it finds a call before
+        ///    the address after each call. Returns null if they agree; else (the first
+        ///    several of) the differences.
+        /// </summary>
+        public static string CompareX86DecoderWithDbgEng( DbgEngDebugger debugger,
+                                                          DbgModuleInfo module,
+                                                          int instructions )
+        {
+            IMAGE_FILE_MACHINE effMach = debugger.GetEffectiveProcessorType();
+            if( (IMAGE_FILE_MACHINE.AMD64 != effMach) && (IMAGE_FILE_MACHINE.I386 != effMach) )
+                return Util.Sprintf( "Machine type not supported: {0}", effMach );
+
+            bool is64Bit = IMAGE_FILE_MACHINE.AMD64 == effMach;
+
+            byte[] code;
+            if( !debugger.TryReadMem( module.BaseAddress, (uint) module.Size, false, out code ) || (0 == code.Length) )
+                return Util.Sprintf( "Could not read module {0}.", module.Name );
+
+            ulong end = module.BaseAddress + (ulong) code.Length;
+            var sites = new X86CallSite[ 4096 ];
+            int scanned;
+            int count = X86Decoder.FindCalls( code, module.BaseAddress, is64Bit, sites, out scanned );
+            ulong start = 0;
+            for( int i = 0; i < count; i++ )
+            {
+                if( (X86Flow.Call == sites[ i ].Flow) && (sites[ i ].Target >= module.BaseAddress) && (sites[ i ].Target < end) )
+                {
+                    start = sites[ i ].Target;
+                    break;
+                }
+            }
+
+            if( 0 == start )
+                return Util.Sprintf( "No direct call targets found in module {0}.", module.Name );
+
+            ulong next;
+            var disasm = debugger.DisassembleRange( start, end - 1, instructions, out next );
+            if( 0 == disasm.Count )
+                return Util.Sprintf( "DbgEng disassembled nothing at 0x{0:x}.", start );
+
+            var problems = new List< string >();
+            foreach( var instr in disasm )
+            {
+                if( problems.Count >= 10 )
+                    break;
+
+                int offset = (int) (instr.Address - module.BaseAddress);
+                var rest = new ReadOnlySpan< byte >( code, offset, code.Length - offset );
+                X86Instruction decoded;
+                if( !X86Decoder.TryDecode( rest, instr.Address, is64Bit, out decoded ) )
+                {
+                    problems.Add( Util.Sprintf( "0x{0:x}: X86Decoder could not decode it ({1}).", instr.Address, instr ) );
+                    continue;
+                }
+
+                if( decoded.Length != instr.Length )
+                {
+                    problems.Add( Util.Sprintf( "0x{0:x}: X86Decoder says {1} byte(s); dbgeng {2} ({3}).",
+                                                instr.Address, decoded.Length, instr.Length, instr ) );
+                    continue;
+                }
+
+                if( (0 != instr.BranchTarget) &&
+                    (!decoded.HasBranchTarget || (decoded.BranchTarget != instr.BranchTarget)) )
+                {
+                    problems.Add( Util.Sprintf( "0x{0:x}: X86Decoder says the branch target is {1}; dbgeng 0x{2:x} ({3}).",
+                                                instr.Address,
+                                                decoded.HasBranchTarget ? Util.Sprintf( "0x{0:x}", decoded.BranchTarget ) : "(none)",
+                                                instr.BranchTarget,
+                                                instr ) );
+                    continue;
+                }
+
+                if( decoded.IsCall )
+                {
+                    ulong returnAddress = instr.Address + (ulong) instr.Length;
+                    int before = Math.Min( offset + instr.Length, X86Decoder.MaxInstructionLength );
+                    X86Instruction call;
+                    if( !X86Decoder.TryFindCallBefore( new ReadOnlySpan< byte >( code, offset + instr.Length - before, before ),
+                                                       returnAddress,
+                                                       is64Bit,
+                                                       out call ) )
+                    {
+                        problems.Add( Util.Sprintf( "0x{0:x}: X86Decoder did not find the call before it ({1}).",
+                                                    returnAddress, instr ) );
+                    }
+                }
+            }
+
+            return (0 == problems.Count) ? null : String.Join( Environment.NewLine, problems );
+        } // end CompareX86DecoderWithDbgEng()
+
+
+        //
+        // Stacks
+        //
+
+        /// <summary>
+        ///    A new (not yet walked) DbgStackInfo for the thread, with the given
+        ///    MaxFrameCount (0 for all the frames). (DbgUModeThreadInfo.Stack hands out
+        ///    the same one every time, and once it has been walked, it stays walked.)
+        /// </summary>
+        public static DbgStackInfo NewStackInfo( DbgUModeThreadInfo thread, int maxFrames )
+        {
+            return new DbgStackInfo( thread, maxFrames );
+        } // end NewStackInfo()
+    } // end class DbgShellTestHooks
+}
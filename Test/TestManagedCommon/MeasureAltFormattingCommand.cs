@@ -0,0 +1,94 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Management.Automation;
+using MS.Dbg.Formatting;
+
+namespace MS.Dbg.Commands
+{
+    public class AltFormattingMeasurement : Measurement
+    {
+        public string FormatCommand { get; internal set; }
+    } // end class AltFormattingMeasurement
+
+
+    /// <summary>
+    ///    Measures how fast objects can be formatted with their registered alternate
+    ///    formatting views, with and without direct evaluation of simple view scripts.
+    /// </summary>
+    /// <remarks>
+    ///    The input objects (for instance, "Get-ClrObject" or "lm" output) are piped
+    ///    through -FormatCommand (Format-AltTable by default) -Repeat times, first with
+    ///    every script column/item run in a nested pipeline, and then with simple
+    ///    scripts (like "$_.Name") evaluated directly. The formatted output is
+    ///    discarded. Items is the number of input objects; Iterations is -Repeat.
+    /// </remarks>
+    [Cmdlet( VerbsDiagnostic.Measure, "AltFormatting" )]
+    [OutputType( typeof( AltFormattingMeasurement ) )]
+    public class MeasureAltFormattingCommand : MeasureCommandBase
+    {
+        [Parameter( Mandatory = true, Position = 0, ValueFromPipeline = true )]
+        public PSObject InputObject { get; set; }
+
+        [Parameter( Mandatory = false )]
+        [ValidateSet( "Format-AltTable", "Format-AltList" )]
+        public string FormatCommand { get; set; } = "Format-AltTable";
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, Int32.MaxValue )]
+        public int Repeat { get; set; } = 1;
+
+        protected override bool TrySetDebuggerContext { get { return false; } }
+
+
+        private static readonly ScriptBlock sm_formatScript =
+            ScriptBlock.Create( "param( $objs, $cmd ) $objs | & $cmd | Out-Null" );
+
+        private List< PSObject > m_objects = new List< PSObject >();
+
+
+        protected override void ProcessRecord()
+        {
+            base.ProcessRecord();
+            m_objects.Add( InputObject );
+        } // end ProcessRecord()
+
+
+        protected override void EndProcessing()
+        {
+            base.EndProcessing();
+
+            bool oldDisabled = CompiledFormatScript.Disabled;
+            try
+            {
+                // Warm up (JIT, view lookup, script compilation) before measuring.
+                _Format();
+
+                CompiledFormatScript.Disabled = true;
+                SafeWriteObject( _Measure( "Pipeline" ) );
+
+                CompiledFormatScript.Disabled = false;
+                SafeWriteObject( _Measure( "Compiled" ) );
+            }
+            finally
+            {
+                CompiledFormatScript.Disabled = oldDisabled;
+            }
+        } // end EndProcessing()
+
+
+        private AltFormattingMeasurement _Measure( string mode )
+        {
+            var sample = Time( Repeat, ( i ) => _Format() );
+            return MakeMeasurement( new AltFormattingMeasurement() { FormatCommand = FormatCommand },
+                                    mode,
+                                    m_objects.Count,
+                                    sample );
+        } // end _Measure()
+
+
+        private void _Format()
+        {
+            InvokeCommand.InvokeScript( false, sm_formatScript, null, m_objects.ToArray(), FormatCommand );
+        } // end _Format()
+    } // end class MeasureAltFormattingCommand
+}
@@ -0,0 +1,183 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Management.Automation;
+using Microsoft.Diagnostics.Runtime;
+
+namespace MS.Dbg.Commands
+{
+    public class ClrMemoryReaderMeasurement : Measurement
+    {
+        public int CacheSize { get; internal set; }
+        public int PageSize { get; internal set; }
+        public int Ways { get; internal set; }
+        public int Sets { get; internal set; }
+        public long Hits { get; internal set; }
+        public long Misses { get; internal set; }
+        public double HitRate { get; internal set; }
+    } // end class ClrMemoryReaderMeasurement
+
+
+    /// <summary>
+    ///    Replays a trace of heap memory reads against ClrMd's MemoryReader cache, for a
+    ///    range of cache geometries, and reports the hit rate and time per read.
+    /// </summary>
+    /// <remarks>
+    ///    If no trace is given, one is recorded by walking the heap (every object, and
+    ///    every reference out of every object) with tracing turned on in the heap's own
+    ///    MemoryReader. Use -RecordOnly to get the trace back so that it can be saved
+    ///    and replayed later (or against a different build).
+    ///
+    ///    The replay goes through the heap's real data reader, so the miss cost included
+    ///    in the timings is the real one. Items is the number of reads in the trace.
+    /// </remarks>
+    [Cmdlet( VerbsDiagnostic.Measure, "ClrMemoryReader" )]
+    [OutputType( typeof( ClrMemoryReaderMeasurement ) )]
+    public class MeasureClrMemoryReaderCommand : MeasureCommandBase
+    {
+        [Parameter( Mandatory = false, Position = 0, ValueFromPipeline = true )]
+        public ClrHeap Heap { get; set; }
+
+        [Parameter( Mandatory = false )]
+        public ulong[] Trace { get; set; }
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, Int32.MaxValue )]
+        public int MaxReads { get; set; } = 1000000;
+
+        [Parameter( Mandatory = false )]
+        [ValidateNotNullOrEmpty]
+        public int[] CacheSize { get; set; } = new int[] { 0x10000, 0x100000 };
+
+        [Parameter( Mandatory = false )]
+        [ValidateNotNullOrEmpty]
+        public int[] PageSize { get; set; } = new int[] { 0x1000 };
+
+        [Parameter( Mandatory = false )]
+        [ValidateNotNullOrEmpty]
+        public int[] Ways { get; set; } = new int[] { 1, 4 };
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, 100 )]
+        public int Iterations { get; set; } = 3;
+
+        [Parameter( Mandatory = false )]
+        public SwitchParameter RecordOnly { get; set; }
+
+
+        protected override void ProcessRecord()
+        {
+            base.ProcessRecord();
+
+            if( null == Heap )
+            {
+                Heap = Debugger.GetCurrentUModeProcess()
+                               ?.ClrRuntimes
+                               .Select( ( r ) => r.GetHeap() )
+                               .FirstOrDefault( ( h ) => h.CanWalkHeap );
+
+                if( null == Heap )
+                {
+                    SafeWriteError( "No walkable CLR heap in the current process.",
+                                    "NoWalkableHeap",
+                                    ErrorCategory.ObjectNotFound,
+                                    null );
+                    return;
+                }
+            }
+
+            var heapBase = (HeapBase) Heap;
+            ulong[] trace = Trace ?? _RecordTrace( heapBase );
+
+            if( RecordOnly )
+            {
+                SafeWriteObject( trace );
+                return;
+            }
+
+            WriteVerbose( Util.Sprintf( "Replaying {0} reads.", trace.Length ) );
+
+            var dataReader = Heap.Runtime.DataTarget.DataReader;
+            foreach( int cacheSize in CacheSize )
+            {
+                foreach( int pageSize in PageSize )
+                {
+                    foreach( int ways in Ways )
+                    {
+                        SafeWriteObject( _Replay( dataReader, trace, cacheSize, pageSize, ways, Iterations ) );
+                    }
+                }
+            }
+        } // end ProcessRecord()
+
+
+        private ulong[] _RecordTrace( HeapBase heap )
+        {
+            var trace = new List< ulong >();
+            var reader = heap.MemoryReader;
+            reader.Trace = trace;
+            try
+            {
+                Action< ulong, int > ignoreRef = ( r, o ) => { };
+                foreach( var obj in heap.EnumerateObjects() )
+                {
+                    obj.Type?.EnumerateRefsOfObjectCarefully( obj.Address, ignoreRef );
+
+                    if( trace.Count >= MaxReads )
+                        break;
+
+                    if( Stopping )
+                        throw new PipelineStoppedException();
+                }
+            }
+            finally
+            {
+                reader.Trace = null;
+            }
+
+            if( trace.Count > MaxReads )
+                trace.RemoveRange( MaxReads, trace.Count - MaxReads );
+
+            return trace.ToArray();
+        } // end _RecordTrace()
+
+
+        private ClrMemoryReaderMeasurement _Replay( IDataReader dataReader,
+                                                    ulong[] trace,
+                                                    int cacheSize,
+                                                    int pageSize,
+                                                    int ways,
+                                                    int iterations )
+        {
+            // Each iteration starts from a cold cache; the statistics reported are from
+            // the last one.
+            MemoryReader reader = null;
+            var sample = TimeParts( iterations, ( iter, timer ) =>
+                {
+                    reader = new MemoryReader( dataReader, cacheSize, pageSize, ways );
+                    timer.Start();
+                    foreach( ulong addr in trace )
+                    {
+                        reader.ReadPtr( addr, out ulong _ );
+                    }
+                    timer.Stop();
+                } );
+
+            long total = reader.Hits + reader.Misses;
+            var m = new ClrMemoryReaderMeasurement()
+            {
+                CacheSize = cacheSize,
+                PageSize = reader.PageSize,
+                Ways = reader.Ways,
+                Sets = reader.Sets,
+                Hits = reader.Hits,
+                Misses = reader.Misses,
+                HitRate = (0 == total) ? 0 : (double) reader.Hits / total,
+            };
+            return MakeMeasurement( m,
+                                    Util.Sprintf( "0x{0:x} in 0x{1:x} pages, {2}-way", cacheSize, reader.PageSize, reader.Ways ),
+                                    trace.Length,
+                                    sample );
+        } // end _Replay()
+    } // end class MeasureClrMemoryReaderCommand
+}
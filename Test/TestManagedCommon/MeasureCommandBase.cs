@@ -0,0 +1,212 @@
+﻿using System;
+using System.Diagnostics;
+using System.Management.Automation;
+using System.Threading;
+
+namespace MS.Dbg.Commands
+{
+    /// <summary>
+    ///    What every Measure-* command outputs (each one derives from this to add the
+    ///    details of its own passes).
+    /// </summary>
+    public class Measurement
+    {
+        /// <summary>
+        ///    Which variant was measured (say, the old code path versus the new one).
+        /// </summary>
+        public string Pass { get; internal set; }
+
+        /// <summary>
+        ///    How many of whatever the pass does (reads, calls, lines, ...), per
+        ///    iteration. With more than one thread, this is the total for all of them.
+        /// </summary>
+        public long Items { get; internal set; }
+
+        public int Iterations { get; internal set; }
+
+        /// <summary>
+        ///    The measured time, per iteration.
+        /// </summary>
+        public double Milliseconds { get; internal set; }
+
+        public double NanosecondsPerItem { get; internal set; }
+
+        public double ItemsPerSecond { get; internal set; }
+
+        /// <summary>
+        ///    Measured with AppDomain resource monitoring, so this includes whatever any
+        ///    other thread in the process allocated at the same time (like the dbgeng
+        ///    thread, or a background flusher).
+        /// </summary>
+        public double BytesAllocatedPerItem { get; internal set; }
+    } // end class Measurement
+
+
+    /// <summary>
+    ///    The scaffolding shared by the Measure-* commands: timing (with the garbage
+    ///    collected first, and allocations counted), iterations, and producer threads.
+    /// </summary>
+    /// <remarks>
+    ///    A command does whatever setup it needs, times each pass with one of the
+    ///    Time* methods, and fills in its own Measurement with MakeMeasurement.
+    ///    Stopping is checked between iterations (and wherever a TimeParts body calls
+    ///    PartTimer.CheckStopping), never inside the timed code.
+    /// </remarks>
+    public abstract class MeasureCommandBase : DbgBaseCommand
+    {
+        /// <summary>
+        ///    The result of timing a pass.
+        /// </summary>
+        protected struct Sample
+        {
+            public TimeSpan Elapsed;
+            public long BytesAllocated;
+            public int Iterations;
+        } // end struct Sample
+
+
+        /// <summary>
+        ///    Used to time only part of each iteration.
+        /// </summary>
+        protected sealed class PartTimer
+        {
+            private readonly MeasureCommandBase m_cmd;
+            internal readonly Stopwatch Stopwatch = new Stopwatch();
+
+            internal PartTimer( MeasureCommandBase cmd )
+            {
+                m_cmd = cmd;
+            }
+
+            public void Start()
+            {
+                Stopwatch.Start();
+            }
+
+            public void Stop()
+            {
+                Stopwatch.Stop();
+            }
+
+            /// <summary>
+            ///    For long untimed stretches: throws if the pipeline is stopping.
+            /// </summary>
+            public void CheckStopping()
+            {
+                m_cmd._CheckStopping();
+            }
+        } // end class PartTimer
+
+
+        private void _CheckStopping()
+        {
+            if( Stopping )
+                throw new PipelineStoppedException();
+        }
+
+
+        private Sample _Time( int iterations, Action< int, PartTimer > iteration )
+        {
+            AppDomain.MonitoringIsEnabled = true;
+
+            var timer = new PartTimer( this );
+            GC.Collect();
+            long bytesBefore = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize;
+
+            for( int i = 0; i < iterations; i++ )
+            {
+                iteration( i, timer );
+                _CheckStopping();
+            }
+
+            long bytes = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize - bytesBefore;
+            return new Sample()
+            {
+                Elapsed = timer.Stopwatch.Elapsed,
+                BytesAllocated = bytes,
+                Iterations = iterations,
+            };
+        } // end _Time()
+
+
+        /// <summary>
+        ///    Times iterations calls of body (which gets the iteration number).
+        /// </summary>
+        protected Sample Time( int iterations, Action< int > body )
+        {
+            return _Time( iterations, ( i, timer ) =>
+                {
+                    timer.Start();
+                    body( i );
+                    timer.Stop();
+                } );
+        } // end Time()
+
+
+        /// <summary>
+        ///    Times one call of body.
+        /// </summary>
+        protected Sample Time( Action body )
+        {
+            return Time( 1, ( i ) => body() );
+        } // end Time()
+
+
+        /// <summary>
+        ///    Runs iterations calls of body, which starts and stops the timer around
+        ///    just the part that counts. (Allocations are counted for all of it.)
+        /// </summary>
+        protected Sample TimeParts( int iterations, Action< int, PartTimer > body )
+        {
+            return _Time( iterations, body );
+        } // end TimeParts()
+
+
+        /// <summary>
+        ///    Times threadCount threads each calling body (with the thread's index).
+        ///    The threads are created before the clock starts.
+        /// </summary>
+        protected Sample TimeOnThreads( int threadCount, Action< int > body )
+        {
+            var threads = new Thread[ threadCount ];
+            for( int i = 0; i < threads.Length; i++ )
+            {
+                int idx = i;
+                threads[ i ] = new Thread( () => body( idx ) );
+            }
+
+            return Time( () =>
+                {
+                    foreach( var t in threads )
+                        t.Start();
+
+                    foreach( var t in threads )
+                        t.Join();
+                } );
+        } // end TimeOnThreads()
+
+
+        /// <summary>
+        ///    Fills in the common Measurement fields of m. items is per iteration.
+        /// </summary>
+        protected static TMeasurement MakeMeasurement< TMeasurement >( TMeasurement m,
+                                                                       string pass,
+                                                                       long items,
+                                                                       Sample sample )
+            where TMeasurement : Measurement
+        {
+            int iterations = Math.Max( 1, sample.Iterations );
+            double ms = sample.Elapsed.TotalMilliseconds / iterations;
+            long totalItems = items * iterations;
+
+            m.Pass = pass;
+            m.Items = items;
+            m.Iterations = iterations;
+            m.Milliseconds = ms;
+            m.NanosecondsPerItem = (0 == totalItems) ? 0 : (sample.Elapsed.TotalMilliseconds * 1000000.0) / totalItems;
+            m.ItemsPerSecond = (ms > 0) ? (items / (ms / 1000.0)) : 0;
+            m.BytesAllocatedPerItem = (0 == totalItems) ? 0 : (double) sample.BytesAllocated / totalItems;
+            return m;
+        } // end MakeMeasurement()
+    } // end class MeasureCommandBase
+}
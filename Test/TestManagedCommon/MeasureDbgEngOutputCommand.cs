@@ -0,0 +1,190 @@
+﻿using System;
+using System.Management.Automation;
+using System.Runtime.InteropServices;
+using System.Text;
+using DbgEngWrapper;
+using Microsoft.Diagnostics.Runtime.Interop;
+
+namespace MS.Dbg.Commands
+{
+    public class DbgEngOutputMeasurement : Measurement
+    {
+        public int Chunks { get; internal set; }
+    } // end class DbgEngOutputMeasurement
+
+
+    /// <summary>
+    ///    Measures how fast dbgeng output gets from dbgeng to a managed line consumer.
+    /// </summary>
+    /// <remarks>
+    ///    A separate debug client is created so that the debugger's own output callbacks
+    ///    are left alone. Output is produced by calling ControlledOutputWide on that
+    ///    client, -ChunksPerLine chunks to a line (dbgeng commands typically produce
+    ///    several chunks per line), and consumed by one of two callback
+    ///    implementations:
+    ///
+    ///       Chunks: gets a String per chunk, and splits it into lines with a
+    ///               StringBuilder (the way DbgEngDebugger used to).
+    ///       Lines:  implements IDebugOutputLinesCallbacksImp, and gets batches of
+    ///               complete lines from the native adapter.
+    ///
+    ///    The cost of producing the output (including marshaling each chunk to dbgeng)
+    ///    is included, and is the same for both. Items is the number of lines.
+    /// </remarks>
+    [Cmdlet( VerbsDiagnostic.Measure, "DbgEngOutput" )]
+    [OutputType( typeof( DbgEngOutputMeasurement ) )]
+    public class MeasureDbgEngOutputCommand : MeasureCommandBase
+    {
+        [Parameter( Mandatory = false, Position = 0 )]
+        [ValidateRange( 1, Int32.MaxValue )]
+        public int Lines { get; set; } = 100000;
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, 64 )]
+        public int ChunksPerLine { get; set; } = 4;
+
+        protected override bool TrySetDebuggerContext { get { return false; } }
+
+
+        private sealed class ChunkCallbacks : IDebugOutputCallbacksImp
+        {
+            private readonly StringBuilder m_sb = new StringBuilder();
+            public int LineCount;
+
+            public int Output( DEBUG_OUTPUT Mask, string Text )
+            {
+                for( int i = 0; i < Text.Length; i++ )
+                {
+                    if( '\r' == Text[ i ] )
+                        continue;
+
+                    if( '\n' == Text[ i ] )
+                    {
+                        var line = m_sb.ToString();
+                        m_sb.Clear();
+                        _ConsumeLine( line );
+                    }
+                    else
+                    {
+                        m_sb.Append( Text[ i ] );
+                    }
+                }
+                return 0;
+            }
+
+            private void _ConsumeLine( string line )
+            {
+                LineCount++;
+            }
+        } // end class ChunkCallbacks
+
+
+        private sealed class LineCallbacks : IDebugOutputLinesCallbacksImp
+        {
+            public int LineCount;
+
+            public int Output( DEBUG_OUTPUT Mask, string Text )
+            {
+                throw new InvalidOperationException( "The adapter should be calling OutputLines." );
+            }
+
+            public int OutputLines( DEBUG_OUTPUT Mask, IntPtr Text, IntPtr LineEnds, int Count )
+            {
+                int start = 0;
+                for( int i = 0; i < Count; i++ )
+                {
+                    int end = Marshal.ReadInt32( LineEnds, i * sizeof( int ) );
+                    _ConsumeLine( Marshal.PtrToStringUni( Text + (start * sizeof( char )), end - start ) );
+                    start = end;
+                }
+                return 0;
+            }
+
+            public void SetFlushCallback( Action Flush )
+            {
+            }
+
+            private void _ConsumeLine( string line )
+            {
+                LineCount++;
+            }
+        } // end class LineCallbacks
+
+
+        protected override void ProcessRecord()
+        {
+            base.ProcessRecord();
+
+            // Something like "0:000> dt -r" output: a field name, some padding, a value,
+            // and the line end, in separate chunks.
+            var chunks = new string[ ChunksPerLine ];
+            for( int i = 0; i < chunks.Length; i++ )
+            {
+                chunks[ i ] = (i == (chunks.Length - 1)) ? "0x00000000`12345678\n" : "   +0x018 Field" + i.ToString() + " : ";
+            }
+
+            var chunkCallbacks = new ChunkCallbacks();
+            var lineCallbacks = new LineCallbacks();
+
+            SafeWriteObject( _Measure( "Chunks", chunkCallbacks, chunks, () => chunkCallbacks.LineCount ) );
+            SafeWriteObject( _Measure( "Lines", lineCallbacks, chunks, () => lineCallbacks.LineCount ) );
+        } // end ProcessRecord()
+
+
+        private DbgEngOutputMeasurement _Measure( string name,
+                                                  IDebugOutputCallbacksImp callbacks,
+                                                  string[] chunks,
+                                                  Func< int > getLineCount )
+        {
+            int lines = Lines;
+            var sample = TimeParts( 1, ( iter, timer ) =>
+                {
+                    Debugger.ExecuteOnDbgEngThread( () =>
+                        {
+                            WDebugClient client;
+                            int hr = Debugger.DebuggerInterface.CreateClient( out client );
+                            if( 0 != hr )
+                                throw new DbgEngException( hr );
+
+                            using( client )
+                            using( var control = (WDebugControl) client )
+                            {
+                                hr = client.SetOutputCallbacksWide( callbacks );
+                                if( 0 != hr )
+                                    throw new DbgEngException( hr );
+
+                                try
+                                {
+                                    // Warm up (JIT, buffers).
+                                    foreach( var chunk in chunks )
+                                        control.ControlledOutputWide( DEBUG_OUTCTL.THIS_CLIENT, DEBUG_OUTPUT.NORMAL, chunk );
+
+                                    timer.Start();
+                                    for( int i = 0; i < lines; i++ )
+                                    {
+                                        foreach( var chunk in chunks )
+                                            control.ControlledOutputWide( DEBUG_OUTCTL.THIS_CLIENT, DEBUG_OUTPUT.NORMAL, chunk );
+                                    }
+                                    timer.Stop();
+                                }
+                                finally
+                                {
+                                    client.SetOutputCallbacksWide( null );
+                                }
+                            }
+                        } );
+                } );
+
+            int linesSeen = getLineCount() - 1; // minus the warm-up line
+            if( linesSeen != lines )
+                WriteWarning( Util.Sprintf( "{0}: expected {1} lines, but saw {2}.", name, lines, linesSeen ) );
+
+            // (The allocations counted include creating the client and the warm-up
+            // line, which is noise next to the default -Lines.)
+            return MakeMeasurement( new DbgEngOutputMeasurement() { Chunks = lines * chunks.Length },
+                                    name,
+                                    linesSeen,
+                                    sample );
+        } // end _Measure()
+    } // end class MeasureDbgEngOutputCommand
+}
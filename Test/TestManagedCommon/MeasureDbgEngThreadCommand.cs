@@ -0,0 +1,118 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Management.Automation;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace MS.Dbg.Commands
+{
+    public class DbgEngThreadMeasurement : Measurement
+    {
+        public int Producers { get; internal set; }
+    } // end class DbgEngThreadMeasurement
+
+
+    /// <summary>
+    ///    Measures the cost of a synchronous round trip to the dbgeng thread.
+    /// </summary>
+    /// <remarks>
+    ///    Each producer thread makes -Count calls to Debugger.ExecuteOnDbgEngThread
+    ///    with a trivial function. For comparison, the same calls are also made
+    ///    through a replica of the original dispatcher (a BlockingCollection of
+    ///    actions, a TaskCompletionSource per call, and Util.Await), which runs on a
+    ///    thread of its own. Items is the number of calls, from all producers.
+    ///
+    ///    The allocations counted include whatever the consuming thread allocates.
+    /// </remarks>
+    [Cmdlet( VerbsDiagnostic.Measure, "DbgEngThread" )]
+    [OutputType( typeof( DbgEngThreadMeasurement ) )]
+    public class MeasureDbgEngThreadCommand : MeasureCommandBase
+    {
+        [Parameter( Mandatory = false, Position = 0 )]
+        [ValidateRange( 1, Int32.MaxValue )]
+        public int Count { get; set; } = 100000;
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, 64 )]
+        public int Producers { get; set; } = 1;
+
+        protected override bool TrySetDebuggerContext { get { return false; } }
+
+
+        private sealed class BlockingCollectionDispatcher : IDisposable
+        {
+            private readonly BlockingCollection< Action > m_q = new BlockingCollection< Action >();
+            private readonly Thread m_thread;
+
+            public BlockingCollectionDispatcher()
+            {
+                m_thread = new Thread( () =>
+                    {
+                        foreach( var action in m_q.GetConsumingEnumerable() )
+                            action();
+                    } );
+                m_thread.IsBackground = true;
+                m_thread.Start();
+            }
+
+            public TRet Execute< TRet >( Func< TRet > f )
+            {
+                var tcs = new TaskCompletionSource< TRet >();
+                m_q.Add( () =>
+                    {
+                        try
+                        {
+                            tcs.TrySetResult( f() );
+                        }
+                        catch( Exception e )
+                        {
+                            tcs.TrySetException( e );
+                        }
+                    } );
+                return Util.Await( tcs.Task );
+            }
+
+            public void Dispose()
+            {
+                m_q.CompleteAdding();
+                m_thread.Join();
+                m_q.Dispose();
+            }
+        } // end class BlockingCollectionDispatcher
+
+
+        protected override void ProcessRecord()
+        {
+            base.ProcessRecord();
+
+            Func< int > f = () => 42;
+
+            using( var baseline = new BlockingCollectionDispatcher() )
+            {
+                // Warm up both paths (JIT, thread-static caches) before measuring.
+                baseline.Execute( f );
+                Debugger.ExecuteOnDbgEngThread( f );
+
+                SafeWriteObject( _Measure( "BlockingCollection (original)", () => baseline.Execute( f ) ) );
+            }
+
+            SafeWriteObject( _Measure( "DbgEngThread", () => Debugger.ExecuteOnDbgEngThread( f ) ) );
+        } // end ProcessRecord()
+
+
+        private DbgEngThreadMeasurement _Measure( string dispatcher, Action call )
+        {
+            int count = Count;
+            var sample = TimeOnThreads( Producers, ( t ) =>
+                {
+                    for( int j = 0; j < count; j++ )
+                        call();
+                } );
+
+            return MakeMeasurement( new DbgEngThreadMeasurement() { Producers = Producers },
+                                    dispatcher,
+                                    (long) count * Producers,
+                                    sample );
+        } // end _Measure()
+    } // end class MeasureDbgEngThreadCommand
+}
@@ -0,0 +1,167 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Management.Automation;
+
+namespace MS.Dbg.Commands
+{
+    public class DbgTypeCacheMeasurement : Measurement
+    {
+        public int DiskCacheHits { get; internal set; }
+        public int DiskCacheMisses { get; internal set; }
+    } // end class DbgTypeCacheMeasurement
+
+
+    /// <summary>
+    ///    Compares the cost of a set of type queries in a fresh session with and without
+    ///    the on-disk type layout cache.
+    /// </summary>
+    /// <remarks>
+    ///    Each -TypeName is looked up (Get-DbgTypeInfo style, so wildcards are fine),
+    ///    and for each type found, its members, base classes, member types and
+    ///    enumerands are loaded. That is done three times:
+    ///
+    ///       DbgHelpOnly: the disk cache is turned off.
+    ///       Cold:        the disk cache starts empty (in a scratch directory), and is
+    ///                    filled (and flushed) by the queries.
+    ///       Warm:        the disk cache files written by the Cold pass are used.
+    ///
+    ///    Before each pass, symbols for the modules involved are reloaded and the
+    ///    in-memory type cache is purged, so that (as much as can be arranged without
+    ///    starting a new process) each pass looks like the start of a new session.
+    ///
+    ///    Looking types up by name always goes to dbghelp, so that part of the cost is
+    ///    the same in every pass. Items is the number of types, members, base classes
+    ///    and enumerands loaded.
+    /// </remarks>
+    [Cmdlet( VerbsDiagnostic.Measure, "DbgTypeCache" )]
+    [OutputType( typeof( DbgTypeCacheMeasurement ) )]
+    public class MeasureDbgTypeCacheCommand : MeasureCommandBase
+    {
+        [Parameter( Mandatory = true, Position = 0 )]
+        [ValidateNotNullOrEmpty]
+        public string[] TypeName { get; set; }
+
+
+        protected override void ProcessRecord()
+        {
+            base.ProcessRecord();
+
+            var modules = new HashSet< string >( StringComparer.OrdinalIgnoreCase );
+            foreach( string name in TypeName )
+            {
+                int bang = name.IndexOf( '!' );
+                if( bang <= 0 )
+                    throw new ArgumentException( Util.Sprintf( "Type name \"{0}\" must be module-qualified.", name ) );
+
+                modules.Add( name.Substring( 0, bang ) );
+            }
+
+            string oldCacheDir = TypeLayoutDiskCache.CacheDirectory;
+            string scratchDir = Path.Combine( Path.GetTempPath(), "DbgTypeCache-" + Guid.NewGuid().ToString( "N" ) );
+            string oldDisable = Environment.GetEnvironmentVariable( "__DisableDiskTypeCache" );
+            try
+            {
+                TypeLayoutDiskCache.CacheDirectory = scratchDir;
+
+                Environment.SetEnvironmentVariable( "__DisableDiskTypeCache", "1" );
+                SafeWriteObject( _MeasurePass( "DbgHelpOnly", modules ) );
+                Environment.SetEnvironmentVariable( "__DisableDiskTypeCache", oldDisable );
+
+                SafeWriteObject( _MeasurePass( "Cold", modules ) );
+
+                TypeLayoutDiskCache.Reset();
+                SafeWriteObject( _MeasurePass( "Warm", modules ) );
+            }
+            finally
+            {
+                Environment.SetEnvironmentVariable( "__DisableDiskTypeCache", oldDisable );
+                TypeLayoutDiskCache.CacheDirectory = oldCacheDir;
+                try
+                {
+                    Directory.Delete( scratchDir, recursive: true );
+                }
+                catch( IOException ioe )
+                {
+                    WriteWarning( Util.Sprintf( "Could not clean up {0}: {1}", scratchDir, ioe.Message ) );
+                }
+            }
+        } // end ProcessRecord()
+
+
+        private DbgTypeCacheMeasurement _MeasurePass( string pass, IEnumerable< string > modules )
+        {
+            foreach( string mod in modules )
+            {
+                Debugger.ReloadSymbols( mod,
+                                        moduleIsLiteral: false,
+                                        address: 0,
+                                        size: 0,
+                                        timestamp: null,
+                                        notLazy: true,
+                                        ignoreMismatched: false,
+                                        overwriteDownstream: false,
+                                        unload: false );
+            }
+
+            DbgTypeInfo.PurgeCache();
+            TypeLayoutDiskCache.ResetStatistics();
+
+            int typesLoaded = 0;
+            var sample = Time( () =>
+                {
+                    foreach( string name in TypeName )
+                    {
+                        foreach( var ti in Debugger.GetTypeInfoByName( name, CancelTS.Token ) )
+                        {
+                            typesLoaded += _LoadLayout( ti );
+                        }
+                    }
+                } );
+
+            TypeLayoutDiskCache.Flush();
+
+            var m = new DbgTypeCacheMeasurement()
+            {
+                DiskCacheHits = TypeLayoutDiskCache.CacheHits,
+                DiskCacheMisses = TypeLayoutDiskCache.CacheMisses,
+            };
+            return MakeMeasurement( m, pass, typesLoaded, sample );
+        } // end _MeasurePass()
+
+
+        private static int _LoadLayout( DbgNamedTypeInfo ti )
+        {
+            int count = 1;
+
+            var udt = ti as DbgUdtTypeInfo;
+            if( null != udt )
+            {
+                foreach( var member in udt.Members )
+                {
+                    count++;
+                    if( null != member.DataType )
+                        count++;
+                }
+
+                foreach( var staticMember in udt.StaticMembers )
+                {
+                    count++;
+                }
+
+                foreach( var baseClass in udt.BaseClasses )
+                {
+                    count++;
+                }
+
+                return count;
+            }
+
+            var enumType = ti as DbgEnumTypeInfo;
+            if( null != enumType )
+                count += enumType.Enumerands.Count;
+
+            return count;
+        } // end _LoadLayout()
+    } // end class MeasureDbgTypeCacheCommand
+}
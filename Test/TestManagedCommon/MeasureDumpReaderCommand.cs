@@ -0,0 +1,178 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Management.Automation;
+using Microsoft.Diagnostics.Runtime;
+using Microsoft.Diagnostics.Runtime.Utilities;
+
+namespace MS.Dbg.Commands
+{
+    public class DumpReaderMeasurement : Measurement
+    {
+        public int Chunks { get; internal set; }
+        public ulong DumpMemoryBytes { get; internal set; }
+        public int ReadSize { get; internal set; }
+        public double MBPerSecond { get; internal set; }
+    } // end class DumpReaderMeasurement
+
+
+    /// <summary>
+    ///    Measures how fast ClrMd's DumpReader can read memory out of a dump file.
+    /// </summary>
+    /// <remarks>
+    ///    Two sets of -Reads reads of -ReadSize bytes each are timed:
+    ///
+    ///       Sequential: front to back through the dump's memory, chunk after chunk
+    ///                   (like walking a heap segment).
+    ///       Random:     at addresses picked uniformly from all the memory in the dump
+    ///                   (like chasing pointers).
+    ///
+    ///    Items is the number of reads. The addresses are generated before the clock
+    ///    starts. Use a big full dump (several GB) to get numbers that mean anything:
+    ///    the chunk search and the page faults on the mapped view are the interesting
+    ///    parts.
+    /// </remarks>
+    [Cmdlet( VerbsDiagnostic.Measure, "DumpReader" )]
+    [OutputType( typeof( DumpReaderMeasurement ) )]
+    public class MeasureDumpReaderCommand : MeasureCommandBase
+    {
+        [Parameter( Mandatory = true, Position = 0 )]
+        [ValidateNotNullOrEmpty]
+        public string DumpFile { get; set; }
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, Int32.MaxValue )]
+        public int Reads { get; set; } = 1000000;
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, 1024 * 1024 )]
+        public int ReadSize { get; set; } = 8;
+
+        [Parameter( Mandatory = false )]
+        public int Seed { get; set; } = 42;
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, 100 )]
+        public int Iterations { get; set; } = 3;
+
+        protected override bool TrySetDebuggerContext { get { return false; } }
+
+
+        protected override void ProcessRecord()
+        {
+            base.ProcessRecord();
+
+            string path = GetUnresolvedProviderPathFromPSPath( DumpFile );
+
+            using( var reader = new DumpReader( path ) )
+            {
+                var ranges = new List< VirtualQueryData >( reader.EnumerateMemoryRanges( 0, UInt64.MaxValue ) );
+                if( 0 == ranges.Count )
+                {
+                    SafeWriteError( Util.Sprintf( "No memory in dump {0}.", path ),
+                                    "NoDumpMemory",
+                                    ErrorCategory.InvalidData,
+                                    path );
+                    return;
+                }
+
+                ulong totalBytes = 0;
+                foreach( var range in ranges )
+                {
+                    totalBytes += range.Size;
+                }
+
+                SafeWriteObject( _Measure( reader, "Sequential", _SequentialAddresses( ranges ), ranges.Count, totalBytes ) );
+                SafeWriteObject( _Measure( reader, "Random", _RandomAddresses( ranges, totalBytes ), ranges.Count, totalBytes ) );
+            }
+        } // end ProcessRecord()
+
+
+        private ulong[] _SequentialAddresses( List< VirtualQueryData > ranges )
+        {
+            var addrs = new ulong[ Reads ];
+            int rangeIdx = 0;
+            ulong offset = 0;
+            for( int i = 0; i < addrs.Length; i++ )
+            {
+                // Skip ranges too small for a whole read (wrapping around at the end).
+                int skipped = 0;
+                while( (offset + (ulong) ReadSize) > ranges[ rangeIdx ].Size )
+                {
+                    rangeIdx = (rangeIdx + 1) % ranges.Count;
+                    offset = 0;
+                    if( ++skipped > ranges.Count )
+                        throw new ArgumentException( "-ReadSize is bigger than every memory range in the dump." );
+                }
+
+                addrs[ i ] = ranges[ rangeIdx ].BaseAddress + offset;
+                offset += (ulong) ReadSize;
+            }
+            return addrs;
+        } // end _SequentialAddresses()
+
+
+        private ulong[] _RandomAddresses( List< VirtualQueryData > ranges, ulong totalBytes )
+        {
+            // Running totals, so that a random offset into "all the memory" can be
+            // mapped back to a range.
+            var ends = new ulong[ ranges.Count ];
+            ulong sum = 0;
+            for( int i = 0; i < ranges.Count; i++ )
+            {
+                sum += ranges[ i ].Size;
+                ends[ i ] = sum;
+            }
+
+            var rand = new Random( Seed );
+            var buf = new byte[ 8 ];
+            var addrs = new ulong[ Reads ];
+            for( int i = 0; i < addrs.Length; i++ )
+            {
+                rand.NextBytes( buf );
+                ulong offset = BitConverter.ToUInt64( buf, 0 ) % totalBytes;
+
+                int idx = Array.BinarySearch( ends, offset );
+                idx = (idx < 0) ? ~idx : idx + 1;
+
+                ulong rangeStart = ends[ idx ] - ranges[ idx ].Size;
+                ulong addr = ranges[ idx ].BaseAddress + (offset - rangeStart);
+
+                // Keep the read inside the range (it may still be a partial read if the
+                // range is smaller than ReadSize).
+                ulong rangeEnd = ranges[ idx ].BaseAddress + ranges[ idx ].Size;
+                if( (addr + (ulong) ReadSize) > rangeEnd )
+                    addr = Math.Max( ranges[ idx ].BaseAddress, rangeEnd - (ulong) ReadSize );
+
+                addrs[ i ] = addr;
+            }
+            return addrs;
+        } // end _RandomAddresses()
+
+
+        private DumpReaderMeasurement _Measure( DumpReader reader,
+                                                string pattern,
+                                                ulong[] addrs,
+                                                int chunks,
+                                                ulong totalBytes )
+        {
+            var buffer = new byte[ ReadSize ];
+            long bytesRead = 0;
+            var sample = Time( Iterations, ( iter ) =>
+                {
+                    for( int i = 0; i < addrs.Length; i++ )
+                    {
+                        bytesRead += reader.ReadPartialMemory( addrs[ i ], buffer, buffer.Length );
+                    }
+                } );
+
+            var m = new DumpReaderMeasurement()
+            {
+                Chunks = chunks,
+                DumpMemoryBytes = totalBytes,
+                ReadSize = ReadSize,
+                MBPerSecond = (bytesRead / (1024.0 * 1024.0)) / sample.Elapsed.TotalSeconds,
+            };
+            return MakeMeasurement( m, pattern, addrs.Length, sample );
+        } // end _Measure()
+    } // end class MeasureDumpReaderCommand
+}
@@ -0,0 +1,122 @@
+﻿using System;
+using System.Management.Automation;
+
+namespace MS.Dbg.Commands
+{
+    public class TraceMeasurement : Measurement
+    {
+        public int Threads { get; internal set; }
+    } // end class TraceMeasurement
+
+
+    /// <summary>
+    ///    Measures the per-call cost of tracing with LogManager.Trace versus
+    ///    TraceRing.Trace.
+    /// </summary>
+    /// <remarks>
+    ///    Each thread makes -Count calls with the same message (a string, an int and an
+    ///    enum inserted into it). Items is the calls from all threads, so with more than
+    ///    one thread, NanosecondsPerItem is the wall-clock time divided by all of them
+    ///    (multiply by -Threads for the time each call took, contention included).
+    ///
+    ///    TraceRing.Trace only defers the formatting and writing, so there is also a
+    ///    "TraceRing.Drain" pass, which traces -Count records in batches that fit in
+    ///    the ring and times just the drains; that is what each record costs the
+    ///    background flusher.
+    ///
+    ///    N.B. All of these really are traced: this puts 3 * -Count * -Threads lines
+    ///    in the log (less whatever the ring drops, when it laps the flusher).
+    /// </remarks>
+    [Cmdlet( VerbsDiagnostic.Measure, "TraceRing" )]
+    [OutputType( typeof( TraceMeasurement ) )]
+    public class MeasureTraceRingCommand : MeasureCommandBase
+    {
+        [Parameter( Mandatory = false, Position = 0 )]
+        [ValidateRange( 1, Int32.MaxValue )]
+        public int Count { get; set; } = 100000;
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, 64 )]
+        public int Threads { get; set; } = 1;
+
+        protected override bool TrySetDebuggerContext { get { return false; } }
+
+
+        private const string c_Format = "Measure-TraceRing: {0} {1} ({2})";
+        private static readonly int sm_fmt = TraceRing.RegisterFormat( c_Format );
+
+        // The ring is 1024 records deep; stay well under that between drains.
+        private const int c_DrainBatch = 512;
+
+
+        protected override void ProcessRecord()
+        {
+            base.ProcessRecord();
+
+            string name = "someSymbol";
+
+            // Warm up both paths (JIT, log session, this thread's ring).
+            LogManager.Trace( c_Format, name, -1, ErrorCategory.NotSpecified );
+            TraceRing.Trace( sm_fmt, name, -1, ErrorCategory.NotSpecified );
+            TraceRing.Drain();
+
+            SafeWriteObject( _Measure( "LogManager.Trace",
+                                       (i) => LogManager.Trace( c_Format, name, i, ErrorCategory.ReadError ) ) );
+
+            SafeWriteObject( _Measure( "TraceRing.Trace",
+                                       (i) => TraceRing.Trace( sm_fmt, name, i, ErrorCategory.ReadError ) ) );
+
+            SafeWriteObject( _MeasureDrain( name ) );
+        } // end ProcessRecord()
+
+
+        private TraceMeasurement _Measure( string method, Action< int > trace )
+        {
+            int count = Count;
+            var sample = TimeOnThreads( Threads, ( t ) =>
+                {
+                    for( int j = 0; j < count; j++ )
+                        trace( j );
+                } );
+
+            return MakeMeasurement( new TraceMeasurement() { Threads = Threads },
+                                    method,
+                                    (long) count * Threads,
+                                    sample );
+        } // end _Measure()
+
+
+        private TraceMeasurement _MeasureDrain( string name )
+        {
+            // Whatever the other threads left behind, so it doesn't count against us.
+            TraceRing.Drain();
+
+            var sample = TimeParts( 1, ( iter, timer ) =>
+                {
+                    int done = 0;
+                    while( done < Count )
+                    {
+                        int batch = Math.Min( c_DrainBatch, Count - done );
+                        for( int i = 0; i < batch; i++ )
+                        {
+                            TraceRing.Trace( sm_fmt, name, done + i, ErrorCategory.ReadError );
+                        }
+
+                        timer.Start();
+                        TraceRing.Drain();
+                        timer.Stop();
+
+                        done += batch;
+                        timer.CheckStopping();
+                    }
+                } );
+
+            // (The background flusher might have gotten to some of the batches first,
+            // in which case they aren't counted; so this errs on the cheap side.)
+            return MakeMeasurement( new TraceMeasurement() { Threads = 1 },
+                                    "TraceRing.Drain",
+                                    Count,
+                                    sample );
+        } // end _MeasureDrain()
+    } // end class MeasureTraceRingCommand
+}
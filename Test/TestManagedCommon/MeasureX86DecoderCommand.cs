@@ -0,0 +1,257 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Management.Automation;
+
+namespace MS.Dbg.Commands
+{
+    public class X86DecoderMeasurement : Measurement
+    {
+        public string Module { get; internal set; }
+        public int Bytes { get; internal set; }
+        public double MBPerSecond { get; internal set; }
+        public int Mismatches { get; internal set; }
+    } // end class X86DecoderMeasurement
+
+
+    /// <summary>
+    ///    Measures the native x86/x64 instruction decoder (X86Decoder) on a module's
+    ///    code, and checks its instruction lengths against dbgeng's disassembler.
+    /// </summary>
+    /// <remarks>
+    ///    The module image (up to -MaxBytes of it) is read once, up front. Then these
+    ///    passes are timed (Items is the count of what each pass produces):
+    ///
+    ///       Decode:      a linear sweep over the whole image, skipping a byte at a
+    ///                    time over anything that doesn't decode (instructions).
+    ///       FindCalls:   the call-target scan (call sites).
+    ///       CallBefore:  return address validation, for the address after every call
+    ///                    site found (calls found).
+    ///       DbgEng:      -DbgEngInstructions instructions disassembled by dbgeng from
+    ///                    the start of the first call target in the module, for
+    ///                    comparison (instructions). Mismatches counts instructions
+    ///                    whose length differs from what X86Decoder says.
+    /// </remarks>
+    [Cmdlet( VerbsDiagnostic.Measure, "X86Decoder" )]
+    [OutputType( typeof( X86DecoderMeasurement ) )]
+    public class MeasureX86DecoderCommand : MeasureCommandBase
+    {
+        [Parameter( Mandatory = true, Position = 0 )]
+        [ModuleTransformation]
+        public DbgModuleInfo Module { get; set; }
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, Int32.MaxValue )]
+        public int MaxBytes { get; set; } = 16 * 1024 * 1024;
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 0, Int32.MaxValue )]
+        public int DbgEngInstructions { get; set; } = 10000;
+
+        [Parameter( Mandatory = false )]
+        [ValidateRange( 1, 100 )]
+        public int Iterations { get; set; } = 3;
+
+
+        protected override void ProcessRecord()
+        {
+            base.ProcessRecord();
+
+            IMAGE_FILE_MACHINE effMach = Debugger.GetEffectiveProcessorType();
+            if( (IMAGE_FILE_MACHINE.AMD64 != effMach) && (IMAGE_FILE_MACHINE.I386 != effMach) )
+            {
+                SafeWriteError( Util.Sprintf( "Machine type not supported: {0}", effMach ),
+                                "UnsupportedMachineType",
+                                ErrorCategory.NotImplemented,
+                                effMach );
+                return;
+            }
+            bool is64Bit = IMAGE_FILE_MACHINE.AMD64 == effMach;
+
+            uint cb = (uint) Math.Min( (long) Module.Size, (long) MaxBytes );
+            byte[] code;
+            if( !Debugger.TryReadMem( Module.BaseAddress, cb, false, out code ) || (0 == code.Length) )
+            {
+                SafeWriteError( Util.Sprintf( "Could not read the image for module {0}.", Module.Name ),
+                                "ModuleNotReadable",
+                                ErrorCategory.ReadError,
+                                Module );
+                return;
+            }
+
+            if( code.Length < cb )
+                WriteWarning( Util.Sprintf( "Only {0} of {1} bytes could be read.", code.Length, cb ) );
+
+            SafeWriteObject( _MeasureDecode( code, is64Bit ) );
+
+            X86CallSite[] sites;
+            SafeWriteObject( _MeasureFindCalls( code, is64Bit, out sites ) );
+            SafeWriteObject( _MeasureCallBefore( code, is64Bit, sites ) );
+
+            if( DbgEngInstructions > 0 )
+            {
+                var m = _MeasureDbgEng( code, is64Bit, sites );
+                if( null != m )
+                    SafeWriteObject( m );
+            }
+        } // end ProcessRecord()
+
+
+        private X86DecoderMeasurement _MeasureDecode( byte[] code, bool is64Bit )
+        {
+            var instructions = new X86Instruction[ 1024 ];
+            long count = 0;
+            var sample = Time( Iterations, ( iter ) =>
+                {
+                    int offset = 0;
+                    while( offset < code.Length )
+                    {
+                        int bytesDecoded;
+                        int n = X86Decoder.DecodeRange( new ReadOnlySpan< byte >( code, offset, code.Length - offset ),
+                                                        Module.BaseAddress + (ulong) offset,
+                                                        is64Bit,
+                                                        instructions,
+                                                        out bytesDecoded );
+                        count += n;
+                        offset += bytesDecoded;
+                        if( n < instructions.Length )
+                            offset++; // skip the byte that didn't decode
+                    }
+                } );
+
+            return _MakeMeasurement( "Decode", code.Length, count / Iterations, sample );
+        } // end _MeasureDecode()
+
+
+        private X86DecoderMeasurement _MeasureFindCalls( byte[] code, bool is64Bit, out X86CallSite[] allSites )
+        {
+            var buf = new X86CallSite[ 1024 ];
+            var sites = new List< X86CallSite >();
+            var sample = TimeParts( Iterations, ( iter, timer ) =>
+                {
+                    sites.Clear();
+                    timer.Start();
+                    int offset = 0;
+                    while( offset < code.Length )
+                    {
+                        int scanned;
+                        int n = X86Decoder.FindCalls( new ReadOnlySpan< byte >( code, offset, code.Length - offset ),
+                                                      Module.BaseAddress + (ulong) offset,
+                                                      is64Bit,
+                                                      buf,
+                                                      out scanned );
+                        for( int i = 0; i < n; i++ )
+                        {
+                            sites.Add( buf[ i ] );
+                        }
+
+                        offset += scanned;
+                        if( (n < buf.Length) || (0 == scanned) )
+                            break;
+                    }
+                    timer.Stop();
+                } );
+
+            allSites = sites.ToArray();
+            return _MakeMeasurement( "FindCalls", code.Length, allSites.Length, sample );
+        } // end _MeasureFindCalls()
+
+
+        private X86DecoderMeasurement _MeasureCallBefore( byte[] code, bool is64Bit, X86CallSite[] sites )
+        {
+            long found = 0;
+            var sample = Time( Iterations, ( iter ) =>
+                {
+                    found = 0;
+                    foreach( var site in sites )
+                    {
+                        ulong returnAddress = site.CallAddress + site.Length;
+                        int end = (int) (returnAddress - Module.BaseAddress);
+                        int start = Math.Max( 0, end - X86Decoder.MaxInstructionLength );
+
+                        X86Instruction call;
+                        if( X86Decoder.TryFindCallBefore( new ReadOnlySpan< byte >( code, start, end - start ),
+                                                          returnAddress,
+                                                          is64Bit,
+                                                          out call ) )
+                        {
+                            found++;
+                        }
+                    }
+                } );
+
+            var m = _MakeMeasurement( "CallBefore", code.Length, found, sample );
+
+            // Every one of them ends in a call, so they should all be found (though
+            // maybe as a different call than the one the scan found).
+            m.Mismatches = sites.Length - (int) found;
+            return m;
+        } // end _MeasureCallBefore()
+
+
+        private X86DecoderMeasurement _MeasureDbgEng( byte[] code, bool is64Bit, X86CallSite[] sites )
+        {
+            // Start somewhere that is definitely code: the first direct call target in
+            // the module.
+            ulong start = 0;
+            ulong end = Module.BaseAddress + (ulong) code.Length;
+            foreach( var site in sites )
+            {
+                if( (X86Flow.Call == site.Flow) && (site.Target >= Module.BaseAddress) && (site.Target < end) )
+                {
+                    start = site.Target;
+                    break;
+                }
+            }
+
+            if( 0 == start )
+            {
+                WriteWarning( "No call targets in the module; skipping the DbgEng pass." );
+                return null;
+            }
+
+            IReadOnlyList< DbgDisassembly > disasm = null;
+            var sample = Time( () =>
+                {
+                    ulong next;
+                    disasm = Debugger.DisassembleRange( start, end - 1, DbgEngInstructions, out next );
+                } );
+
+            int mismatches = 0;
+            foreach( var instr in disasm )
+            {
+                int offset = (int) (instr.Address - Module.BaseAddress);
+                X86Instruction decoded;
+                if( !X86Decoder.TryDecode( new ReadOnlySpan< byte >( code, offset, code.Length - offset ),
+                                           instr.Address,
+                                           is64Bit,
+                                           out decoded ) ||
+                    (decoded.Length != instr.Length) )
+                {
+                    mismatches++;
+                    WriteVerbose( Util.Sprintf( "Length mismatch at {0}: dbgeng {1} ({2}), X86Decoder {3}",
+                                                Util.FormatHalfOrFullQWord( instr.Address ),
+                                                instr.Length,
+                                                instr.Instruction,
+                                                decoded.Length ) );
+                }
+            }
+
+            var m = _MakeMeasurement( "DbgEng", code.Length, disasm.Count, sample );
+            m.Mismatches = mismatches;
+            return m;
+        } // end _MeasureDbgEng()
+
+
+        private X86DecoderMeasurement _MakeMeasurement( string pass, int bytes, long items, Sample sample )
+        {
+            var m = new X86DecoderMeasurement()
+            {
+                Module = Module.Name,
+                Bytes = bytes,
+            };
+            MakeMeasurement( m, pass, items, sample );
+            m.MBPerSecond = (m.Milliseconds > 0) ? ((bytes / (1024.0 * 1024.0)) / (m.Milliseconds / 1000.0)) : 0;
+            return m;
+        } // end _MakeMeasurement()
+    } // end class MeasureX86DecoderCommand
+}
@@ -0,0 +1,220 @@
+Describe "ClrHeap" {
+
+    pushd
+
+    $dumpDir = "$($env:temp)\DbgShellTestClrHeap"
+    $dumpPath = "$($dumpDir)\testManaged.dmp"
+
+    if( !(Test-Path $dumpDir) )
+    {
+        $null = mkdir $dumpDir
+    }
+    else
+    {
+        del "$($dumpDir)\*"
+    }
+
+    # One dump of the managed test app, shared by all the tests below.
+    function MountTestDump()
+    {
+        if( !(Test-Path $dumpPath) )
+        {
+            New-TestApp -TestApp TestManagedConsoleApp -Attach -TargetName testApp -HiddenTargetWindow
+            try
+            {
+                Write-DbgDumpFile -DumpFile $dumpPath
+            }
+            finally
+            {
+                .kill
+            }
+        }
+
+        Mount-DbgDumpFile $dumpPath
+        $Debugger.IsLive | Should Be $false
+    }
+
+    # Copies an index file, overwrites the 8-byte value at the given offset into the
+    # copy, and returns the path of the copy.
+    function CopyAndDamageIndex( [string] $path, [long] $offset, [long] $value )
+    {
+        $copy = "$($path).damaged"
+        $bytes = [System.IO.File]::ReadAllBytes( $path )
+        [System.BitConverter]::GetBytes( $value ).CopyTo( $bytes, $offset )
+        [System.IO.File]::WriteAllBytes( $copy, $bytes )
+        return $copy
+    }
+
+    It "walks the heap in parallel, ordered and not, the same as the serial walk" {
+
+        MountTestDump
+        try
+        {
+            $heap = Get-ClrHeap | Select-Object -First 1
+
+            foreach( $dop in @( 1, 2, 0 ) )
+            {
+                [MS.Dbg.DbgShellTestHooks]::CompareParallelWalk( $heap, $dop, $true ) | Should BeNullOrEmpty
+                [MS.Dbg.DbgShellTestHooks]::CompareParallelWalk( $heap, $dop, $false ) | Should BeNullOrEmpty
+            }
+
+            $expected = [MS.Dbg.DbgShellTestHooks]::GetSerialTypeStatistics( $heap )
+            [MS.Dbg.DbgShellTestHooks]::CompareTypeStatistics( $expected, $heap.GetTypeStatistics( 0 ) ) | Should BeNullOrEmpty
+            [MS.Dbg.DbgShellTestHooks]::CompareTypeStatistics( $expected, (Get-ClrHeap -Statistics -ThrottleLimit 2) ) | Should BeNullOrEmpty
+
+            [MS.Dbg.DbgShellTestHooks]::TypeStatisticsHonorCancellation( $heap ) | Should Be $true
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    It "builds heap indexes that match the heap, and rejects damaged ones" {
+
+        MountTestDump
+        try
+        {
+            $heap = Get-ClrHeap | Select-Object -First 1
+            $expected = [MS.Dbg.DbgShellTestHooks]::GetSerialTypeStatistics( $heap )
+            $expected.Count | Should BeGreaterThan 0
+
+            $index = New-ClrHeapIndex | Select-Object -First 1
+            $index.Count | Should BeGreaterThan 0
+            [MS.Dbg.DbgShellTestHooks]::CompareTypeStatistics( $expected, $index.GetTypeStatistics() ) | Should BeNullOrEmpty
+
+            $withRetained = [MS.Dbg.DbgShellTestHooks]::GetSerialTypeStatistics( $heap, $true )
+            $indexed = $index.GetTypeStatistics( $true, [System.Threading.CancellationToken]::None )
+            [MS.Dbg.DbgShellTestHooks]::CompareTypeStatistics( $withRetained, $indexed ) | Should BeNullOrEmpty
+
+            # Building it again replaces the file in place.
+            $index = New-ClrHeapIndex | Select-Object -First 1
+            $path = $index.Path
+            $count = $index.Count
+            [MS.Dbg.DbgShellTestHooks]::CompareTypeStatistics( $expected, (Get-ClrHeap -Statistics) ) | Should BeNullOrEmpty
+
+            # Reopening a copy (the header has the source id at offset 8) gives the same index.
+            $bytes = [System.IO.File]::ReadAllBytes( $path )
+            $sourceId = New-Object 'System.Guid' -ArgumentList @( ,[byte[]] $bytes[ 8..23 ] )
+            $copy = "$($path).copy"
+            Copy-Item $path $copy
+            $reopened = [Microsoft.Diagnostics.Runtime.ClrHeapIndex]::TryOpen( $heap, $copy, $sourceId )
+            $reopened | Should Not BeNullOrEmpty
+            $reopened.Count | Should Be $count
+            $reopened.Dispose()
+
+            # A different source id: stale.
+            [Microsoft.Diagnostics.Runtime.ClrHeapIndex]::TryOpen( $heap, $copy, [guid]::NewGuid() ) | Should BeNullOrEmpty
+
+            # The column offsets are at 56 in the header: addresses, MethodTables,
+            # component MTs, reference starts, sizes, references.
+            $refStartsOffset = [System.BitConverter]::ToInt64( $bytes, 56 + (3 * 8) )
+            $refsOffset = [System.BitConverter]::ToInt64( $bytes, 56 + (5 * 8) )
+
+            # A reference range that runs backwards is caught when the index is opened.
+            $copy = CopyAndDamageIndex $path ($refStartsOffset + (8 * [int] ($count / 2))) -1
+            [Microsoft.Diagnostics.Runtime.ClrHeapIndex]::TryOpen( $heap, $copy, $sourceId ) | Should BeNullOrEmpty
+
+            # A reference to an object that isn't there is caught when it is read.
+            $first = 0
+            while( $index.GetReferenceCount( $first ) -eq 0 ) { $first++ }
+            $copy = CopyAndDamageIndex $path $refsOffset 0x7fffffff7fffffff
+            $damaged = [Microsoft.Diagnostics.Runtime.ClrHeapIndex]::TryOpen( $heap, $copy, $sourceId )
+            try
+            {
+                { $damaged.EnumerateReferences( $first ) | Out-Null } | Should Throw
+            }
+            finally
+            {
+                $damaged.Dispose()
+            }
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    It "estimates retained sizes the same as the serial walk, and saves and compares heap statistics" {
+
+        MountTestDump
+        try
+        {
+            $heap = Get-ClrHeap | Select-Object -First 1
+            $expected = [MS.Dbg.DbgShellTestHooks]::GetSerialTypeStatistics( $heap, $true )
+            [Microsoft.Diagnostics.Runtime.ClrHeapHistogram]::HasRetainedSizes( $expected ) | Should Be $true
+
+            foreach( $dop in @( 1, 0 ) )
+            {
+                $actual = $heap.GetTypeStatistics( $dop, $true, [System.Threading.CancellationToken]::None )
+                [MS.Dbg.DbgShellTestHooks]::CompareTypeStatistics( $expected, $actual ) | Should BeNullOrEmpty
+            }
+
+            $path = "$($dumpDir)\testManaged.stats"
+            $stats = Get-ClrHeap -Statistics -EstimateRetainedSize -Path $path
+            [MS.Dbg.DbgShellTestHooks]::CompareTypeStatistics( $expected, $stats ) | Should BeNullOrEmpty
+
+            # Loaded statistics have no ClrType, but the same names and totals.
+            $loaded = [Microsoft.Diagnostics.Runtime.ClrHeapHistogram]::Load( $path )
+            [MS.Dbg.DbgShellTestHooks]::CompareTypeStatistics( $expected, $loaded ) | Should BeNullOrEmpty
+
+            # Nothing has changed since they were saved.
+            Compare-ClrHeapHistogram $path | Should BeNullOrEmpty
+            $stats | Compare-ClrHeapHistogram $path | Should BeNullOrEmpty
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    It "counts an object that refers to another through two fields as its only referrer" {
+
+        MountTestDump
+        try
+        {
+            $heap = Get-ClrHeap | Select-Object -First 1
+            $typeName = 'TestManagedConsoleApp.Program+TwoRefsToOne'
+            $obj = $heap.EnumerateObjects() | Where-Object { ($null -ne $_.Type) -and ($_.Type.Name -eq $typeName) } | Select-Object -First 1
+            $obj | Should Not BeNullOrEmpty
+            $first = $obj.Type.GetFieldByName( 'First' ).GetValue( $obj.Address )
+            $second = $obj.Type.GetFieldByName( 'Second' ).GetValue( $obj.Address )
+            $second | Should Be $first
+            $arraySize = $heap.GetObjectType( $first ).GetSize( $first )
+
+            # The array is owned by that object, so it counts towards the retained size (once).
+            $serial = [MS.Dbg.DbgShellTestHooks]::GetSerialTypeStatistics( $heap, $true ) | Where-Object { $_.TypeName -eq $typeName }
+            $serial.RetainedSize | Should Be ($serial.TotalSize + $arraySize)
+
+            foreach( $dop in @( 1, 0 ) )
+            {
+                $stats = $heap.GetTypeStatistics( $dop, $true, [System.Threading.CancellationToken]::None ) | Where-Object { $_.TypeName -eq $typeName }
+                $stats.RetainedSize | Should Be $serial.RetainedSize
+            }
+
+            $index = New-ClrHeapIndex | Select-Object -First 1
+            $stats = $index.GetTypeStatistics( $true, [System.Threading.CancellationToken]::None ) | Where-Object { $_.TypeName -eq $typeName }
+            $stats.RetainedSize | Should Be $serial.RetainedSize
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    It "finds the same root paths single-threaded and in parallel" {
+
+        MountTestDump
+        try
+        {
+            $heap = Get-ClrHeap | Select-Object -First 1
+            [MS.Dbg.DbgShellTestHooks]::CompareRootPaths( $heap, 20 ) | Should BeNullOrEmpty
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    popd
+}
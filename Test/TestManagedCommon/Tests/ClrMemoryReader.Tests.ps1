@@ -0,0 +1,21 @@
+Describe "ClrMemoryReader" {
+
+    pushd
+
+    It "reads ahead in whole windows during a linear scan" {
+
+        # Without read-ahead, every page is a separate read.
+        [MS.Dbg.DbgShellTestHooks]::CountLinearScanReads( 64, 0 ) | Should Be 64
+
+        # With 4 pages of read-ahead, a scan should only go back to the data reader
+        # about once every 4 pages (plus a few at the start and at the end of memory).
+        [MS.Dbg.DbgShellTestHooks]::CountLinearScanReads( 64, 4 ) | Should BeLessThan 24
+    }
+
+    It "doesn't count read-ahead probes as uses" {
+
+        [MS.Dbg.DbgShellTestHooks]::PrefetchProbeLeavesLruAlone() | Should Be $true
+    }
+
+    popd
+}
@@ -0,0 +1,52 @@
+
+Describe "DbgEngOutput" {
+
+    pushd
+
+    # Sends the chunks through dbgeng to line callbacks, and returns what they got:
+    # "MASK: line" for each line, and "--" after each chunk.
+    function CaptureLines( [string[]] $chunks, [string[]] $masks, [switch] $Flush )
+    {
+        $outputMasks = [Microsoft.Diagnostics.Runtime.Interop.DEBUG_OUTPUT[]] $masks
+        $lines = [MS.Dbg.DbgShellTestHooks]::CaptureDbgEngOutputLines( $Debugger,
+                                                                        $chunks,
+                                                                        $outputMasks,
+                                                                        $Flush.IsPresent )
+        return $lines -join '|'
+    }
+
+    It "hands over whole lines as soon as they are complete" {
+
+        CaptureLines @( 'ab', "c`r`n", "d`ne", "f`n", "`n" ) (@( 'NORMAL' ) * 5) |
+            Should Be '--|NORMAL: abc|--|NORMAL: d|--|NORMAL: ef|--|NORMAL: |--'
+
+        # Several lines in one chunk:
+        CaptureLines @( "one`ntwo`r`nthree`n" ) @( 'NORMAL' ) |
+            Should Be 'NORMAL: one|NORMAL: two|NORMAL: three|--'
+    }
+
+    It "holds on to a partial line until it is finished or flushed" {
+
+        CaptureLines @( 'x', 'y' ) @( 'NORMAL', 'NORMAL' ) |
+            Should Be '--|--'
+
+        CaptureLines @( 'x', 'y' ) @( 'NORMAL', 'NORMAL' ) -Flush |
+            Should Be '--|--|NORMAL: xy'
+    }
+
+    It "gives each batch of lines a single mask" {
+
+        # A line made of pieces with different masks gets all of them...
+        CaptureLines @( 'x', "y`n" ) @( 'WARNING', 'NORMAL' ) |
+            Should Be '--|NORMAL, WARNING: xy|--'
+
+        # ...but doesn't pass them on to the next line in the same chunk.
+        CaptureLines @( 'p', "q`nr`n" ) @( 'WARNING', 'NORMAL' ) |
+            Should Be '--|NORMAL, WARNING: pq|NORMAL: r|--'
+
+        CaptureLines @( 'e', "rror`n" ) @( 'ERROR', 'ERROR' ) -Flush |
+            Should Be '--|ERROR: error|--'
+    }
+
+    popd
+}
@@ -0,0 +1,19 @@
+
+Describe "DbgEngThread" {
+
+    pushd
+
+    It "runs every queued action once, in order per producer" {
+
+        # Plenty of room in the ring:
+        [MS.Dbg.DbgShellTestHooks]::CheckMpscActionQueue( 4, 10000, 1024 ) | Should Be $null
+
+        # And a ring so small that the producers keep finding it full:
+        [MS.Dbg.DbgShellTestHooks]::CheckMpscActionQueue( 8, 2000, 4 ) | Should Be $null
+
+        # Just the one producer (the usual case):
+        [MS.Dbg.DbgShellTestHooks]::CheckMpscActionQueue( 1, 10000, 2 ) | Should Be $null
+    }
+
+    popd
+}
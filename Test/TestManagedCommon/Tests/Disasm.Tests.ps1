@@ -48,6 +48,125 @@ Describe "Disasm" {
         }
     }
 
+    It "can find direct branch targets" {
+
+        $cases = @(
+            @( 'jmp',  '00007ff6`ece87d60',           0x7ff6ece87d60 ),
+            @( 'je',   'foo+0x22 (01131650)',         0x1131650 ),
+            @( 'call', 'dword ptr [foo (0113c078)]',  0 ),
+            @( 'call', 'qword ptr [rax+8]',           0 ),
+            @( 'call', 'rax',                         0 ),
+            @( 'bl',   'foo (00401000)',              0x401000 ),
+            @( 'bne',  '00401010',                    0x401010 ),
+            @( 'cbz',  'x0,0000000140001000',         0x140001000 ),
+            @( 'b.ne', '#0x1234',                     0x1234 ),
+            @( 'blx',  'r3',                          0 ),
+            @( 'mov',  'eax, 1',                      0 )
+        )
+
+        foreach( $case in $cases )
+        {
+            $target = [MS.Dbg.DbgShellTestHooks]::ParseBranchTarget( $case[ 0 ], $case[ 1 ] )
+            "$($case[ 0 ]) $($case[ 1 ]): $($target)" | Should Be "$($case[ 0 ]) $($case[ 1 ]): $([UInt64] $case[ 2 ])"
+        }
+    }
+
+    It "disassembles in batches the same as one instruction at a time" {
+
+        New-TestApp -TestApp TestNativeConsoleApp -Attach -TargetName testApp -HiddenTargetWindow
+
+        try
+        {
+            $addr = (Get-DbgStack).Frames[ 0 ].InstructionPointer
+
+            # More than one batch (of 256), and not a multiple of it.
+            $batched = @( Read-DbgDisassembly -Address $addr -InstructionCount 600 )
+            $batched.Count | Should Be 600
+
+            $cur = $addr
+            foreach( $instr in $batched )
+            {
+                $next = [UInt64] 0
+                $single = $Debugger.Disassemble( $cur, [ref] $next )
+
+                $instr.Address | Should Be $cur
+                $single -match "\b$([regex]::Escape( $instr.Instruction ))\b" | Should Be $true
+
+                $next | Should Be ($cur + $instr.Length)
+                $cur = $next
+            }
+
+            # -EndAddress is inclusive.
+            $ranged = @( Read-DbgDisassembly -Address $addr -EndAddress $batched[ 299 ].Address )
+            $ranged.Count | Should Be 300
+            for( $i = 0; $i -lt $ranged.Count; $i++ )
+            {
+                $ranged[ $i ].Address | Should Be $batched[ $i ].Address
+                $ranged[ $i ].ToString() | Should Be $batched[ $i ].ToString()
+            }
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    It "throws away cached disassembly when the effective processor type changes" {
+
+        New-TestApp -TestApp TestNativeConsoleApp -Attach -TargetName testApp -HiddenTargetWindow
+
+        $dumpDir = "$($env:temp)\DbgShellTestDumps"
+        $dumpPath = "$($dumpDir)\disasm.dmp"
+
+        try
+        {
+            if( !(Test-Path $dumpDir) )
+            {
+                $null = mkdir $dumpDir
+            }
+
+            $addr = (Get-DbgStack).Frames[ 0 ].InstructionPointer
+            Write-DbgDumpFile -DumpFile $dumpPath
+            .kill
+
+            Mount-DbgDumpFile $dumpPath
+            $Debugger.IsLive | Should Be $false
+
+            $amd64 = @( Read-DbgDisassembly -Address $addr -InstructionCount 100 )
+            [MS.Dbg.DbgShellTestHooks]::GetDisassemblyCacheSize( $Debugger ) | Should Be 100
+
+            # Coming from the cache this time; nothing new to count.
+            $again = @( Read-DbgDisassembly -Address $addr -InstructionCount 100 )
+            [MS.Dbg.DbgShellTestHooks]::GetDisassemblyCacheSize( $Debugger ) | Should Be 100
+            $again[ 99 ].ToString() | Should Be $amd64[ 99 ].ToString()
+
+            $effmach = $Debugger.GetEffectiveProcessorType()
+            try
+            {
+                $Debugger.SetEffectiveProcessorType( [Microsoft.Diagnostics.Runtime.Interop.IMAGE_FILE_MACHINE]::I386 )
+
+                $null = @( Read-DbgDisassembly -Address $addr -InstructionCount 10 )
+                [MS.Dbg.DbgShellTestHooks]::GetDisassemblyCacheSize( $Debugger ) | Should Be 10
+            }
+            finally
+            {
+                $Debugger.SetEffectiveProcessorType( $effmach )
+            }
+
+            .kill
+        }
+        finally
+        {
+            if( $Debugger.Targets.Count -ne 0 )
+            {
+                .kill
+            }
+            if( Test-Path $dumpPath )
+            {
+                del $dumpPath
+            }
+        }
+    }
+
     popd
 }
-
@@ -0,0 +1,45 @@
+
+Describe "DumpReader" {
+
+    pushd
+
+    It "reads the same memory from a dump as dbgeng does" {
+
+        New-TestApp -TestApp TestNativeConsoleApp -Attach -TargetName testApp -HiddenTargetWindow
+
+        $dumpDir = "$($env:temp)\DbgShellTestDumps"
+        $dumpPath = "$($dumpDir)\DumpReader.dmp"
+
+        try
+        {
+            if( !(Test-Path $dumpDir) )
+            {
+                $null = mkdir $dumpDir
+            }
+
+            Write-DbgDumpFile -DumpFile $dumpPath -AllowClobber
+            .kill
+
+            Mount-DbgDumpFile $dumpPath
+            $Debugger.IsLive | Should Be $false
+
+            [MS.Dbg.DbgShellTestHooks]::CompareDumpReaderWithDebugger( $Debugger, $dumpPath, 10000, 42 ) | Should Be $null
+
+            .kill
+        }
+        finally
+        {
+            if( $Debugger.Targets.Count -ne 0 )
+            {
+                .kill
+            }
+
+            if( Test-Path $dumpPath )
+            {
+                del $dumpPath
+            }
+        }
+    }
+
+    popd
+}
@@ -43,6 +43,23 @@ Describe "Formatting" {
 
             $s | Should Be $s2
         }
+
+        It "$cmd renders simple member scripts the same as other scripts" {
+
+            # "$_.Foo" gets evaluated directly, without a pipeline; the [object] cast
+            # makes the second one run the normal way.
+            $s = $ps1, $ps2 | & $cmd @{ Label = 'Calc'; Expression = { $_.PRA1PropName } } | Out-String
+            $s2 = $ps1, $ps2 | & $cmd @{ Label = 'Calc'; Expression = { [object] $_.PRA1PropName } } | Out-String
+
+            $s.Contains( 'ps2_pra1val' ) | Should Be $true
+            $s | Should Be $s2
+
+            # And when the property is missing (on $ps2):
+            $s = $ps1, $ps2 | & $cmd @{ Label = 'Calc'; Expression = { $_.PRA2 } } | Out-String
+            $s2 = $ps1, $ps2 | & $cmd @{ Label = 'Calc'; Expression = { [object] $_.PRA2 } } | Out-String
+
+            $s | Should Be $s2
+        }
     } # end foreach( $FmtCmds )
 
     # Some tests only really apply to (or are testable with) table views.
@@ -0,0 +1,77 @@
+
+Describe "ModuleLookup" {
+
+    pushd
+
+    It "finds the containing module by address" {
+
+        New-TestApp -TestApp TestNativeConsoleApp -Attach -TargetName testApp -HiddenTargetWindow
+
+        try
+        {
+            $target = $Debugger.GetCurrentTarget()
+            $target.Modules.Count | Should BeGreaterThan 0
+
+            foreach( $mod in $target.Modules )
+            {
+                foreach( $addr in @( $mod.BaseAddress,
+                                     ($mod.BaseAddress + ($mod.Size / 2)),
+                                     ($mod.BaseAddress + $mod.Size - 1) ) )
+                {
+                    $found = $Debugger.GetModuleByAddress( $addr )
+                    $found.BaseAddress | Should Be $mod.BaseAddress
+                    $found.Name | Should Be $mod.Name
+                }
+            }
+
+            # Same answers as dbgeng, after the cached module lists are thrown away.
+            $ntdll = $target.Modules | where Name -eq 'ntdll'
+            $Debugger.DiscardCachedModuleInfo()
+            $found = $Debugger.GetModuleByAddress( $ntdll.BaseAddress + 0x1000 )
+            $found.BaseAddress | Should Be $ntdll.BaseAddress
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    It "symbolizes batches of addresses the same as one at a time" {
+
+        New-TestApp -TestApp TestNativeConsoleApp -Attach -TargetName testApp -HiddenTargetWindow
+
+        try
+        {
+            $target = $Debugger.GetCurrentTarget()
+            [ulong[]] $addrs = @( $target.Modules | %{ $_.BaseAddress + 0x1000 ; $_.BaseAddress + 0x1010 } ) + @( 0x10 ) | sort
+
+            foreach( $pass in 1..2 ) # the second time around comes from the cache
+            {
+                $disps = $null
+                $names = $Debugger.TryGetNamesByOffsets( $addrs, [ref] $disps )
+                $names.Count | Should Be $addrs.Count
+
+                for( $i = 0; $i -lt $addrs.Count; $i++ )
+                {
+                    $name = $null
+                    $disp = 0
+                    if( $Debugger.TryGetNameByOffset( $addrs[ $i ], [ref] $name, [ref] $disp ) )
+                    {
+                        $names[ $i ] | Should Be $name
+                        $disps[ $i ] | Should Be $disp
+                    }
+                    else
+                    {
+                        $names[ $i ] | Should BeNullOrEmpty
+                    }
+                }
+            }
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    popd
+}
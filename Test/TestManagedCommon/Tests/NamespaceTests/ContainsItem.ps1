@@ -0,0 +1,33 @@
+
+$global:error.Clear()
+
+$TestContext = Get-TestContext
+
+[void] (mkdir Foo)
+[void] (mkdir Foo2)
+$x = New-Item Foo\x
+[string] $content1 = "hi"
+Set-Content Foo\x $content1
+
+# "Foo2" starts with "Foo", but Foo does not contain it, so this is allowed.
+Move-Item Foo Foo2
+Verify-AreEqual 0 ($global:error.Count)
+Verify-IsNull (dir Foo)
+Verify-AreEqual $content1 (Get-Content Foo2\Foo\x)
+Verify-AreEqual $true ((Get-Item Foo2\Foo\x).PSPath.EndsWith( 'Foo2\Foo\x' ))
+
+# The paths of everything under a renamed item change too.
+Rename-Item Foo2 Bar
+Verify-AreEqual 0 ($global:error.Count)
+Verify-IsNull (dir Foo2*)
+Verify-AreEqual $content1 (Get-Content Bar\Foo\x)
+Verify-AreEqual $true ((Get-Item Bar\Foo\x).PSPath.EndsWith( 'Bar\Foo\x' ))
+
+#
+# Let's test some things that should fail.
+#
+Move-Item Bar Bar\Foo -ErrorAction SilentlyContinue  # so that we don't see scary red stuff in the output
+Verify-AreEqual 1 ($global:error.Count)
+$global:error.Clear()
+
+Verify-AreEqual 0 ($global:error.Count)
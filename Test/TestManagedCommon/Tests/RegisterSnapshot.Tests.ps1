@@ -0,0 +1,42 @@
+
+Describe "RegisterSnapshot" {
+
+    pushd
+
+    It "leaves the current thread and frame alone" {
+
+        New-TestApp -TestApp TestNativeConsoleApp -Attach -TargetName testApp -HiddenTargetWindow
+
+        try
+        {
+            # Not the thread or frame that dbgeng would end up on after visiting every
+            # thread (the last thread, frame 0).
+            Switch-DbgUModeThreadInfo -DebuggerId 0 | Out-Null
+            Set-DbgStackFrame 1 | Out-Null
+
+            $threadBefore = $Debugger.GetCurrentThread().DebuggerId
+            $frameBefore = $Debugger.GetCurrentScopeFrame().FrameNumber
+            $frameBefore | Should Be 1
+
+            $snap = Get-DbgRegisterSet -AllThreads
+            $snap.Threads.Count | Should BeGreaterThan 1
+            $snap.Threads.Count | Should Be (Get-DbgUModeThreadInfo).Count
+
+            $Debugger.GetCurrentThread().DebuggerId | Should Be $threadBefore
+            $Debugger.GetCurrentScopeFrame().FrameNumber | Should Be $frameBefore
+
+            # And switching to another thread (and back) still works.
+            $lastId = $snap.Threads[ $snap.Threads.Count - 1 ].DbgEngId
+            Switch-DbgUModeThreadInfo -DebuggerId $lastId | Out-Null
+            $Debugger.GetCurrentThread().DebuggerId | Should Be $lastId
+            Switch-DbgUModeThreadInfo -DebuggerId $threadBefore | Out-Null
+            $Debugger.GetCurrentThread().DebuggerId | Should Be $threadBefore
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    popd
+}
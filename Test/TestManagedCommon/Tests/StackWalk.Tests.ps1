@@ -0,0 +1,67 @@
+
+Describe "StackWalk" {
+
+    pushd
+
+    function FrameKeys( $frames )
+    {
+        return ($frames | %{ '{0:x}/{1:x}' -f $_.InstructionPointer, $_.StackPointer }) -join ' '
+    }
+
+    It "streams the same frames that Frames gets" {
+
+        New-TestApp -TestApp TestNativeConsoleApp -SkipInitialBreakpoint -Arg 'deepStack 300' -HiddenTargetWindow
+
+        try
+        {
+            $thread = Get-DbgUModeThreadInfo -Current
+            $all = [MS.Dbg.DbgShellTestHooks]::NewStackInfo( $thread, 0 ).Frames
+            $all.Count | Should BeGreaterThan 300
+            $allKeys = FrameKeys $all
+
+            # The whole stack, streamed: a first chunk, then the rest.
+            $streamed = @( [MS.Dbg.DbgShellTestHooks]::NewStackInfo( $thread, 0 ).EnumerateStackFrames() )
+            $streamed.Count | Should Be $all.Count
+            FrameKeys $streamed | Should Be $allKeys
+
+            # With a frame limit, smaller than, the same as, and bigger than the first
+            # chunk.
+            foreach( $max in @( 5, 16, 17, 100 ) )
+            {
+                $expected = FrameKeys $all[ 0..($max - 1) ]
+
+                $capped = [MS.Dbg.DbgShellTestHooks]::NewStackInfo( $thread, $max ).Frames
+                $capped.Count | Should Be $max
+                FrameKeys $capped | Should Be $expected
+
+                $streamed = @( [MS.Dbg.DbgShellTestHooks]::NewStackInfo( $thread, $max ).EnumerateStackFrames() )
+                $streamed.Count | Should Be $max
+                FrameKeys $streamed | Should Be $expected
+            }
+
+            # Stopping early (within the first chunk, and past it), then enumerating
+            # again, which has to walk again.
+            foreach( $first in @( 3, 20 ) )
+            {
+                $stack = [MS.Dbg.DbgShellTestHooks]::NewStackInfo( $thread, 0 )
+                $some = @( $stack.EnumerateStackFrames() | select -First $first )
+                $some.Count | Should Be $first
+                FrameKeys $some | Should Be (FrameKeys $all[ 0..($first - 1) ])
+
+                $streamed = @( $stack.EnumerateStackFrames() )
+                $streamed.Count | Should Be $all.Count
+                FrameKeys $streamed | Should Be $allKeys
+            }
+
+            # And through Get-DbgStack.
+            (Get-DbgStack -MaxFrameCount 10).Frames.Count | Should Be 10
+            (Get-DbgStack).Frames.Count | Should Be $all.Count
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    popd
+}
@@ -375,6 +375,11 @@ Describe "StlTypeConversion" {
         $gv['2'][0] | Should Be "zz"
     }
 
+    It "retries a lazily-populated dictionary whose population failed" {
+
+        [MS.Dbg.DbgShellTestHooks]::CheckPopulateFailureRecovery() | Should BeNullOrEmpty
+    }
+
     It "can handle uniquePtr" {
 
         $g = Get-DbgSymbol TestNativeConsoleApp!g_uniquePtr
@@ -401,6 +406,9 @@ Describe "StlTypeConversion" {
             for( [int] $i = 0; $i -lt 22; $i++ )
             {
                 (New-Object 'System.String' -Arg @( ([char] 'a'), $i )) | Should Be $gv[ $i ]
+
+                # Short or long, the built-in converter gives back a plain string.
+                $gv[ $i ] -is [string] | Should Be $true
             }
         }
     }
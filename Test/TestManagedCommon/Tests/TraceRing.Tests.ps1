@@ -0,0 +1,38 @@
+
+Describe "TraceRing" {
+
+    pushd
+
+    It "shows recent trace ring records, in order, with Get-DbgShellLog -Recent" {
+
+        $tag = [guid]::NewGuid().ToString()
+
+        $enabled = [MS.Dbg.DbgShellTestHooks]::TraceThroughRing( $tag, 1 )
+        for( $i = 2; $i -le 4; $i++ )
+        {
+            $null = [MS.Dbg.DbgShellTestHooks]::TraceThroughRing( $tag, $i )
+        }
+
+        $lines = @( Get-DbgShellLog -Recent | where { $_.Contains( $tag ) } )
+
+        if( !$enabled )
+        {
+            # The "UseTraceRing" registry value turned it off; everything went
+            # straight to the log, and there's nothing in the rings.
+            $lines.Count | Should Be 0
+            return
+        }
+
+        $lines.Count | Should Be 4
+        for( $i = 0; $i -lt 4; $i++ )
+        {
+            $lines[ $i ].EndsWith( "DbgShellTestHooks: $tag ($($i + 1))" ) | Should Be $true
+        }
+
+        # -Recent doesn't drain anything (and the ring keeps records after they are
+        # drained, until they are overwritten), so they are all still there.
+        @( Get-DbgShellLog -Recent | where { $_.Contains( $tag ) } ).Count | Should Be 4
+    }
+
+    popd
+}
@@ -0,0 +1,71 @@
+
+Describe "TypeLayoutDiskCache" {
+
+    pushd
+
+    $cacheDir = "$($env:temp)\DbgShellTestTypeCache"
+
+    function CleanCacheDir()
+    {
+        if( !(Test-Path $cacheDir) )
+        {
+            $null = mkdir $cacheDir
+        }
+        else
+        {
+            del "$($cacheDir)\*"
+        }
+    }
+
+    It "stores static member addresses relative to the module base" {
+
+        CleanCacheDir
+        try
+        {
+            # Saved with the module at one base, loaded with it at another:
+            $addr = [MS.Dbg.DbgShellTestHooks]::RoundTripStaticMemberAddress( $cacheDir,
+                                                                                0x7ff612341234,
+                                                                                0x7ff612340000,
+                                                                                0x7ff798760000 )
+            $addr | Should Be 0x7ff798761234
+
+            # Same base:
+            $addr = [MS.Dbg.DbgShellTestHooks]::RoundTripStaticMemberAddress( $cacheDir,
+                                                                                0x00401234,
+                                                                                0x00400000,
+                                                                                0x00400000 )
+            $addr | Should Be 0x00401234
+
+            # No address (not a static member) stays that way:
+            $addr = [MS.Dbg.DbgShellTestHooks]::RoundTripStaticMemberAddress( $cacheDir,
+                                                                                0,
+                                                                                0x7ff612340000,
+                                                                                0x7ff798760000 )
+            $addr | Should Be 0
+        }
+        finally
+        {
+            CleanCacheDir
+        }
+    }
+
+    It "ignores damaged cache files" {
+
+        CleanCacheDir
+        try
+        {
+            [MS.Dbg.DbgShellTestHooks]::OpenDamagedTypeCacheFile( $cacheDir, 'None' ) | Should Be 2
+
+            foreach( $damage in @( 'Truncate', 'BadOffset', 'BadLength', 'Unsorted' ) )
+            {
+                [MS.Dbg.DbgShellTestHooks]::OpenDamagedTypeCacheFile( $cacheDir, $damage ) | Should Be 0
+            }
+        }
+        finally
+        {
+            CleanCacheDir
+        }
+    }
+
+    popd
+}
@@ -0,0 +1,75 @@
+
+Describe "X86Decoder" {
+
+    pushd
+
+    It "decodes instruction lengths and control flow" {
+
+        # call rel32 (x64 and x86: the target is relative to the next instruction)
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0xe8, 0x10, 0, 0, 0 ), 0x1000, $true ) |
+            Should Be '5 Call 0x1015'
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0xe8, 0xfb, 0xff, 0xff, 0xff ), 0x1000, $false ) |
+            Should Be '5 Call 0x1000'
+
+        # call rax
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0xff, 0xd0 ), 0x1000, $true ) |
+            Should Be '2 CallIndirect'
+
+        # call qword ptr [rip+1000h] (x64), call dword ptr [00002000] (x86)
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0xff, 0x15, 0, 0x10, 0, 0 ), 0x1000, $true ) |
+            Should Be '6 CallIndirect [0x2006]'
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0xff, 0x15, 0, 0x20, 0, 0 ), 0x1000, $false ) |
+            Should Be '6 CallIndirect [0x2000]'
+
+        # ret; je +2; mov rbp,rsp
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0xc3 ), 0x1000, $true ) |
+            Should Be '1 Return'
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0x74, 0x02 ), 0x1000, $true ) |
+            Should Be '2 ConditionalJump 0x1004'
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0x48, 0x89, 0xe5 ), 0x1000, $true ) |
+            Should Be '3 None'
+
+        # Truncated:
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0x0f ), 0x1000, $true ) |
+            Should Be $null
+        [MS.Dbg.DbgShellTestHooks]::DecodeX86Instruction( [byte[]] @( 0xe8, 0x10, 0, 0 ), 0x1000, $true ) |
+            Should Be $null
+    }
+
+    It "finds the call before a return address" {
+
+        [MS.Dbg.DbgShellTestHooks]::FindX86CallBefore( [byte[]] @( 0x90, 0x90, 0xe8, 0x10, 0, 0, 0 ), 0x1007, $true ) |
+            Should Be '0x1002: 5 Call 0x1017'
+
+        [MS.Dbg.DbgShellTestHooks]::FindX86CallBefore( [byte[]] @( 0x90, 0x48, 0x8b, 0xc1, 0xff, 0xd0 ), 0x1006, $true ) |
+            Should Be '0x1004: 2 CallIndirect'
+
+        [MS.Dbg.DbgShellTestHooks]::FindX86CallBefore( [byte[]] @( 0xff, 0x15, 0, 0x10, 0, 0 ), 0x1006, $true ) |
+            Should Be '0x1000: 6 CallIndirect [0x2006]'
+
+        # The last two bytes of this direct call's displacement are also "call rax";
+        # the direct call is the one we want.
+        [MS.Dbg.DbgShellTestHooks]::FindX86CallBefore( [byte[]] @( 0x90, 0x90, 0xe8, 0x11, 0x22, 0xff, 0xd0 ), 0x401007, $false ) |
+            Should Be '0x401002: 5 Call 0xd13f3218'
+
+        [MS.Dbg.DbgShellTestHooks]::FindX86CallBefore( [byte[]] @( 0x90, 0x90, 0x90 ), 0x1003, $true ) |
+            Should Be $null
+    }
+
+    It "agrees with dbgeng about real code" {
+
+        New-TestApp -TestApp TestNativeConsoleApp -Attach -TargetName testApp -HiddenTargetWindow
+
+        try
+        {
+            $mod = Get-DbgModuleInfo TestNativeConsoleApp
+            [MS.Dbg.DbgShellTestHooks]::CompareX86DecoderWithDbgEng( $Debugger, $mod, 2000 ) | Should Be $null
+        }
+        finally
+        {
+            .kill
+        }
+    }
+
+    popd
+}
@@ -31,8 +31,17 @@ public class ClassThatContainsFoo
             public string ClassString;
         }
 
+        // Both fields refer to the same array, which is still owned by this one object (for
+        // the retained size tests).
+        public class TwoRefsToOne
+        {
+            public byte[] First;
+            public byte[] Second;
+        }
+
         private static volatile ClassThatContainsFoo sm_ctcf;
         private static volatile object sm_boxedStruct;
+        private static volatile TwoRefsToOne sm_twoRefsToOne;
 
         static int Main( string[] args )
         {
@@ -46,6 +55,7 @@ static int Main( string[] args )
 
             sm_boxedStruct = new FooStruct() { MyInt = 0x42, MyString = "Hello", MyBool = true };
 
+            sm_twoRefsToOne = _MakeTwoRefsToOne();
 
             if( (null != args) &&
                 (0 != args.Length) &&
@@ -101,7 +111,7 @@ static int Main( string[] args )
                 } // end while( more instructions )
             }
 
-            if( (null != sm_ctcf) && (null != sm_boxedStruct) )
+            if( (null != sm_ctcf) && (null != sm_boxedStruct) && (null != sm_twoRefsToOne) )
                 Console.WriteLine( "Don't optimize those dudes out." );
 
             Console.WriteLine( "Exiting with rc: {0}", rc );
@@ -109,6 +119,14 @@ static int Main( string[] args )
         } // end Main()
 
 
+        // In its own method so that no local in Main keeps the array alive.
+        private static TwoRefsToOne _MakeTwoRefsToOne()
+        {
+            byte[] bytes = new byte[ 100 ];
+            return new TwoRefsToOne() { First = bytes, Second = bytes };
+        } // end _MakeTwoRefsToOne()
+
+
         private static Dictionary< string, Func< string[], int > > sm_routines = new Dictionary< string, Func< string[], int > >( StringComparer.OrdinalIgnoreCase )
         {
             { "nothing", (x) => { return 0; } },
@@ -873,6 +873,35 @@ int _TwoThreadGuTest( vector< wstring >& args )
 } // end _TwoThreadGuTest()
 
 
+// Recurses 'depth' times, then breaks into the debugger, for testing deep stacks.
+__declspec( noinline )
+int _DeepStackRecurse( int depth )
+{
+    if( depth <= 0 )
+    {
+        __debugbreak();
+        return 0;
+    }
+
+    // (Doing something with the result keeps it from being a tail call.)
+    return _DeepStackRecurse( depth - 1 ) + 1;
+}
+
+
+int _DeepStack( vector< wstring >& args )
+{
+    if( args.size() != 1 )
+    {
+        wprintf( L"Error: %s: How deep should the stack be?\n", __FUNCTIONW__ );
+        return -1;
+    }
+
+    int depth = _wtoi( args[ 0 ].c_str() );
+    wprintf( L"Recursing %i times.\n", depth );
+    return _DeepStackRecurse( depth );
+} // end _DeepStack()
+
+
 vector< int >       g_intVector;
 vector< wstring >   g_wsVector;
 vector< string >    g_sVector;
@@ -1345,6 +1374,7 @@ int wmain( int numArgs, wchar_t* args[] )
     rm[ L"callFoo" ]   = _CallFoo;
     rm[ L"callFFE0" ]  = _CallFFE0;
     rm[ L"lockCs" ]    = _LockCritSec;
+    rm[ L"deepStack" ] = _DeepStack;
 
     vector< wstring > routineArgs;
     Routine routine;